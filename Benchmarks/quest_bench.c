@@ -0,0 +1,941 @@
+// Distributed under MIT licence. See https://github.com/QuEST-Kit/QuEST/blob/master/LICENCE.txt for details
+
+/** @file
+ * A standalone micro-benchmark of the statevec_ and densmatr_ backend kernels.
+ *
+ * Every kernel in the table below is timed directly (bypassing validation and QASM
+ * recording) over a sweep of qubit counts, target and control positions and OpenMP
+ * thread counts. Each measurement is converted to an effective memory bandwidth using
+ * a simple traffic model (the number of state-sized passes over memory the kernel
+ * makes), and compared to a STREAM triad bandwidth measured with the same number of
+ * threads. Precision is fixed at compile time by QuEST_PREC, so is swept by rebuilding,
+ * e.g. via 'make clean bench PRECISION=1'.
+ *
+ * Results are written as CSV (default) or JSON, one record per measurement. Run with
+ * --help for the available options.
+ *
+ * Density-matrix kernels are timed only at even state-vector sizes N, upon N/2 represented
+ * qubits. The 'qubits' column of every record is N, so measures the same memory footprint
+ * for both types.
+ *
+ * The table covers every backend kernel which makes whole passes over the state, except:
+ * - creation, destruction, initialisation, and the setting, getting and reporting of amplitudes
+ * - the conjugated variants (e.g. statevec_pauliYConj), which are the same kernels
+ * - measurement (which draws random outcomes), though its collapse is timed
+ * - the lazy global-factor bookkeeping, which touches no amplitudes
+ * - densmatr_calcTotalProb, densmatr_calcProbOfOutcome and densmatr_calcExpecDiagonalOp,
+ *   which read only the diagonal so are not bandwidth bound
+ * - composite routines (like statevec_applyTrotterCircuit and statevec_calcGroundState)
+ *   which are sequences of the kernels in the table
+ */
+
+/* clock_gettime is hidden by -std=c99 */
+#ifdef __linux__
+    #define _POSIX_C_SOURCE 200809L
+#endif
+
+# include "QuEST.h"
+# include "QuEST_internal.h"
+# include "QuEST_precision.h"
+
+# include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
+# include <math.h>
+
+# ifdef _OPENMP
+# include <omp.h>
+# elif defined(_WIN32)
+# include <windows.h>
+# else
+# include <time.h>
+# endif
+
+# define MAX_LIST_LEN 64
+# define MAX_TRIALS 101
+# define MAX_BATCH_REPS (1LL << 30)
+
+/* strength of the decoherence kernels, kept tiny so that repeated application within a
+ * batch never decays the off-diagonal elements into (very slow) denormals
+ */
+# define NOISE_PROB 1E-6
+# define ANGLE 0.3
+
+/** The kinds of additional qureg a kernel is passed beside the one it modifies */
+enum benchOther {OTHER_NONE, OTHER_SAME, OTHER_PURE};
+
+typedef struct {
+    const char* name;
+    int isDensity;
+    //! Whether the kernel acts upon a second qubit (a control, or second target)
+    int usesControl;
+    enum benchOther other;
+    //! Memory traffic of a single call, in multiples of the state size
+    double traffic;
+    void (*apply)(Qureg qureg, Qureg other, int target, int control);
+} BenchKernel;
+
+typedef struct {
+    int minQubits;
+    int maxQubits;
+    int targets[MAX_LIST_LEN];
+    int numTargets;             // -1 for all
+    int controls[MAX_LIST_LEN];
+    int numControls;            // -1 for all, 0 for the extremal qubits
+    int threads[MAX_LIST_LEN];
+    int numThreads;
+    const char* kernels[MAX_LIST_LEN];
+    int numKernels;             // 0 for all
+    int numTrials;
+    double batchTime;
+    int streamPower;
+    int isJSON;
+    FILE* out;
+} BenchSettings;
+
+typedef struct {
+    long long int reps;
+    double best;
+    double median;
+} BenchTiming;
+
+
+/*
+ * kernel operands, populated once by initOperands
+ */
+
+static ComplexMatrix2 bench_u2;
+static ComplexMatrix4 bench_u4;
+static ComplexMatrixN bench_uN;
+static ComplexMatrixN bench_u1N;
+static ComplexMatrix2 bench_kraus[2];
+static ComplexMatrix4 bench_kraus4[2];
+static ComplexMatrixN bench_krausN[2];
+static Complex bench_alpha, bench_beta;
+
+/* the Pauli sum X_t X_c + Z_t Z_c, and a permutation swapping qubits t and c, over at most 64 qubits */
+static enum pauliOpType bench_codes[2 * 64];
+static qreal bench_coeffs[2] = {ANGLE, ANGLE};
+static int bench_perm[64];
+
+/* diagonal operators (of unit-modulus elements) matching the last state-vector and 
+ * density-matrix sizes, created when first needed
+ */
+static QuESTEnv bench_env;
+static DiagonalOp bench_diags[2];
+static int bench_diagQubits[2] = {0, 0};
+
+/* results of the calc kernels are accumulated here so no call is discarded */
+static volatile qreal bench_sink;
+
+static void initOperands(void) {
+
+    // a fixed, arbitrary single-qubit unitary
+    qreal c = cos(ANGLE), s = sin(ANGLE);
+    bench_alpha.real = c; bench_alpha.imag = 0;
+    bench_beta.real = 0;  bench_beta.imag = s;
+    bench_u2 = (ComplexMatrix2) {
+        .real = {{c, 0}, {0, c}},
+        .imag = {{0, s}, {s, 0}}};
+
+    // and its tensor square, as a two-qubit unitary
+    bench_u4 = (ComplexMatrix4) {.real = {{0}}, .imag = {{0}}};
+    for (int r=0; r<4; r++)
+        for (int k=0; k<4; k++) {
+            qreal ar = bench_u2.real[r/2][k/2], ai = bench_u2.imag[r/2][k/2];
+            qreal br = bench_u2.real[r%2][k%2], bi = bench_u2.imag[r%2][k%2];
+            bench_u4.real[r][k] = ar*br - ai*bi;
+            bench_u4.imag[r][k] = ar*bi + ai*br;
+        }
+
+    bench_uN = createComplexMatrixN(2);
+    for (int r=0; r<4; r++)
+        for (int k=0; k<4; k++) {
+            bench_uN.real[r][k] = bench_u4.real[r][k];
+            bench_uN.imag[r][k] = bench_u4.imag[r][k];
+        }
+
+    bench_u1N = createComplexMatrixN(1);
+    for (int r=0; r<2; r++)
+        for (int k=0; k<2; k++) {
+            bench_u1N.real[r][k] = bench_u2.real[r][k];
+            bench_u1N.imag[r][k] = bench_u2.imag[r][k];
+        }
+
+    // a weak dephasing channel
+    qreal k0 = sqrt(1 - NOISE_PROB), k1 = sqrt(NOISE_PROB);
+    bench_kraus[0] = (ComplexMatrix2) {.real = {{k0, 0}, {0, k0}}, .imag = {{0}}};
+    bench_kraus[1] = (ComplexMatrix2) {.real = {{k1, 0}, {0, -k1}}, .imag = {{0}}};
+
+    // and a weak two-qubit (ZZ) dephasing channel, as fixed and as general Kraus operators
+    for (int i=0; i<2; i++) {
+        bench_kraus4[i] = (ComplexMatrix4) {.real = {{0}}, .imag = {{0}}};
+        bench_krausN[i] = createComplexMatrixN(2);
+    }
+    for (int r=0; r<4; r++) {
+        qreal parity = (r == 0 || r == 3)? 1 : -1;
+        bench_kraus4[0].real[r][r] = bench_krausN[0].real[r][r] = k0;
+        bench_kraus4[1].real[r][r] = bench_krausN[1].real[r][r] = k1 * parity;
+    }
+}
+
+static void destroyOperands(void) {
+    destroyComplexMatrixN(bench_uN);
+    destroyComplexMatrixN(bench_u1N);
+    for (int i=0; i<2; i++)
+        destroyComplexMatrixN(bench_krausN[i]);
+    for (int i=0; i<2; i++)
+        if (bench_diagQubits[i] > 0)
+            agnostic_destroyDiagonalOp(bench_diags[i]);
+}
+
+/* Populates bench_codes with the Pauli sum X_t X_c + Z_t Z_c upon numQubits */
+static void setPauliSumCodes(int numQubits, int t, int c) {
+    for (int i=0; i < 2*numQubits; i++)
+        bench_codes[i] = PAULI_I;
+    bench_codes[t] = bench_codes[c] = PAULI_X;
+    bench_codes[numQubits + t] = bench_codes[numQubits + c] = PAULI_Z;
+}
+
+/* Populates bench_perm with the permutation of numQubits which swaps qubits t and c */
+static void setSwapPerm(int numQubits, int t, int c) {
+    for (int q=0; q < numQubits; q++)
+        bench_perm[q] = q;
+    bench_perm[t] = c;
+    bench_perm[c] = t;
+}
+
+static DiagonalOp getDiagonalOp(Qureg qureg) {
+    int isDensity = qureg.isDensityMatrix;
+    int numQubits = qureg.numQubitsRepresented;
+    if (bench_diagQubits[isDensity] == numQubits)
+        return bench_diags[isDensity];
+
+    if (bench_diagQubits[isDensity] > 0)
+        agnostic_destroyDiagonalOp(bench_diags[isDensity]);
+    DiagonalOp op = agnostic_createDiagonalOp(numQubits, bench_env);
+    for (long long int i=0; i < op.numElemsPerChunk; i++) {
+        op.real[i] = cos(ANGLE * i);
+        op.imag[i] = sin(ANGLE * i);
+    }
+    agnostic_syncDiagonalOp(op);
+
+    bench_diags[isDensity] = op;
+    bench_diagQubits[isDensity] = numQubits;
+    return op;
+}
+
+
+/*
+ * kernel adapters, presenting every backend function with a common signature
+ */
+
+static void sv_hadamard(Qureg q, Qureg o, int t, int c) { statevec_hadamard(q, t); }
+static void sv_pauliX(Qureg q, Qureg o, int t, int c) { statevec_pauliX(q, t); }
+static void sv_pauliY(Qureg q, Qureg o, int t, int c) { statevec_pauliY(q, t); }
+static void sv_pauliZ(Qureg q, Qureg o, int t, int c) { statevec_pauliZ(q, t); }
+static void sv_sGate(Qureg q, Qureg o, int t, int c) { statevec_sGate(q, t); }
+static void sv_tGate(Qureg q, Qureg o, int t, int c) { statevec_tGate(q, t); }
+static void sv_phaseShift(Qureg q, Qureg o, int t, int c) { statevec_phaseShift(q, t, ANGLE); }
+static void sv_rotateX(Qureg q, Qureg o, int t, int c) { statevec_rotateX(q, t, ANGLE); }
+static void sv_rotateY(Qureg q, Qureg o, int t, int c) { statevec_rotateY(q, t, ANGLE); }
+static void sv_rotateZ(Qureg q, Qureg o, int t, int c) { statevec_rotateZ(q, t, ANGLE); }
+static void sv_compactUnitary(Qureg q, Qureg o, int t, int c) {
+    statevec_compactUnitary(q, t, bench_alpha, bench_beta); }
+static void sv_unitary(Qureg q, Qureg o, int t, int c) { statevec_unitary(q, t, bench_u2); }
+static void sv_controlledNot(Qureg q, Qureg o, int t, int c) { statevec_controlledNot(q, c, t); }
+static void sv_controlledPauliY(Qureg q, Qureg o, int t, int c) { statevec_controlledPauliY(q, c, t); }
+static void sv_controlledPhaseFlip(Qureg q, Qureg o, int t, int c) {
+    statevec_controlledPhaseFlip(q, c, t); }
+static void sv_controlledPhaseShift(Qureg q, Qureg o, int t, int c) {
+    statevec_controlledPhaseShift(q, c, t, ANGLE); }
+static void sv_controlledRotateX(Qureg q, Qureg o, int t, int c) {
+    statevec_controlledRotateX(q, c, t, ANGLE); }
+static void sv_controlledRotateY(Qureg q, Qureg o, int t, int c) {
+    statevec_controlledRotateY(q, c, t, ANGLE); }
+static void sv_controlledRotateZ(Qureg q, Qureg o, int t, int c) {
+    statevec_controlledRotateZ(q, c, t, ANGLE); }
+static void sv_controlledCompactUnitary(Qureg q, Qureg o, int t, int c) {
+    statevec_controlledCompactUnitary(q, c, t, bench_alpha, bench_beta); }
+static void sv_controlledUnitary(Qureg q, Qureg o, int t, int c) {
+    statevec_controlledUnitary(q, c, t, bench_u2); }
+static void sv_multiControlledUnitary(Qureg q, Qureg o, int t, int c) {
+    statevec_multiControlledUnitary(q, 1LL << c, 0, t, bench_u2); }
+static void sv_swapQubitAmps(Qureg q, Qureg o, int t, int c) { statevec_swapQubitAmps(q, t, c); }
+static void sv_sqrtSwapGate(Qureg q, Qureg o, int t, int c) { statevec_sqrtSwapGate(q, t, c); }
+static void sv_twoQubitUnitary(Qureg q, Qureg o, int t, int c) {
+    statevec_twoQubitUnitary(q, t, c, bench_u4); }
+static void sv_multiQubitUnitary(Qureg q, Qureg o, int t, int c) {
+    int targs[] = {t, c};
+    statevec_multiQubitUnitary(q, targs, 2, bench_uN); }
+static void sv_multiRotateZ(Qureg q, Qureg o, int t, int c) {
+    statevec_multiRotateZ(q, (1LL << t) | (1LL << c), ANGLE); }
+static void sv_calcTotalProb(Qureg q, Qureg o, int t, int c) {
+    bench_sink += statevec_calcTotalProb(q); }
+static void sv_calcProbOfOutcome(Qureg q, Qureg o, int t, int c) {
+    bench_sink += statevec_calcProbOfOutcome(q, t, 0); }
+static void sv_calcInnerProduct(Qureg q, Qureg o, int t, int c) {
+    bench_sink += statevec_calcInnerProduct(q, o).real; }
+static void sv_calcFidelity(Qureg q, Qureg o, int t, int c) {
+    bench_sink += statevec_calcFidelity(q, o); }
+static void sv_cloneQureg(Qureg q, Qureg o, int t, int c) { statevec_cloneQureg(q, o); }
+static void sv_multiRotatePauli(Qureg q, Qureg o, int t, int c) {
+    int targs[] = {t, c};
+    enum pauliOpType paulis[] = {PAULI_X, PAULI_Y};
+    statevec_multiRotatePauli(q, targs, paulis, 2, ANGLE, 0); }
+static void sv_multiControlledMultiQubitUnitary(Qureg q, Qureg o, int t, int c) {
+    statevec_multiControlledMultiQubitUnitary(q, 1LL << c, &t, 1, bench_u1N); }
+static void sv_applyQFT(Qureg q, Qureg o, int t, int c) {
+    int qubits[] = {t, c};
+    statevec_applyQFT(q, qubits, 2, 0); }
+static void sv_applyPhaseFunc(Qureg q, Qureg o, int t, int c) {
+    int qubits[] = {t, c};
+    qreal coeff = ANGLE, exponent = 1;
+    statevec_applyPhaseFunc(q, qubits, 2, UNSIGNED, &coeff, &exponent, 1, NULL, NULL, 0, 0); }
+static void sv_applyPhaseFuncOverrides(Qureg q, Qureg o, int t, int c) {
+    int qubits[] = {t, c};
+    qreal coeff = ANGLE, exponent = 1, phase = -ANGLE;
+    long long int ind = 0;
+    statevec_applyPhaseFuncOverrides(q, qubits, 2, UNSIGNED, &coeff, &exponent, 1, &ind, &phase, 1, 0); }
+static void sv_applyPhaseFuncTable(Qureg q, Qureg o, int t, int c) {
+    int qubits[] = {t, c};
+    qreal phases[] = {0, ANGLE, 2*ANGLE, 3*ANGLE};
+    statevec_applyPhaseFuncTable(q, qubits, 2, phases, 0); }
+static void sv_applyPauliSum(Qureg q, Qureg o, int t, int c) {
+    setPauliSumCodes(q.numQubitsRepresented, t, c);
+    statevec_applyPauliSum(o, bench_codes, bench_coeffs, 2, q); }
+static void sv_applyDiagonalOp(Qureg q, Qureg o, int t, int c) {
+    statevec_applyDiagonalOp(q, getDiagonalOp(q)); }
+static void sv_calcExpecDiagonalOp(Qureg q, Qureg o, int t, int c) {
+    bench_sink += statevec_calcExpecDiagonalOp(q, getDiagonalOp(q)).real; }
+static void sv_permuteQubits(Qureg q, Qureg o, int t, int c) {
+    setSwapPerm(q.numQubitsRepresented, t, c);
+    statevec_permuteQubits(q, bench_perm); }
+static void sv_calcInnerProductsMatrix(Qureg q, Qureg o, int t, int c) {
+    Qureg quregs[] = {q, o};
+    qreal matrRe[4], matrIm[4];
+    statevec_calcInnerProductsMatrix(quregs, 2, matrRe, matrIm);
+    bench_sink += matrRe[1]; }
+static void sv_collapseToKnownProbOutcome(Qureg q, Qureg o, int t, int c) {
+    // the outcome has probability 1 after the first call, which keeps the state normalised
+    statevec_collapseToKnownProbOutcome(q, t, 0, 1); }
+static void sv_setWeightedQureg(Qureg q, Qureg o, int t, int c) {
+    Complex facOther = {.real = NOISE_PROB, .imag = 0};
+    Complex facZero = {.real = 0, .imag = 0};
+    Complex facOut = {.real = 1 - NOISE_PROB, .imag = 0};
+    statevec_setWeightedQureg(facOther, o, facZero, q, facOut, q); }
+
+static void dm_mixDephasing(Qureg q, Qureg o, int t, int c) {
+    densmatr_mixDephasing(q, t, 2*NOISE_PROB); }
+static void dm_mixTwoQubitDephasing(Qureg q, Qureg o, int t, int c) {
+    densmatr_mixTwoQubitDephasing(q, t, c, 4*NOISE_PROB/3); }
+static void dm_mixDepolarising(Qureg q, Qureg o, int t, int c) {
+    densmatr_mixDepolarising(q, t, 4*NOISE_PROB/3); }
+static void dm_mixTwoQubitDepolarising(Qureg q, Qureg o, int t, int c) {
+    densmatr_mixTwoQubitDepolarising(q, t, c, 16*NOISE_PROB/15); }
+static void dm_mixDamping(Qureg q, Qureg o, int t, int c) { densmatr_mixDamping(q, t, NOISE_PROB); }
+static void dm_mixPauli(Qureg q, Qureg o, int t, int c) {
+    densmatr_mixPauli(q, t, NOISE_PROB, NOISE_PROB, NOISE_PROB); }
+static void dm_mixKrausMap(Qureg q, Qureg o, int t, int c) { densmatr_mixKrausMap(q, t, bench_kraus, 2); }
+static void dm_mixTwoQubitKrausMap(Qureg q, Qureg o, int t, int c) {
+    densmatr_mixTwoQubitKrausMap(q, t, c, bench_kraus4, 2); }
+static void dm_mixMultiQubitKrausMap(Qureg q, Qureg o, int t, int c) {
+    int targs[] = {t, c};
+    densmatr_mixMultiQubitKrausMap(q, targs, 2, bench_krausN, 2); }
+static void dm_mixDensityMatrix(Qureg q, Qureg o, int t, int c) {
+    densmatr_mixDensityMatrix(q, NOISE_PROB, o); }
+static void dm_collapseToKnownProbOutcome(Qureg q, Qureg o, int t, int c) {
+    densmatr_collapseToKnownProbOutcome(q, t, 0, 1); }
+static void dm_applyDiagonalOp(Qureg q, Qureg o, int t, int c) {
+    densmatr_applyDiagonalOp(q, getDiagonalOp(q)); }
+static void dm_permuteQubits(Qureg q, Qureg o, int t, int c) {
+    setSwapPerm(q.numQubitsRepresented, t, c);
+    densmatr_permuteQubits(q, bench_perm); }
+static void dm_calcPurity(Qureg q, Qureg o, int t, int c) { bench_sink += densmatr_calcPurity(q); }
+static void dm_calcInnerProduct(Qureg q, Qureg o, int t, int c) {
+    bench_sink += densmatr_calcInnerProduct(q, o); }
+static void dm_calcHilbertSchmidtDistance(Qureg q, Qureg o, int t, int c) {
+    bench_sink += densmatr_calcHilbertSchmidtDistance(q, o); }
+static void dm_calcFidelity(Qureg q, Qureg o, int t, int c) {
+    bench_sink += densmatr_calcFidelity(q, o); }
+static void dm_calcInnerProductsMatrix(Qureg q, Qureg o, int t, int c) {
+    Qureg quregs[] = {q, o};
+    qreal matr[4];
+    densmatr_calcInnerProductsMatrix(quregs, 2, matr);
+    bench_sink += matr[1]; }
+
+/* Traffic counts one pass for every amplitude read, and one for every amplitude written;
+ * e.g. a controlled gate reads and writes the half of the state with the control set.
+ * A state-sized DiagonalOp counts as a state, and permuteQubits first copies the state aside.
+ * applyPauliSum clears its output, then reads the input and updates the output once per
+ * distinct X/Y pattern (of which X_t X_c + Z_t Z_c has two).
+ */
+static const BenchKernel kernels[] = {
+    {"hadamard",                    0, 0, OTHER_NONE, 2,    sv_hadamard},
+    {"pauliX",                      0, 0, OTHER_NONE, 2,    sv_pauliX},
+    {"pauliY",                      0, 0, OTHER_NONE, 2,    sv_pauliY},
+    {"pauliZ",                      0, 0, OTHER_NONE, 1,    sv_pauliZ},
+    {"sGate",                       0, 0, OTHER_NONE, 1,    sv_sGate},
+    {"tGate",                       0, 0, OTHER_NONE, 1,    sv_tGate},
+    {"phaseShift",                  0, 0, OTHER_NONE, 1,    sv_phaseShift},
+    {"rotateX",                     0, 0, OTHER_NONE, 2,    sv_rotateX},
+    {"rotateY",                     0, 0, OTHER_NONE, 2,    sv_rotateY},
+    {"rotateZ",                     0, 0, OTHER_NONE, 2,    sv_rotateZ},
+    {"compactUnitary",              0, 0, OTHER_NONE, 2,    sv_compactUnitary},
+    {"unitary",                     0, 0, OTHER_NONE, 2,    sv_unitary},
+    {"controlledNot",               0, 1, OTHER_NONE, 1,    sv_controlledNot},
+    {"controlledPauliY",            0, 1, OTHER_NONE, 1,    sv_controlledPauliY},
+    {"controlledPhaseFlip",         0, 1, OTHER_NONE, 0.5,  sv_controlledPhaseFlip},
+    {"controlledPhaseShift",        0, 1, OTHER_NONE, 0.5,  sv_controlledPhaseShift},
+    {"controlledRotateX",           0, 1, OTHER_NONE, 1,    sv_controlledRotateX},
+    {"controlledRotateY",           0, 1, OTHER_NONE, 1,    sv_controlledRotateY},
+    {"controlledRotateZ",           0, 1, OTHER_NONE, 1,    sv_controlledRotateZ},
+    {"controlledCompactUnitary",    0, 1, OTHER_NONE, 1,    sv_controlledCompactUnitary},
+    {"controlledUnitary",           0, 1, OTHER_NONE, 1,    sv_controlledUnitary},
+    {"multiControlledUnitary",      0, 1, OTHER_NONE, 1,    sv_multiControlledUnitary},
+    {"swapQubitAmps",               0, 1, OTHER_NONE, 1,    sv_swapQubitAmps},
+    {"sqrtSwapGate",                0, 1, OTHER_NONE, 1,    sv_sqrtSwapGate},
+    {"twoQubitUnitary",             0, 1, OTHER_NONE, 2,    sv_twoQubitUnitary},
+    {"multiQubitUnitary",           0, 1, OTHER_NONE, 2,    sv_multiQubitUnitary},
+    {"multiRotateZ",                0, 1, OTHER_NONE, 2,    sv_multiRotateZ},
+    {"calcTotalProb",               0, 0, OTHER_NONE, 1,    sv_calcTotalProb},
+    {"calcProbOfOutcome",           0, 0, OTHER_NONE, 0.5,  sv_calcProbOfOutcome},
+    {"calcInnerProduct",            0, 0, OTHER_SAME, 2,    sv_calcInnerProduct},
+    {"calcFidelity",                0, 0, OTHER_SAME, 2,    sv_calcFidelity},
+    {"cloneQureg",                  0, 0, OTHER_SAME, 2,    sv_cloneQureg},
+    {"multiRotatePauli",            0, 1, OTHER_NONE, 2,    sv_multiRotatePauli},
+    {"multiControlledMultiQubitUnitary", 0, 1, OTHER_NONE, 1, sv_multiControlledMultiQubitUnitary},
+    {"applyQFT",                    0, 1, OTHER_NONE, 3,    sv_applyQFT},
+    {"applyPhaseFunc",              0, 1, OTHER_NONE, 2,    sv_applyPhaseFunc},
+    {"applyPhaseFuncOverrides",     0, 1, OTHER_NONE, 2,    sv_applyPhaseFuncOverrides},
+    {"applyPhaseFuncTable",         0, 1, OTHER_NONE, 2,    sv_applyPhaseFuncTable},
+    {"applyPauliSum",               0, 1, OTHER_SAME, 7,    sv_applyPauliSum},
+    {"applyDiagonalOp",             0, 0, OTHER_NONE, 3,    sv_applyDiagonalOp},
+    {"calcExpecDiagonalOp",         0, 0, OTHER_NONE, 2,    sv_calcExpecDiagonalOp},
+    {"permuteQubits",               0, 1, OTHER_NONE, 4,    sv_permuteQubits},
+    {"calcInnerProductsMatrix",     0, 0, OTHER_SAME, 2,    sv_calcInnerProductsMatrix},
+    {"collapseToKnownProbOutcome",  0, 0, OTHER_NONE, 1.5,  sv_collapseToKnownProbOutcome},
+    {"setWeightedQureg",            0, 0, OTHER_SAME, 3,    sv_setWeightedQureg},
+    {"mixDephasing",                1, 0, OTHER_NONE, 1,    dm_mixDephasing},
+    {"mixTwoQubitDephasing",        1, 1, OTHER_NONE, 1.5,  dm_mixTwoQubitDephasing},
+    {"mixDepolarising",             1, 0, OTHER_NONE, 2,    dm_mixDepolarising},
+    {"mixTwoQubitDepolarising",     1, 1, OTHER_NONE, 3.5,  dm_mixTwoQubitDepolarising},
+    {"mixDamping",                  1, 0, OTHER_NONE, 2,    dm_mixDamping},
+    {"mixPauli",                    1, 0, OTHER_NONE, 2,    dm_mixPauli},
+    {"mixKrausMap",                 1, 0, OTHER_NONE, 2,    dm_mixKrausMap},
+    {"mixTwoQubitKrausMap",         1, 1, OTHER_NONE, 2,    dm_mixTwoQubitKrausMap},
+    {"mixMultiQubitKrausMap",       1, 1, OTHER_NONE, 2,    dm_mixMultiQubitKrausMap},
+    {"mixDensityMatrix",            1, 0, OTHER_SAME, 3,    dm_mixDensityMatrix},
+    {"densCollapseToKnownProbOutcome", 1, 0, OTHER_NONE, 1.25, dm_collapseToKnownProbOutcome},
+    {"densApplyDiagonalOp",         1, 0, OTHER_NONE, 2,    dm_applyDiagonalOp},
+    {"densPermuteQubits",           1, 1, OTHER_NONE, 4,    dm_permuteQubits},
+    {"densCalcPurity",              1, 0, OTHER_NONE, 1,    dm_calcPurity},
+    {"densCalcInnerProduct",        1, 0, OTHER_SAME, 2,    dm_calcInnerProduct},
+    {"densCalcHilbertSchmidtDist",  1, 0, OTHER_SAME, 2,    dm_calcHilbertSchmidtDistance},
+    {"densCalcFidelity",            1, 0, OTHER_PURE, 1,    dm_calcFidelity},
+    {"densCalcInnerProductsMatrix", 1, 0, OTHER_SAME, 2,    dm_calcInnerProductsMatrix}
+};
+static const int numKernels = sizeof(kernels) / sizeof(*kernels);
+
+
+/*
+ * timing
+ */
+
+static double getWallTime(void) {
+# ifdef _OPENMP
+    return omp_get_wtime();
+# elif defined(_WIN32)
+    LARGE_INTEGER count, freq;
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&freq);
+    return count.QuadPart / (double) freq.QuadPart;
+# else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + 1E-9 * t.tv_nsec;
+# endif
+}
+
+static void setNumThreads(int numThreads) {
+# ifdef _OPENMP
+    omp_set_num_threads(numThreads);
+# endif
+}
+
+static int getMaxNumThreads(void) {
+# ifdef _OPENMP
+    return omp_get_max_threads();
+# else
+    return 1;
+# endif
+}
+
+static int compareDoubles(const void* a, const void* b) {
+    double x = *(const double*) a, y = *(const double*) b;
+    return (x > y) - (x < y);
+}
+
+static void resetQureg(Qureg qureg) {
+    if (qureg.isDensityMatrix)
+        densmatr_initPlusState(qureg);
+    else
+        statevec_initPlusState(qureg);
+}
+
+/** Times a single call of the kernel, as the best and median of numTrials batches, each
+ * running long enough to exceed batchTime. The qureg is restored to |+> before every batch.
+ */
+static BenchTiming timeKernel(
+    const BenchKernel* kernel, Qureg qureg, Qureg other, int target, int control,
+    BenchSettings* settings, QuESTEnv env
+) {
+    BenchTiming timing;
+    double times[MAX_TRIALS];
+
+    // warm up, and double the batch until it is long enough to time reliably
+    long long int reps = 1;
+    for (;;) {
+        resetQureg(qureg);
+        syncQuESTEnv(env);
+        double start = getWallTime();
+        for (long long int r=0; r<reps; r++)
+            kernel->apply(qureg, other, target, control);
+        syncQuESTEnv(env);
+        if (getWallTime() - start >= settings->batchTime || reps >= MAX_BATCH_REPS)
+            break;
+        reps *= 2;
+    }
+
+    for (int i=0; i<settings->numTrials; i++) {
+        resetQureg(qureg);
+        syncQuESTEnv(env);
+        double start = getWallTime();
+        for (long long int r=0; r<reps; r++)
+            kernel->apply(qureg, other, target, control);
+        syncQuESTEnv(env);
+        times[i] = (getWallTime() - start) / reps;
+    }
+
+    qsort(times, settings->numTrials, sizeof *times, compareDoubles);
+    timing.reps = reps;
+    timing.best = times[0];
+    timing.median = times[settings->numTrials/2];
+    return timing;
+}
+
+/** Measures the STREAM triad (a = b + s c) bandwidth, in GB/s, upon qreal arrays of
+ * 2^streamPower elements, as the best of numTrials passes.
+ */
+static double measureStreamBandwidth(BenchSettings* settings) {
+    long long int len = 1LL << settings->streamPower;
+    qreal* a = malloc(len * sizeof *a);
+    qreal* b = malloc(len * sizeof *b);
+    qreal* c = malloc(len * sizeof *c);
+    if (a == NULL || b == NULL || c == NULL) {
+        fprintf(stderr, "Could not allocate the STREAM arrays; try a smaller --stream-size\n");
+        exit(EXIT_FAILURE);
+    }
+    long long int i;
+
+    // first-touch the arrays with the same thread layout as the triad
+# ifdef _OPENMP
+# pragma omp parallel for schedule(static) default(none) shared(a,b,c,len) private(i)
+# endif
+    for (i=0; i<len; i++) {
+        a[i] = 0;
+        b[i] = 1;
+        c[i] = 2;
+    }
+
+    qreal scalar = 3;
+    double best = -1;
+    for (int t=0; t<settings->numTrials; t++) {
+        double start = getWallTime();
+# ifdef _OPENMP
+# pragma omp parallel for schedule(static) default(none) shared(a,b,c,len,scalar) private(i)
+# endif
+        for (i=0; i<len; i++)
+            a[i] = b[i] + scalar*c[i];
+        double dur = getWallTime() - start;
+        if (best < 0 || dur < best)
+            best = dur;
+    }
+    bench_sink += a[len/2];
+
+    free(a);
+    free(b);
+    free(c);
+    return 3. * len * sizeof(qreal) / best / 1E9;
+}
+
+
+/*
+ * output
+ */
+
+static int isFirstRecord = 1;
+
+static void writeHeader(BenchSettings* settings) {
+    if (settings->isJSON)
+        fprintf(settings->out,
+            "{\n\"precision\": %d,\n\"bytesPerReal\": %d,\n\"maxThreads\": %d,\n\"results\": [\n",
+            QuEST_PREC, (int) sizeof(qreal), getMaxNumThreads());
+    else
+        fprintf(settings->out,
+            "precision,threads,kernel,type,qubits,target,control,"
+            "reps,best_s,median_s,bytes,gbps,stream_gbps,stream_fraction\n");
+}
+
+static void writeFooter(BenchSettings* settings) {
+    if (settings->isJSON)
+        fprintf(settings->out, "\n]\n}\n");
+}
+
+/** Writes one measurement. A negative qubits marks a STREAM record, for which only
+ * the bandwidth is meaningful
+ */
+static void writeRecord(
+    BenchSettings* settings, int numThreads, const char* name, const char* type,
+    int numQubits, int target, int control, BenchTiming timing, double bytes, double streamGBps
+) {
+    double gbps = (numQubits < 0)? streamGBps : bytes / timing.best / 1E9;
+    double fraction = gbps / streamGBps;
+
+    if (settings->isJSON) {
+        fprintf(settings->out,
+            "%s{\"threads\": %d, \"kernel\": \"%s\", \"type\": \"%s\", \"qubits\": %d, "
+            "\"target\": %d, \"control\": %d, \"reps\": %lld, \"best_s\": %.6e, "
+            "\"median_s\": %.6e, \"bytes\": %.0f, \"gbps\": %.4f, \"stream_gbps\": %.4f, "
+            "\"stream_fraction\": %.4f}",
+            (isFirstRecord)? "" : ",\n", numThreads, name, type, numQubits, target, control,
+            timing.reps, timing.best, timing.median, bytes, gbps, streamGBps, fraction);
+    } else {
+        fprintf(settings->out,
+            "%d,%d,%s,%s,%d,%d,%d,%lld,%.6e,%.6e,%.0f,%.4f,%.4f,%.4f\n",
+            QuEST_PREC, numThreads, name, type, numQubits, target, control,
+            timing.reps, timing.best, timing.median, bytes, gbps, streamGBps, fraction);
+    }
+    isFirstRecord = 0;
+    fflush(settings->out);
+}
+
+
+/*
+ * sweep
+ */
+
+static int isKernelSelected(const BenchKernel* kernel, BenchSettings* settings) {
+    if (settings->numKernels == 0)
+        return 1;
+    for (int i=0; i<settings->numKernels; i++)
+        if (strcmp(settings->kernels[i], kernel->name) == 0)
+            return 1;
+    return 0;
+}
+
+/** Populates list with the qubit positions to sweep, given the user's choice in
+ * (choice, numChoice), where numChoice is -1 for all qubits and 0 for the extremal qubits
+ */
+static int getPositions(int* choice, int numChoice, int numQubits, int* list) {
+    int len = 0;
+    if (numChoice == -1)
+        for (int q=0; q<numQubits; q++)
+            list[len++] = q;
+    else if (numChoice == 0) {
+        list[len++] = 0;
+        if (numQubits > 1)
+            list[len++] = numQubits - 1;
+    }
+    else
+        for (int i=0; i<numChoice; i++)
+            if (choice[i] < numQubits)
+                list[len++] = choice[i];
+    return len;
+}
+
+static void benchmarkSize(int numStateQubits, int numThreads, double streamGBps, BenchSettings* settings, QuESTEnv env) {
+
+    // density kernels represent half as many qubits in the same memory
+    int hasDensity = (numStateQubits % 2 == 0);
+
+    // only create those quregs needed by the selected kernels
+    int needs[2][3] = {{0}};
+    int any[2] = {0};
+    for (int k=0; k<numKernels; k++)
+        if (isKernelSelected(&kernels[k], settings)) {
+            needs[kernels[k].isDensity][kernels[k].other] = 1;
+            any[kernels[k].isDensity] = 1;
+        }
+    if (!hasDensity)
+        any[1] = 0;
+
+    Qureg quregs[2], others[2][3];
+    if (any[0]) {
+        quregs[0] = createQureg(numStateQubits, env);
+        if (needs[0][OTHER_SAME]) {
+            others[0][OTHER_SAME] = createQureg(numStateQubits, env);
+            statevec_initPlusState(others[0][OTHER_SAME]);
+        }
+    }
+    if (any[1]) {
+        quregs[1] = createDensityQureg(numStateQubits/2, env);
+        if (needs[1][OTHER_SAME]) {
+            others[1][OTHER_SAME] = createDensityQureg(numStateQubits/2, env);
+            densmatr_initPlusState(others[1][OTHER_SAME]);
+        }
+        if (needs[1][OTHER_PURE]) {
+            others[1][OTHER_PURE] = createQureg(numStateQubits/2, env);
+            statevec_initPlusState(others[1][OTHER_PURE]);
+        }
+    }
+
+    int targets[MAX_LIST_LEN], controls[MAX_LIST_LEN];
+    for (int k=0; k<numKernels; k++) {
+        const BenchKernel* kernel = &kernels[k];
+        if (!isKernelSelected(kernel, settings) || !any[kernel->isDensity])
+            continue;
+
+        Qureg qureg = quregs[kernel->isDensity];
+        Qureg other = (kernel->other == OTHER_NONE)? qureg : others[kernel->isDensity][kernel->other];
+        int numQubits = qureg.numQubitsRepresented;
+        double bytes = kernel->traffic * qureg.numAmpsTotal * 2 * sizeof(qreal);
+        const char* type = (kernel->isDensity)? "densmatr" : "statevec";
+
+        int numTargs = getPositions(settings->targets, settings->numTargets, numQubits, targets);
+        for (int t=0; t<numTargs; t++) {
+
+            if (!kernel->usesControl) {
+                BenchTiming timing = timeKernel(kernel, qureg, other, targets[t], -1, settings, env);
+                writeRecord(settings, numThreads, kernel->name, type,
+                    numStateQubits, targets[t], -1, timing, bytes, streamGBps);
+                continue;
+            }
+
+            int numCtrls = getPositions(settings->controls, settings->numControls, numQubits, controls);
+            for (int c=0; c<numCtrls; c++) {
+                int control = controls[c];
+
+                // an extremal control coinciding with the target is moved to its neighbour
+                if (control == targets[t] && settings->numControls == 0)
+                    control += (control == 0)? 1 : -1;
+                if (control == targets[t] || control < 0 || control >= numQubits)
+                    continue;
+
+                BenchTiming timing = timeKernel(kernel, qureg, other, targets[t], control, settings, env);
+                writeRecord(settings, numThreads, kernel->name, type,
+                    numStateQubits, targets[t], control, timing, bytes, streamGBps);
+            }
+        }
+    }
+
+    if (any[0]) {
+        destroyQureg(quregs[0], env);
+        if (needs[0][OTHER_SAME])
+            destroyQureg(others[0][OTHER_SAME], env);
+    }
+    if (any[1]) {
+        destroyQureg(quregs[1], env);
+        if (needs[1][OTHER_SAME])
+            destroyQureg(others[1][OTHER_SAME], env);
+        if (needs[1][OTHER_PURE])
+            destroyQureg(others[1][OTHER_PURE], env);
+    }
+}
+
+
+/*
+ * command line
+ */
+
+static void printUsage(const char* exe) {
+    printf(
+        "Usage: %s [options]\n"
+        "  --min-qubits=N       smallest state-vector size to sweep (default 10)\n"
+        "  --max-qubits=N       largest state-vector size to sweep (default 20)\n"
+        "  --targets=LIST       comma-separated target qubits, or 'all' (default all)\n"
+        "  --controls=LIST      comma-separated control (or second target) qubits, 'all', or\n"
+        "                       'ends' for the first and last qubit (default ends)\n"
+        "  --threads=LIST       comma-separated OpenMP thread counts (default powers of 2 up to max)\n"
+        "  --kernels=LIST       comma-separated kernel names (default all)\n"
+        "  --trials=N           timed batches per measurement (default 5)\n"
+        "  --batch-time=S       minimum duration in seconds of each batch (default 0.01)\n"
+        "  --stream-size=P      STREAM arrays hold 2^P reals (default 24)\n"
+        "  --format=csv|json    output format (default csv)\n"
+        "  --output=FILE        output file (default stdout)\n"
+        "  --list               print the kernel names and exit\n",
+        exe);
+}
+
+static void failWithUsage(const char* exe, const char* arg) {
+    fprintf(stderr, "Invalid argument '%s'\n", arg);
+    printUsage(exe);
+    exit(EXIT_FAILURE);
+}
+
+/** Parses a comma-separated list of non-negative integers, returning its length or -1 if malformed */
+static int parseIntList(const char* str, int* list) {
+    int len = 0;
+    while (*str != '\0') {
+        char* end;
+        long val = strtol(str, &end, 10);
+        if (end == str || val < 0 || len == MAX_LIST_LEN)
+            return -1;
+        list[len++] = (int) val;
+        str = end;
+        if (*str == ',')
+            str++;
+        else if (*str != '\0')
+            return -1;
+    }
+    return len;
+}
+
+static void parseArgs(int argc, char** argv, BenchSettings* s) {
+
+    s->minQubits = 10;
+    s->maxQubits = 20;
+    s->numTargets = -1;
+    s->numControls = 0;
+    s->numThreads = 0;
+    s->numKernels = 0;
+    s->numTrials = 5;
+    s->batchTime = 0.01;
+    s->streamPower = 24;
+    s->isJSON = 0;
+    s->out = stdout;
+
+    for (int i=1; i<argc; i++) {
+        char* arg = argv[i];
+        char* val = strchr(arg, '=');
+        if (val != NULL)
+            val++;
+
+        if (strcmp(arg, "--help") == 0) {
+            printUsage(argv[0]);
+            exit(EXIT_SUCCESS);
+        }
+        else if (strcmp(arg, "--list") == 0) {
+            for (int k=0; k<numKernels; k++)
+                printf("%s\n", kernels[k].name);
+            exit(EXIT_SUCCESS);
+        }
+        else if (val == NULL)
+            failWithUsage(argv[0], arg);
+        else if (strncmp(arg, "--min-qubits=", 13) == 0)
+            s->minQubits = atoi(val);
+        else if (strncmp(arg, "--max-qubits=", 13) == 0)
+            s->maxQubits = atoi(val);
+        else if (strncmp(arg, "--trials=", 9) == 0)
+            s->numTrials = atoi(val);
+        else if (strncmp(arg, "--batch-time=", 13) == 0)
+            s->batchTime = atof(val);
+        else if (strncmp(arg, "--stream-size=", 14) == 0)
+            s->streamPower = atoi(val);
+        else if (strncmp(arg, "--targets=", 10) == 0) {
+            if (strcmp(val, "all") == 0)
+                s->numTargets = -1;
+            else if ((s->numTargets = parseIntList(val, s->targets)) <= 0)
+                failWithUsage(argv[0], arg);
+        }
+        else if (strncmp(arg, "--controls=", 11) == 0) {
+            if (strcmp(val, "all") == 0)
+                s->numControls = -1;
+            else if (strcmp(val, "ends") == 0)
+                s->numControls = 0;
+            else if ((s->numControls = parseIntList(val, s->controls)) <= 0)
+                failWithUsage(argv[0], arg);
+        }
+        else if (strncmp(arg, "--threads=", 10) == 0) {
+            if ((s->numThreads = parseIntList(val, s->threads)) <= 0)
+                failWithUsage(argv[0], arg);
+        }
+        else if (strncmp(arg, "--kernels=", 10) == 0) {
+            for (char* name = strtok(val, ","); name != NULL; name = strtok(NULL, ",")) {
+                int k;
+                for (k=0; k<numKernels && strcmp(kernels[k].name, name) != 0; k++)
+                    ;
+                if (k == numKernels || s->numKernels == MAX_LIST_LEN)
+                    failWithUsage(argv[0], name);
+                s->kernels[s->numKernels++] = name;
+            }
+        }
+        else if (strncmp(arg, "--format=", 9) == 0) {
+            if (strcmp(val, "json") == 0)
+                s->isJSON = 1;
+            else if (strcmp(val, "csv") == 0)
+                s->isJSON = 0;
+            else
+                failWithUsage(argv[0], arg);
+        }
+        else if (strncmp(arg, "--output=", 9) == 0) {
+            s->out = fopen(val, "w");
+            if (s->out == NULL) {
+                fprintf(stderr, "Could not open '%s' for writing\n", val);
+                exit(EXIT_FAILURE);
+            }
+        }
+        else
+            failWithUsage(argv[0], arg);
+    }
+
+    if (s->minQubits < 2 || s->maxQubits < s->minQubits)
+        failWithUsage(argv[0], "--min-qubits/--max-qubits");
+    if (s->numTrials < 1 || s->numTrials > MAX_TRIALS)
+        failWithUsage(argv[0], "--trials");
+    if (s->streamPower < 10 || s->streamPower > 40)
+        failWithUsage(argv[0], "--stream-size");
+
+    // default to powers of 2 up to (and including) every available thread
+    if (s->numThreads == 0) {
+        int max = getMaxNumThreads();
+        for (int t=1; t<max && s->numThreads < MAX_LIST_LEN-1; t*=2)
+            s->threads[s->numThreads++] = t;
+        s->threads[s->numThreads++] = max;
+    }
+# ifndef _OPENMP
+    for (int t=0; t<s->numThreads; t++)
+        if (s->threads[t] != 1) {
+            fprintf(stderr, "Built without OpenMP (MULTITHREADED=0); only --threads=1 is possible\n");
+            exit(EXIT_FAILURE);
+        }
+# endif
+}
+
+/** Reports user-input validation errors, which this executable should never trigger */
+void invalidQuESTInputError(const char* errMsg, const char* errFunc) {
+    fprintf(stderr, "QuEST error in %s: %s\n", errFunc, errMsg);
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char** argv) {
+
+    BenchSettings settings;
+    parseArgs(argc, argv, &settings);
+
+    QuESTEnv env = createQuESTEnv();
+    bench_env = env;
+    initOperands();
+    writeHeader(&settings);
+
+    BenchTiming none = {0, 0, 0};
+    for (int t=0; t<settings.numThreads; t++) {
+        int numThreads = settings.threads[t];
+        setNumThreads(numThreads);
+
+        double streamGBps = measureStreamBandwidth(&settings);
+        writeRecord(&settings, numThreads, "streamTriad", "stream",
+            -1, -1, -1, none, 3. * (1LL << settings.streamPower) * sizeof(qreal), streamGBps);
+
+        for (int n=settings.minQubits; n<=settings.maxQubits; n++)
+            benchmarkSize(n, numThreads, streamGBps, &settings, env);
+    }
+
+    writeFooter(&settings);
+    if (settings.out != stdout)
+        fclose(settings.out);
+
+    destroyOperands();
+    destroyQuESTEnv(env);
+    return 0;
+}
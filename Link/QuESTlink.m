@@ -18,9 +18,21 @@ BeginPackage["QuEST`"]
     
     ApplyCircuit::usage = "ApplyCircuit[circuit, qureg] modifies qureg by applying the circuit. Returns any measurement outcomes, grouped by M operators and ordered by their order in M.
 ApplyCircuit[circuit, inQureg, outQureg] leaves inQureg unchanged, but modifies outQureg to be the result of applying the circuit to inQureg.
+ApplyCircuit[circId, qureg] and ApplyCircuit[circId, inQureg, outQureg] apply a circuit previously created with CreateCircuit, which is not re-sent nor re-validated.
 Accepts optional arguments WithBackup and ShowProgress."
     ApplyCircuit::error = "`1`"
     
+    CreateCircuit::usage = "CreateCircuit[circuit] sends the circuit to the QuEST environment once, where it is validated and compiled, and returns an id which can be passed to ApplyCircuit in place of the circuit.
+CreateCircuit[circuit, varVals] accepts a circuit containing symbolic parameters, given initial values by varVals (in the format {param -> value}), which can later be changed with SetCircuitParams. Each param must appear only as a whole gate argument (e.g. Rx[theta] is allowed, but Rx[2 theta] and within U matrices is not).
+CreateCircuit[filename] reads an OpenQASM 2 file (such as one written by QuEST's QASM logger) directly in the QuEST environment, so that its gates are never sent from Mathematica. The file may use the gates of qelib1.inc and its own gate definitions, measure (whose outcomes ApplyCircuit returns, one list per measure statement) and reset, but not classically-conditioned operations."
+    CreateCircuit::error = "`1`"
+    
+    SetCircuitParams::usage = "SetCircuitParams[circId, varVals] changes the values of the symbolic parameters of a circuit created by CreateCircuit[circuit, varVals], sending only the new values."
+    SetCircuitParams::error = "`1`"
+    
+    DestroyCircuit::usage = "DestroyCircuit[circId] frees the circuit created by CreateCircuit."
+    DestroyCircuit::error = "`1`"
+    
     CalcQuregDerivs::usage = "CalcQuregDerivs[circuit, initQureg, varVals, derivQuregs] sets the given list of (deriv)quregs to be the result of applying derivatives of the parameterised circuit to the initial state. The derivQuregs are ordered by the varVals, which should be in the format {param -> value}, where param is featured in Rx, Ry, Rz, R or U (and controlled) of the given circuit ONCE (multiple times within a U matrix is allowed). The initState is unchanged. Note Rx[theta] is allowed, but Rx[f(theta)] is not. Furthermore U matrices must contain at most one parameter."
     CalcQuregDerivs::error = "`1`"
     
@@ -46,8 +58,40 @@ CalcDensityInnerProducts[rhoId, omegaIds] returns a real vector with i-th elemen
 
     ApplyPauliSum::usage = "ApplyPauliSum[inQureg, pauliSum, outQureg] modifies outQureg to be the result of applying the weighted sum of Paulis to inQureg."
     ApplyPauliSum::error = "`1`"
+    
+    ApplyTrotterCircuit::usage = "ApplyTrotterCircuit[qureg, pauliSum, time, order, reps] applies a Trotter-Suzuki approximation of Exp[-i pauliSum time] to qureg, of the given order (1, or a positive even number like 2 or 4), with time divided into reps steps. The pauliSum is sent only once and evolved natively, which is much faster than applying an equivalent circuit of R gates. pauliSum must have real coefficients."
+    ApplyTrotterCircuit::error = "`1`"
+
+    ApplyKrylovEvolution::usage = "ApplyKrylovEvolution[qureg, pauliSum, time] applies Exp[-i pauliSum time] to the state-vector qureg, exactly (to numerical precision), by projecting pauliSum onto small Krylov subspaces found by the Lanczos method. The matrix of pauliSum is never formed, so this scales to as many qubits as fit in memory (it needs three workspace registers). pauliSum must have real coefficients."
+    ApplyKrylovEvolution::error = "`1`"
+    
+    CalcGroundState::usage = "CalcGroundState[pauliSum, qureg, tolerance] overwrites the state-vector qureg with the ground state of pauliSum (found by the restarted Lanczos method from qureg's initial state, which should overlap the ground state, e.g. a random state) and returns its energy. Iteration stops once the residual norm |pauliSum psi - energy psi| is at most tolerance. The matrix of pauliSum is never formed. pauliSum must have real coefficients. An error is thrown if qureg is initially zero, or if tolerance is not reached within 1000 Lanczos restarts (leaving qureg in the final approximation)."
+    CalcGroundState::error = "`1`"
+
+    CreateDiagonalOp::usage = "CreateDiagonalOp[elems] creates a diagonal operator in the QuEST environment with the given list of 2^numQubits (possibly complex) diagonal elements, and returns its id, which can be passed to ApplyDiagonalOp and CalcExpecDiagonalOp.
+CreateDiagonalOp[filename] reads the elements from the given file, directly in the QuEST environment (so they are not sent from Mathematica). Each line of the file (excluding blank lines and those beginning with #) is a single element, with format {re im} or {re} (exclude braces), and the number of elements must be a power of 2.
+The operator must eventually be freed with DestroyDiagonalOp."
+    CreateDiagonalOp::error = "`1`"
 
-    CalcPauliSumMatrix::usage = "CalcPauliSumMatrix[pauliSum] returns the matrix form of the given weighted sum of Pauli operators. The number of qubits is assumed to be the largest Pauli target."
+    ApplyPhaseFunc::usage = "ApplyPhaseFunc[qureg, qubits, f, x] multiplies every basis state of qureg by Exp[I f[x]], where x is the integer encoded by the given qubits (the first being least significant), and f is a polynomial in symbol x, possibly with negative or fractional exponents. This is a single pass over the state, much faster than the equivalent circuit of phase gates.
+ApplyPhaseFunc[qureg, qubits, phases] uses the list of 2^Length[qubits] phases as a lookup table, indexed by the unsigned value of x.
+Options BitEncoding -> \"Unsigned\" (default) or \"TwosComplement\", and PhaseOverrides -> {x1 -> phase1, ...} which replaces f at the given values of x (and which is necessary when f diverges at x = 0).
+Returns the qureg id."
+    ApplyPhaseFunc::error = "`1`"
+    
+    CreateDiskQureg::usage = "CreateDiskQureg[numQubits, filename] returns the id of a newly created statevector whose amplitudes live in a memory-mapped scratch file (ideally on a fast local disk), so that it may exceed the available memory. The file is deleted as soon as it is mapped; use SaveQureg to keep the state. A distributed qureg uses one file per node, suffixed with _rank_k. Not supported on Windows nor in GPU mode."
+    CreateDiskQureg::error = "`1`"
+    
+    CreateDensityDiskQureg::usage = "CreateDensityDiskQureg[numQubits, filename] returns the id of a newly created density matrix whose amplitudes live in a memory-mapped scratch file. See ?CreateDiskQureg."
+    CreateDensityDiskQureg::error = "`1`"
+    
+    SaveQureg::usage = "SaveQureg[qureg, filename] saves the state of qureg (directly from the QuEST environment) to a binary checkpoint file, which can be restored by LoadQureg, and returns the qureg id. A distributed qureg is saved to one file per node, suffixed with _rank_k."
+    SaveQureg::error = "`1`"
+    
+    LoadQureg::usage = "LoadQureg[qureg, filename] overwrites qureg with the state in a checkpoint written by SaveQureg, which must have been saved from a qureg of the same type and number of qubits. The checkpoint may have been saved by a quest_link of a different precision (e.g. one compiled with PRECISION=1), in which case the amplitudes are converted. Returns the qureg id."
+    LoadQureg::error = "`1`"
+    
+    CalcPauliSumMatrix::usage = "CalcPauliSumMatrix[pauliSum] returns the matrix form of the given weighted sum of Pauli operators, as a SparseArray (use Normal to obtain a dense matrix). The number of qubits is assumed to be the largest Pauli target. The matrix is built directly from the Pauli strings (each contributing one element per column) without simulation, so is fast for many-qubit Hamiltonians."
     CalcPauliSumMatrix::error = "`1`"
 
     DestroyQureg::usage = "DestroyQureg[qureg] destroys the qureg associated with the given ID. If qureg is a Symbol, it will additionally be cleared."
@@ -112,6 +156,12 @@ When two matrices are passed, many options (e.g. ChartStyle) can accept a length
     PackageExport[ShowProgress]
     ShowProgress::usage = "Optional argument to ApplyCircuit, indicating whether to show a progress bar during circuit evaluation (default False). This slows evaluation slightly."
     
+    PackageExport[BitEncoding]
+    BitEncoding::usage = "Optional argument to ApplyPhaseFunc, indicating whether the qubits encode an \"Unsigned\" integer (default) or a signed \"TwosComplement\" integer."
+    
+    PackageExport[PhaseOverrides]
+    PhaseOverrides::usage = "Optional argument to ApplyPhaseFunc, a list of rules {x -> phase, ...} which replace the phase function at the given integer values of x (default {})."
+    
     PackageExport[PlotComponent]
     PlotComponent::Usage = "Optional argument to PlotDensityMatrix, to plot the \"Real\", \"Imaginary\" component of the matrix, or its \"Magnitude\" (default)."
     
@@ -158,6 +208,12 @@ P[outcomes] is a (normalised) projector onto the given {0,1} outcomes. The left
     Kraus::usage = "Kraus[ops] applies a one or two-qubit Kraus map (given as a list of Kraus operators) to a density matrix."
     PackageExport[G]
     G::usage = "G[phi] applies a global phase rotation of phi, by premultiplying Exp[i phi]."
+    PackageExport[QFT]
+    QFT::usage = "QFT is the quantum Fourier transform upon any number of target qubits, the first being the least significant. It is effected natively as a fast Fourier transform, much faster than the equivalent circuit of H, controlled phase and SWAP gates."
+    
+    PackageExport[InvQFT]
+    InvQFT::usage = "InvQFT is the inverse of the QFT gate upon the same target qubits."
+    
     PackageExport[Id]
     Id::usage = "Id is an identity gate which effects no change, but can be used for forcing gate alignment in DrawCircuit, or as an alternative to removing gates in ApplyCircuit."
  
@@ -174,7 +230,7 @@ P[outcomes] is a (normalised) projector onto the given {0,1} outcomes. The left
                
         (* opcodes *)
         getOpCode[gate_] :=
-	        gate /. {H->0,X->1,Y->2,Z->3,Rx->4,Ry->5,Rz->6,R->7,S->8,T->9,U->10,Deph->11,Depol->12,Damp->13,SWAP->14,M->15,P->16,Kraus->17,G->18,Id->19,_->-1}
+	        gate /. {H->0,X->1,Y->2,Z->3,Rx->4,Ry->5,Rz->6,R->7,S->8,T->9,U->10,Deph->11,Depol->12,Damp->13,SWAP->14,M->15,P->16,Kraus->17,G->18,Id->19,QFT->20,InvQFT->21,_->-1}
         
         (* convert MMA matrix to a flat format which can be embedded in the circuit param list *)
         codifyMatrix[matr_] :=
@@ -274,9 +330,88 @@ P[outcomes] is a (normalised) projector onto the given {0,1} outcomes. The left
         		QuEST`CloneQureg[outQureg, inQureg];
         		ApplyCircuit[circuit, outQureg, opts]
         	]
+        (* applying a circuit created by CreateCircuit, referred to by its id *)
+        applyCreatedCircuitInner[circId_, qureg_, withBackup_, showProgress:0] :=
+            ApplyCreatedCircuitInternal[circId, qureg, withBackup, showProgress]
+        applyCreatedCircuitInner[circId_, qureg_, withBackup_, showProgress:1] :=
+            Monitor[
+                circuitProgressVar = 0;
+                ApplyCreatedCircuitInternal[circId, qureg, withBackup, showProgress],
+                ProgressIndicator[circuitProgressVar]
+            ]
+        ApplyCircuit[circId_Integer, qureg_Integer, OptionsPattern[ApplyCircuit]] :=
+            Which[
+                Not @ Or[OptionValue[WithBackup] === True, OptionValue[WithBackup] === False],
+                Message[ApplyCircuit::error, "Option WithBackup must be True or False."]; $Failed,
+                Not @ Or[OptionValue[ShowProgress] === True, OptionValue[ShowProgress] === False],
+                Message[ApplyCircuit::error, "Option ShowProgress must be True or False."]; $Failed,
+                True,
+                applyCreatedCircuitInner[
+                    circId, qureg, 
+                    If[OptionValue[WithBackup]===True,1,0], 
+                    If[OptionValue[ShowProgress]===True,1,0]
+                ]
+            ]
+        ApplyCircuit[circId_Integer, inQureg_Integer, outQureg_Integer, opts:OptionsPattern[ApplyCircuit]] :=
+        	Block[{},
+        		QuEST`CloneQureg[outQureg, inQureg];
+        		ApplyCircuit[circId, outQureg, opts]
+        	]
         (* error for bad args *)
         ApplyCircuit[___] := invalidArgError[ApplyCircuit]
         
+        (* the (C-indexed) positions in the flat param list of each symbolic param, of each created circuit *)
+        createdCircuitParamInds = <||>;
+        
+        (* send a circuit to be compiled and stored by the backend. CreateCircuitInternal provided by WSTP *)
+        CreateCircuit[circuit_?isCircuitFormat, varVals:{(_ -> _?NumericQ) ...}:{}] :=
+            Module[
+                {codes, flatParams, paramInds, circId},
+                codes = codifyCircuit[circuit];
+                flatParams = Flatten[codes[[4]]];
+                paramInds = Flatten[Position[flatParams, #, {1}]]& /@ varVals[[All,1]];
+                Which[
+                    AnyTrue[paramInds, Length[#]<1&],
+                    Message[CreateCircuit::error, "One or more variables were not present (as whole gate arguments) in the circuit!"]; $Failed,
+                    Not @ AllTrue[ReplacePart[flatParams, Thread[Flatten[paramInds] -> 0]], NumericQ],
+                    Message[CreateCircuit::error, "The circuit contained variables not assigned values in varVals, or which were not whole gate arguments!"]; $Failed,
+                    True,
+                    circId = CreateCircuitInternal @ unpackEncodedCircuit[codes /. varVals];
+                    If[IntegerQ[circId], 
+                        createdCircuitParamInds[circId] = AssociationThread[varVals[[All,1]], paramInds - 1]];
+                    circId
+                ]
+            ]
+        (* compile a circuit from an OpenQASM file. CreateCircuitFromQASMInternal provided by WSTP *)
+        CreateCircuit[filename_String] :=
+            CreateCircuitFromQASMInternal @ If[FileExistsQ[filename], AbsoluteFileName[filename], filename]
+        CreateCircuit[___] := invalidArgError[CreateCircuit]
+        
+        (* rebind the symbolic params of a created circuit. SetCircuitParamsInternal provided by WSTP *)
+        SetCircuitParams[circId_Integer, varVals:{(_ -> _?NumericQ) ..}] :=
+            Which[
+                Not @ KeyExistsQ[createdCircuitParamInds, circId],
+                Message[SetCircuitParams::error, "The circuit (with id " <> ToString[circId] <> ") has not been created."]; $Failed,
+                Not @ AllTrue[varVals[[All,1]], KeyExistsQ[createdCircuitParamInds[circId], #]&],
+                Message[SetCircuitParams::error, "One or more variables were not symbolic parameters of the created circuit!"]; $Failed,
+                True,
+                With[
+                    {inds = createdCircuitParamInds[circId] /@ varVals[[All,1]]},
+                    SetCircuitParamsInternal[
+                        circId, Flatten[inds],
+                        N @ Flatten @ MapThread[ConstantArray[#1, Length[#2]]&, {varVals[[All,2]], inds}]]
+                ]
+            ]
+        SetCircuitParams[___] := invalidArgError[SetCircuitParams]
+        
+        (* free a created circuit. DestroyCircuitInternal provided by WSTP *)
+        DestroyCircuit[circId_Integer] :=
+            With[{id = DestroyCircuitInternal[circId]},
+                If[IntegerQ[id], KeyDropFrom[createdCircuitParamInds, circId]];
+                id
+            ]
+        DestroyCircuit[___] := invalidArgError[DestroyCircuit]
+        
         (* apply the derivatives of a circuit on an initial state, storing the ersults in the given quregs *)
         extractUnitaryMatrix[Subscript[U, __Integer][u_List]] := u
         extractUnitaryMatrix[Subscript[C, __Integer][Subscript[U, __Integer][u_List]]] := u
@@ -460,26 +595,146 @@ P[outcomes] is a (normalised) projector onto the given {0,1} outcomes. The left
                 ApplyPauliSumInternal[inQureg, outQureg, coeffs, Flatten[codes], Flatten[targs], Length /@ targs]
             ]
         ApplyPauliSum[___] := invalidArgError[ApplyPauliSum]
+        
+        (* apply a Trotterisation of exp(-i pauliSum time) to a qureg *)
+        ApplyTrotterCircuit[qureg_Integer, paulis:pattPauliSum, time_?NumericQ, order_Integer, reps_Integer] :=
+            With[{
+                coeffs = getPauliSumTermCoeff /@ List @@ paulis,
+                codes = getPauliSumTermCodes /@ List @@ paulis,
+                targs = getPauliSumTermTargs /@ List @@ paulis
+                },
+                ApplyTrotterCircuitInternal[qureg, N @ time, order, reps, coeffs, Flatten[codes], Flatten[targs], Length /@ targs]
+            ]
+        ApplyTrotterCircuit[qureg_Integer, pauli:pattPauli, time_?NumericQ, order_Integer, reps_Integer] :=
+            ApplyTrotterCircuitInternal[qureg, N @ time, order, reps, {1}, {getOpCode @ pauli[[1]]}, {pauli[[2]]}, {1}]
+        ApplyTrotterCircuit[qureg_Integer, Verbatim[Times][coeff:_?NumericQ:1, paulis:pattPauli..], time_?NumericQ, order_Integer, reps_Integer] :=
+            ApplyTrotterCircuitInternal[qureg, N @ time, order, reps, {coeff}, getOpCode /@ {paulis}[[All,1]], {paulis}[[All,2]], {Length @ {paulis}}]
+        ApplyTrotterCircuit[qureg_Integer, blank:pattConstPlusPauliSum, time_?NumericQ, order_Integer, reps_Integer] := 
+            With[{
+                coeffs = Append[getPauliSumTermCoeff /@ {pauliTerms}, const],
+                codes = Append[getPauliSumTermCodes /@ {pauliTerms}, {0}],
+                targs = Append[getPauliSumTermTargs /@ {pauliTerms}, {0}]
+                },
+                ApplyTrotterCircuitInternal[qureg, N @ time, order, reps, coeffs, Flatten[codes], Flatten[targs], Length /@ targs]
+            ]
+        ApplyTrotterCircuit[___] := invalidArgError[ApplyTrotterCircuit]
+        
+        (* exactly evolve or find the ground state of a qureg under a Pauli sum, by Krylov methods *)
+        ApplyKrylovEvolution[qureg_Integer, paulis:pattPauliSum, time_?NumericQ] :=
+            With[{
+                coeffs = getPauliSumTermCoeff /@ List @@ paulis,
+                codes = getPauliSumTermCodes /@ List @@ paulis,
+                targs = getPauliSumTermTargs /@ List @@ paulis
+                },
+                ApplyKrylovEvolutionInternal[qureg, N @ time, coeffs, Flatten[codes], Flatten[targs], Length /@ targs]
+            ]
+        ApplyKrylovEvolution[qureg_Integer, blank:pattConstPlusPauliSum, time_?NumericQ] := 
+            With[{
+                coeffs = Append[getPauliSumTermCoeff /@ {pauliTerms}, const],
+                codes = Append[getPauliSumTermCodes /@ {pauliTerms}, {0}],
+                targs = Append[getPauliSumTermTargs /@ {pauliTerms}, {0}]
+                },
+                ApplyKrylovEvolutionInternal[qureg, N @ time, coeffs, Flatten[codes], Flatten[targs], Length /@ targs]
+            ]
+        ApplyKrylovEvolution[___] := invalidArgError[ApplyKrylovEvolution]
+        CalcGroundState[paulis:pattPauliSum, qureg_Integer, tolerance_?NumericQ] :=
+            With[{
+                coeffs = getPauliSumTermCoeff /@ List @@ paulis,
+                codes = getPauliSumTermCodes /@ List @@ paulis,
+                targs = getPauliSumTermTargs /@ List @@ paulis
+                },
+                CalcGroundStateInternal[qureg, N @ tolerance, coeffs, Flatten[codes], Flatten[targs], Length /@ targs]
+            ]
+        CalcGroundState[blank:pattConstPlusPauliSum, qureg_Integer, tolerance_?NumericQ] := 
+            With[{
+                coeffs = Append[getPauliSumTermCoeff /@ {pauliTerms}, const],
+                codes = Append[getPauliSumTermCodes /@ {pauliTerms}, {0}],
+                targs = Append[getPauliSumTermTargs /@ {pauliTerms}, {0}]
+                },
+                CalcGroundStateInternal[qureg, N @ tolerance, coeffs, Flatten[codes], Flatten[targs], Length /@ targs]
+            ]
+        CalcGroundState[___] := invalidArgError[CalcGroundState]
                 
         (* convert a weighted sum of Pauli products into a matrix *)
         CalcPauliSumMatrix[paulis:pattPauliSum] := 
             With[{
-                arrs=With[{
-                    coeffs = getPauliSumTermCoeff /@ List @@ paulis,
-                    codes = getPauliSumTermCodes /@ List @@ paulis,
-                    targs = getPauliSumTermTargs /@ List @@ paulis
+                numQb = 1+Max@Flatten[getPauliSumTermTargs /@ List @@ paulis]
+                },
+                With[{
+                    arrs = CalcPauliSumMatrixInternal[numQb,
+                        getPauliSumTermCoeff /@ List @@ paulis,
+                        Flatten[getPauliSumTermCodes /@ List @@ paulis], 
+                        Flatten[getPauliSumTermTargs /@ List @@ paulis], 
+                        Length /@ (getPauliSumTermTargs /@ List @@ paulis)]
                     },
-                    CalcPauliSumMatrixInternal[1+Max@Flatten@targs, coeffs, Flatten[codes], Flatten[targs], Length /@ targs]
-                ]},
-                (#[[1]] + I #[[2]])& /@ Partition[arrs,2] // Transpose
+                    (* arrs = {rows, cols, reals, imags} of the nonzero elements *)
+                    If[arrs === $Failed, $Failed,
+                        SparseArray[Transpose[arrs[[{1,2}]]] -> arrs[[3]] + I arrs[[4]], {2^numQb, 2^numQb}]]
+                ]
             ]
         CalcPauliSumMatrix[blank:pattConstPlusPauliSum] := 
             With[
                 {matr=CalcPauliSumMatrix[Plus @@ {pauliTerms}]},
-                matr + const IdentityMatrix @ Length @ matr 
+                If[matr === $Failed, $Failed,
+                    matr + SparseArray[Band[{1,1}] -> const, Dimensions @ matr]]
             ]
         CalcPauliSumMatrix[___] := invalidArgError[CalcPauliSumMatrix]
         
+        (* create quregs backed by a scratch file, relative to the Mathematica working directory. Create(Density)DiskQuregInternal provided by WSTP *)
+        CreateDiskQureg[numQubits_Integer, filename_String] :=
+            CreateDiskQuregInternal[numQubits, ExpandFileName[filename]]
+        CreateDiskQureg[___] := invalidArgError[CreateDiskQureg]
+        CreateDensityDiskQureg[numQubits_Integer, filename_String] :=
+            CreateDensityDiskQuregInternal[numQubits, ExpandFileName[filename]]
+        CreateDensityDiskQureg[___] := invalidArgError[CreateDensityDiskQureg]
+        
+        (* checkpoint quregs to file, relative to the Mathematica working directory. (Save|Load)QuregInternal provided by WSTP *)
+        SaveQureg[qureg_Integer, filename_String] :=
+            SaveQuregInternal[qureg, ExpandFileName[filename]]
+        SaveQureg[___] := invalidArgError[SaveQureg]
+        LoadQureg[qureg_Integer, filename_String] :=
+            LoadQuregInternal[qureg, ExpandFileName[filename]]
+        LoadQureg[___] := invalidArgError[LoadQureg]
+        
+        (* create a diagonal operator in the backend. CreateDiagonalOp(FromFile)Internal provided by WSTP *)
+        CreateDiagonalOp[elems:{__?NumericQ}] :=
+            CreateDiagonalOpInternal[Ceiling @ Log2 @ Length @ elems, N @ Re @ elems, N @ Im @ elems]
+        CreateDiagonalOp[filename_String] :=
+            CreateDiagonalOpFromFileInternal @ If[FileExistsQ[filename], AbsoluteFileName[filename], filename]
+        CreateDiagonalOp[___] := invalidArgError[CreateDiagonalOp]
+        
+        (* apply exp(i f(x)) over the integer x encoded by qubits. ApplyPhaseFunc(Table)Internal provided by WSTP *)
+        Options[ApplyPhaseFunc] = {
+            BitEncoding -> "Unsigned",
+            PhaseOverrides -> {}
+        };
+        (* the {coefficient, exponent} of each term of f, where a non-polynomial term (like Sin[x] or Sqrt[1+x]) retains x in its coefficient *)
+        getPhaseFuncTerms[f_, x_Symbol] :=
+            With[{e = Exponent[#, x]}, {# / x^e, e}]& /@ 
+                With[{g = Expand[f]}, If[Head[g] === Plus, List @@ g, {g}]]
+        ApplyPhaseFunc[qureg_Integer, qubits:{__Integer}, f_, x_Symbol, OptionsPattern[ApplyPhaseFunc]] :=
+            With[
+                {terms = getPhaseFuncTerms[f, x], overs = OptionValue[PhaseOverrides]},
+                Which[
+                    Not @ AllTrue[terms[[All, 1]], FreeQ[#, x]&] || Not @ AllTrue[Flatten @ terms, NumericQ],
+                    Message[ApplyPhaseFunc::error, "The phase function must be a polynomial in " <> ToString[x] <> " with numerical coefficients and exponents."]; $Failed,
+                    Not @ MemberQ[{"Unsigned", "TwosComplement"}, OptionValue[BitEncoding]],
+                    Message[ApplyPhaseFunc::error, "Option BitEncoding must be \"Unsigned\" or \"TwosComplement\"."]; $Failed,
+                    Not @ MatchQ[overs, {(_Integer -> _?NumericQ)...}],
+                    Message[ApplyPhaseFunc::error, "Option PhaseOverrides must be a list of rules from integers to numerical phases."]; $Failed,
+                    True,
+                    ApplyPhaseFuncInternal[
+                        qureg, qubits, 
+                        If[OptionValue[BitEncoding] === "TwosComplement", 1, 0],
+                        N @ terms[[All, 1]], N @ terms[[All, 2]],
+                        overs[[All, 1]], N @ overs[[All, 2]]
+                    ]
+                ]
+            ]
+        ApplyPhaseFunc[qureg_Integer, qubits:{__Integer}, phases:{__?NumericQ}] :=
+            ApplyPhaseFuncTableInternal[qureg, qubits, N @ phases]
+        ApplyPhaseFunc[___] := invalidArgError[ApplyPhaseFunc]
+        
         (* convert a list of Pauli coefficients and codes into a weighted (symbolic) sum of products *)
         GetPauliSumFromCoeffs[addr_String] :=
             Plus @@ (#[[1]] Times @@ MapThread[
@@ -1000,6 +1255,9 @@ P[outcomes] is a (normalised) projector onto the given {0,1} outcomes. The left
         getAnalGateMatrix[Subscript[Rz, _][a_]] = MatrixExp[-I a/2 PauliMatrix[3]];
         getAnalGateMatrix[R[a_, pauli_]] := MatrixExp[-I a/2 getAnalGateMatrix @ pauli];
         getAnalGateMatrix[R[a_, paulis_Times]] := MatrixExp[-I a/2 * KroneckerProduct @@ (getAnalGateMatrix /@ List @@ paulis)]
+        getAnalGateMatrix[Subscript[QFT, t__]] := With[{d=2^Length[{t}]}, 
+            Table[Exp[2 \[Pi] I x y/d], {y,0,d-1}, {x,0,d-1}]/Sqrt[d]]
+        getAnalGateMatrix[Subscript[InvQFT, t__]] := ConjugateTranspose @ getAnalGateMatrix[Subscript[QFT, t]]
         getAnalGateMatrix[Subscript[C, __][g_]] := getAnalGateMatrix[g]
         
         (* extract ctrls from gate symbols *)
@@ -35,8 +35,78 @@
 #include <string.h>
 #include <QuEST.h>
 #include <string>
+#include <fstream>
+#include <sstream>
 #include <vector>
+#include <algorithm>
 #include <exception>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <cctype>
+#include <cerrno>
+#include <climits>
+
+/*
+ * When compiled with MIXED_PRECISION (see makefile), a second, single-precision
+ * copy of the QuEST core is linked, whose every symbol is prefixed by 'single_'.
+ * It is declared here within namespace single (so that its types, like
+ * single::Qureg, are distinct), by re-including QuEST.h with QuEST_PREC=1
+ */
+#ifdef QUEST_MIXED_PRECISION
+    #if QuEST_PREC != 2
+        #error "MIXED_PRECISION requires the default QuEST core to be double precision"
+    #endif
+
+    #pragma push_macro("QuEST_PREC")
+    #pragma push_macro("qreal")
+    #pragma push_macro("MPI_QuEST_REAL")
+    #pragma push_macro("MPI_MAX_AMPS_IN_MSG")
+    #pragma push_macro("REAL_STRING_FORMAT")
+    #pragma push_macro("REAL_QASM_FORMAT")
+    #pragma push_macro("REAL_EPS")
+    #pragma push_macro("absReal")
+    #undef QuEST_PREC
+    #undef qreal
+    #undef MPI_QuEST_REAL
+    #undef MPI_MAX_AMPS_IN_MSG
+    #undef REAL_STRING_FORMAT
+    #undef REAL_QASM_FORMAT
+    #undef REAL_EPS
+    #undef absReal
+    #undef QUEST_PRECISION_H
+    #undef QUEST_H
+    #define QuEST_PREC 1
+
+    // getEnvironmentString is declared, but not defined, by the CPU core, so isn't prefixed by the makefile
+    namespace single {
+        #include "quest_single_names.h"
+        #define getEnvironmentString single_getEnvironmentString
+        #include <QuEST.h>
+        #undef getEnvironmentString
+        #include "quest_single_unnames.h"
+    }
+
+    #undef QuEST_PREC
+    #undef qreal
+    #undef MPI_QuEST_REAL
+    #undef MPI_MAX_AMPS_IN_MSG
+    #undef REAL_STRING_FORMAT
+    #undef REAL_QASM_FORMAT
+    #undef REAL_EPS
+    #undef absReal
+    #pragma pop_macro("QuEST_PREC")
+    #pragma pop_macro("qreal")
+    #pragma pop_macro("MPI_QuEST_REAL")
+    #pragma pop_macro("MPI_MAX_AMPS_IN_MSG")
+    #pragma pop_macro("REAL_STRING_FORMAT")
+    #pragma pop_macro("REAL_QASM_FORMAT")
+    #pragma pop_macro("REAL_EPS")
+    #pragma pop_macro("absReal")
+#endif
 
 /*
  * PI constant needed for (multiControlled) sGate and tGate
@@ -68,6 +138,19 @@
 #define OPCODE_Kraus 17
 #define OPCODE_G 18
 #define OPCODE_Id 19
+#define OPCODE_QFT 20
+#define OPCODE_InvQFT 21
+
+/*
+ * Codes for operations which are never sent from MMA, but which are produced 
+ * when reading circuits from OpenQASM files
+ */
+#define OPCODE_Reset 22
+
+/*
+ * Maximum depth to which OpenQASM gate definitions may invoke other definitions
+ */
+#define MAX_QASM_GATE_NESTING 64
 
 /*
  * Codes for dynamically updating kernel variables, to indicate progress 
@@ -75,10 +158,11 @@
 #define CIRC_PROGRESS_VAR "QuEST`Private`circuitProgressVar"
 
 /*
- * Max number of target and control qubits which can be specified 
- * for an individual gate 
+ * Wall-clock intervals (in ms) at which the link thread, while a circuit is 
+ * simulated by a worker thread, checks for an abort and updates progress
  */
-#define MAX_NUM_TARGS_CTRLS 100
+#define ABORT_POLL_INTERVAL_MS 10
+#define PROGRESS_UPDATE_INTERVAL_MS 100
 
 /*
  * Global instance of QuESTEnv, created when MMA is linked.
@@ -86,10 +170,18 @@
 QuESTEnv env;
 
 /*
- * Collection of instantiated Quregs
+ * Collection of instantiated Quregs, and the precision (1 or 2) of each.
+ * Single-precision quregs (only possible with QUEST_MIXED_PRECISION) are 
+ * instead stored at the same index of singleQuregs
  */
 std::vector<Qureg> quregs;
 std::vector<bool> quregIsCreated;
+std::vector<int> quregPrecisions;
+
+#ifdef QUEST_MIXED_PRECISION
+single::QuESTEnv singleEnv;
+std::vector<single::Qureg> singleQuregs;
+#endif
 
 
 
@@ -111,7 +203,12 @@ public:
 /* channel core-QuEST validation errors into catchable exceptions
  */
 extern "C" void invalidQuESTInputError(const char* errMsg, const char* errFunc) {
-    throw QuESTException(errFunc, errMsg);
+    
+    // the single-precision core (see QUEST_MIXED_PRECISION) reports its prefixed function names
+    std::string func = errFunc;
+    if (func.compare(0, 7, "single_") == 0)
+        func = func.substr(7);
+    throw QuESTException(func, errMsg);
 }
 
 /* Reports an error message to MMA without closing the pipe (more output must follow).
@@ -152,13 +249,24 @@ void local_sendErrorAndAbort(std::string funcName, std::string errMsg) {
     // this closes the pipe; no further WSPut's should follow before control flow returns
 }
 
-void local_throwExcepIfQuregNotCreated(int id) {
+void local_throwExcepIfQuregOfAnyPrecisionNotCreated(int id) {
     if (id < 0)
         throw QuESTException("", "qureg id " + std::to_string(id) + " is invalid (must be >= 0).");
     if (id >= (int) quregs.size() || !quregIsCreated[id])
         throw QuESTException("", "qureg (with id " + std::to_string(id) + ") has not been created");
 }
 
+/* only the functions which use local_throwExcepIfQuregOfAnyPrecisionNotCreated 
+ * instead accept quregs of a precision other than QuEST_PREC
+ */
+void local_throwExcepIfQuregNotCreated(int id) {
+    local_throwExcepIfQuregOfAnyPrecisionNotCreated(id); // throws
+    if (quregPrecisions[id] != QuEST_PREC)
+        throw QuESTException("", "qureg (with id " + std::to_string(id) + ") has precision " + 
+            std::to_string(quregPrecisions[id]) + ", which this function does not support. "
+            "Use CloneQureg to copy it into a qureg of precision " + std::to_string(QuEST_PREC) + ".");
+}
+
 QuESTException local_gateUnsupportedExcep(std::string gate) {
     return QuESTException("", "the gate '" + gate + "' is not supported.");    
 }
@@ -179,31 +287,411 @@ QuESTException local_wrongNumGateTargsExcep(std::string gate, int wrongNumTargs,
 
 
 
+/*
+ * MIXED PRECISION
+ */
+
+/* A qureg of either precision, passed to those functions (like the compiled-gate
+ * kernels) which support quregs of any precision. Without QUEST_MIXED_PRECISION,
+ * this is simply a Qureg. Otherwise, the core functions which are called upon it
+ * are overloaded below to dispatch to the QuEST core of the qureg's precision,
+ * converting any matrix and complex operands to single precision as needed
+ */
+#ifndef QUEST_MIXED_PRECISION
+
+typedef Qureg AnyQureg;
+
+AnyQureg local_getAnyQureg(int id) {
+    return quregs[id];
+}
+
+#else
+
+struct AnyQureg {
+    bool isSingle;
+    int isDensityMatrix;
+    Qureg qureg;               // used only if !isSingle
+    single::Qureg singleQureg; // used only if isSingle
+};
+
+AnyQureg local_getAnyQureg(int id) {
+    AnyQureg q;
+    q.isSingle = (quregPrecisions[id] == 1);
+    q.qureg = quregs[id];
+    q.singleQureg = singleQuregs[id];
+    q.isDensityMatrix = (q.isSingle)? q.singleQureg.isDensityMatrix : q.qureg.isDensityMatrix;
+    return q;
+}
+
+single::Complex local_toSingle(Complex c) {
+    single::Complex s;
+    s.real = c.real;
+    s.imag = c.imag;
+    return s;
+}
+
+template <class SingleMatrix, class Matrix> 
+SingleMatrix local_toSingleMatrix(Matrix& m, int dim) {
+    SingleMatrix s;
+    for (int r=0; r < dim; r++) {
+        for (int c=0; c < dim; c++) {
+            s.real[r][c] = m.real[r][c];
+            s.imag[r][c] = m.imag[r][c];
+        }
+    }
+    return s;
+}
+single::ComplexMatrix2 local_toSingle(ComplexMatrix2 m) {
+    return local_toSingleMatrix<single::ComplexMatrix2>(m, 2);
+}
+single::ComplexMatrix4 local_toSingle(ComplexMatrix4 m) {
+    return local_toSingleMatrix<single::ComplexMatrix4>(m, 4);
+}
+
+/* the returned matrix must be destroyed with single_destroyComplexMatrixN */
+single::ComplexMatrixN local_createSingleMatrixN(ComplexMatrixN m) {
+    single::ComplexMatrixN s = single::single_createComplexMatrixN(m.numQubits); // throws
+    int dim = 1 << m.numQubits;
+    for (int r=0; r < dim; r++) {
+        for (int c=0; c < dim; c++) {
+            s.real[r][c] = m.real[r][c];
+            s.imag[r][c] = m.imag[r][c];
+        }
+    }
+    return s;
+}
+
+/* core functions supported upon single-precision quregs */
+
+void hadamard(AnyQureg q, const int t) {
+    if (q.isSingle) single::single_hadamard(q.singleQureg, t);
+    else hadamard(q.qureg, t);
+}
+void sGate(AnyQureg q, const int t) {
+    if (q.isSingle) single::single_sGate(q.singleQureg, t);
+    else sGate(q.qureg, t);
+}
+void tGate(AnyQureg q, const int t) {
+    if (q.isSingle) single::single_tGate(q.singleQureg, t);
+    else tGate(q.qureg, t);
+}
+void pauliX(AnyQureg q, const int t) {
+    if (q.isSingle) single::single_pauliX(q.singleQureg, t);
+    else pauliX(q.qureg, t);
+}
+void pauliY(AnyQureg q, const int t) {
+    if (q.isSingle) single::single_pauliY(q.singleQureg, t);
+    else pauliY(q.qureg, t);
+}
+void pauliZ(AnyQureg q, const int t) {
+    if (q.isSingle) single::single_pauliZ(q.singleQureg, t);
+    else pauliZ(q.qureg, t);
+}
+void controlledNot(AnyQureg q, const int c, const int t) {
+    if (q.isSingle) single::single_controlledNot(q.singleQureg, c, t);
+    else controlledNot(q.qureg, c, t);
+}
+void controlledPauliY(AnyQureg q, const int c, const int t) {
+    if (q.isSingle) single::single_controlledPauliY(q.singleQureg, c, t);
+    else controlledPauliY(q.qureg, c, t);
+}
+void multiControlledPhaseShift(AnyQureg q, int* qubits, int numQubits, qreal angle) {
+    if (q.isSingle) single::single_multiControlledPhaseShift(q.singleQureg, qubits, numQubits, angle);
+    else multiControlledPhaseShift(q.qureg, qubits, numQubits, angle);
+}
+void multiControlledPhaseFlip(AnyQureg q, int* qubits, int numQubits) {
+    if (q.isSingle) single::single_multiControlledPhaseFlip(q.singleQureg, qubits, numQubits);
+    else multiControlledPhaseFlip(q.qureg, qubits, numQubits);
+}
+void rotateX(AnyQureg q, const int t, qreal angle) {
+    if (q.isSingle) single::single_rotateX(q.singleQureg, t, angle);
+    else rotateX(q.qureg, t, angle);
+}
+void rotateY(AnyQureg q, const int t, qreal angle) {
+    if (q.isSingle) single::single_rotateY(q.singleQureg, t, angle);
+    else rotateY(q.qureg, t, angle);
+}
+void rotateZ(AnyQureg q, const int t, qreal angle) {
+    if (q.isSingle) single::single_rotateZ(q.singleQureg, t, angle);
+    else rotateZ(q.qureg, t, angle);
+}
+void controlledRotateX(AnyQureg q, const int c, const int t, qreal angle) {
+    if (q.isSingle) single::single_controlledRotateX(q.singleQureg, c, t, angle);
+    else controlledRotateX(q.qureg, c, t, angle);
+}
+void controlledRotateY(AnyQureg q, const int c, const int t, qreal angle) {
+    if (q.isSingle) single::single_controlledRotateY(q.singleQureg, c, t, angle);
+    else controlledRotateY(q.qureg, c, t, angle);
+}
+void controlledRotateZ(AnyQureg q, const int c, const int t, qreal angle) {
+    if (q.isSingle) single::single_controlledRotateZ(q.singleQureg, c, t, angle);
+    else controlledRotateZ(q.qureg, c, t, angle);
+}
+void multiRotateZ(AnyQureg q, int* qubits, int numQubits, qreal angle) {
+    if (q.isSingle) single::single_multiRotateZ(q.singleQureg, qubits, numQubits, angle);
+    else multiRotateZ(q.qureg, qubits, numQubits, angle);
+}
+void multiRotatePauli(AnyQureg q, int* targs, pauliOpType* paulis, int numTargs, qreal angle) {
+    if (!q.isSingle) {
+        multiRotatePauli(q.qureg, targs, paulis, numTargs, angle);
+        return;
+    }
+    std::vector<single::pauliOpType> singlePaulis(numTargs);
+    for (int i=0; i < numTargs; i++)
+        singlePaulis[i] = (single::pauliOpType) paulis[i];
+    single::single_multiRotatePauli(q.singleQureg, targs, singlePaulis.data(), numTargs, angle);
+}
+void unitary(AnyQureg q, const int t, ComplexMatrix2 u) {
+    if (q.isSingle) single::single_unitary(q.singleQureg, t, local_toSingle(u));
+    else unitary(q.qureg, t, u);
+}
+void multiControlledUnitary(AnyQureg q, int* ctrls, const int numCtrls, const int t, ComplexMatrix2 u) {
+    if (q.isSingle) single::single_multiControlledUnitary(q.singleQureg, ctrls, numCtrls, t, local_toSingle(u));
+    else multiControlledUnitary(q.qureg, ctrls, numCtrls, t, u);
+}
+void twoQubitUnitary(AnyQureg q, const int t1, const int t2, ComplexMatrix4 u) {
+    if (q.isSingle) single::single_twoQubitUnitary(q.singleQureg, t1, t2, local_toSingle(u));
+    else twoQubitUnitary(q.qureg, t1, t2, u);
+}
+void multiControlledTwoQubitUnitary(AnyQureg q, int* ctrls, const int numCtrls, const int t1, const int t2, ComplexMatrix4 u) {
+    if (q.isSingle) single::single_multiControlledTwoQubitUnitary(q.singleQureg, ctrls, numCtrls, t1, t2, local_toSingle(u));
+    else multiControlledTwoQubitUnitary(q.qureg, ctrls, numCtrls, t1, t2, u);
+}
+void multiControlledMultiQubitUnitary(AnyQureg q, int* ctrls, const int numCtrls, int* targs, const int numTargs, ComplexMatrixN u) {
+    if (!q.isSingle) {
+        multiControlledMultiQubitUnitary(q.qureg, ctrls, numCtrls, targs, numTargs, u);
+        return;
+    }
+    single::ComplexMatrixN singleU = local_createSingleMatrixN(u); // throws
+    try {
+        if (numCtrls == 0)
+            single::single_multiQubitUnitary(q.singleQureg, targs, numTargs, singleU); // throws
+        else
+            single::single_multiControlledMultiQubitUnitary(q.singleQureg, ctrls, numCtrls, targs, numTargs, singleU); // throws
+    } catch (QuESTException& err) {
+        single::single_destroyComplexMatrixN(singleU);
+        throw; // throws
+    }
+    single::single_destroyComplexMatrixN(singleU);
+}
+void multiQubitUnitary(AnyQureg q, int* targs, const int numTargs, ComplexMatrixN u) {
+    if (q.isSingle) multiControlledMultiQubitUnitary(q, NULL, 0, targs, numTargs, u);
+    else multiQubitUnitary(q.qureg, targs, numTargs, u);
+}
+void mixDephasing(AnyQureg q, const int t, qreal prob) {
+    if (q.isSingle) single::single_mixDephasing(q.singleQureg, t, prob);
+    else mixDephasing(q.qureg, t, prob);
+}
+void mixTwoQubitDephasing(AnyQureg q, int t1, int t2, qreal prob) {
+    if (q.isSingle) single::single_mixTwoQubitDephasing(q.singleQureg, t1, t2, prob);
+    else mixTwoQubitDephasing(q.qureg, t1, t2, prob);
+}
+void mixDepolarising(AnyQureg q, const int t, qreal prob) {
+    if (q.isSingle) single::single_mixDepolarising(q.singleQureg, t, prob);
+    else mixDepolarising(q.qureg, t, prob);
+}
+void mixTwoQubitDepolarising(AnyQureg q, int t1, int t2, qreal prob) {
+    if (q.isSingle) single::single_mixTwoQubitDepolarising(q.singleQureg, t1, t2, prob);
+    else mixTwoQubitDepolarising(q.qureg, t1, t2, prob);
+}
+void mixDamping(AnyQureg q, const int t, qreal prob) {
+    if (q.isSingle) single::single_mixDamping(q.singleQureg, t, prob);
+    else mixDamping(q.qureg, t, prob);
+}
+void mixKrausMap(AnyQureg q, int t, ComplexMatrix2* ops, int numOps) {
+    if (!q.isSingle) {
+        mixKrausMap(q.qureg, t, ops, numOps);
+        return;
+    }
+    std::vector<single::ComplexMatrix2> singleOps(numOps);
+    for (int i=0; i < numOps; i++)
+        singleOps[i] = local_toSingle(ops[i]);
+    single::single_mixKrausMap(q.singleQureg, t, singleOps.data(), numOps);
+}
+void mixTwoQubitKrausMap(AnyQureg q, int t1, int t2, ComplexMatrix4* ops, int numOps) {
+    if (!q.isSingle) {
+        mixTwoQubitKrausMap(q.qureg, t1, t2, ops, numOps);
+        return;
+    }
+    std::vector<single::ComplexMatrix4> singleOps(numOps);
+    for (int i=0; i < numOps; i++)
+        singleOps[i] = local_toSingle(ops[i]);
+    single::single_mixTwoQubitKrausMap(q.singleQureg, t1, t2, singleOps.data(), numOps);
+}
+void swapGate(AnyQureg q, int t1, int t2) {
+    if (q.isSingle) single::single_swapGate(q.singleQureg, t1, t2);
+    else swapGate(q.qureg, t1, t2);
+}
+int measure(AnyQureg q, int t) {
+    if (q.isSingle) return single::single_measure(q.singleQureg, t);
+    else return measure(q.qureg, t);
+}
+qreal collapseToOutcome(AnyQureg q, const int t, int outcome) {
+    if (q.isSingle) return single::single_collapseToOutcome(q.singleQureg, t, outcome);
+    else return collapseToOutcome(q.qureg, t, outcome);
+}
+void applyQFT(AnyQureg q, int* qubits, int numQubits) {
+    if (q.isSingle) single::single_applyQFT(q.singleQureg, qubits, numQubits);
+    else applyQFT(q.qureg, qubits, numQubits);
+}
+void applyInverseQFT(AnyQureg q, int* qubits, int numQubits) {
+    if (q.isSingle) single::single_applyInverseQFT(q.singleQureg, qubits, numQubits);
+    else applyInverseQFT(q.qureg, qubits, numQubits);
+}
+void applyGlobalFactor(AnyQureg q, Complex fac) {
+    if (q.isSingle) single::single_applyGlobalFactor(q.singleQureg, local_toSingle(fac));
+    else applyGlobalFactor(q.qureg, fac);
+}
+void initZeroState(AnyQureg q) {
+    if (q.isSingle) single::single_initZeroState(q.singleQureg);
+    else initZeroState(q.qureg);
+}
+void initPlusState(AnyQureg q) {
+    if (q.isSingle) single::single_initPlusState(q.singleQureg);
+    else initPlusState(q.qureg);
+}
+void initClassicalState(AnyQureg q, long long int stateInd) {
+    if (q.isSingle) single::single_initClassicalState(q.singleQureg, stateInd);
+    else initClassicalState(q.qureg, stateInd);
+}
+Complex getAmp(AnyQureg q, long long int index) {
+    if (!q.isSingle)
+        return getAmp(q.qureg, index);
+    single::Complex s = single::single_getAmp(q.singleQureg, index);
+    Complex amp;
+    amp.real = s.real;
+    amp.imag = s.imag;
+    return amp;
+}
+Complex getDensityAmp(AnyQureg q, long long int row, long long int col) {
+    if (!q.isSingle)
+        return getDensityAmp(q.qureg, row, col);
+    single::Complex s = single::single_getDensityAmp(q.singleQureg, row, col);
+    Complex amp;
+    amp.real = s.real;
+    amp.imag = s.imag;
+    return amp;
+}
+qreal calcProbOfOutcome(AnyQureg q, const int t, int outcome) {
+    if (q.isSingle) return single::single_calcProbOfOutcome(q.singleQureg, t, outcome);
+    else return calcProbOfOutcome(q.qureg, t, outcome);
+}
+qreal calcTotalProb(AnyQureg q) {
+    if (q.isSingle) return single::single_calcTotalProb(q.singleQureg);
+    else return calcTotalProb(q.qureg);
+}
+void copyStateFromGPU(AnyQureg q) {
+    if (q.isSingle) single::single_copyStateFromGPU(q.singleQureg);
+    else copyStateFromGPU(q.qureg);
+}
+AnyQureg createCloneQureg(AnyQureg q, QuESTEnv env) {
+    if (q.isSingle) q.singleQureg = single::single_createCloneQureg(q.singleQureg, singleEnv);
+    else q.qureg = createCloneQureg(q.qureg, env);
+    return q;
+}
+
+/* sets target to the state of copy, which has the other precision, by converting every amplitude 
+ * @throws QuESTException if the quregs differ in type or number of qubits (thrower is "")
+ */
+void local_cloneQuregAcrossPrecisions(AnyQureg target, AnyQureg copy) {
+    Qureg qureg = (target.isSingle)? copy.qureg : target.qureg;
+    single::Qureg singleQureg = (target.isSingle)? target.singleQureg : copy.singleQureg;
+    if (qureg.isDensityMatrix != singleQureg.isDensityMatrix || 
+        qureg.numQubitsRepresented != singleQureg.numQubitsRepresented)
+        throw QuESTException("", "The quregs must have the same number of qubits, and both be state-vectors or density matrices."); // throws
+    
+    // commit any lazy factors, so that stateVec can be accessed directly (MIXED_PRECISION is CPU only)
+    copyStateFromGPU(qureg);
+    single::single_copyStateFromGPU(singleQureg);
+    
+    long long int numAmps = qureg.numAmpsTotal;
+    if (target.isSingle) {
+        for (long long int i=0; i < numAmps; i++) {
+            singleQureg.stateVec.real[i] = qureg.stateVec.real[i];
+            singleQureg.stateVec.imag[i] = qureg.stateVec.imag[i];
+        }
+    } else {
+        for (long long int i=0; i < numAmps; i++) {
+            qureg.stateVec.real[i] = singleQureg.stateVec.real[i];
+            qureg.stateVec.imag[i] = singleQureg.stateVec.imag[i];
+        }
+    }
+}
+void cloneQureg(AnyQureg target, AnyQureg copy) {
+    if (target.isSingle != copy.isSingle) local_cloneQuregAcrossPrecisions(target, copy); // throws
+    else if (target.isSingle) single::single_cloneQureg(target.singleQureg, copy.singleQureg);
+    else cloneQureg(target.qureg, copy.qureg);
+}
+void destroyQureg(AnyQureg q, QuESTEnv env) {
+    if (q.isSingle) single::single_destroyQureg(q.singleQureg, singleEnv);
+    else destroyQureg(q.qureg, env);
+}
+
+#endif
+
+
+
+
 /* 
  * QUREG MANAGEMENT
  */
 
+/* returns the id of the next free qureg, which has default precision QuEST_PREC 
+ * unless changed by the caller upon creating it
+ */
 size_t local_getNextQuregID(void) {
     size_t id;
     
     // check for next id
     for (id=0; id < quregs.size(); id++)
-        if (!quregIsCreated[id])
+        if (!quregIsCreated[id]) {
+            quregPrecisions[id] = QuEST_PREC;
             return id;
+        }
             
     // if none are available, make more space (using a blank Qureg)
     Qureg blank;
     id = quregs.size();
     quregs.push_back(blank);
     quregIsCreated.push_back(false);
+    quregPrecisions.push_back(QuEST_PREC);
+#ifdef QUEST_MIXED_PRECISION
+    singleQuregs.push_back(single::Qureg());
+#endif
+    return id;
+}
+
+/* creates a state-vector or density matrix of the given precision, and returns its id
+ * @throws QuESTException if the precision is unsupported, or the core fails validation
+ */
+size_t local_createQuregOfPrecision(int numQubits, int isDensity, int precision) {
+#ifdef QUEST_MIXED_PRECISION
+    if (precision != 1 && precision != 2)
+        throw QuESTException("", "Invalid precision. Must be 1 (single) or 2 (double)."); // throws
+#else
+    if (precision != QuEST_PREC)
+        throw QuESTException("", "Invalid precision. This quest_link was compiled without "
+            "MIXED_PRECISION, so supports only precision " + std::to_string(QuEST_PREC) + "."); // throws
+#endif
+    
+    size_t id = local_getNextQuregID();
+    if (precision == QuEST_PREC)
+        quregs[id] = (isDensity)? 
+            createDensityQureg(numQubits, env) : createQureg(numQubits, env); // throws
+#ifdef QUEST_MIXED_PRECISION
+    else
+        singleQuregs[id] = (isDensity)? 
+            single::single_createDensityQureg(numQubits, singleEnv) : 
+            single::single_createQureg(numQubits, singleEnv); // throws
+#endif
+    quregPrecisions[id] = precision;
+    quregIsCreated[id] = true;
     return id;
 }
 
 void wrapper_createQureg(int numQubits) {
     try { 
-        size_t id = local_getNextQuregID();
-        quregs[id] = createQureg(numQubits, env); // throws
-        quregIsCreated[id] = true;
+        size_t id = local_createQuregOfPrecision(numQubits, 0, QuEST_PREC); // throws
         WSPutInteger(stdlink, id);
         
     } catch( QuESTException& err) {
@@ -212,22 +700,64 @@ void wrapper_createQureg(int numQubits) {
 }
 
 void wrapper_createDensityQureg(int numQubits) {
+    try { 
+        size_t id = local_createQuregOfPrecision(numQubits, 1, QuEST_PREC); // throws
+        WSPutInteger(stdlink, id);
+        
+    } catch( QuESTException& err) {
+        local_sendErrorAndFail("CreateDensityQureg", err.message);
+    }
+}
+
+void callable_createQuregOfPrecision(int numQubits, int precision) {
+    try { 
+        size_t id = local_createQuregOfPrecision(numQubits, 0, precision); // throws
+        WSPutInteger(stdlink, id);
+        
+    } catch( QuESTException& err) {
+        local_sendErrorAndFail("CreateQureg", err.message);
+    }
+}
+
+void callable_createDensityQuregOfPrecision(int numQubits, int precision) {
+    try { 
+        size_t id = local_createQuregOfPrecision(numQubits, 1, precision); // throws
+        WSPutInteger(stdlink, id);
+        
+    } catch( QuESTException& err) {
+        local_sendErrorAndFail("CreateDensityQureg", err.message);
+    }
+}
+
+void internal_createDiskQureg(int numQubits, const char* filename) {
     try { 
         size_t id = local_getNextQuregID();
-        quregs[id] = createDensityQureg(numQubits, env); // throws
+        quregs[id] = createDiskQureg(numQubits, (char*) filename, env); // throws
         quregIsCreated[id] = true;
         WSPutInteger(stdlink, id);
         
     } catch( QuESTException& err) {
-        local_sendErrorAndFail("CreateDensityQureg", err.message);
+        local_sendErrorAndFail("CreateDiskQureg", err.message);
+    }
+}
+
+void internal_createDensityDiskQureg(int numQubits, const char* filename) {
+    try { 
+        size_t id = local_getNextQuregID();
+        quregs[id] = createDensityDiskQureg(numQubits, (char*) filename, env); // throws
+        quregIsCreated[id] = true;
+        WSPutInteger(stdlink, id);
+        
+    } catch( QuESTException& err) {
+        local_sendErrorAndFail("CreateDensityDiskQureg", err.message);
     }
 }
 
 void wrapper_destroyQureg(int id) {
     try { 
-        local_throwExcepIfQuregNotCreated(id); // throws
+        local_throwExcepIfQuregOfAnyPrecisionNotCreated(id); // throws
         
-        destroyQureg(quregs[id], env); // throws
+        destroyQureg(local_getAnyQureg(id), env); // throws
         quregIsCreated[id] = false;
         WSPutInteger(stdlink, id);
 
@@ -236,14 +766,28 @@ void wrapper_destroyQureg(int id) {
     }
 }
 
+void local_releaseFreedQuregMemory(void) {
+    releaseFreedQuregMemory(env);
+#ifdef QUEST_MIXED_PRECISION
+    single::single_releaseFreedQuregMemory(singleEnv);
+#endif
+}
+
 void callable_destroyAllQuregs(void) {
     
     for (size_t id=0; id < quregs.size(); id++) {
         if (quregIsCreated[id]) {
-            destroyQureg(quregs[id], env);
+            destroyQureg(local_getAnyQureg(id), env);
             quregIsCreated[id] = false;
         }
     }
+    local_releaseFreedQuregMemory();
+    WSPutSymbol(stdlink, "Null");
+}
+
+void callable_releaseFreedMemory(void) {
+    
+    local_releaseFreedQuregMemory();
     WSPutSymbol(stdlink, "Null");
 }
 
@@ -319,10 +863,10 @@ void internal_getAmp(int quregID) {
     long long int col = (long long int) rawCol;
     
     try { 
-        local_throwExcepIfQuregNotCreated(quregID); // throws
+        local_throwExcepIfQuregOfAnyPrecisionNotCreated(quregID); // throws
         
         // ensure user supplied the correct number of args for the qureg type
-        Qureg qureg = quregs[quregID];
+        AnyQureg qureg = local_getAnyQureg(quregID);
         if (qureg.isDensityMatrix && col==-1)
             throw QuESTException("", "Called on a density matrix without supplying both row and column."); // throws
         if (!qureg.isDensityMatrix && col!=-1)
@@ -347,8 +891,8 @@ void internal_getAmp(int quregID) {
 
 void callable_isDensityMatrix(int quregID) {
     try { 
-        local_throwExcepIfQuregNotCreated(quregID); // throws
-        Qureg qureg = quregs[quregID];
+        local_throwExcepIfQuregOfAnyPrecisionNotCreated(quregID); // throws
+        AnyQureg qureg = local_getAnyQureg(quregID);
         WSPutInteger(stdlink, qureg.isDensityMatrix);
         
     } catch( QuESTException& err) {
@@ -356,6 +900,16 @@ void callable_isDensityMatrix(int quregID) {
     }
 }
 
+void callable_getQuregPrecision(int quregID) {
+    try { 
+        local_throwExcepIfQuregOfAnyPrecisionNotCreated(quregID); // throws
+        WSPutInteger(stdlink, quregPrecisions[quregID]);
+        
+    } catch( QuESTException& err) {
+        local_sendErrorAndFail("GetQuregPrecision", err.message);
+    }
+}
+
 /* puts a Qureg into MMA, with the structure of
  * {numQubits, isDensityMatrix, realAmps, imagAmps}.
  * Instead gives -1 if error (e.g. qureg id is wrong)
@@ -365,7 +919,21 @@ void internal_getQuregMatrix(int id) {
     // superflous try-catch, but we want to grab the quregNotCreated error message
     // (and this also keeps the pattern consistent)
     try {
-        local_throwExcepIfQuregNotCreated(id); // throws
+        local_throwExcepIfQuregOfAnyPrecisionNotCreated(id); // throws
+        
+#ifdef QUEST_MIXED_PRECISION
+        if (quregPrecisions[id] == 1) {
+            single::Qureg qureg = singleQuregs[id];
+            single::single_copyStateFromGPU(qureg); // commits the lazy factor
+            
+            WSPutFunction(stdlink, "List", 4);
+            WSPutInteger(stdlink, qureg.numQubitsRepresented);
+            WSPutInteger(stdlink, qureg.isDensityMatrix);
+            WSPutReal32List(stdlink, qureg.stateVec.real, qureg.numAmpsTotal);
+            WSPutReal32List(stdlink, qureg.stateVec.imag, qureg.numAmpsTotal);
+            return;
+        }
+#endif
     
         Qureg qureg = quregs[id];
         syncQuESTEnv(env);       // does nothing on local
@@ -406,8 +974,8 @@ void callable_getAllQuregs(void) {
 
 void wrapper_initZeroState(int id) {
     try {
-        local_throwExcepIfQuregNotCreated(id); // throws
-        initZeroState(quregs[id]);
+        local_throwExcepIfQuregOfAnyPrecisionNotCreated(id); // throws
+        initZeroState(local_getAnyQureg(id));
         WSPutInteger(stdlink, id);
         
     } catch( QuESTException& err) {
@@ -417,8 +985,8 @@ void wrapper_initZeroState(int id) {
 
 void wrapper_initPlusState(int id) {
     try {
-        local_throwExcepIfQuregNotCreated(id); // throws
-        initPlusState(quregs[id]);
+        local_throwExcepIfQuregOfAnyPrecisionNotCreated(id); // throws
+        initPlusState(local_getAnyQureg(id));
         WSPutInteger(stdlink, id);
         
     } catch( QuESTException& err) {
@@ -428,8 +996,8 @@ void wrapper_initPlusState(int id) {
 
 void wrapper_initClassicalState(int id, int stateInd) {
     try {
-        local_throwExcepIfQuregNotCreated(id); // throws
-        initClassicalState(quregs[id], stateInd); // throws
+        local_throwExcepIfQuregOfAnyPrecisionNotCreated(id); // throws
+        initClassicalState(local_getAnyQureg(id), stateInd); // throws
         WSPutInteger(stdlink, id);
         
     } catch( QuESTException& err) {
@@ -467,9 +1035,9 @@ void wrapper_initStateFromAmps(int quregID, qreal* reals, long l1, qreal* imags,
 
 void wrapper_cloneQureg(int outID, int inID) {
     try {
-        local_throwExcepIfQuregNotCreated(outID); // throws
-        local_throwExcepIfQuregNotCreated(inID); // throws
-        cloneQureg(quregs[outID], quregs[inID]); // throws
+        local_throwExcepIfQuregOfAnyPrecisionNotCreated(outID); // throws
+        local_throwExcepIfQuregOfAnyPrecisionNotCreated(inID); // throws
+        cloneQureg(local_getAnyQureg(outID), local_getAnyQureg(inID)); // throws
         WSPutInteger(stdlink, outID);
         
     } catch( QuESTException& err) {
@@ -477,6 +1045,28 @@ void wrapper_cloneQureg(int outID, int inID) {
     }
 }
 
+void internal_saveQureg(int quregID, const char* filename) {
+    try {
+        local_throwExcepIfQuregNotCreated(quregID); // throws
+        saveQureg(quregs[quregID], (char*) filename); // throws
+        WSPutInteger(stdlink, quregID);
+        
+    } catch( QuESTException& err) {
+        local_sendErrorAndFail("SaveQureg", err.message);
+    }
+}
+
+void internal_loadQureg(int quregID, const char* filename) {
+    try {
+        local_throwExcepIfQuregNotCreated(quregID); // throws
+        loadQureg(quregs[quregID], (char*) filename); // throws
+        WSPutInteger(stdlink, quregID);
+        
+    } catch( QuESTException& err) {
+        local_sendErrorAndFail("LoadQureg", err.message);
+    }
+}
+
 
 
 
@@ -593,8 +1183,8 @@ void wrapper_mixDamping(int id, int qb, qreal prob) {
 
 void wrapper_calcProbOfOutcome(int id, int qb, int outcome) {
     try {
-        local_throwExcepIfQuregNotCreated(id); // throws
-        qreal prob = calcProbOfOutcome(quregs[id], qb, outcome); // throws
+        local_throwExcepIfQuregOfAnyPrecisionNotCreated(id); // throws
+        qreal prob = calcProbOfOutcome(local_getAnyQureg(id), qb, outcome); // throws
         WSPutReal64(stdlink, prob); 
         
     } catch( QuESTException& err) {
@@ -653,8 +1243,8 @@ void wrapper_calcPurity(int id) {
 
 void wrapper_calcTotalProb(int id) {
     try {
-        local_throwExcepIfQuregNotCreated(id); // throws
-        qreal prob = calcTotalProb(quregs[id]); // throws
+        local_throwExcepIfQuregOfAnyPrecisionNotCreated(id); // throws
+        qreal prob = calcTotalProb(local_getAnyQureg(id)); // throws
         WSPutReal64(stdlink, prob);
     
     } catch( QuESTException& err) {
@@ -757,39 +1347,37 @@ void internal_calcDensityInnerProductsMatrix(int* quregIds, long numQuregs) {
     
     // init to NULL so we can later check if it needs cleanup
     qreal* matr = NULL;
+    Qureg* quregList = NULL;
     
     try {
         // check all quregs are created
         for (int i=0; i<numQuregs; i++)
             local_throwExcepIfQuregNotCreated(quregIds[i]); // throws
             
+        // gather the quregs, so that each is read only once
+        quregList = (Qureg*) malloc(numQuregs * sizeof *quregList);
+        for (int i=0; i<numQuregs; i++)
+            quregList[i] = quregs[quregIds[i]];
+            
         // store real matrix as `nested pointers`
         long len = numQuregs * numQuregs;
         matr = (qreal*) malloc(len * sizeof *matr);
-        
-        // compute matrix (exploiting matrix is symmetric)
-        for (int r=0; r<numQuregs; r++) {
-            for (int c=0; c<numQuregs; c++) {
-                if (c >= r) {
-                    qreal val = calcDensityInnerProduct(quregs[quregIds[r]], quregs[quregIds[c]]); // throws
-                    matr[r*numQuregs + c] = val;
-                } else {
-                    matr[r*numQuregs + c] = matr[c*numQuregs + r];
-                }
-            }
-        }
+        calcDensityInnerProductsMatrix(quregList, numQuregs, matr); // throws
         
         // return
         WSPutReal64List(stdlink, matr, len);
         
         // clean-up
         free(matr);
+        free(quregList);
         
     } catch (QuESTException& err) {
         
         // may still need clean-up
         if (matr != NULL)
             free(matr);
+        if (quregList != NULL)
+            free(quregList);
             
         // send error and exit
         local_sendErrorAndFail("CalcDensityInnerProducts", err.message);
@@ -802,30 +1390,23 @@ void internal_calcInnerProductsMatrix(int* quregIds, long numQuregs) {
     // init to NULL so we can later check if it needs cleanup
     qreal* matrRe = NULL;
     qreal* matrIm = NULL;
+    Qureg* quregList = NULL;
     
     try {
         // check all quregs are created
         for (int i=0; i<numQuregs; i++)
             local_throwExcepIfQuregNotCreated(quregIds[i]); // throws
+            
+        // gather the quregs, so that each is read only once
+        quregList = (Qureg*) malloc(numQuregs * sizeof *quregList);
+        for (int i=0; i<numQuregs; i++)
+            quregList[i] = quregs[quregIds[i]];
     
         // store complex matrix as 2 flat real arrays
         long len = numQuregs * numQuregs;
         matrRe = (qreal*) malloc(len * sizeof *matrRe);
         matrIm = (qreal*) malloc(len * sizeof *matrIm);
-    
-        // compute elems, exploiting matrix is Hermitian
-        for (int r=0; r<numQuregs; r++) {
-            for (int c=0; c<numQuregs; c++) {
-                if (c >= r) {
-                    Complex val = calcInnerProduct(quregs[quregIds[r]], quregs[quregIds[c]]); // throws
-                    matrRe[r*numQuregs + c] = val.real;
-                    matrIm[r*numQuregs + c] = val.imag;
-                } else {
-                    matrRe[r*numQuregs + c] =   matrRe[c*numQuregs + r];
-                    matrIm[r*numQuregs + c] = - matrIm[c*numQuregs + r]; // conjugate transpose
-                }
-            }
-        }
+        calcInnerProductsMatrix(quregList, numQuregs, matrRe, matrIm); // throws
         
         // return
         WSPutFunction(stdlink, "List", 2);
@@ -835,6 +1416,7 @@ void internal_calcInnerProductsMatrix(int* quregIds, long numQuregs) {
         // cleanup
         free(matrRe);
         free(matrIm);
+        free(quregList);
         
     } catch (QuESTException& err) {
         
@@ -843,6 +1425,8 @@ void internal_calcInnerProductsMatrix(int* quregIds, long numQuregs) {
             free(matrRe);
         if (matrIm != NULL)
             free(matrIm);
+        if (quregList != NULL)
+            free(quregList);
             
         local_sendErrorAndFail("CalcInnerProducts", err.message);
     }
@@ -855,15 +1439,6 @@ void internal_calcInnerProductsMatrix(int* quregIds, long numQuregs) {
  * CIRCUIT EXECUTION 
  */
 
-int* local_prepareCtrlCache(int* ctrls, int ctrlInd, int numCtrls, int addTarg) {
-    static int ctrlCache[MAX_NUM_TARGS_CTRLS]; 
-    for (int i=0; i < numCtrls; i++)
-        ctrlCache[i] = ctrls[ctrlInd + i];
-    if (addTarg != -1)
-        ctrlCache[numCtrls] = addTarg;
-    return ctrlCache;
-}
-
 ComplexMatrix2 local_getMatrix2FromFlatList(qreal* list) {
     int dim = 2;
     ComplexMatrix2 m;
@@ -895,435 +1470,752 @@ void local_setMatrixNFromFlatList(qreal* list, ComplexMatrixN m, int numQubits)
         }
 }
 
-/* updates the CIRC_PROGRESS_VAR in the front-end with the new passed value 
- * which must lie in [0, 1]. This can be used to indicate progress of a long 
- * evaluation to the user 
+struct CompiledGate;
+
+/* A function which effects a compiled gate upon a qureg (of either precision) via the core API,
+ * specialised to the gate's opcode and number of controls and targets.
+ * mesOutcomeCache may be NULL, else the outcome of any measurement is written 
+ * to mesOutcomeCache[*mesInd], and mesInd incremented
+ * @throws QuESTException if a core-QuEST function fails validation (in this case,
+ *      exception.thrower will be the name of the throwing core API function)
  */
-void local_updateCircuitProgress(qreal progress) {
+typedef void (*GateKernel)(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd);
+
+/* A single gate of a circuit, decoded from the flat lists sent by MMA.
+ * The gate's link-side validation (of its number of controls, targets and 
+ * parameters) is performed once when it is compiled, at which time the kernel
+ * which effects it is chosen, and any matrices or qubit 
+ * lists it needs are pre-built. Fields ctrls, targs and params point into 
+ * the flat lists of the owning CompiledCircuit.
+ */
+struct CompiledGate {
+    GateKernel apply;
+    int opcode;
+    int numCtrls;
+    int numTargs;
+    int numParams;
+    int* ctrls;
+    int* targs;
+    qreal* params;
+    
+    // operands pre-built by compilation (which are populated depends on opcode)
+    Complex alpha;
+    qreal angle;
+    std::vector<int> ctrlsAndTarg;
+    std::vector<int> outcomes;
+    std::vector<pauliOpType> paulis;
+    std::vector<ComplexMatrix2> matrs2;
+    std::vector<ComplexMatrix4> matrs4;
+    ComplexMatrixN matrN;
+    bool hasMatrN;
+};
 
-    // send new packet to MMA
-    WSPutFunction(stdlink, "EvaluatePacket", 1);
+/* A circuit, retaining its encoding as sent by MMA (so that its parameters 
+ * can later be rebound), and its compiled gates 
+ */
+struct CompiledCircuit {
+    std::vector<int> opcodes;
+    std::vector<int> ctrls;
+    std::vector<int> numCtrlsPerOp;
+    std::vector<int> targs;
+    std::vector<int> numTargsPerOp;
+    std::vector<qreal> params;
+    std::vector<int> numParamsPerOp;
+    
+    // index of each gate's first parameter in params
+    std::vector<int> paramIndPerOp;
+    
+    std::vector<CompiledGate> gates;
+    int numMesGates;
+    int numMeasurements;
+};
 
-    // echo the message
-    WSPutFunction(stdlink, "Set", 2);
-    WSPutSymbol(stdlink, CIRC_PROGRESS_VAR);
-    WSPutReal64(stdlink, progress);
+/*
+ * Collection of compiled circuits (created by CreateCircuit), NULL once destroyed
+ */
+std::vector<CompiledCircuit*> circuits;
 
-    WSEndPacket(stdlink);
-    WSNextPacket(stdlink);
-    WSNewPacket(stdlink);
+size_t local_getNextCircuitID(void) {
+    size_t id;
     
-    // a new packet is now expected; caller MUST send something else
-}
-
-/* @param mesOutcomeCache may be NULL
- * @param finalCtrlInd, finalTargInd and finalParamInd are modified to point to 
- *  the final values of ctrlInd, targInd and paramInd, after the #numOps operation 
- *  has been applied. If #numOps isn't smaller than the actual length of the 
- *  circuit arrays, these indices will point out of bounds.
- * @throws QuESTException if a core-QuEST function fails validation (in this case,
- *      exception.thrower will be the name of the throwing core API function),
- *      or if a QuESTlink validation herein fails (exception.thrower will be ""),
- *      or if evaluation is aborted (exception.throw = "Abort")
+    // check for next id
+    for (id=0; id < circuits.size(); id++)
+        if (circuits[id] == NULL)
+            return id;
+            
+    // if none are available, make more space
+    id = circuits.size();
+    circuits.push_back(NULL);
+    return id;
+}
+
+void local_throwExcepIfCircuitNotCreated(int id) {
+    if (id < 0)
+        throw QuESTException("", "circuit id " + std::to_string(id) + " is invalid (must be >= 0).");
+    if (id >= (int) circuits.size() || circuits[id] == NULL)
+        throw QuESTException("", "circuit (with id " + std::to_string(id) + ") has not been created");
+}
+
+ComplexMatrix2 local_getPauliXMatrix2(void) {
+    ComplexMatrix2 u;
+    u.real[0][0] = 0; u.real[0][1] = 1; // verbose for old MSVC
+    u.real[1][0] = 1; u.real[1][1] = 0;
+    u.imag[0][0] = 0; u.imag[0][1] = 0;
+    u.imag[1][0] = 0; u.imag[1][1] = 0;
+    return u;
+}
+
+/*
+ * Gate kernels, chosen once by local_compileGate
  */
-void local_applyGates(
-    Qureg qureg, 
-    int numOps, int* opcodes, 
-    int* ctrls, int* numCtrlsPerOp, 
-    int* targs, int* numTargsPerOp, 
-    qreal* params, int* numParamsPerOp,
-    int* mesOutcomeCache,
-    int* finalCtrlInd, int* finalTargInd, int* finalParamInd,
-    int showProgress
-    ) {
+ 
+void local_applyNothing(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+}
+void local_applyHadamard(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    hadamard(qureg, gate.targs[0]); // throws
+}
+void local_applySGate(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    sGate(qureg, gate.targs[0]); // throws
+}
+void local_applyTGate(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    tGate(qureg, gate.targs[0]); // throws
+}
+void local_applyMultiControlledPhaseShift(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    multiControlledPhaseShift(qureg, gate.ctrlsAndTarg.data(), gate.numCtrls+1, gate.angle); // throws
+}
+void local_applyPauliX(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    pauliX(qureg, gate.targs[0]); // throws
+}
+void local_applyControlledNot(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    controlledNot(qureg, gate.ctrls[0], gate.targs[0]); // throws
+}
+void local_applyPauliY(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    pauliY(qureg, gate.targs[0]); // throws
+}
+void local_applyControlledPauliY(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    controlledPauliY(qureg, gate.ctrls[0], gate.targs[0]); // throws
+}
+void local_applyPauliZ(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    pauliZ(qureg, gate.targs[0]); // throws
+}
+void local_applyMultiControlledPhaseFlip(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    multiControlledPhaseFlip(qureg, gate.ctrlsAndTarg.data(), gate.numCtrls+1); // throws
+}
+void local_applyRotateX(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    rotateX(qureg, gate.targs[0], gate.params[0]); // throws
+}
+void local_applyControlledRotateX(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    controlledRotateX(qureg, gate.ctrls[0], gate.targs[0], gate.params[0]); // throws
+}
+void local_applyRotateY(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    rotateY(qureg, gate.targs[0], gate.params[0]); // throws
+}
+void local_applyControlledRotateY(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    controlledRotateY(qureg, gate.ctrls[0], gate.targs[0], gate.params[0]); // throws
+}
+void local_applyRotateZ(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    rotateZ(qureg, gate.targs[0], gate.params[0]); // throws
+}
+void local_applyControlledRotateZ(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    controlledRotateZ(qureg, gate.ctrls[0], gate.targs[0], gate.params[0]); // throws
+}
+void local_applyMultiRotateZ(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    multiRotateZ(qureg, gate.targs, gate.numTargs, gate.params[0]); // throws
+}
+void local_applyMultiRotatePauli(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    multiRotatePauli(qureg, gate.targs, gate.paulis.data(), gate.numTargs, gate.params[0]); // throws
+}
+void local_applyUnitary(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    unitary(qureg, gate.targs[0], gate.matrs2[0]); // throws
+}
+void local_applyMultiControlledUnitary(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    multiControlledUnitary(qureg, gate.ctrls, gate.numCtrls, gate.targs[0], gate.matrs2[0]); // throws
+}
+void local_applyTwoQubitUnitary(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    twoQubitUnitary(qureg, gate.targs[0], gate.targs[1], gate.matrs4[0]); // throws
+}
+void local_applyMultiControlledTwoQubitUnitary(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    multiControlledTwoQubitUnitary(qureg, gate.ctrls, gate.numCtrls, gate.targs[0], gate.targs[1], gate.matrs4[0]); // throws
+}
+void local_applyMultiQubitUnitary(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    multiQubitUnitary(qureg, gate.targs, gate.numTargs, gate.matrN); // throws
+}
+void local_applyMultiControlledMultiQubitUnitary(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    multiControlledMultiQubitUnitary(qureg, gate.ctrls, gate.numCtrls, gate.targs, gate.numTargs, gate.matrN); // throws
+}
+void local_applyDephasing(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    mixDephasing(qureg, gate.targs[0], gate.params[0]); // throws
+}
+void local_applyTwoQubitDephasing(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    mixTwoQubitDephasing(qureg, gate.targs[0], gate.targs[1], gate.params[0]); // throws
+}
+void local_applyDepolarising(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    mixDepolarising(qureg, gate.targs[0], gate.params[0]); // throws
+}
+void local_applyTwoQubitDepolarising(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    mixTwoQubitDepolarising(qureg, gate.targs[0], gate.targs[1], gate.params[0]); // throws
+}
+void local_applyDamping(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    mixDamping(qureg, gate.targs[0], gate.params[0]); // throws
+}
+void local_applySwapGate(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    swapGate(qureg, gate.targs[0], gate.targs[1]); // throws
+}
+void local_applyMultiControlledSwapGate(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    // core-QuEST doesn't yet support multiControlledSwapGate, 
+    // so we construct SWAP from 3 CNOT's, and add additional controls
+    int* ctrlsAndTarg = gate.ctrlsAndTarg.data();
+    int numCtrls = gate.numCtrls;
+    int* targs = gate.targs;
+    ctrlsAndTarg[numCtrls] = targs[0];
+    multiControlledUnitary(qureg, ctrlsAndTarg, numCtrls+1, targs[1], gate.matrs2[0]); // throws
+    ctrlsAndTarg[numCtrls] = targs[1];
+    multiControlledUnitary(qureg, ctrlsAndTarg, numCtrls+1, targs[0], gate.matrs2[0]);
+    ctrlsAndTarg[numCtrls] = targs[0];
+    multiControlledUnitary(qureg, ctrlsAndTarg, numCtrls+1, targs[1], gate.matrs2[0]);
+}
+void local_applyMeasurement(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    for (int q=0; q < gate.numTargs; q++) {
+        int outcomeVal = measure(qureg, gate.targs[q]); // throws
+        if (mesOutcomeCache != NULL)
+            mesOutcomeCache[(*mesInd)++] = outcomeVal;
+    }
+}
+void local_applyProjector(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    for (size_t q=0; q < gate.outcomes.size(); q++)
+        collapseToOutcome(qureg, gate.targs[q], gate.outcomes[q]); // throws
+}
+void local_applyKrausMap(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    mixKrausMap(qureg, gate.targs[0], gate.matrs2.data(), (int) gate.matrs2.size()); // throws
+}
+void local_applyTwoQubitKrausMap(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    mixTwoQubitKrausMap(qureg, gate.targs[0], gate.targs[1], gate.matrs4.data(), (int) gate.matrs4.size()); // throws
+}
+void local_applyQFT(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    applyQFT(qureg, gate.targs, gate.numTargs); // throws
+}
+void local_applyInverseQFT(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    applyInverseQFT(qureg, gate.targs, gate.numTargs); // throws
+}
+void local_applyGlobalPhase(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    // phase does not change density matrices, and is applied lazily to state-vectors
+    if (!qureg.isDensityMatrix)
+        applyGlobalFactor(qureg, gate.alpha);
+}
+void local_applyReset(AnyQureg qureg, CompiledGate& gate, int* mesOutcomeCache, int* mesInd) {
+    for (int q=0; q < gate.numTargs; q++) {
+        // density matrices undergo the channel {|0><0|, |0><1|}, state-vectors are measured and corrected
+        if (qureg.isDensityMatrix)
+            mixKrausMap(qureg, gate.targs[q], gate.matrs2.data(), (int) gate.matrs2.size()); // throws
+        else if (measure(qureg, gate.targs[q]) == 1) // throws
+            pauliX(qureg, gate.targs[q]);
+    }
+}
+
+/* validates the gate's number of controls, targets and parameters, chooses 
+ * its kernel and (re)builds its operands from its current parameters. This is called
+ * again whenever the gate's parameters are rebound.
+ * @throws QuESTException if the gate is invalid (exception.thrower will be "")
+ */
+void local_compileGate(CompiledGate& gate) {
+    
+    int op = gate.opcode;
+    int numCtrls = gate.numCtrls;
+    int numTargs = gate.numTargs;
+    int numParams = gate.numParams;
+    qreal* params = gate.params;
+    
+    // controls followed by (the first) target, for gates effected as multi-controlled phases
+    gate.ctrlsAndTarg.assign(gate.ctrls, gate.ctrls + numCtrls);
+    if (numTargs > 0)
+        gate.ctrlsAndTarg.push_back(gate.targs[0]);
+    
+    switch(op) {
         
-    int ctrlInd = 0;
-    int targInd = 0;
-    int paramInd = 0;
-    int mesInd = 0;
+        case OPCODE_H :
+            if (numParams != 0)
+                throw local_wrongNumGateParamsExcep("Hadamard", numParams, 0); // throws
+            if (numCtrls != 0)
+                throw local_gateUnsupportedExcep("controlled Hadamard"); // throws
+            if (numTargs != 1)
+                throw local_wrongNumGateTargsExcep("Hadamard", numTargs, "1 target"); // throws
+            gate.apply = local_applyHadamard;
+            break;
+            
+        case OPCODE_S :
+            if (numParams != 0)
+                throw local_wrongNumGateParamsExcep("S gate", numParams, 0); // throws
+            if (numTargs != 1)
+                throw local_wrongNumGateTargsExcep("S gate", numTargs, "1 target"); // throws
+            gate.angle = M_PI/2;
+            gate.apply = (numCtrls == 0)? local_applySGate : local_applyMultiControlledPhaseShift;
+            break;
+            
+        case OPCODE_T :
+            if (numParams != 0)
+                throw local_wrongNumGateParamsExcep("T gate", numParams, 0); // throws
+            if (numTargs != 1)
+                throw local_wrongNumGateTargsExcep("T gate", numTargs, "1 target"); // throws
+            gate.angle = M_PI/4;
+            gate.apply = (numCtrls == 0)? local_applyTGate : local_applyMultiControlledPhaseShift;
+            break;
     
-    // attempt to apply each gate
-    for (int opInd=0; opInd < numOps; opInd++) {
-                
-        // check whether the user has tried to abort
-        if (WSMessageReady(stdlink)) {
-            int code, arg;
-            WSGetMessage(stdlink, &code, &arg);
-            if (code == WSTerminateMessage || code == WSInterruptMessage || 
-                code == WSAbortMessage     || code == WSImDyingMessage) {
-                    
-                throw QuESTException("Abort", "Circuit simulation aborted."); // throws
+        case OPCODE_X :
+            if (numParams != 0)
+                throw local_wrongNumGateParamsExcep("X", numParams, 0); // throws
+            if (numTargs != 1)
+                throw local_wrongNumGateTargsExcep("X", numTargs, "1 target"); // throws
+            if (numCtrls > 1)
+                gate.matrs2.assign(1, local_getPauliXMatrix2());
+            if (numCtrls == 0)
+                gate.apply = local_applyPauliX;
+            else if (numCtrls == 1)
+                gate.apply = local_applyControlledNot;
+            else
+                gate.apply = local_applyMultiControlledUnitary;
+            break;
+            
+        case OPCODE_Y :
+            if (numParams != 0)
+                throw local_wrongNumGateParamsExcep("Y", numParams, 0); // throws
+            if (numTargs != 1)
+                throw local_wrongNumGateTargsExcep("Y", numTargs, "1 target"); // throws
+            if (numCtrls > 1)
+                throw local_gateUnsupportedExcep("controlled Y"); // throws
+            gate.apply = (numCtrls == 0)? local_applyPauliY : local_applyControlledPauliY;
+            break;
+            
+        case OPCODE_Z :
+            if (numParams != 0)
+                throw local_wrongNumGateParamsExcep("Z", numParams, 0); // throws
+            if (numTargs != 1)
+                throw local_wrongNumGateTargsExcep("Z", numTargs, "1 target"); // throws
+            gate.apply = (numCtrls == 0)? local_applyPauliZ : local_applyMultiControlledPhaseFlip;
+            break;
+    
+        case OPCODE_Rx :
+            if (numParams != 1)
+                throw local_wrongNumGateParamsExcep("Rx", numParams, 1); // throws
+            if (numTargs != 1)
+                throw local_wrongNumGateTargsExcep("Rx", numTargs, "1 target"); // throws
+            if (numCtrls > 1)
+                throw local_gateUnsupportedExcep("multi-controlled Rotate X"); // throws
+            gate.apply = (numCtrls == 0)? local_applyRotateX : local_applyControlledRotateX;
+            break;
+            
+        case OPCODE_Ry :
+            if (numParams != 1)
+                throw local_wrongNumGateParamsExcep("Ry", numParams, 1); // throws
+            if (numTargs != 1)
+                throw local_wrongNumGateTargsExcep("Ry", numTargs, "1 target"); // throws
+            if (numCtrls > 1)
+                throw local_gateUnsupportedExcep("multi-controlled Rotate Y"); // throws
+            gate.apply = (numCtrls == 0)? local_applyRotateY : local_applyControlledRotateY;
+            break;
+            
+        case OPCODE_Rz :
+            if (numParams != 1)
+                throw local_wrongNumGateParamsExcep("Rz", numParams, 1); // throws
+            if (numCtrls > 1)
+                throw local_gateUnsupportedExcep("multi-controlled Rotate Z"); // throws
+            if (numCtrls == 1 && numTargs > 1)
+                throw local_gateUnsupportedExcep("multi-controlled multi-rotateZ"); // throws
+            if (numTargs == 1)
+                gate.apply = (numCtrls == 0)? local_applyRotateZ : local_applyControlledRotateZ;
+            else
+                gate.apply = local_applyMultiRotateZ;
+            break;
+            
+        case OPCODE_R:
+            if (numCtrls != 0)
+                throw local_gateUnsupportedExcep("controlled multi-rotate-Pauli"); // throws
+            if (numTargs != numParams-1) {
+                throw QuESTException("", 
+                    std::string("An internel error in R occured! ") +
+                    "The quest_link received an unequal number of Pauli codes " + 
+                    "(" + std::to_string(numParams-1) + ") and target qubits " + 
+                    "(" + std::to_string(numTargs) + ")!"); // throws
             }
-        }
+            gate.paulis.resize(numTargs);
+            for (int p=0; p < numTargs; p++)
+                gate.paulis[p] = (pauliOpType) ((int) params[1+p]);
+            gate.apply = local_applyMultiRotatePauli;
+            break;
         
-        // display progress to the user
-        if (showProgress)
-            local_updateCircuitProgress(opInd / (qreal) numOps);
-
-        // get gate info
-        int op = opcodes[opInd];
-        int numCtrls = numCtrlsPerOp[opInd];
-        int numTargs = numTargsPerOp[opInd];
-        int numParams = numParamsPerOp[opInd];
-        
-        switch(op) {
+        case OPCODE_U : {
+            long long int dim = (1 << numTargs);
+            if (numParams != 2 * dim*dim)
+                throw QuESTException("", std::to_string(numTargs) + "-qubit U accepts only " + 
+                    std::to_string(dim) + "x" +  std::to_string(dim) + " matrices."); // throws
             
-            case OPCODE_H :
-                if (numParams != 0)
-                    throw local_wrongNumGateParamsExcep("Hadamard", numParams, 0); // throws
-                if (numCtrls != 0)
-                    throw local_gateUnsupportedExcep("controlled Hadamard"); // throws
-                if (numTargs != 1)
-                    throw local_wrongNumGateTargsExcep("Hadamard", numTargs, "1 target"); // throws
-                hadamard(qureg, targs[targInd]); // throws
-                break;
-                
-            case OPCODE_S :
-                if (numParams != 0)
-                    throw local_wrongNumGateParamsExcep("S gate", numParams, 0); // throws
-                if (numTargs != 1)
-                    throw local_wrongNumGateTargsExcep("S gate", numTargs, "1 target"); // throws
-                if (numCtrls == 0)
-                    sGate(qureg, targs[targInd]); // throws
-                else {
-                    int* ctrlCache = local_prepareCtrlCache(ctrls, ctrlInd, numCtrls, targs[targInd]);
-                    multiControlledPhaseShift(qureg, ctrlCache, numCtrls+1, M_PI/2); // throws
-                }
-                break;
-                
-            case OPCODE_T : {
-                if (numParams != 0)
-                    throw local_wrongNumGateParamsExcep("T gate", numParams, 0); // throws
-                if (numTargs != 1)
-                    throw local_wrongNumGateTargsExcep("T gate", numTargs, "1 target"); // throws
-                if (numCtrls == 0)
-                    tGate(qureg, targs[targInd]); // throws
-                else {
-                    int* ctrlCache = local_prepareCtrlCache(ctrls, ctrlInd, numCtrls, targs[targInd]);
-                    multiControlledPhaseShift(qureg, ctrlCache, numCtrls+1, M_PI/4); // throws
-                }
+            if (numTargs == 1) {
+                gate.matrs2.assign(1, local_getMatrix2FromFlatList(params));
+                gate.apply = (numCtrls == 0)? local_applyUnitary : local_applyMultiControlledUnitary;
             }
-                break;
-        
-            case OPCODE_X : {
-                if (numParams != 0)
-                    throw local_wrongNumGateParamsExcep("X", numParams, 0); // throws
-                if (numTargs != 1)
-                    throw local_wrongNumGateTargsExcep("X", numTargs, "1 target"); // throws
-                if (numCtrls == 0)
-                    pauliX(qureg, targs[targInd]); // throws
-                else if (numCtrls == 1)
-                    controlledNot(qureg, ctrls[ctrlInd], targs[targInd]); // throws
-                else {
-                    ComplexMatrix2 u;
-                    u.real[0][0] = 0; u.real[0][1] = 1; // verbose for old MSVC
-                    u.real[1][0] = 1; u.real[1][1] = 0;
-                    u.imag[0][0] = 0; u.imag[0][1] = 0;
-                    u.imag[1][0] = 0; u.imag[1][1] = 0;
-                    multiControlledUnitary(qureg, &ctrls[ctrlInd], numCtrls, targs[targInd], u); // throws
-                }
+            else if (numTargs == 2) {
+                gate.matrs4.assign(1, local_getMatrix4FromFlatList(params));
+                gate.apply = (numCtrls == 0)? local_applyTwoQubitUnitary : local_applyMultiControlledTwoQubitUnitary;
             }
-                break;
-                
-            case OPCODE_Y :
-                if (numParams != 0)
-                    throw local_wrongNumGateParamsExcep("Y", numParams, 0); // throws
-                if (numTargs != 1)
-                    throw local_wrongNumGateTargsExcep("Y", numTargs, "1 target"); // throws
-                if (numCtrls == 0)
-                    pauliY(qureg, targs[targInd]); // throws
-                else if (numCtrls == 1)
-                    controlledPauliY(qureg, ctrls[ctrlInd], targs[targInd]); // throws
-                else
-                    throw local_gateUnsupportedExcep("controlled Y"); // throws
-                break;
-                
-            case OPCODE_Z : {
-                if (numParams != 0)
-                    throw local_wrongNumGateParamsExcep("Z", numParams, 0); // throws
-                if (numTargs != 1)
-                    throw local_wrongNumGateTargsExcep("Z", numTargs, "1 target"); // throws
-                if (numCtrls == 0)
-                    pauliZ(qureg, targs[targInd]); // throws
-                else {
-                    int* ctrlCache = local_prepareCtrlCache(ctrls, ctrlInd, numCtrls, targs[targInd]);
-                    multiControlledPhaseFlip(qureg, ctrlCache, numCtrls+1); // throws
+            else {
+                // allocated only once, even when the gate is recompiled
+                if (!gate.hasMatrN) {
+                    gate.matrN = createComplexMatrixN(numTargs); // throws
+                    gate.hasMatrN = true;
                 }
+                local_setMatrixNFromFlatList(params, gate.matrN, numTargs);
+                gate.apply = (numCtrls == 0)? local_applyMultiQubitUnitary : local_applyMultiControlledMultiQubitUnitary;
             }
-                break;
+        }
+            break;
+            
+        case OPCODE_Deph :
+            if (numParams != 1)
+                throw local_wrongNumGateParamsExcep("Dephasing", numParams, 1); // throws
+            if (numCtrls != 0)
+                throw local_gateUnsupportedExcep("controlled dephasing"); // throws
+            if (numTargs != 1 && numTargs != 2)
+                throw local_wrongNumGateTargsExcep("Dephasing", numTargs, "1 or 2 targets"); // throws
+            // zero-prob decoherence does nothing, so can act upon state-vectors
+            if (params[0] == 0)
+                gate.apply = local_applyNothing;
+            else
+                gate.apply = (numTargs == 1)? local_applyDephasing : local_applyTwoQubitDephasing;
+            break;
+            
+        case OPCODE_Depol :
+            if (numParams != 1)
+                throw local_wrongNumGateParamsExcep("Depolarising", numParams, 1); // throws
+            if (numCtrls != 0)
+                throw local_gateUnsupportedExcep("controlled depolarising"); // throws
+            if (numTargs != 1 && numTargs != 2)
+                throw local_wrongNumGateTargsExcep("Depolarising", numTargs, "1 or 2 targets"); // throws
+            if (params[0] == 0)
+                gate.apply = local_applyNothing;
+            else
+                gate.apply = (numTargs == 1)? local_applyDepolarising : local_applyTwoQubitDepolarising;
+            break;
+            
+        case OPCODE_Damp :
+            if (numParams != 1)
+                throw local_wrongNumGateParamsExcep("Damping", numParams, 1); // throws
+            if (numCtrls != 0)
+                throw local_gateUnsupportedExcep("controlled damping"); // throws
+            if (numTargs != 1)
+                throw local_wrongNumGateTargsExcep("Damping", numTargs, "1 target"); // throws
+            gate.apply = (params[0] == 0)? local_applyNothing : local_applyDamping;
+            break;
+            
+        case OPCODE_SWAP:
+            if (numParams != 0)
+                throw local_wrongNumGateParamsExcep("SWAP", numParams, 0); // throws
+            if (numTargs != 2)
+                throw local_wrongNumGateTargsExcep("Depolarising", numTargs, "2 targets"); // throws
+            if (numCtrls > 0)
+                gate.matrs2.assign(1, local_getPauliXMatrix2());
+            gate.apply = (numCtrls == 0)? local_applySwapGate : local_applyMultiControlledSwapGate;
+            break;
+            
+        case OPCODE_M:
+            if (numParams != 0)
+                throw local_wrongNumGateParamsExcep("M", numParams, 0); // throws
+            if (numCtrls != 0)
+                throw local_gateUnsupportedExcep("controlled measurement"); // throws
+            gate.apply = local_applyMeasurement;
+            break;
         
-            case OPCODE_Rx :
-                if (numParams != 1)
-                    throw local_wrongNumGateParamsExcep("Rx", numParams, 1); // throws
-                if (numTargs != 1)
-                    throw local_wrongNumGateTargsExcep("Rx", numTargs, "1 target"); // throws
-                if (numCtrls == 0)
-                    rotateX(qureg, targs[targInd], params[paramInd]); // throws
-                else if (numCtrls == 1)
-                    controlledRotateX(qureg, ctrls[ctrlInd], targs[targInd], params[paramInd]); // throws
-                else
-                    throw local_gateUnsupportedExcep("multi-controlled Rotate X"); // throws
-                break;
-                
-            case OPCODE_Ry :
-                if (numParams != 1)
-                    throw local_wrongNumGateParamsExcep("Ry", numParams, 1); // throws
-                if (numTargs != 1)
-                    throw local_wrongNumGateTargsExcep("Ry", numTargs, "1 target"); // throws
-                if (numCtrls == 0)
-                    rotateY(qureg, targs[targInd], params[paramInd]); // throws
-                else if (numCtrls == 1)
-                    controlledRotateY(qureg, ctrls[ctrlInd], targs[targInd], params[paramInd]); // throws
-                else
-                    throw local_gateUnsupportedExcep("multi-controlled Rotate Y"); // throws
-                break;
-                
-            case OPCODE_Rz :
-                if (numParams != 1)
-                    throw local_wrongNumGateParamsExcep("Rz", numParams, 1); // throws
-                if (numCtrls > 1)
-                    throw local_gateUnsupportedExcep("multi-controlled Rotate Z"); // throws
-                if (numCtrls == 1 && numTargs > 1)
-                    throw local_gateUnsupportedExcep("multi-controlled multi-rotateZ"); // throws
-                if (numTargs == 1) {
-                    if (numCtrls == 0)
-                        rotateZ(qureg, targs[targInd], params[paramInd]); // throws
-                    if (numCtrls == 1)
-                        controlledRotateZ(qureg, ctrls[ctrlInd], targs[targInd], params[paramInd]); // throws
-                } else
-                    multiRotateZ(qureg, &targs[targInd], numTargs, params[paramInd]); // throws
-                break;
-                
-            case OPCODE_R: {
-                if (numCtrls != 0)
-                    throw local_gateUnsupportedExcep("controlled multi-rotate-Pauli"); // throws
-                if (numTargs != numParams-1) {
-                    throw QuESTException("", 
-                        std::string("An internel error in R occured! ") +
-                        "The quest_link received an unequal number of Pauli codes " + 
-                        "(" + std::to_string(numParams-1) + ") and target qubits " + 
-                        "(" + std::to_string(numTargs) + ")!"); // throws
-                }
-                enum pauliOpType paulis[MAX_NUM_TARGS_CTRLS]; 
-                for (int p=0; p < numTargs; p++)
-                    paulis[p] = (pauliOpType) ((int) params[paramInd+1+p]);
-                multiRotatePauli(qureg, &targs[targInd], paulis, numTargs, params[paramInd]); // throws
+        case OPCODE_P:
+            if (numParams != 1 && numParams != numTargs)
+                throw QuESTException("", 
+                    std::string("P[outcomes] specified a different number of binary outcomes ") + 
+                    "(" + std::to_string(numParams) + ") than target qubits  " +
+                    "(" + std::to_string(numTargs) + ")!"); // throws
+            if (numCtrls != 0)
+                throw local_gateUnsupportedExcep("controlled projector"); // throws
+            // check value isn't impossibly high
+            if (numParams == 1 && params[0] >= (1LL << numTargs))
+                throw QuESTException("",
+                    "P[ " + std::to_string((int) params[0]) + "] was applied to " +
+                    std::to_string(numTargs) + " qubits and exceeds their maximum represented " +
+                    "value of " + std::to_string(1LL << numTargs) + "."); // throws
+            // the outcome of each target, in order of targs
+            if (numParams > 1) {
+                gate.outcomes.resize(numParams);
+                for (int q=0; q < numParams; q++)
+                    gate.outcomes[q] = (int) params[q];
+            } else {
+                // right most (least significant) bit acts on right-most target
+                gate.outcomes.resize(numTargs);
+                for (int q=0; q < numTargs; q++)
+                    gate.outcomes[numTargs-q-1] = (((int) params[0]) >> q) & 1;
             }
-                break;
+            gate.apply = local_applyProjector;
+            break;
             
-            case OPCODE_U : {
-                ; // empty post-label statement, courtesy of weird C99 standard.
-                // this was added when QuESTlink was already refactored for C++11,
-                // however the quirk of being unable to define a variable on the first 
-                // line of a switch case in C99 is so strange, I carry on the tradition anyway
-                long long int dim = (1 << numTargs);
-                if (numParams != 2 * dim*dim)
-                    throw QuESTException("", std::to_string(numTargs) + "-qubit U accepts only " + 
-                        std::to_string(dim) + "x" +  std::to_string(dim) + " matrices."); // throws
-                
-                if (numTargs == 1) {
-                    ComplexMatrix2 u = local_getMatrix2FromFlatList(&params[paramInd]);
-                    if (numCtrls == 0)
-                        unitary(qureg, targs[targInd], u); // throws
-                    else
-                        multiControlledUnitary(qureg, &ctrls[ctrlInd], numCtrls, targs[targInd], u); // throws
-                }
-                else if (numTargs == 2) {
-                    ComplexMatrix4 u = local_getMatrix4FromFlatList(&params[paramInd]);
-                    if (numCtrls == 0)
-                        twoQubitUnitary(qureg, targs[targInd], targs[targInd+1], u); // throws
-                    else
-                        multiControlledTwoQubitUnitary(qureg, &ctrls[ctrlInd], numCtrls, targs[targInd], targs[targInd+1], u); // throws
-                } 
-                else {
-                    // this is wastefully(?) allocating and deallocating memory on the fly!
-                    ComplexMatrixN u = createComplexMatrixN(numTargs);
-                    local_setMatrixNFromFlatList(&params[paramInd], u, numTargs);
-                    if (numCtrls == 0)
-                        multiQubitUnitary(qureg, &targs[targInd], numTargs, u); // throws
-                    else
-                        multiControlledMultiQubitUnitary(qureg, &ctrls[ctrlInd], numCtrls, &targs[targInd], numTargs, u); // throws
-                    destroyComplexMatrixN(u);
-                }
+        case OPCODE_Kraus: {
+            int numKrausOps = (int) params[0];
+            if (numCtrls != 0)
+                throw local_gateUnsupportedExcep("controlled Kraus map"); // throws
+            if (numTargs != 1 && numTargs != 2)
+                throw local_wrongNumGateTargsExcep("Kraus map", numTargs, "1 or 2 targets"); // throws
+            if ((numKrausOps < 1) ||
+                (numTargs == 1 && numKrausOps > 4 ) ||
+                (numTargs == 2 && numKrausOps > 16))
+                throw QuESTException("", 
+                    std::to_string(numKrausOps) + " operators were passed to single-qubit Kraus[ops], " + 
+                    "which accepts only >0 and <=" + std::to_string((numTargs==1)? 4:16) + " operators!"); // throws
+            if (numTargs == 1 && (numParams-1) != 2*2*2*numKrausOps)
+                throw QuESTException("", "one-qubit Kraus expects 2-by-2 matrices!"); // throws
+            if (numTargs == 2 && (numParams-1) != 4*4*2*numKrausOps)
+                throw QuESTException("", "two-qubit Kraus expects 4-by-4 matrices!"); // throws
+
+            if (numTargs == 1) {
+                gate.matrs2.resize(numKrausOps);
+                for (int n=0; n < numKrausOps; n++)
+                    gate.matrs2[n] = local_getMatrix2FromFlatList(&params[1 + 2*2*2*n]);
+                gate.apply = local_applyKrausMap;
+            } 
+            else if (numTargs == 2) {
+                gate.matrs4.resize(numKrausOps);
+                for (int n=0; n < numKrausOps; n++)
+                    gate.matrs4[n] = local_getMatrix4FromFlatList(&params[1 + 2*4*4*n]);
+                gate.apply = local_applyTwoQubitKrausMap;
             }
-                break;
-                
-            case OPCODE_Deph :
-                if (numParams != 1)
-                    throw local_wrongNumGateParamsExcep("Dephasing", numParams, 1); // throws
-                if (numCtrls != 0)
-                    throw local_gateUnsupportedExcep("controlled dephasing"); // throws
-                if (numTargs != 1 && numTargs != 2)
-                    throw local_wrongNumGateTargsExcep("Dephasing", numTargs, "1 or 2 targets"); // throws
-                if (params[paramInd] == 0)
-                    break; // allows zero-prob decoherence to act on state-vectors
-                if (numTargs == 1)
-                    mixDephasing(qureg, targs[targInd], params[paramInd]); // throws
-                if (numTargs == 2)
-                    mixTwoQubitDephasing(qureg, targs[targInd], targs[targInd+1], params[paramInd]); // throws
-                break;
-                
-            case OPCODE_Depol :
-                if (numParams != 1)
-                    throw local_wrongNumGateParamsExcep("Depolarising", numParams, 1); // throws
-                if (numCtrls != 0)
-                    throw local_gateUnsupportedExcep("controlled depolarising"); // throws
-                if (numTargs != 1 && numTargs != 2)
-                    throw local_wrongNumGateTargsExcep("Depolarising", numTargs, "1 or 2 targets"); // throws
-                if (params[paramInd] == 0)
-                    break; // allows zero-prob decoherence to act on state-vectors
-                if (numTargs == 1)
-                    mixDepolarising(qureg, targs[targInd], params[paramInd]); // throws
-                if (numTargs == 2)
-                    mixTwoQubitDepolarising(qureg, targs[targInd], targs[targInd+1], params[paramInd]); // throws
-                break;
-                
-            case OPCODE_Damp :
-                if (numParams != 1)
-                    throw local_wrongNumGateParamsExcep("Damping", numParams, 1); // throws
-                if (numCtrls != 0)
-                    throw local_gateUnsupportedExcep("controlled damping"); // throws
-                if (numTargs != 1)
-                    throw local_wrongNumGateTargsExcep("Damping", numTargs, "1 target"); // throws
-                if (params[paramInd] == 0)
-                    break; // allows zero-prob decoherence to act on state-vectors
-                mixDamping(qureg, targs[targInd], params[paramInd]); // throws
-                break;
-                
-            case OPCODE_SWAP: {
-                if (numParams != 0)
-                    throw local_wrongNumGateParamsExcep("SWAP", numParams, 0); // throws
-                if (numTargs != 2)
-                    throw local_wrongNumGateTargsExcep("Depolarising", numTargs, "2 targets"); // throws
-                if (numCtrls == 0) {
-                    swapGate(qureg, targs[targInd],   targs[targInd+1]); // throws
-                } else {    
-                    // core-QuEST doesn't yet support multiControlledSwapGate, 
-                    // so we construct SWAP from 3 CNOT's, and add additional controls
-                    ComplexMatrix2 u;
-                    u.real[0][0] = 0; u.real[0][1] = 1; // verbose for old MSVC 
-                    u.real[1][0] = 1; u.real[1][1] = 0;
-                    u.imag[0][0] = 0; u.imag[0][1] = 0;
-                    u.imag[1][0] = 0; u.imag[1][1] = 0;
-                    int* ctrlCache = local_prepareCtrlCache(ctrls, ctrlInd, numCtrls, targs[targInd]);
-                    multiControlledUnitary(qureg, ctrlCache, numCtrls+1, targs[targInd+1], u); // throws
-                    ctrlCache[numCtrls] = targs[targInd+1];
-                    multiControlledUnitary(qureg, ctrlCache, numCtrls+1, targs[targInd], u);
-                    ctrlCache[numCtrls] = targs[targInd];
-                    multiControlledUnitary(qureg, ctrlCache, numCtrls+1, targs[targInd+1], u);
-                }
-            }
-                break;
-                
-            case OPCODE_M: {
-                if (numParams != 0)
-                    throw local_wrongNumGateParamsExcep("M", numParams, 0); // throws
-                if (numCtrls != 0)
-                    throw local_gateUnsupportedExcep("controlled measurement"); // throws
-                for (int q=0; q < numTargs; q++) {
-                    int outcomeVal = measure(qureg, targs[targInd+q]); // throws // throws
-                    if (mesOutcomeCache != NULL)
-                        mesOutcomeCache[mesInd++] = outcomeVal;
-                }
-            }
-                break;
+        }
+            break;
             
-            case OPCODE_P:
-                if (numParams != 1 && numParams != numTargs)
-                    throw QuESTException("", 
-                        std::string("P[outcomes] specified a different number of binary outcomes ") + 
-                        "(" + std::to_string(numParams) + ") than target qubits  " +
-                        "(" + std::to_string(numTargs) + ")!"); // throws
-                if (numCtrls != 0)
-                    throw local_gateUnsupportedExcep("controlled projector"); // throws
-                if (numParams > 1)
-                    for (int q=0; q < numParams; q++)
-                        collapseToOutcome(qureg, targs[targInd+q], (int) params[paramInd+q]); // throws
-                else {
-                    // check value isn't impossibly high
-                    if (params[paramInd] >= (1LL << numTargs))
-                        throw QuESTException("",
-                            "P[ " + std::to_string((int) params[paramInd]) + "] was applied to " +
-                            std::to_string(numTargs) + " qubits and exceeds their maximum represented " +
-                            "value of " + std::to_string(1LL << numTargs) + "."); // throws
-                    // work out each bit outcome and apply; right most (least significant) bit acts on right-most target
-                    for (int q=0; q < numTargs; q++)
-                        collapseToOutcome(qureg, targs[targInd+numTargs-q-1], (((int) params[paramInd]) >> q) & 1); // throws
-                }
-                break;
-                
-            case OPCODE_Kraus: {
-                ; // empty post-label statement, courtesy of weird C99 standard
-                int numKrausOps = (int) params[paramInd];
-                if (numCtrls != 0)
-                    throw local_gateUnsupportedExcep("controlled Kraus map"); // throws
-                if (numTargs != 1 && numTargs != 2)
-                    throw local_wrongNumGateTargsExcep("Kraus map", numTargs, "1 or 2 targets"); // throws
-                if ((numKrausOps < 1) ||
-                    (numTargs == 1 && numKrausOps > 4 ) ||
-                    (numTargs == 2 && numKrausOps > 16))
-                    throw QuESTException("", 
-                        std::to_string(numKrausOps) + " operators were passed to single-qubit Kraus[ops], " + 
-                        "which accepts only >0 and <=" + std::to_string((numTargs==1)? 4:16) + " operators!"); // throws
-                if (numTargs == 1 && (numParams-1) != 2*2*2*numKrausOps)
-                    throw QuESTException("", "one-qubit Kraus expects 2-by-2 matrices!"); // throws
-                if (numTargs == 2 && (numParams-1) != 4*4*2*numKrausOps)
-                    throw QuESTException("", "two-qubit Kraus expects 4-by-4 matrices!"); // throws
+        case OPCODE_G :
+            if (numParams != 1)
+                throw local_wrongNumGateParamsExcep("Global phase", numParams, 1); // throws
+            if (numCtrls != 0)
+                throw local_gateUnsupportedExcep("controlled global phase"); // throws
+            if (numTargs != 0)
+                throw local_wrongNumGateTargsExcep("Global phase", numTargs, "0 targets"); // throws
+            // factor exp(i param)
+            gate.alpha.real = cos(params[0]);
+            gate.alpha.imag = sin(params[0]);
+            gate.apply = (params[0] == 0)? local_applyNothing : local_applyGlobalPhase;
+            break;
+            
+        case OPCODE_Id :
+            // any numCtrls, numParams and numTargs is valid; all do nothing!
+            gate.apply = local_applyNothing;
+            break;
+            
+        case OPCODE_QFT :
+        case OPCODE_InvQFT :
+            if (numParams != 0)
+                throw local_wrongNumGateParamsExcep("QFT", numParams, 0); // throws
+            if (numCtrls != 0)
+                throw local_gateUnsupportedExcep("controlled QFT"); // throws
+            if (numTargs == 0)
+                throw local_wrongNumGateTargsExcep("QFT", numTargs, "at least 1 target"); // throws
+            gate.apply = (op == OPCODE_QFT)? local_applyQFT : local_applyInverseQFT;
+            break;
+            
+        case OPCODE_Reset : {
+            if (numParams != 0)
+                throw local_wrongNumGateParamsExcep("Reset", numParams, 0); // throws
+            if (numCtrls != 0)
+                throw local_gateUnsupportedExcep("controlled reset"); // throws
+            ComplexMatrix2 toZero = {0};
+            gate.matrs2.assign(2, toZero);
+            gate.matrs2[0].real[0][0] = 1;
+            gate.matrs2[1].real[0][1] = 1;
+            gate.apply = local_applyReset;
+        }
+            break;
+            
+        default:            
+            throw QuESTException("", "circuit contained an unknown gate."); // throws
+    }
+}
 
-                if (numTargs == 1) {
-                    ComplexMatrix2 krausOps[4];
-                    int opElemInd = 1 + paramInd;
-                    for (int n=0; n < numKrausOps; n++)
-                        krausOps[n] = local_getMatrix2FromFlatList(&params[opElemInd + 2*2*2*n]);
-                    mixKrausMap(qureg, targs[targInd], krausOps, numKrausOps); // throws
-                } 
-                else if (numTargs == 2) {
-                    ComplexMatrix4 krausOps[16];
-                    int opElemInd = 1 + paramInd;
-                    for (int n=0; n < numKrausOps; n++)
-                        krausOps[n] = local_getMatrix4FromFlatList(&params[opElemInd + 2*4*4*n]);
-                    mixTwoQubitKrausMap(qureg, targs[targInd], targs[targInd+1], krausOps, numKrausOps); // throws
-                }
+void local_destroyCompiledCircuit(CompiledCircuit* circ) {
+    for (size_t g=0; g < circ->gates.size(); g++)
+        if (circ->gates[g].hasMatrN)
+            destroyComplexMatrixN(circ->gates[g].matrN);
+    delete circ;
+}
+
+/* copies the given circuit encoding (so the passed lists may be freed), then 
+ * decodes and validates each gate. The returned circuit must be later destroyed
+ * with local_destroyCompiledCircuit.
+ * @throws QuESTException if any gate is invalid (exception.thrower will be "")
+ */
+CompiledCircuit* local_compileCircuit(
+    int numOps, int* opcodes, 
+    int* ctrls, int* numCtrlsPerOp, 
+    int* targs, int* numTargsPerOp, 
+    qreal* params, int* numParamsPerOp
+) {
+    CompiledCircuit* circ = new CompiledCircuit;
+    circ->opcodes.assign(opcodes, opcodes + numOps);
+    circ->numCtrlsPerOp.assign(numCtrlsPerOp, numCtrlsPerOp + numOps);
+    circ->numTargsPerOp.assign(numTargsPerOp, numTargsPerOp + numOps);
+    circ->numParamsPerOp.assign(numParamsPerOp, numParamsPerOp + numOps);
+    
+    int totalNumCtrls = 0;
+    int totalNumTargs = 0;
+    int totalNumParams = 0;
+    for (int opInd=0; opInd < numOps; opInd++) {
+        totalNumCtrls += numCtrlsPerOp[opInd];
+        totalNumTargs += numTargsPerOp[opInd];
+        totalNumParams += numParamsPerOp[opInd];
+    }
+    circ->ctrls.assign(ctrls, ctrls + totalNumCtrls);
+    circ->targs.assign(targs, targs + totalNumTargs);
+    circ->params.assign(params, params + totalNumParams);
+    
+    // decode each gate, pointing into the copied lists
+    circ->gates.resize(numOps);
+    circ->paramIndPerOp.resize(numOps);
+    circ->numMesGates = 0;
+    circ->numMeasurements = 0;
+    int ctrlInd = 0;
+    int targInd = 0;
+    int paramInd = 0;
+    
+    try {
+        for (int opInd=0; opInd < numOps; opInd++) {
+            CompiledGate& gate = circ->gates[opInd];
+            gate.opcode = opcodes[opInd];
+            gate.numCtrls = numCtrlsPerOp[opInd];
+            gate.numTargs = numTargsPerOp[opInd];
+            gate.numParams = numParamsPerOp[opInd];
+            gate.ctrls = circ->ctrls.data() + ctrlInd;
+            gate.targs = circ->targs.data() + targInd;
+            gate.params = circ->params.data() + paramInd;
+            gate.hasMatrN = false;
+            circ->paramIndPerOp[opInd] = paramInd;
+            
+            local_compileGate(gate); // throws
+            
+            if (gate.opcode == OPCODE_M) {
+                circ->numMesGates++;
+                circ->numMeasurements += gate.numTargs;
             }
-                break;
+            
+            ctrlInd += gate.numCtrls;
+            targInd += gate.numTargs;
+            paramInd += gate.numParams;
+        }
+    } catch (QuESTException& err) {
+        local_destroyCompiledCircuit(circ);
+        throw;
+    }
+    
+    return circ;
+}
+
+/* updates the CIRC_PROGRESS_VAR in the front-end with the new passed value 
+ * which must lie in [0, 1]. This can be used to indicate progress of a long 
+ * evaluation to the user 
+ */
+void local_updateCircuitProgress(qreal progress) {
+
+    // send new packet to MMA
+    WSPutFunction(stdlink, "EvaluatePacket", 1);
+
+    // echo the message
+    WSPutFunction(stdlink, "Set", 2);
+    WSPutSymbol(stdlink, CIRC_PROGRESS_VAR);
+    WSPutReal64(stdlink, progress);
+
+    WSEndPacket(stdlink);
+    WSNextPacket(stdlink);
+    WSNewPacket(stdlink);
+    
+    // a new packet is now expected; caller MUST send something else
+}
+
+/* returns whether the user has tried to abort evaluation. This must only be 
+ * called by the link thread.
+ */
+bool local_isAbortMessageReady(void) {
+    if (WSMessageReady(stdlink)) {
+        int code, arg;
+        WSGetMessage(stdlink, &code, &arg);
+        if (code == WSTerminateMessage || code == WSInterruptMessage || 
+            code == WSAbortMessage     || code == WSImDyingMessage)
+            return true;
+    }
+    return false;
+}
+
+/* applies gates [startOp, endOp) of the compiled circuit to qureg.
+ * The gates are applied by a worker thread, while the calling (link) thread 
+ * remains responsive; it polls for an abort (which the worker observes through
+ * an atomic flag between gates), and if showProgress, updates the progress 
+ * shown to the user no more often than every PROGRESS_UPDATE_INTERVAL_MS.
+ * @param mesOutcomeCache may be NULL
+ * @throws QuESTException if a core-QuEST function fails validation (in this case,
+ *      exception.thrower will be the name of the throwing core API function),
+ *      or if evaluation is aborted (exception.throw = "Abort")
+ */
+void local_applyCompiledGates(
+    AnyQureg qureg, CompiledCircuit* circ, int startOp, int endOp,
+    int* mesOutcomeCache, int showProgress
+) {
+    if (startOp >= endOp)
+        return;
+    
+    // state shared between the link and worker threads
+    std::atomic<bool> abortRequested(false);
+    std::atomic<int> numOpsDone(0);
+    bool finished = false;
+    std::mutex finishedMutex;
+    std::condition_variable finishedCond;
+    bool failed = false;
+    QuESTException failure("", "");
+    
+    std::thread worker([&]() {
+        int mesInd = 0;
+        try {
+            for (int opInd=startOp; opInd < endOp; opInd++) {
+                if (abortRequested.load(std::memory_order_relaxed))
+                    throw QuESTException("Abort", "Circuit simulation aborted."); // throws
                 
-            case OPCODE_G : {
-                if (numParams != 1)
-                    throw local_wrongNumGateParamsExcep("Global phase", numParams, 1); // throws
-                if (numCtrls != 0)
-                    throw local_gateUnsupportedExcep("controlled global phase"); // throws
-                if (numTargs != 0)
-                    throw local_wrongNumGateTargsExcep("Global phase", numTargs, "0 targets"); // throws
-                if (params[paramInd] == 0)
-                    break;
-                // phase does not change density matrices
-                if (!qureg.isDensityMatrix) {
-                     // create factor exp(i param)
-                    Complex zero; zero.real=0; zero.imag=0;
-                    Complex fac; fac.real=cos(params[paramInd]); fac.imag=sin(params[paramInd]);
-                    setWeightedQureg(zero, qureg, zero, qureg, fac, qureg); // throws
-                }
+                CompiledGate& gate = circ->gates[opInd];
+                gate.apply(qureg, gate, mesOutcomeCache, &mesInd); // throws
+                numOpsDone.store(opInd + 1 - startOp, std::memory_order_relaxed);
             }
-                break;
-                
-            case OPCODE_Id :
-                // any numCtrls, numParams and numTargs is valid; all do nothing!
-                break;
-                
-            default:            
-                throw QuESTException("", "circuit contained an unknown gate."); // throws
+        } catch (QuESTException& err) {
+            failed = true;
+            failure = err;
         }
+        std::lock_guard<std::mutex> lock(finishedMutex);
+        finished = true;
+        finishedCond.notify_one();
+    });
+    
+    // only the link thread may communicate with MMA
+    int numOps = endOp - startOp;
+    std::chrono::steady_clock::time_point lastUpdate = std::chrono::steady_clock::now();
+    if (showProgress)
+        local_updateCircuitProgress(0);
+    
+    std::unique_lock<std::mutex> lock(finishedMutex);
+    while (!finished) {
+        finishedCond.wait_for(lock, std::chrono::milliseconds(ABORT_POLL_INTERVAL_MS));
+        if (finished)
+            break;
         
-        // update progress through gate list
-        ctrlInd += numCtrls;
-        targInd += numTargs;
-        paramInd += numParams;
+        lock.unlock();
+        if (!abortRequested && local_isAbortMessageReady())
+            abortRequested = true;
+        
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        if (showProgress && now - lastUpdate >= std::chrono::milliseconds(PROGRESS_UPDATE_INTERVAL_MS)) {
+            local_updateCircuitProgress(numOpsDone.load(std::memory_order_relaxed) / (qreal) numOps);
+            lastUpdate = now;
+        }
+        lock.lock();
     }
+    lock.unlock();
+    worker.join();
     
-    // update final pointers
-    *finalCtrlInd = ctrlInd;
-    *finalTargInd = targInd;
-    *finalParamInd = paramInd;
+    if (failed)
+        throw failure; // throws
 }
 
 /* load a circuit specification from Mathematica. All these lists must be 
@@ -1363,82 +2255,36 @@ void local_freeCircuit(
     WSReleaseInteger32List(stdlink, numParamsPerOp, numOps);
 }
 
-/* Applies a given circuit to the identified qureg.
- * The circuit is expressed as lists of opcodes (identifying gates),
- * the total flat sequence control qubits, a list denoting how many of
- * the control qubits apply to each operation, their target qubits (flat list),
- * a list denotating how many targets each operation has, their parameters 
- * (flat list) and a list denoting how many params each operation has.
- * Returns a list of measurement outcome of any performed measurements in the circuit.
+/* Applies the compiled circuit to the identified qureg (which must exist), and 
+ * sends to MMA a list of the outcomes of any performed measurements.
  * The original qureg of the state is restored when this function
- * is aborted by the calling MMA (sends Abort[] to MMA), or aborted due to encountering
- * an invalid gate or a QuEST-core validation error (sends $Failed to MMA). 
+ * is aborted by the calling MMA (sends Abort[] to MMA), or aborted due to 
+ * a QuEST-core validation error (sends $Failed to MMA). 
  */
-void internal_applyCircuit(int id, int storeBackup, int showProgress) {
-    
-    // get arguments from MMA link; these must be later freed!
-    int numOps;
-    int *opcodes, *ctrls, *numCtrlsPerOp, 
-        *targs, *numTargsPerOp, *numParamsPerOp;
-    qreal* params;
-    int totalNumCtrls, totalNumTargs, totalNumParams; // these fields are only needed by clean-up
-    local_loadCircuitFromMMA(
-        &numOps, &opcodes, &ctrls, &numCtrlsPerOp, 
-        &targs, &numTargsPerOp, &params, &numParamsPerOp,
-        &totalNumCtrls, &totalNumTargs, &totalNumParams);
-    
-    // ensure qureg exists, else clean-up and exit
-    try {
-        local_throwExcepIfQuregNotCreated(id); // throws
-        
-    } catch (QuESTException& err) {
-    
-        local_freeCircuit(
-            opcodes, ctrls, numCtrlsPerOp, targs, 
-            numTargsPerOp, params, numParamsPerOp,
-            numOps, totalNumCtrls, totalNumTargs, totalNumParams);
-            
-        local_sendErrorAndFail("ApplyCircuit", err.message);
-        return;
-    }
+void local_applyCircuitAndSendOutcomes(CompiledCircuit* circ, int id, int storeBackup, int showProgress) {
     
-    Qureg qureg = quregs[id];
-    Qureg backup;
+    AnyQureg qureg = local_getAnyQureg(id);
+    AnyQureg backup;
     if (storeBackup)
         backup = createCloneQureg(qureg, env); // must clean-up
-    
-    // count the total number of measurements performed in a circuit
-    int totalNumMesGates = 0;
-    int totalNumMeasurements = 0;
-    for (int opInd=0; opInd < numOps; opInd++)
-        if (opcodes[opInd] == OPCODE_M) {
-            totalNumMesGates++;
-            totalNumMeasurements += numTargsPerOp[opInd];
-        }
         
     // prepare records of measurement outcomes
-    int* mesOutcomeCache = (int*) malloc(totalNumMeasurements * sizeof(int)); // must clean-up
+    int* mesOutcomeCache = (int*) malloc(circ->numMeasurements * sizeof(int)); // must clean-up
     int mesInd = 0;
 
     // attempt to apply the circuit
     try {
-        // these fields are ignored
-        int finalCtrlInd, finalTargInd, finalParamInd;
-        
-        local_applyGates(
-            qureg, numOps, opcodes, ctrls, numCtrlsPerOp, 
-            targs, numTargsPerOp, params, numParamsPerOp,
-            mesOutcomeCache,
-            &finalCtrlInd, &finalTargInd, &finalParamInd,
-            showProgress); // throws
+        local_applyCompiledGates(
+            qureg, circ, 0, circ->gates.size(), mesOutcomeCache, showProgress); // throws
             
         // return lists of measurement outcomes
         mesInd = 0;
-        WSPutFunction(stdlink, "List", totalNumMesGates);
-        for (int opInd=0; opInd < numOps; opInd++) {
-            if (opcodes[opInd] == OPCODE_M) {
-                WSPutFunction(stdlink, "List", numTargsPerOp[opInd]);
-                for (int i=0; i < numTargsPerOp[opInd]; i++)
+        WSPutFunction(stdlink, "List", circ->numMesGates);
+        for (size_t opInd=0; opInd < circ->gates.size(); opInd++) {
+            CompiledGate& gate = circ->gates[opInd];
+            if (gate.opcode == OPCODE_M) {
+                WSPutFunction(stdlink, "List", gate.numTargs);
+                for (int i=0; i < gate.numTargs; i++)
                     WSPutInteger(stdlink, mesOutcomeCache[mesInd++]);
             }
         }
@@ -1447,10 +2293,6 @@ void internal_applyCircuit(int id, int storeBackup, int showProgress) {
         if (storeBackup)
             destroyQureg(backup, env);
         free(mesOutcomeCache);
-        local_freeCircuit(
-            opcodes, ctrls, numCtrlsPerOp, targs, 
-            numTargsPerOp, params, numParamsPerOp,
-            numOps, totalNumCtrls, totalNumTargs, totalNumParams);
     
     } catch (QuESTException& err) {
         
@@ -1459,13 +2301,7 @@ void internal_applyCircuit(int id, int storeBackup, int showProgress) {
             cloneQureg(qureg, backup);
             destroyQureg(backup, env);
         }
-                
-        // all objs need cleaning
         free(mesOutcomeCache);
-        local_freeCircuit(
-            opcodes, ctrls, numCtrlsPerOp, targs, 
-            numTargsPerOp, params, numParamsPerOp,
-            numOps, totalNumCtrls, totalNumTargs, totalNumParams);
             
         // report error, depending on type
         std::string backupNotice;
@@ -1476,17 +2312,895 @@ void internal_applyCircuit(int id, int storeBackup, int showProgress) {
             backupNotice = " Since no backup was stored, the qureg (id " + std::to_string(id) + 
                 ") is now in an unknown state, and should be reinitialised.";
         
-        if (err.thrower == "")
-            local_sendErrorAndFail("ApplyCircuit", err.message + backupNotice);
-        else if (err.thrower == "Abort")
-            local_sendErrorAndAbort("ApplyCircuit", err.message + backupNotice);
-        else 
-            local_sendErrorAndFail("ApplyCircuit", 
-                "Error in " + err.thrower + ": " + err.message + backupNotice);
+        if (err.thrower == "")
+            local_sendErrorAndFail("ApplyCircuit", err.message + backupNotice);
+        else if (err.thrower == "Abort")
+            local_sendErrorAndAbort("ApplyCircuit", err.message + backupNotice);
+        else 
+            local_sendErrorAndFail("ApplyCircuit", 
+                "Error in " + err.thrower + ": " + err.message + backupNotice);
+    }
+}
+
+/* Applies a given circuit to the identified qureg.
+ * The circuit is expressed as lists of opcodes (identifying gates),
+ * the total flat sequence control qubits, a list denoting how many of
+ * the control qubits apply to each operation, their target qubits (flat list),
+ * a list denotating how many targets each operation has, their parameters 
+ * (flat list) and a list denoting how many params each operation has.
+ * Returns a list of measurement outcome of any performed measurements in the circuit.
+ * An invalid gate is reported (sends $Failed to MMA) before any gate is applied.
+ */
+void internal_applyCircuit(int id, int storeBackup, int showProgress) {
+    
+    // get arguments from MMA link; these must be later freed!
+    int numOps;
+    int *opcodes, *ctrls, *numCtrlsPerOp, 
+        *targs, *numTargsPerOp, *numParamsPerOp;
+    qreal* params;
+    int totalNumCtrls, totalNumTargs, totalNumParams; // these fields are only needed by clean-up
+    local_loadCircuitFromMMA(
+        &numOps, &opcodes, &ctrls, &numCtrlsPerOp, 
+        &targs, &numTargsPerOp, &params, &numParamsPerOp,
+        &totalNumCtrls, &totalNumTargs, &totalNumParams);
+    
+    // ensure qureg exists and the circuit is valid, else clean-up and exit
+    CompiledCircuit* circ = NULL;
+    try {
+        local_throwExcepIfQuregOfAnyPrecisionNotCreated(id); // throws
+        circ = local_compileCircuit(
+            numOps, opcodes, ctrls, numCtrlsPerOp, 
+            targs, numTargsPerOp, params, numParamsPerOp); // throws
+        
+    } catch (QuESTException& err) {
+        local_sendErrorAndFail("ApplyCircuit", err.message);
+    }
+    
+    // the compiled circuit has its own copy of the lists
+    local_freeCircuit(
+        opcodes, ctrls, numCtrlsPerOp, targs, 
+        numTargsPerOp, params, numParamsPerOp,
+        numOps, totalNumCtrls, totalNumTargs, totalNumParams);
+    
+    if (circ == NULL)
+        return;
+        
+    local_applyCircuitAndSendOutcomes(circ, id, storeBackup, showProgress);
+    local_destroyCompiledCircuit(circ);
+}
+
+/* Compiles the circuit (encoded as per internal_applyCircuit), storing it 
+ * so that it can be repeatedly applied (by id) without being re-sent or 
+ * re-validated. Returns the circuit id.
+ */
+void internal_createCircuit(void) {
+    
+    // get arguments from MMA link; these must be later freed!
+    int numOps;
+    int *opcodes, *ctrls, *numCtrlsPerOp, 
+        *targs, *numTargsPerOp, *numParamsPerOp;
+    qreal* params;
+    int totalNumCtrls, totalNumTargs, totalNumParams; // these fields are only needed by clean-up
+    local_loadCircuitFromMMA(
+        &numOps, &opcodes, &ctrls, &numCtrlsPerOp, 
+        &targs, &numTargsPerOp, &params, &numParamsPerOp,
+        &totalNumCtrls, &totalNumTargs, &totalNumParams);
+        
+    try {
+        CompiledCircuit* circ = local_compileCircuit(
+            numOps, opcodes, ctrls, numCtrlsPerOp, 
+            targs, numTargsPerOp, params, numParamsPerOp); // throws
+        
+        size_t id = local_getNextCircuitID();
+        circuits[id] = circ;
+        WSPutInteger(stdlink, id);
+        
+    } catch (QuESTException& err) {
+        local_sendErrorAndFail("CreateCircuit", err.message);
+    }
+    
+    local_freeCircuit(
+        opcodes, ctrls, numCtrlsPerOp, targs, 
+        numTargsPerOp, params, numParamsPerOp,
+        numOps, totalNumCtrls, totalNumTargs, totalNumParams);
+}
+
+/* Applies a circuit created by internal_createCircuit, as per internal_applyCircuit */
+void internal_applyCreatedCircuit(int circId, int quregId, int storeBackup, int showProgress) {
+    try {
+        local_throwExcepIfCircuitNotCreated(circId); // throws
+        local_throwExcepIfQuregOfAnyPrecisionNotCreated(quregId); // throws
+        
+    } catch (QuESTException& err) {
+        local_sendErrorAndFail("ApplyCircuit", err.message);
+        return;
+    }
+    
+    local_applyCircuitAndSendOutcomes(circuits[circId], quregId, storeBackup, showProgress);
+}
+
+/* Rebinds the parameters at the given indices (of the flat parameter list with which 
+ * the circuit was created) to the given values, recompiling only the affected gates.
+ * If any affected gate becomes invalid, the circuit is restored to its prior parameters.
+ */
+void internal_setCircuitParams(int circId, int* paramInds, long numInds, qreal* paramVals, long numVals) {
+    try {
+        local_throwExcepIfCircuitNotCreated(circId); // throws
+        CompiledCircuit* circ = circuits[circId];
+        
+        if (numInds != numVals)
+            throw QuESTException("", "an equal number of parameter indices and values must be passed."); // throws
+        for (long i=0; i < numInds; i++)
+            if (paramInds[i] < 0 || paramInds[i] >= (int) circ->params.size())
+                throw QuESTException("", "parameter index " + std::to_string(paramInds[i]) + 
+                    " is invalid for a circuit with " + std::to_string(circ->params.size()) + 
+                    " parameters."); // throws
+        
+        // find the gate containing each parameter (gates are ordered by their first parameter)
+        std::vector<int> opInds(numInds);
+        for (long i=0; i < numInds; i++)
+            opInds[i] = (std::upper_bound(
+                circ->paramIndPerOp.begin(), circ->paramIndPerOp.end(), paramInds[i]) 
+                - circ->paramIndPerOp.begin()) - 1;
+        
+        // rebind and recompile, restoring the old parameters if any gate becomes invalid
+        std::vector<qreal> oldVals(numInds);
+        for (long i=0; i < numInds; i++) {
+            oldVals[i] = circ->params[paramInds[i]];
+            circ->params[paramInds[i]] = paramVals[i];
+        }
+        try {
+            for (long i=0; i < numInds; i++)
+                local_compileGate(circ->gates[opInds[i]]); // throws
+                
+        } catch (QuESTException& err) {
+            for (long i=numInds-1; i >= 0; i--)
+                circ->params[paramInds[i]] = oldVals[i];
+            for (long i=0; i < numInds; i++)
+                local_compileGate(circ->gates[opInds[i]]); // cannot throw
+            throw;
+        }
+        
+        WSPutInteger(stdlink, circId);
+        
+    } catch (QuESTException& err) {
+        local_sendErrorAndFail("SetCircuitParams", err.message);
+    }
+}
+
+void internal_destroyCircuit(int circId) {
+    try {
+        local_throwExcepIfCircuitNotCreated(circId); // throws
+        local_destroyCompiledCircuit(circuits[circId]);
+        circuits[circId] = NULL;
+        WSPutInteger(stdlink, circId);
+        
+    } catch (QuESTException& err) {
+        local_sendErrorAndFail("DestroyCircuit", err.message);
+    }
+}
+
+/*
+ * Reading circuits from OpenQASM 2 files
+ */
+
+enum QASMTokenType {QASM_IDENT, QASM_NUMBER, QASM_STRING, QASM_SYMBOL, QASM_END};
+
+/* The largest total size of a file's quantum registers. This bounds the
+ * qubit indices (like those of a Qureg), and the gates of broadcast operations
+ */
+#define MAX_NUM_QASM_QUBITS 62
+
+struct QASMToken {
+    QASMTokenType type;
+    std::string text;
+    int line;
+};
+
+/* A gate defined by "gate name(params) args { body }", whose body is the
+ * range [bodyStart, bodyEnd) of the reader's tokens. Opaque gates have no body.
+ */
+struct QASMGateDef {
+    std::vector<std::string> params;
+    std::vector<std::string> args;
+    size_t bodyStart;
+    size_t bodyEnd;
+    bool isOpaque;
+};
+
+/* The state of parsing an OpenQASM file, and the circuit read so far, encoded
+ * in the same flat lists which MMA sends to internal_createCircuit
+ */
+struct QASMReader {
+    std::string filename;
+    std::vector<QASMToken> tokens;
+    size_t pos;
+
+    // first qubit and size of each quantum register, and size of each classical register
+    std::map<std::string, std::pair<int,int>> qregs;
+    std::map<std::string, int> cregs;
+    int numQubits;
+    std::map<std::string, QASMGateDef> gateDefs;
+    int gateNesting;
+
+    std::vector<int> opcodes;
+    std::vector<int> ctrls;
+    std::vector<int> numCtrlsPerOp;
+    std::vector<int> targs;
+    std::vector<int> numTargsPerOp;
+    std::vector<qreal> params;
+    std::vector<int> numParamsPerOp;
+};
+
+QuESTException local_qasmExcep(QASMReader& r, int line, std::string msg) {
+    return QuESTException("", "error on line " + std::to_string(line) +
+        " of OpenQASM file '" + r.filename + "': " + msg);
+}
+
+void local_tokeniseQASM(QASMReader& r, const std::string& text) {
+    int line = 1;
+    size_t i = 0;
+    size_t len = text.size();
+    r.tokens.reserve(len / 2);
+
+    while (i < len) {
+        char c = text[i];
+
+        if (c == '\n') {
+            line++;
+            i++;
+        }
+        else if (isspace((unsigned char) c))
+            i++;
+        else if (c == '/' && i+1 < len && text[i+1] == '/') {
+            while (i < len && text[i] != '\n')
+                i++;
+        }
+        else if (isalpha((unsigned char) c) || c == '_') {
+            size_t start = i;
+            while (i < len && (isalnum((unsigned char) text[i]) || text[i] == '_'))
+                i++;
+            r.tokens.push_back({QASM_IDENT, text.substr(start, i-start), line});
+        }
+        else if (isdigit((unsigned char) c) || (c == '.' && i+1 < len && isdigit((unsigned char) text[i+1]))) {
+            size_t start = i;
+            while (i < len && (isdigit((unsigned char) text[i]) || text[i] == '.'))
+                i++;
+            if (i < len && (text[i] == 'e' || text[i] == 'E')) {
+                i++;
+                if (i < len && (text[i] == '+' || text[i] == '-'))
+                    i++;
+                while (i < len && isdigit((unsigned char) text[i]))
+                    i++;
+            }
+            r.tokens.push_back({QASM_NUMBER, text.substr(start, i-start), line});
+        }
+        else if (c == '"') {
+            size_t start = ++i;
+            while (i < len && text[i] != '"' && text[i] != '\n')
+                i++;
+            if (i == len || text[i] != '"')
+                throw local_qasmExcep(r, line, "unterminated string."); // throws
+            r.tokens.push_back({QASM_STRING, text.substr(start, i-start), line});
+            i++;
+        }
+        else if ((c == '-' && i+1 < len && text[i+1] == '>') || (c == '=' && i+1 < len && text[i+1] == '=')) {
+            r.tokens.push_back({QASM_SYMBOL, text.substr(i, 2), line});
+            i += 2;
+        }
+        else if (strchr(";,()[]{}+-*/^", c) != NULL) {
+            r.tokens.push_back({QASM_SYMBOL, std::string(1, c), line});
+            i++;
+        }
+        else
+            throw local_qasmExcep(r, line, "unexpected character '" + std::string(1, c) + "'."); // throws
+    }
+
+    r.tokens.push_back({QASM_END, "", line});
+}
+
+QASMToken& local_nextQASMToken(QASMReader& r) {
+    QASMToken& tok = r.tokens[r.pos];
+    if (tok.type != QASM_END)
+        r.pos++;
+    return tok;
+}
+
+/* consumes the next token if it is the given symbol (or keyword), returning whether it was */
+bool local_acceptQASMToken(QASMReader& r, const char* text) {
+    QASMToken& tok = r.tokens[r.pos];
+    if ((tok.type == QASM_SYMBOL || tok.type == QASM_IDENT) && tok.text == text) {
+        r.pos++;
+        return true;
+    }
+    return false;
+}
+
+void local_expectQASMToken(QASMReader& r, const char* text) {
+    QASMToken& tok = r.tokens[r.pos];
+    if (!local_acceptQASMToken(r, text))
+        throw local_qasmExcep(r, tok.line, "expected '" + std::string(text) + "' but found '" +
+            ((tok.type == QASM_END)? "end of file" : tok.text) + "'."); // throws
+}
+
+std::string local_expectQASMIdent(QASMReader& r) {
+    QASMToken& tok = local_nextQASMToken(r);
+    if (tok.type != QASM_IDENT)
+        throw local_qasmExcep(r, tok.line, "expected a name but found '" +
+            ((tok.type == QASM_END)? "end of file" : tok.text) + "'."); // throws
+    return tok.text;
+}
+
+int local_expectQASMIndex(QASMReader& r) {
+    QASMToken& tok = local_nextQASMToken(r);
+    if (tok.type != QASM_NUMBER || tok.text.find_first_not_of("0123456789") != std::string::npos)
+        throw local_qasmExcep(r, tok.line, "expected a non-negative integer but found '" + tok.text + "'."); // throws
+    errno = 0;
+    long val = strtol(tok.text.c_str(), NULL, 10);
+    if (errno == ERANGE || val > INT_MAX)
+        throw local_qasmExcep(r, tok.line, "integer '" + tok.text + "' is too large."); // throws
+    return (int) val;
+}
+
+/*
+ * Parameter expressions, evaluated when read, with any gate parameters bound in env
+ */
+
+qreal local_parseQASMExpr(QASMReader& r, std::map<std::string,qreal>& env);
+
+qreal local_parseQASMPrimary(QASMReader& r, std::map<std::string,qreal>& env) {
+    QASMToken& tok = local_nextQASMToken(r);
+
+    if (tok.type == QASM_NUMBER) {
+        errno = 0;
+        double val = strtod(tok.text.c_str(), NULL);
+        if (errno == ERANGE)
+            throw local_qasmExcep(r, tok.line, "number '" + tok.text + "' is too large or too small to be represented."); // throws
+        return (qreal) val;
+    }
+
+    if (tok.type == QASM_SYMBOL && tok.text == "(") {
+        qreal val = local_parseQASMExpr(r, env); // throws
+        local_expectQASMToken(r, ")"); // throws
+        return val;
+    }
+
+    if (tok.type == QASM_IDENT) {
+        if (tok.text == "pi")
+            return M_PI;
+        if (env.count(tok.text))
+            return env[tok.text];
+
+        local_expectQASMToken(r, "("); // throws
+        qreal arg = local_parseQASMExpr(r, env); // throws
+        local_expectQASMToken(r, ")"); // throws
+        if (tok.text == "sin")  return sin(arg);
+        if (tok.text == "cos")  return cos(arg);
+        if (tok.text == "tan")  return tan(arg);
+        if (tok.text == "exp")  return exp(arg);
+        if (tok.text == "ln")   return log(arg);
+        if (tok.text == "sqrt") return sqrt(arg);
+        throw local_qasmExcep(r, tok.line, "unknown function or parameter '" + tok.text + "'."); // throws
+    }
+
+    throw local_qasmExcep(r, tok.line, "expected an expression but found '" + tok.text + "'."); // throws
+}
+
+qreal local_parseQASMFactor(QASMReader& r, std::map<std::string,qreal>& env) {
+    if (local_acceptQASMToken(r, "-"))
+        return - local_parseQASMFactor(r, env); // throws
+    if (local_acceptQASMToken(r, "+"))
+        return local_parseQASMFactor(r, env); // throws
+
+    // exponentiation is right-associative, and binds more tightly than negation
+    qreal base = local_parseQASMPrimary(r, env); // throws
+    if (local_acceptQASMToken(r, "^"))
+        return pow(base, local_parseQASMFactor(r, env)); // throws
+    return base;
+}
+
+qreal local_parseQASMTerm(QASMReader& r, std::map<std::string,qreal>& env) {
+    qreal val = local_parseQASMFactor(r, env); // throws
+    while (true) {
+        if (local_acceptQASMToken(r, "*"))
+            val *= local_parseQASMFactor(r, env); // throws
+        else if (local_acceptQASMToken(r, "/"))
+            val /= local_parseQASMFactor(r, env); // throws
+        else
+            return val;
+    }
+}
+
+qreal local_parseQASMExpr(QASMReader& r, std::map<std::string,qreal>& env) {
+    qreal val = local_parseQASMTerm(r, env); // throws
+    while (true) {
+        if (local_acceptQASMToken(r, "+"))
+            val += local_parseQASMTerm(r, env); // throws
+        else if (local_acceptQASMToken(r, "-"))
+            val -= local_parseQASMTerm(r, env); // throws
+        else
+            return val;
+    }
+}
+
+/* parses a quantum argument, returning its qubits. Within a gate definition
+ * (boundArgs != NULL), an argument is the name of a single bound qubit, else
+ * it is an indexed qubit or an entire register
+ */
+std::vector<int> local_parseQASMQubits(QASMReader& r, std::map<std::string,int>* boundArgs) {
+    int line = r.tokens[r.pos].line;
+    std::string name = local_expectQASMIdent(r); // throws
+
+    if (boundArgs != NULL) {
+        if (!boundArgs->count(name))
+            throw local_qasmExcep(r, line, "'" + name + "' is not an argument of the gate definition."); // throws
+        return std::vector<int>(1, (*boundArgs)[name]);
+    }
+
+    if (!r.qregs.count(name))
+        throw local_qasmExcep(r, line, "quantum register '" + name + "' has not been declared."); // throws
+    int first = r.qregs[name].first;
+    int size = r.qregs[name].second;
+
+    if (local_acceptQASMToken(r, "[")) {
+        int ind = local_expectQASMIndex(r); // throws
+        local_expectQASMToken(r, "]"); // throws
+        if (ind >= size)
+            throw local_qasmExcep(r, line, "index " + std::to_string(ind) +
+                " exceeds the size of register '" + name + "'."); // throws
+        return std::vector<int>(1, first + ind);
+    }
+
+    std::vector<int> qubits(size);
+    for (int i=0; i < size; i++)
+        qubits[i] = first + i;
+    return qubits;
+}
+
+/* parses a comma-separated list of quantum arguments, until a ';' */
+std::vector<std::vector<int>> local_parseQASMQubitLists(QASMReader& r, std::map<std::string,int>* boundArgs) {
+    std::vector<std::vector<int>> lists;
+    do
+        lists.push_back(local_parseQASMQubits(r, boundArgs)); // throws
+    while (local_acceptQASMToken(r, ","));
+    local_expectQASMToken(r, ";"); // throws
+    return lists;
+}
+
+/* returns the number of times an operation upon the given arguments must be
+ * applied; once, or once per qubit of the (equally sized) register arguments
+ */
+int local_getQASMBroadcastSize(QASMReader& r, int line, std::vector<std::vector<int>>& lists) {
+    int size = 1;
+    for (size_t i=0; i < lists.size(); i++) {
+        int len = (int) lists[i].size();
+        if (len != 1 && size != 1 && len != size)
+            throw local_qasmExcep(r, line, "registers of different sizes were passed to one operation."); // throws
+        if (len != 1)
+            size = len;
+    }
+    return size;
+}
+
+/*
+ * Encoding of the operations read
+ */
+
+void local_addQASMOp(
+    QASMReader& r, int opcode,
+    std::vector<int>& qubits, int numCtrls, std::vector<qreal>& params
+) {
+    r.opcodes.push_back(opcode);
+    r.ctrls.insert(r.ctrls.end(), qubits.begin(), qubits.begin() + numCtrls);
+    r.numCtrlsPerOp.push_back(numCtrls);
+    r.targs.insert(r.targs.end(), qubits.begin() + numCtrls, qubits.end());
+    r.numTargsPerOp.push_back((int) qubits.size() - numCtrls);
+    r.params.insert(r.params.end(), params.begin(), params.end());
+    r.numParamsPerOp.push_back((int) params.size());
+}
+
+/* adds a (controlled) unitary, given as a row-major list of complex elements,
+ * flattened to {re, im, re, im, ...} as is sent by MMA for U
+ */
+void local_addQASMUnitary(
+    QASMReader& r, std::vector<int>& qubits, int numCtrls,
+    std::vector<qreal> elems
+) {
+    local_addQASMOp(r, OPCODE_U, qubits, numCtrls, elems);
+}
+
+/* elements of U(theta,phi,lambda) = Rz(phi) Ry(theta) Rz(lambda), with global phase exp(i gamma)
+ * chosen as per the OpenQASM specification (when gamma = 0)
+ */
+std::vector<qreal> local_getQASMUElems(qreal theta, qreal phi, qreal lambda, qreal gamma) {
+    qreal c = cos(theta/2);
+    qreal s = sin(theta/2);
+    return {
+        c*cos(gamma),                  c*sin(gamma),
+        -s*cos(gamma+lambda),          -s*sin(gamma+lambda),
+        s*cos(gamma+phi),              s*sin(gamma+phi),
+        c*cos(gamma+phi+lambda),       c*sin(gamma+phi+lambda)
+    };
+}
+
+std::vector<qreal> local_getQASMRotationElems(int opcode, qreal angle) {
+    qreal c = cos(angle/2);
+    qreal s = sin(angle/2);
+    if (opcode == OPCODE_Rx)
+        return {c,0, 0,-s, 0,-s, c,0};
+    if (opcode == OPCODE_Ry)
+        return {c,0, -s,0, s,0, c,0};
+    return {c,-s, 0,0, 0,0, c,s};
+}
+
+/* adds a gate of the qelib1.inc library (or as output by QuEST's QASM logger),
+ * returning false if name is not such a gate. Any leading 'c' of name (which
+ * does not itself name a gate) is taken as an additional control qubit.
+ */
+bool local_addQASMLibraryGate(
+    QASMReader& r, std::string name, int line,
+    std::vector<qreal>& params, std::vector<int>& qubits
+) {
+    std::string base = name;
+    for (size_t i=0; i < base.size(); i++)
+        base[i] = tolower((unsigned char) base[i]);
+
+    static const char* gateNames[] = {
+        "id", "u0", "x", "y", "z", "h", "s", "sdg", "t", "tdg", "sx", "sxdg",
+        "rx", "ry", "rz", "u1", "p", "u2", "u3", "u", "swap", "sqrtswap", "rxx", "ryy", "rzz"};
+    static const int numGateNames = sizeof(gateNames) / sizeof(*gateNames);
+
+    // strip controls from the name until a gate is recognised
+    int numCtrls = 0;
+    while (true) {
+        bool isGate = false;
+        for (int i=0; i < numGateNames && !isGate; i++)
+            isGate = (base == gateNames[i]);
+        if (isGate)
+            break;
+        if (base.size() < 2 || base[0] != 'c')
+            return false;
+        base = base.substr(1);
+        numCtrls++;
+    }
+
+    bool isTwoQubit = (base == "swap" || base == "sqrtswap" || base == "rxx" || base == "ryy" || base == "rzz");
+    int numQubits = numCtrls + (isTwoQubit? 2 : 1);
+    if ((int) qubits.size() != numQubits)
+        throw local_qasmExcep(r, line, "gate '" + name + "' acts upon " + std::to_string(numQubits) +
+            " qubits, but " + std::to_string(qubits.size()) + " were given."); // throws
+
+    int numParams = (int) params.size();
+    int rightNumParams = 0;
+    if (base == "rx" || base == "ry" || base == "rz" || base == "u1" || base == "p" ||
+        base == "rxx" || base == "ryy" || base == "rzz" || base == "u0")
+        rightNumParams = 1;
+    if (base == "u2")
+        rightNumParams = 2;
+    if (base == "u3" || (base == "u" && numParams != 4))
+        rightNumParams = 3;
+    if (base == "u" && numParams == 4)
+        rightNumParams = 4;
+    if (numParams != rightNumParams)
+        throw local_qasmExcep(r, line, "gate '" + name + "' accepts " + std::to_string(rightNumParams) +
+            " parameters, but " + std::to_string(numParams) + " were given."); // throws
+
+    std::vector<qreal> none;
+    qreal r2 = 1/sqrt(2.);
+
+    // gates (and numbers of controls) which the compiled circuit supports directly
+    if (base == "id" || base == "u0")
+        return true;
+    if (base == "x")
+        local_addQASMOp(r, OPCODE_X, qubits, numCtrls, none);
+    else if (base == "z")
+        local_addQASMOp(r, OPCODE_Z, qubits, numCtrls, none);
+    else if (base == "s")
+        local_addQASMOp(r, OPCODE_S, qubits, numCtrls, none);
+    else if (base == "t")
+        local_addQASMOp(r, OPCODE_T, qubits, numCtrls, none);
+    else if (base == "swap")
+        local_addQASMOp(r, OPCODE_SWAP, qubits, numCtrls, none);
+    else if (base == "y" && numCtrls <= 1)
+        local_addQASMOp(r, OPCODE_Y, qubits, numCtrls, none);
+    else if (base == "h" && numCtrls == 0)
+        local_addQASMOp(r, OPCODE_H, qubits, numCtrls, none);
+    else if (base == "rx" && numCtrls <= 1)
+        local_addQASMOp(r, OPCODE_Rx, qubits, numCtrls, params);
+    else if (base == "ry" && numCtrls <= 1)
+        local_addQASMOp(r, OPCODE_Ry, qubits, numCtrls, params);
+    else if (base == "rz" && numCtrls <= 1)
+        local_addQASMOp(r, OPCODE_Rz, qubits, numCtrls, params);
+
+    // two-qubit rotations are effected as multi-rotate-Paulis
+    else if (base == "rxx" || base == "ryy" || base == "rzz") {
+        if (numCtrls != 0)
+            throw local_qasmExcep(r, line, "controlled gate '" + name + "' is not supported."); // throws
+        qreal code = (base == "rxx")? PAULI_X : ((base == "ryy")? PAULI_Y : PAULI_Z);
+        std::vector<qreal> rotParams = {params[0], code, code};
+        local_addQASMOp(r, OPCODE_R, qubits, numCtrls, rotParams);
+    }
+
+    // remaining gates are effected as (multi-controlled) unitaries
+    else if (base == "y")
+        local_addQASMUnitary(r, qubits, numCtrls, {0,0, 0,-1, 0,1, 0,0});
+    else if (base == "h")
+        local_addQASMUnitary(r, qubits, numCtrls,
+            {r2,0, r2,0, r2,0, -r2,0});
+    else if (base == "sdg")
+        local_addQASMUnitary(r, qubits, numCtrls, {1,0, 0,0, 0,0, 0,-1});
+    else if (base == "tdg")
+        local_addQASMUnitary(r, qubits, numCtrls, {1,0, 0,0, 0,0, r2,-r2});
+    else if (base == "sx")
+        local_addQASMUnitary(r, qubits, numCtrls, {.5,.5, .5,-.5, .5,-.5, .5,.5});
+    else if (base == "sxdg")
+        local_addQASMUnitary(r, qubits, numCtrls, {.5,-.5, .5,.5, .5,.5, .5,-.5});
+    else if (base == "rx")
+        local_addQASMUnitary(r, qubits, numCtrls, local_getQASMRotationElems(OPCODE_Rx, params[0]));
+    else if (base == "ry")
+        local_addQASMUnitary(r, qubits, numCtrls, local_getQASMRotationElems(OPCODE_Ry, params[0]));
+    else if (base == "rz")
+        local_addQASMUnitary(r, qubits, numCtrls, local_getQASMRotationElems(OPCODE_Rz, params[0]));
+    else if (base == "u1" || base == "p")
+        local_addQASMUnitary(r, qubits, numCtrls, local_getQASMUElems(0, 0, params[0], 0));
+    else if (base == "u2")
+        local_addQASMUnitary(r, qubits, numCtrls, local_getQASMUElems(M_PI/2, params[0], params[1], 0));
+    else if (base == "u3" || base == "u")
+        local_addQASMUnitary(r, qubits, numCtrls, local_getQASMUElems(
+            params[0], params[1], params[2], (numParams == 4)? params[3] : 0));
+    else if (base == "sqrtswap")
+        local_addQASMUnitary(r, qubits, numCtrls, {
+            1,0, 0,0,       0,0,       0,0,
+            0,0, .5,.5,     .5,-.5,    0,0,
+            0,0, .5,-.5,    .5,.5,     0,0,
+            0,0, 0,0,       0,0,       1,0});
+
+    return true;
+}
+
+void local_addQASMGate(
+    QASMReader& r, std::string name, int line,
+    std::vector<qreal>& params, std::vector<int>& qubits);
+
+/* parses the statement "name(params) args;" and adds the gate it applies,
+ * once per qubit of any register arguments
+ */
+void local_parseQASMGateStatement(
+    QASMReader& r, std::map<std::string,qreal>& env, std::map<std::string,int>* boundArgs
+) {
+    int line = r.tokens[r.pos].line;
+    std::string name = local_expectQASMIdent(r); // throws
+
+    std::vector<qreal> params;
+    if (local_acceptQASMToken(r, "(") && !local_acceptQASMToken(r, ")")) {
+        do
+            params.push_back(local_parseQASMExpr(r, env)); // throws
+        while (local_acceptQASMToken(r, ","));
+        local_expectQASMToken(r, ")"); // throws
+    }
+
+    std::vector<std::vector<int>> lists = local_parseQASMQubitLists(r, boundArgs); // throws
+    int size = local_getQASMBroadcastSize(r, line, lists); // throws
+
+    std::vector<int> qubits(lists.size());
+    for (int i=0; i < size; i++) {
+        for (size_t a=0; a < lists.size(); a++)
+            qubits[a] = (lists[a].size() == 1)? lists[a][0] : lists[a][i];
+        local_addQASMGate(r, name, line, params, qubits); // throws
+    }
+}
+
+/* adds a gate, expanding it if it was defined in the file (which takes
+ * precedence over the gates of qelib1.inc)
+ */
+void local_addQASMGate(
+    QASMReader& r, std::string name, int line,
+    std::vector<qreal>& params, std::vector<int>& qubits
+) {
+    if (!r.gateDefs.count(name)) {
+        if (!local_addQASMLibraryGate(r, name, line, params, qubits)) // throws
+            throw local_qasmExcep(r, line, "gate '" + name + "' has not been defined."); // throws
+        return;
+    }
+
+    QASMGateDef& def = r.gateDefs[name];
+    if (def.isOpaque)
+        throw local_qasmExcep(r, line, "opaque gate '" + name + "' cannot be simulated."); // throws
+    if (params.size() != def.params.size() || qubits.size() != def.args.size())
+        throw local_qasmExcep(r, line, "gate '" + name + "' accepts " +
+            std::to_string(def.params.size()) + " parameters and " +
+            std::to_string(def.args.size()) + " qubits."); // throws
+    if (r.gateNesting >= MAX_QASM_GATE_NESTING)
+        throw local_qasmExcep(r, line, "gate definitions are nested too deeply (or are recursive)."); // throws
+
+    std::map<std::string,qreal> env;
+    for (size_t i=0; i < params.size(); i++)
+        env[def.params[i]] = params[i];
+    std::map<std::string,int> boundArgs;
+    for (size_t i=0; i < qubits.size(); i++)
+        boundArgs[def.args[i]] = qubits[i];
+
+    // re-parse the body with the parameters and qubits bound
+    size_t callerPos = r.pos;
+    r.pos = def.bodyStart;
+    r.gateNesting++;
+    while (r.pos < def.bodyEnd) {
+        if (local_acceptQASMToken(r, "barrier"))
+            local_parseQASMQubitLists(r, &boundArgs); // throws
+        else
+            local_parseQASMGateStatement(r, env, &boundArgs); // throws
+    }
+    r.gateNesting--;
+    r.pos = callerPos;
+}
+
+/* parses "gate name(params) args { body }" or "opaque name(params) args;" */
+void local_parseQASMGateDef(QASMReader& r, bool isOpaque) {
+    int line = r.tokens[r.pos].line;
+    std::string name = local_expectQASMIdent(r); // throws
+    if (r.gateDefs.count(name))
+        throw local_qasmExcep(r, line, "gate '" + name + "' is already defined."); // throws
+
+    QASMGateDef def;
+    def.isOpaque = isOpaque;
+    if (local_acceptQASMToken(r, "(") && !local_acceptQASMToken(r, ")")) {
+        do
+            def.params.push_back(local_expectQASMIdent(r)); // throws
+        while (local_acceptQASMToken(r, ","));
+        local_expectQASMToken(r, ")"); // throws
+    }
+    do
+        def.args.push_back(local_expectQASMIdent(r)); // throws
+    while (local_acceptQASMToken(r, ","));
+
+    if (isOpaque)
+        local_expectQASMToken(r, ";"); // throws
+    else {
+        local_expectQASMToken(r, "{"); // throws
+        def.bodyStart = r.pos;
+        while (!local_acceptQASMToken(r, "}"))
+            if (local_nextQASMToken(r).type == QASM_END)
+                throw local_qasmExcep(r, line, "the definition of gate '" + name + "' is not closed."); // throws
+        def.bodyEnd = r.pos - 1;
+    }
+    r.gateDefs[name] = def;
+}
+
+/* parses the whole file, encoding its operations in r */
+void local_parseQASMProgram(QASMReader& r) {
+
+    // the version header is optional
+    if (local_acceptQASMToken(r, "OPENQASM")) {
+        QASMToken& version = local_nextQASMToken(r);
+        if (version.type != QASM_NUMBER || version.text.substr(0,1) != "2")
+            throw local_qasmExcep(r, version.line, "only OpenQASM 2 is supported."); // throws
+        local_expectQASMToken(r, ";"); // throws
+    }
+
+    while (r.tokens[r.pos].type != QASM_END) {
+        int line = r.tokens[r.pos].line;
+
+        if (local_acceptQASMToken(r, "include")) {
+            QASMToken& file = local_nextQASMToken(r);
+            if (file.type != QASM_STRING)
+                throw local_qasmExcep(r, line, "expected a filename after include."); // throws
+            if (file.text != "qelib1.inc")
+                throw local_qasmExcep(r, line, "only qelib1.inc may be included."); // throws
+            local_expectQASMToken(r, ";"); // throws
+        }
+        else if (local_acceptQASMToken(r, "qreg") || local_acceptQASMToken(r, "creg")) {
+            bool isQuantum = (r.tokens[r.pos-1].text == "qreg");
+            std::string name = local_expectQASMIdent(r); // throws
+            local_expectQASMToken(r, "["); // throws
+            int size = local_expectQASMIndex(r); // throws
+            local_expectQASMToken(r, "]"); // throws
+            local_expectQASMToken(r, ";"); // throws
+            if (r.qregs.count(name) || r.cregs.count(name))
+                throw local_qasmExcep(r, line, "register '" + name + "' is already declared."); // throws
+            if (isQuantum) {
+                if (size > MAX_NUM_QASM_QUBITS - r.numQubits)
+                    throw local_qasmExcep(r, line, "quantum registers may contain at most " + 
+                        std::to_string(MAX_NUM_QASM_QUBITS) + " qubits in total."); // throws
+                r.qregs[name] = std::make_pair(r.numQubits, size);
+                r.numQubits += size;
+            } else
+                r.cregs[name] = size;
+        }
+        else if (local_acceptQASMToken(r, "gate"))
+            local_parseQASMGateDef(r, false); // throws
+        else if (local_acceptQASMToken(r, "opaque"))
+            local_parseQASMGateDef(r, true); // throws
+        else if (local_acceptQASMToken(r, "barrier"))
+            local_parseQASMQubitLists(r, NULL); // throws
+        else if (local_acceptQASMToken(r, "if"))
+            throw local_qasmExcep(r, line, "classically-conditioned operations are not supported."); // throws
+
+        // measurements and resets of registers become single multi-target operations
+        else if (local_acceptQASMToken(r, "measure")) {
+            std::vector<int> qubits = local_parseQASMQubits(r, NULL); // throws
+            local_expectQASMToken(r, "->"); // throws
+            std::string creg = local_expectQASMIdent(r); // throws
+            if (!r.cregs.count(creg))
+                throw local_qasmExcep(r, line, "classical register '" + creg + "' has not been declared."); // throws
+            int numBits = r.cregs[creg];
+            if (local_acceptQASMToken(r, "[")) {
+                if (local_expectQASMIndex(r) >= numBits) // throws
+                    throw local_qasmExcep(r, line, "index exceeds the size of register '" + creg + "'."); // throws
+                local_expectQASMToken(r, "]"); // throws
+                numBits = 1;
+            }
+            local_expectQASMToken(r, ";"); // throws
+            if (numBits != (int) qubits.size())
+                throw local_qasmExcep(r, line, "the quantum and classical registers of the measurement differ in size."); // throws
+            std::vector<qreal> none;
+            local_addQASMOp(r, OPCODE_M, qubits, 0, none);
+        }
+        else if (local_acceptQASMToken(r, "reset")) {
+            std::vector<int> qubits = local_parseQASMQubits(r, NULL); // throws
+            local_expectQASMToken(r, ";"); // throws
+            std::vector<qreal> none;
+            local_addQASMOp(r, OPCODE_Reset, qubits, 0, none);
+        }
+        else {
+            std::map<std::string,qreal> env;
+            local_parseQASMGateStatement(r, env, NULL); // throws
+        }
+    }
+}
+
+/* reads an OpenQASM 2 file (on the machine running the link), and compiles
+ * its operations as a circuit, as if it had been sent from MMA. The returned
+ * circuit must be later destroyed with local_destroyCompiledCircuit.
+ * @throws QuESTException if the file cannot be read, or is invalid or unsupported
+ *      (exception.thrower will be "")
+ */
+CompiledCircuit* local_readCircuitFromQASM(const char* filename) {
+
+    std::ifstream file(filename);
+    if (!file.is_open())
+        throw QuESTException("", "could not open file '" + std::string(filename) + "'."); // throws
+    std::stringstream text;
+    text << file.rdbuf();
+
+    QASMReader r;
+    r.filename = filename;
+    r.pos = 0;
+    r.numQubits = 0;
+    r.gateNesting = 0;
+    local_tokeniseQASM(r, text.str()); // throws
+    local_parseQASMProgram(r); // throws
+
+    return local_compileCircuit(
+        (int) r.opcodes.size(), r.opcodes.data(),
+        r.ctrls.data(), r.numCtrlsPerOp.data(),
+        r.targs.data(), r.numTargsPerOp.data(),
+        r.params.data(), r.numParamsPerOp.data()); // throws
+}
+
+/* Compiles the circuit in the given OpenQASM 2 file, storing it as per
+ * internal_createCircuit, so that it can be applied (by id) without the gates
+ * ever being sent to MMA. Returns the circuit id.
+ */
+void internal_createCircuitFromQASM(const char* filename) {
+    try {
+        CompiledCircuit* circ = local_readCircuitFromQASM(filename); // throws
+
+        size_t id = local_getNextCircuitID();
+        circuits[id] = circ;
+        WSPutInteger(stdlink, id);
+
+    } catch (QuESTException& err) {
+        local_sendErrorAndFail("CreateCircuit", err.message);
+        
+    // e.g. a circuit too large to allocate, which must not kill the link
+    } catch (std::exception& err) {
+        local_sendErrorAndFail("CreateCircuit", 
+            "could not read OpenQASM file '" + std::string(filename) + "': " + err.what());
     }
 }
 
 /* @precondition quregs must be prior initialised and cloned to the initial state of the circuit.
+ * The circuit is compiled only once, and each derivative applies sub-ranges of its gates.
  * @throws QuESTException if a core QuEST validation fails (in this case,
  *      exception.thrower will be the name of the throwing core API function), 
  *      or we encounter an unsupported gate (exception.thrower = ""), 
@@ -1496,16 +3210,15 @@ void internal_applyCircuit(int id, int storeBackup, int showProgress) {
 void local_getDerivativeQuregs(
     // variable (to be differentiated) info
     int* quregIds, int* varOpInds, int numVars, 
-    // circuit info
-    int numOps, int* opcodes, 
-    int* ctrls, int* numCtrlsPerOp, 
-    int* targs, int* numTargsPerOp, 
-    qreal* params, int* numParamsPerOp,
+    // compiled circuit
+    CompiledCircuit* circ,
     // derivative matrices of general unitary gates in circuit
     qreal* unitaryDerivs)
 {        
     // index of the first (real) element of the next unitary derivative
     int unitaryDerivInd = 0;
+    
+    int numOps = circ->gates.size();
 
     // don't record measurement outcomes
     int* mesOutcomes = NULL;
@@ -1516,76 +3229,52 @@ void local_getDerivativeQuregs(
     // compute each derivative one-by-one
     for (int v=0; v<numVars; v++) {
         
-        // check whether the user has tried to abort
-        if (WSMessageReady(stdlink)) {
-            int code, arg;
-            WSGetMessage(stdlink, &code, &arg);
-            if (code == WSTerminateMessage || code == WSInterruptMessage || 
-                code == WSAbortMessage     || code == WSImDyingMessage) {
-                    
-                throw QuESTException("Abort", "Circuit simulation aborted."); // throws
-            }
-        }
-        
         local_throwExcepIfQuregNotCreated(quregIds[v]); // throws
         Qureg qureg = quregs[quregIds[v]];
         int varOp = varOpInds[v];
         
-        // indices AFTER last gate applied by circuit
-        int finalCtrlInd, finalTargInd, finalParamInd;
+        // the to-be-differentiated gate
+        CompiledGate& gate = circ->gates[varOp];
+        int numCtrls = gate.numCtrls;
+        int numTargs = gate.numTargs;
+        int* targs = gate.targs;
         
         // apply only gates up to and including the to-be-differentiated gate,
-        // unless that gate is the general unitary
-        int op = opcodes[varOp];
-        int diffGateWasApplied = (op != OPCODE_U);
-        local_applyGates(
-            qureg, (diffGateWasApplied)? varOp+1 : varOp, opcodes, 
-            ctrls, numCtrlsPerOp, targs, numTargsPerOp, params, numParamsPerOp,
-            mesOutcomes, &finalCtrlInd, &finalTargInd, &finalParamInd, 
-            dontShowProgress); // throws 
-
-        // details of (possibly already applied) to-be-differentiated gate
-        int numCtrls = numCtrlsPerOp[varOp];
-        int numTargs = numTargsPerOp[varOp];
-        int numParams = numParamsPerOp[varOp];
-
-        // wind back inds to point to the to-be-differentiated gate 
-        if (diffGateWasApplied) {
-            finalCtrlInd -= numCtrls;
-            finalTargInd -= numTargs;
-            finalParamInd -= numParams;
-        }
+        // unless that gate is the general unitary (this checks for abort)
+        int diffGateWasApplied = (gate.opcode != OPCODE_U);
+        local_applyCompiledGates(
+            local_getAnyQureg(quregIds[v]), circ, 0, (diffGateWasApplied)? varOp+1 : varOp, 
+            mesOutcomes, dontShowProgress); // throws 
         
         // choices of re-normalisation (verbose for MSVC :( )
         Complex negHalfI; negHalfI.real=0; negHalfI.imag=-0.5;
         Complex posI; posI.real=0; posI.imag=1;
-        Complex zero; zero.real=0; zero.imag=0;
         Complex one; one.real=1; one.imag=0;
         
         // disregard control qubits and apply gate Paulis incurred by differentiation 
         Complex normFac;
-        switch(op) {
+        switch(gate.opcode) {
             case OPCODE_Rx:
                 for (int t=0; t < numTargs; t++) // multi-target X may be possible later 
-                    pauliX(qureg, targs[t+finalTargInd]);  // throws
+                    pauliX(qureg, targs[t]);  // throws
                 normFac = negHalfI;
                 break;
             case OPCODE_Ry:
                 for (int t=0; t < numTargs; t++) // multi-target Y may be possible later 
-                    pauliY(qureg, targs[t+finalTargInd]);  // throws
+                    pauliY(qureg, targs[t]);  // throws
                 normFac = negHalfI;
                 break;
             case OPCODE_Rz:
                 for (int t=0; t < numTargs; t++)
-                    pauliZ(qureg, targs[t+finalTargInd]);  // throws
+                    pauliZ(qureg, targs[t]);  // throws
                 normFac = negHalfI;
                 break;
             case OPCODE_R:
                 for (int t=0; t < numTargs; t++) {
-                    int pauliCode = (int) params[t+finalParamInd+1];
-                    if (pauliCode == 1) pauliX(qureg, targs[t+finalTargInd]);  // throws
-                    if (pauliCode == 2) pauliY(qureg, targs[t+finalTargInd]);  // throws
-                    if (pauliCode == 3) pauliZ(qureg, targs[t+finalTargInd]);  // throws
+                    pauliOpType pauliCode = gate.paulis[t];
+                    if (pauliCode == PAULI_X) pauliX(qureg, targs[t]);  // throws
+                    if (pauliCode == PAULI_Y) pauliY(qureg, targs[t]);  // throws
+                    if (pauliCode == PAULI_Z) pauliZ(qureg, targs[t]);  // throws
                 }
                 normFac = negHalfI;
                 break;
@@ -1597,11 +3286,11 @@ void local_getDerivativeQuregs(
                 if (numTargs == 1) {
                     ComplexMatrix2 u2 = local_getMatrix2FromFlatList(&unitaryDerivs[unitaryDerivInd]);
                     unitaryDerivInd += 2*2*2;
-                    applyOneQubitMatrix(qureg, targs[finalTargInd], u2); // throws
+                    applyOneQubitMatrix(qureg, targs[0], u2); // throws
                 } else if (numTargs == 2) {
                     ComplexMatrix4 u4 = local_getMatrix4FromFlatList(&unitaryDerivs[unitaryDerivInd]);
                     unitaryDerivInd += 2*4*4;
-                    applyTwoQubitMatrix(qureg, targs[finalTargInd], targs[finalTargInd+1], u4); // throws
+                    applyTwoQubitMatrix(qureg, targs[0], targs[1], u4); // throws
                 }
                 else {
                     // TODO: create a non-dynamic ComplexMatrixN instance 
@@ -1616,24 +3305,14 @@ void local_getDerivativeQuregs(
         
         // differentiate control qubits by forcing them to 1, without renormalising
         for (int c=0; c<numCtrls; c++)
-            projectToOne(qureg, ctrls[finalCtrlInd]); // throws
+            projectToOne(qureg, gate.ctrls[c]); // throws
         
-        // adjust normalisation
-        setWeightedQureg(zero, qureg, zero, qureg, normFac, qureg); // cannot throw
-        
-        // wind forward inds to point to the next gate 
-        finalCtrlInd += numCtrls;
-        finalTargInd += numTargs;
-        finalParamInd += numParams;
+        // adjust normalisation (lazily, so that it costs no pass over the state)
+        applyGlobalFactor(qureg, normFac); // cannot throw
 
         // apply the remainder of the circuit
-        local_applyGates(
-            qureg, numOps-(varOp+1), &opcodes[varOp+1], 
-            &ctrls[  finalCtrlInd], &numCtrlsPerOp[varOp+1], 
-            &targs[  finalTargInd], &numTargsPerOp[varOp+1], 
-            &params[finalParamInd], &numParamsPerOp[varOp+1],
-            mesOutcomes, &finalCtrlInd, &finalTargInd, &finalParamInd, 
-            dontShowProgress); // throws
+        local_applyCompiledGates(
+            local_getAnyQureg(quregIds[v]), circ, varOp+1, numOps, mesOutcomes, dontShowProgress); // throws
     }
 }
 
@@ -1664,6 +3343,7 @@ void internal_calcQuregDerivs(int initStateId) {
     int numElems;
     WSGetReal64List(stdlink, &unitaryDerivs, &numElems); // must free
     
+    CompiledCircuit* circ = NULL; // must free
     try {
         // validate inputs (note varOpInds is already validated by MMA caller)
         if (numQuregs != numVars)
@@ -1696,9 +3376,12 @@ void internal_calcQuregDerivs(int initStateId) {
         for (int q=0; q < numQuregs; q++)
             cloneQureg(quregs[quregIds[q]], quregs[initStateId]); // throw precluded by above validation
             
-        local_getDerivativeQuregs(
-            quregIds, varOpInds, numVars, numOps, opcodes, ctrls, numCtrlsPerOp, 
-            targs, numTargsPerOp, params, numParamsPerOp, unitaryDerivs); // throws
+        // decode and validate the circuit once, for all derivatives
+        circ = local_compileCircuit(
+            numOps, opcodes, ctrls, numCtrlsPerOp, 
+            targs, numTargsPerOp, params, numParamsPerOp); // throws
+            
+        local_getDerivativeQuregs(quregIds, varOpInds, numVars, circ, unitaryDerivs); // throws
             
         // return
         WSPutInteger(stdlink, initStateId);
@@ -1720,6 +3403,8 @@ void internal_calcQuregDerivs(int initStateId) {
     }
     
     // clean-up, even if errors have been sent to MMA
+    if (circ != NULL)
+        local_destroyCompiledCircuit(circ);
     WSReleaseInteger32List(stdlink, quregIds, numQuregs);
     WSReleaseInteger32List(stdlink, varOpInds, numVars);
     WSReleaseReal64List(stdlink, unitaryDerivs, numElems);
@@ -1885,6 +3570,24 @@ void internal_calcExpecPauliSum(int quregId, int workspaceId) {
     }
 }
 
+/* returns 1 if the binary representation of num has an odd number of ones, else 0 */
+int local_getBitParity(unsigned long long int num) {
+    num ^= num >> 32;
+    num ^= num >> 16;
+    num ^= num >> 8;
+    num ^= num >> 4;
+    num ^= num >> 2;
+    num ^= num >> 1;
+    return (int) (num & 1ULL);
+}
+
+/* Builds the matrix of the given Pauli sum directly, without simulation. 
+ * Every Pauli product is a signed permutation: it maps basis state |c> to 
+ * i^(#Y) (-1)^(parity of c on the Y and Z targets) |c ^ flipMask>, where flipMask
+ * marks the X and Y targets. Terms sharing a flipMask populate the same entries, 
+ * so are summed together, and the matrix is sent as the 1-indexed {rows, cols, 
+ * reals, imags} of its (at most #distinct-flipMasks * 2^numQubits) nonzero elements
+ */
 void internal_calcPauliSumMatrix(int numQubits) {
     
     // must load MMA args before validation (these must all also be freed)
@@ -1893,57 +3596,109 @@ void internal_calcPauliSumMatrix(int numQubits) {
     int *allPauliCodes, *allPauliTargets, *numPaulisPerTerm;
     local_loadEncodedPauliSumFromMMA(
         &numPaulis, &numTerms, &termCoeffs, &allPauliCodes, &allPauliTargets, &numPaulisPerTerm);
-
-    // create states needed to apply Pauli products
-    Qureg inQureg = createQureg(numQubits, env);
-    Qureg outQureg = createQureg(numQubits, env);
     
     // init to null in case loading fails, to indicate no-cleanup needed
     pauliOpType* arrPaulis = NULL;
     
+    // the flip and sign masks, and the i^(#Y)-scaled coefficient, of each term
+    std::vector<long long int> flipMasks(numTerms), signMasks(numTerms);
+    std::vector<qreal> coeffsRe(numTerms), coeffsIm(numTerms);
+    
     try {
         // reformat MMA args into QuEST Hamil format (must be later freed)    
         arrPaulis = local_decodePauliSum(
             numQubits, numTerms, allPauliCodes, allPauliTargets, numPaulisPerTerm); // throws
         
-        // check that applyPauliSum will succeed (small price to pay; can't interrupt loop!)
-        applyPauliSum(inQureg, arrPaulis, termCoeffs, numTerms, outQureg);
-        
+        for (int t=0; t < numTerms; t++) {
+            long long int flipMask = 0, signMask = 0;
+            int numY = 0;
+            
+            for (int q=0; q < numQubits; q++) {
+                int code = arrPaulis[t*numQubits + q];
+                if (code < PAULI_I || code > PAULI_Z)
+                    throw QuESTException("", 
+                        "Invalid Pauli code. Codes must be 0 (or PAULI_I), 1 (PAULI_X), 2 (PAULI_Y) "
+                        "or 3 (PAULI_Z) to indicate the identity, X, Y and Z gates respectively.");
+                
+                if (code == PAULI_X || code == PAULI_Y)
+                    flipMask |= 1LL << q;
+                if (code == PAULI_Y || code == PAULI_Z)
+                    signMask |= 1LL << q;
+                if (code == PAULI_Y)
+                    numY++;
+            }
+            
+            // coeff * i^numY
+            qreal re = termCoeffs[t];
+            qreal im = 0;
+            for (int y=0; y < numY % 4; y++) {
+                qreal tmp = re;
+                re = - im;
+                im = tmp;
+            }
+            
+            flipMasks[t] = flipMask;
+            signMasks[t] = signMask;
+            coeffsRe[t] = re;
+            coeffsIm[t] = im;
+        }
     } catch( QuESTException& err) {
-
+        
         // must still perform cleanup to avoid memory leak
         local_freePauliSum(numPaulis, numTerms, 
             termCoeffs, allPauliCodes, allPauliTargets, numPaulisPerTerm, arrPaulis);
-        destroyQureg(inQureg, env);
-        destroyQureg(outQureg, env);
         
         // then exit 
         local_sendErrorAndFail("CalcPauliSumMatrix", err.message);
         return;
     }
     
-    // get result of paulis on each basis state
-    long long int dim = inQureg.numAmpsTotal;
-    WSPutFunction(stdlink, "List", 2*dim);
+    // group the terms by their flip mask
+    std::vector<int> termOrder(numTerms);
+    for (int t=0; t < numTerms; t++)
+        termOrder[t] = t;
+    std::stable_sort(termOrder.begin(), termOrder.end(), 
+        [&flipMasks](int t1, int t2) { return flipMasks[t1] < flipMasks[t2]; });
     
-    for (long long int i=0; i < dim; i++) {
-        initClassicalState(inQureg, i);
-        applyPauliSum(inQureg, arrPaulis, termCoeffs, numTerms, outQureg);
-        
-        syncQuESTEnv(env);
-        copyStateFromGPU(outQureg); // does nothing on CPU
+    long long int dim = 1LL << numQubits;
+    std::vector<wsint64> rows, cols;
+    std::vector<qreal> elemsRe, elemsIm;
+    
+    for (int first=0, last; first < numTerms; first = last) {
+        long long int flipMask = flipMasks[termOrder[first]];
+        for (last=first; last < numTerms && flipMasks[termOrder[last]] == flipMask; last++)
+            ;
         
-        WSPutReal64List(stdlink, outQureg.stateVec.real, dim);
-        WSPutReal64List(stdlink, outQureg.stateVec.imag, dim);
+        // each column has one element in this group, at row = col ^ flipMask
+        for (long long int col=0; col < dim; col++) {
+            qreal re = 0, im = 0;
+            for (int i=first; i < last; i++) {
+                int t = termOrder[i];
+                qreal sign = local_getBitParity(col & signMasks[t])? -1 : 1;
+                re += sign * coeffsRe[t];
+                im += sign * coeffsIm[t];
+            }
+            
+            // omit elements which cancelled
+            if (re == 0 && im == 0)
+                continue;
+            
+            rows.push_back(1 + (col ^ flipMask));
+            cols.push_back(1 + col);
+            elemsRe.push_back(re);
+            elemsIm.push_back(im);
+        }
     }
     
-    // output has already been 'put'
+    WSPutFunction(stdlink, "List", 4);
+    WSPutInteger64List(stdlink, rows.data(), rows.size());
+    WSPutInteger64List(stdlink, cols.data(), cols.size());
+    WSPutReal64List(stdlink, elemsRe.data(), elemsRe.size());
+    WSPutReal64List(stdlink, elemsIm.data(), elemsIm.size());
 
     // clean up
     local_freePauliSum(numPaulis, numTerms, 
         termCoeffs, allPauliCodes, allPauliTargets, numPaulisPerTerm, arrPaulis);
-    destroyQureg(inQureg, env);
-    destroyQureg(outQureg, env);
 }
 
 void internal_applyPauliSum(int inId, int outId) {
@@ -1992,6 +3747,334 @@ void internal_applyPauliSum(int inId, int outId) {
     }
 }
 
+void internal_applyTrotterCircuit(int quregId, qreal time, int order, int reps) {
+    
+    // must load MMA args before validation (these must all also be freed)
+    int numPaulis, numTerms;
+    qreal* termCoeffs;
+    int *allPauliCodes, *allPauliTargets, *numPaulisPerTerm;
+    local_loadEncodedPauliSumFromMMA(
+        &numPaulis, &numTerms, &termCoeffs, &allPauliCodes, &allPauliTargets, &numPaulisPerTerm);
+
+    // init to null in case loading fails, to indicate no-cleanup needed
+    pauliOpType* arrPaulis = NULL;
+    
+    try {
+        local_throwExcepIfQuregNotCreated(quregId); // throws
+        Qureg qureg = quregs[quregId];
+        
+        // reformat MMA args into QuEST Hamil format (must be later freed)
+        arrPaulis = local_decodePauliSum(
+            qureg.numQubitsRepresented, numTerms, allPauliCodes, allPauliTargets, numPaulisPerTerm); // throws
+        
+        applyTrotterCircuit(qureg, arrPaulis, termCoeffs, numTerms, time, order, reps); // throws
+        
+        // cleanup
+        local_freePauliSum(numPaulis, numTerms, 
+            termCoeffs, allPauliCodes, allPauliTargets, numPaulisPerTerm, arrPaulis);
+            
+        // and return
+        WSPutInteger(stdlink, quregId);
+        
+    } catch( QuESTException& err) {
+        
+        // must still clean-up (arrPaulis may still be NULL)
+        local_freePauliSum(numPaulis, numTerms, 
+            termCoeffs, allPauliCodes, allPauliTargets, numPaulisPerTerm, arrPaulis);
+            
+        // and report error
+        local_sendErrorAndFail("ApplyTrotterCircuit", err.message);
+    }
+}
+
+
+void internal_applyKrylovEvolution(int quregId, qreal time) {
+    
+    // must load MMA args before validation (these must all also be freed)
+    int numPaulis, numTerms;
+    qreal* termCoeffs;
+    int *allPauliCodes, *allPauliTargets, *numPaulisPerTerm;
+    local_loadEncodedPauliSumFromMMA(
+        &numPaulis, &numTerms, &termCoeffs, &allPauliCodes, &allPauliTargets, &numPaulisPerTerm);
+
+    // init to null in case loading fails, to indicate no-cleanup needed
+    pauliOpType* arrPaulis = NULL;
+    
+    try {
+        local_throwExcepIfQuregNotCreated(quregId); // throws
+        Qureg qureg = quregs[quregId];
+        
+        // reformat MMA args into QuEST Hamil format (must be later freed)
+        arrPaulis = local_decodePauliSum(
+            qureg.numQubitsRepresented, numTerms, allPauliCodes, allPauliTargets, numPaulisPerTerm); // throws
+        
+        applyKrylovEvolution(qureg, arrPaulis, termCoeffs, numTerms, time, env); // throws
+        
+        // cleanup
+        local_freePauliSum(numPaulis, numTerms, 
+            termCoeffs, allPauliCodes, allPauliTargets, numPaulisPerTerm, arrPaulis);
+            
+        // and return
+        WSPutInteger(stdlink, quregId);
+        
+    } catch( QuESTException& err) {
+        
+        // must still clean-up (arrPaulis may still be NULL)
+        local_freePauliSum(numPaulis, numTerms, 
+            termCoeffs, allPauliCodes, allPauliTargets, numPaulisPerTerm, arrPaulis);
+            
+        // and report error
+        local_sendErrorAndFail("ApplyKrylovEvolution", err.message);
+    }
+}
+
+void internal_calcGroundState(int quregId, qreal tolerance) {
+    
+    // must load MMA args before validation (these must all also be freed)
+    int numPaulis, numTerms;
+    qreal* termCoeffs;
+    int *allPauliCodes, *allPauliTargets, *numPaulisPerTerm;
+    local_loadEncodedPauliSumFromMMA(
+        &numPaulis, &numTerms, &termCoeffs, &allPauliCodes, &allPauliTargets, &numPaulisPerTerm);
+
+    // init to null in case loading fails, to indicate no-cleanup needed
+    pauliOpType* arrPaulis = NULL;
+    
+    try {
+        local_throwExcepIfQuregNotCreated(quregId); // throws
+        Qureg qureg = quregs[quregId];
+        
+        // reformat MMA args into QuEST Hamil format (must be later freed)
+        arrPaulis = local_decodePauliSum(
+            qureg.numQubitsRepresented, numTerms, allPauliCodes, allPauliTargets, numPaulisPerTerm); // throws
+        
+        qreal energy = calcGroundState(qureg, arrPaulis, termCoeffs, numTerms, tolerance, env); // throws
+        
+        // cleanup
+        local_freePauliSum(numPaulis, numTerms, 
+            termCoeffs, allPauliCodes, allPauliTargets, numPaulisPerTerm, arrPaulis);
+            
+        // and return
+        WSPutReal64(stdlink, energy);
+        
+    } catch( QuESTException& err) {
+        
+        // must still clean-up (arrPaulis may still be NULL)
+        local_freePauliSum(numPaulis, numTerms, 
+            termCoeffs, allPauliCodes, allPauliTargets, numPaulisPerTerm, arrPaulis);
+            
+        // and report error
+        local_sendErrorAndFail("CalcGroundState", err.message);
+    }
+}
+
+
+
+
+/*
+ * DIAGONAL OPERATORS
+ */
+
+/*
+ * Collection of instantiated DiagonalOps (created by CreateDiagonalOp)
+ */
+std::vector<DiagonalOp> diagOps;
+std::vector<bool> diagOpIsCreated;
+
+size_t local_getNextDiagOpID(void) {
+    size_t id;
+    
+    // check for next id
+    for (id=0; id < diagOps.size(); id++)
+        if (!diagOpIsCreated[id])
+            return id;
+            
+    // if none are available, make more space (using a blank DiagonalOp)
+    DiagonalOp blank = {0};
+    id = diagOps.size();
+    diagOps.push_back(blank);
+    diagOpIsCreated.push_back(false);
+    return id;
+}
+
+void local_throwExcepIfDiagOpNotCreated(int id) {
+    if (id < 0)
+        throw QuESTException("", "diagonal operator id " + std::to_string(id) + " is invalid (must be >= 0).");
+    if (id >= (int) diagOps.size() || !diagOpIsCreated[id])
+        throw QuESTException("", "diagonal operator (with id " + std::to_string(id) + ") has not been created");
+}
+
+/* returns the number of qubits of an operator with numElems diagonal elements, 
+ * throwing an exception if numElems is not a power of 2 (of at least 2)
+ */
+int local_getNumQubitsOfDiagOp(long long int numElems) {
+    int numQubits = 0;
+    while ((1LL << numQubits) < numElems)
+        numQubits++;
+    if (numElems < 2 || (1LL << numQubits) != numElems)
+        throw QuESTException("", "the number of diagonal elements (" + std::to_string(numElems) + 
+            ") must be a power of 2 (of at least 2).");
+    return numQubits;
+}
+
+/* creates a DiagonalOp with the given elements (which must number 2^numQubits), 
+ * returning its id 
+ */
+int local_createDiagonalOpFromElems(int numQubits, qreal* reals, qreal* imags) {
+    size_t id = local_getNextDiagOpID();
+    diagOps[id] = createDiagonalOp(numQubits, env); // throws
+    diagOpIsCreated[id] = true;
+    initDiagonalOp(diagOps[id], reals, imags);
+    return id;
+}
+
+/* Creates a DiagonalOp from the flat lists of the real and imaginary 
+ * components of its 2^numQubits diagonal elements, and returns its id
+ */
+void internal_createDiagonalOp(int numQubits, qreal* reals, long l1, qreal* imags, long l2) {
+    try {
+        if (l1 != l2 || numQubits < 1 || numQubits > 62 || l1 != (1LL << numQubits))
+            throw QuESTException("", "incorrect number of diagonal elements supplied."); // throws
+        
+        int id = local_createDiagonalOpFromElems(numQubits, reals, imags); // throws
+        WSPutInteger(stdlink, id);
+        
+    } catch( QuESTException& err) {
+        local_sendErrorAndFail("CreateDiagonalOp", err.message);
+    }
+}
+
+/* Creates a DiagonalOp from a plain-text file (read by the backend, so that the elements 
+ * need not be sent from MMA), and returns its id. Each non-empty line of the file 
+ * (excluding those beginning with #) specifies a single diagonal element, in the 
+ * format {re im} or {re} (exclude braces), and the number of lines must be a power of 2.
+ */
+void internal_createDiagonalOpFromFile(const char* filename) {
+    try {
+        std::ifstream file(filename);
+        if (!file.is_open())
+            throw QuESTException("", "could not open file '" + std::string(filename) + "'."); // throws
+        
+        std::vector<qreal> reals, imags;
+        std::string line;
+        long long int lineNum = 0;
+        while (std::getline(file, line)) {
+            lineNum++;
+            
+            // skip blank and comment lines
+            size_t start = line.find_first_not_of(" \t\r");
+            if (start == std::string::npos || line[start] == '#')
+                continue;
+            
+            // accept only {re} or {re im}, with nothing after
+            std::istringstream fields(line);
+            double re, im=0;
+            std::string extra;
+            bool isValid = static_cast<bool>(fields >> re);
+            if (isValid && !(fields >> im))
+                isValid = fields.eof();
+            else if (isValid)
+                isValid = !(fields >> extra);
+            if (!isValid)
+                throw QuESTException("", "could not parse line " + std::to_string(lineNum) + 
+                    " of file '" + std::string(filename) + "' as a complex number."); // throws
+            
+            reals.push_back(re);
+            imags.push_back(im);
+        }
+        
+        int numQubits = local_getNumQubitsOfDiagOp(reals.size()); // throws
+        int id = local_createDiagonalOpFromElems(numQubits, reals.data(), imags.data()); // throws
+        WSPutInteger(stdlink, id);
+        
+    } catch( QuESTException& err) {
+        local_sendErrorAndFail("CreateDiagonalOp", err.message);
+    }
+}
+
+void wrapper_destroyDiagonalOp(int id) {
+    try { 
+        local_throwExcepIfDiagOpNotCreated(id); // throws
+        
+        destroyDiagonalOp(diagOps[id], env); // throws
+        diagOpIsCreated[id] = false;
+        WSPutInteger(stdlink, id);
+
+    } catch( QuESTException& err) {
+        local_sendErrorAndFail("DestroyDiagonalOp", err.message);
+    }
+}
+
+void wrapper_applyDiagonalOp(int quregId, int opId) {
+    try {
+        local_throwExcepIfQuregNotCreated(quregId); // throws
+        local_throwExcepIfDiagOpNotCreated(opId); // throws
+        
+        applyDiagonalOp(quregs[quregId], diagOps[opId]); // throws
+        WSPutInteger(stdlink, quregId);
+        
+    } catch( QuESTException& err) {
+        local_sendErrorAndFail("ApplyDiagonalOp", err.message);
+    }
+}
+
+void wrapper_calcExpecDiagonalOp(int quregId, int opId) {
+    try {
+        local_throwExcepIfQuregNotCreated(quregId); // throws
+        local_throwExcepIfDiagOpNotCreated(opId); // throws
+        
+        Complex res = calcExpecDiagonalOp(quregs[quregId], diagOps[opId]); // throws
+        WSPutFunction(stdlink, "Complex", 2);
+        WSPutReal64(stdlink, res.real);
+        WSPutReal64(stdlink, res.imag);
+        
+    } catch( QuESTException& err) {
+        local_sendErrorAndFail("CalcExpecDiagonalOp", err.message);
+    }
+}
+
+/* Applies exp(i f(x)) where x is the integer encoded by the given qubits, and f is 
+ * a polynomial (with the given coefficients and exponents) or else one of the given 
+ * override phases, chosen when x is one of the given override indices
+ */
+void internal_applyPhaseFunc(
+    int quregId, int* qubits, long numQubits, int encoding, 
+    qreal* coeffs, long numTerms, qreal* exponents, long numExps, 
+    int* overrideInds, long numOverrides, qreal* overridePhases, long numPhases
+) {
+    try {
+        local_throwExcepIfQuregNotCreated(quregId); // throws
+        if (numTerms != numExps || numOverrides != numPhases)
+            throw QuESTException("", "Internal error: the lists of terms or overrides had inconsistent lengths.");
+        
+        // overrides are sent as (machine) integers but QuEST accepts long long int
+        std::vector<long long int> inds(overrideInds, overrideInds + numOverrides);
+        applyPhaseFuncOverrides(
+            quregs[quregId], qubits, numQubits, (enum bitEncoding) encoding, 
+            coeffs, exponents, numTerms, inds.data(), overridePhases, numOverrides); // throws
+        WSPutInteger(stdlink, quregId);
+        
+    } catch( QuESTException& err) {
+        local_sendErrorAndFail("ApplyPhaseFunc", err.message);
+    }
+}
+
+/* Applies exp(i phases[x]) where x is the unsigned integer encoded by the given qubits */
+void internal_applyPhaseFuncTable(int quregId, int* qubits, long numQubits, qreal* phases, long numPhases) {
+    try {
+        local_throwExcepIfQuregNotCreated(quregId); // throws
+        if (numQubits < 1 || numQubits > 62 || numPhases != (1LL << numQubits))
+            throw QuESTException("", "The number of phases (" + std::to_string(numPhases) + 
+                ") must equal 2^(the number of qubits).");
+        
+        applyPhaseFuncTable(quregs[quregId], qubits, numQubits, phases); // throws
+        WSPutInteger(stdlink, quregId);
+        
+    } catch( QuESTException& err) {
+        local_sendErrorAndFail("ApplyPhaseFunc", err.message);
+    }
+}
+
 
 
 
@@ -2005,6 +4088,9 @@ void internal_applyPauliSum(int inId, int outId) {
       
         // create the single, global QuEST execution env
         env = createQuESTEnv();
+#ifdef QUEST_MIXED_PRECISION
+        singleEnv = single::single_createQuESTEnv();
+#endif
         
         // establish link with MMA
         return WSMain(argc, argv);
@@ -2016,6 +4102,9 @@ void internal_applyPauliSum(int inId, int outId) {
       
         // create the single, global QuEST execution env
         env = createQuESTEnv();
+#ifdef QUEST_MIXED_PRECISION
+        singleEnv = single::single_createQuESTEnv();
+#endif
 
         // parse Windows args
         char  buff[512];
@@ -7,7 +7,7 @@
 :ReturnType:     Manual
 :End:
 :Evaluate: 
-    QuEST`CreateQureg::usage = "CreateQureg[numQubits] returns the id of a newly created statevector.";
+    QuEST`CreateQureg::usage = "CreateQureg[numQubits] returns the id of a newly created statevector. CreateQureg[numQubits, precision] creates the statevector in the given precision, 1 (single) or 2 (double), which is only possible when quest_link was compiled with MIXED_PRECISION. Single-precision quregs support only creation, initialisation, circuits, amplitude and probability getters, and CloneQureg (which converts between precisions).";
     QuEST`CreateQureg::error = "`1`";
     QuEST`CreateQureg[___] := QuEST`Private`invalidArgError[CreateQureg];
 
@@ -19,10 +19,44 @@
 :ReturnType:     Manual
 :End:
 :Evaluate: 
-    QuEST`CreateDensityQureg::usage = "CreateDensityQureg[numQubits] returns the id of a newly created density matrix.";
+    QuEST`CreateDensityQureg::usage = "CreateDensityQureg[numQubits] returns the id of a newly created density matrix. CreateDensityQureg[numQubits, precision] creates the density matrix in the given precision, 1 (single) or 2 (double), as per CreateQureg.";
     QuEST`CreateDensityQureg::error = "`1`";
     QuEST`CreateDensityQureg[___] := QuEST`Private`invalidArgError[CreateDensityQureg];
 
+:Begin:
+:Function:       callable_createQuregOfPrecision
+:Pattern:        QuEST`CreateQureg[numQubits_Integer, precision_Integer]
+:Arguments:      { numQubits, precision }
+:ArgumentTypes:  { Integer, Integer }
+:ReturnType:     Manual
+:End:
+
+:Begin:
+:Function:       callable_createDensityQuregOfPrecision
+:Pattern:        QuEST`CreateDensityQureg[numQubits_Integer, precision_Integer]
+:Arguments:      { numQubits, precision }
+:ArgumentTypes:  { Integer, Integer }
+:ReturnType:     Manual
+:End:
+
+:Begin:
+:Function:       internal_createDiskQureg
+:Pattern:        QuEST`Private`CreateDiskQuregInternal[numQubits_Integer, filename_String]
+:Arguments:      { numQubits, filename }
+:ArgumentTypes:  { Integer, String }
+:ReturnType:     Manual
+:End:
+:Evaluate: QuEST`Private`CreateDiskQuregInternal::usage = "CreateDiskQuregInternal[numQubits, filename] returns the id of a newly created statevector, memory-mapped from a scratch file at the given (absolute) filename."
+
+:Begin:
+:Function:       internal_createDensityDiskQureg
+:Pattern:        QuEST`Private`CreateDensityDiskQuregInternal[numQubits_Integer, filename_String]
+:Arguments:      { numQubits, filename }
+:ArgumentTypes:  { Integer, String }
+:ReturnType:     Manual
+:End:
+:Evaluate: QuEST`Private`CreateDensityDiskQuregInternal::usage = "CreateDensityDiskQuregInternal[numQubits, filename] returns the id of a newly created density matrix, memory-mapped from a scratch file at the given (absolute) filename."
+
 :Begin:
 :Function:       wrapper_destroyQureg
 :Pattern:        QuEST`Private`DestroyQuregInternal[id_Integer]
@@ -127,10 +161,28 @@
 :ReturnType:     Manual
 :End:
 :Evaluate:
-    QuEST`CloneQureg::usage = "CloneQureg[dest, source] sets dest to be a copy of source.";
+    QuEST`CloneQureg::usage = "CloneQureg[dest, source] sets dest to be a copy of source. The quregs may differ in precision, in which case every amplitude is converted.";
     QuEST`CloneQureg::error = "`1`";
     QuEST`CloneQureg[___] := QuEST`Private`invalidArgError[CloneQureg];
 
+:Begin:
+:Function:       internal_saveQureg
+:Pattern:        QuEST`Private`SaveQuregInternal[qureg_Integer, filename_String]
+:Arguments:      { qureg, filename }
+:ArgumentTypes:  { Integer, String }
+:ReturnType:     Manual
+:End:
+:Evaluate: QuEST`Private`SaveQuregInternal::usage = "SaveQuregInternal[qureg, filename] saves the qureg to a binary checkpoint at the given (absolute) filename, and returns the qureg id."
+
+:Begin:
+:Function:       internal_loadQureg
+:Pattern:        QuEST`Private`LoadQuregInternal[qureg_Integer, filename_String]
+:Arguments:      { qureg, filename }
+:ArgumentTypes:  { Integer, String }
+:ReturnType:     Manual
+:End:
+:Evaluate: QuEST`Private`LoadQuregInternal::usage = "LoadQuregInternal[qureg, filename] overwrites the qureg with the checkpoint at the given (absolute) filename, and returns the qureg id."
+
 :Begin:
 :Function:       internal_getAmp
 :Pattern:        QuEST`Private`GetAmpInternal[qureg_Integer, row_Integer, col_Integer]
@@ -152,6 +204,18 @@
     QuEST`IsDensityMatrix::error = "`1`";
     QuEST`IsDensityMatrix[___] := QuEST`Private`invalidArgError[IsDensityMatrix];
 
+:Begin:
+:Function:       callable_getQuregPrecision
+:Pattern:        QuEST`GetQuregPrecision[qureg_Integer]
+:Arguments:      { qureg }
+:ArgumentTypes:  { Integer }
+:ReturnType:     Manual
+:End:
+:Evaluate: 
+    QuEST`GetQuregPrecision::usage = "GetQuregPrecision[qureg] returns the precision of the qureg's amplitudes; 1 (single) or 2 (double).";
+    QuEST`GetQuregPrecision::error = "`1`";
+    QuEST`GetQuregPrecision[___] := QuEST`Private`invalidArgError[GetQuregPrecision];
+
 
 
 
@@ -357,6 +421,51 @@
 :ReturnType:     Manual
 :End:
 :Evaluate: QuEST`Private`ApplyCircuitInternal::usage = "ApplyCircuitInternal[qureg, storeBackup, showProgress, opcodes, ctrls, numCtrlsPerOps, targs, numTargsPerOp, params, numParamsPerOps] applies a circuit (decomposed into codes) to the given qureg."
+:Begin:
+:Function:       internal_createCircuit
+:Pattern:        QuEST`Private`CreateCircuitInternal[opcodes_List, ctrls_List, numCtrlsPerOp_List, targs_List, numTargsPerOp_List, params_List, numParamsPerOp_List]
+:Arguments:      { opcodes, ctrls, numCtrlsPerOp, targs, numTargsPerOp, params, numParamsPerOp }
+:ArgumentTypes:  { Manual }
+:ReturnType:     Manual
+:End:
+:Evaluate: QuEST`Private`CreateCircuitInternal::usage = "CreateCircuitInternal[opcodes, ctrls, numCtrlsPerOps, targs, numTargsPerOp, params, numParamsPerOps] validates and compiles a circuit (decomposed into codes), storing it in the backend, and returns its id."
+
+:Begin:
+:Function:       internal_createCircuitFromQASM
+:Pattern:        QuEST`Private`CreateCircuitFromQASMInternal[filename_String]
+:Arguments:      { filename }
+:ArgumentTypes:  { String }
+:ReturnType:     Manual
+:End:
+:Evaluate: QuEST`Private`CreateCircuitFromQASMInternal::usage = "CreateCircuitFromQASMInternal[filename] reads (in the backend) the OpenQASM 2 file, validates and compiles its operations as a circuit, storing it in the backend, and returns its id."
+
+:Begin:
+:Function:       internal_applyCreatedCircuit
+:Pattern:        QuEST`Private`ApplyCreatedCircuitInternal[circId_Integer, qureg_Integer, storeBackup_Integer, showProgress_Integer]
+:Arguments:      { circId, qureg, storeBackup, showProgress }
+:ArgumentTypes:  { Integer, Integer, Integer, Integer }
+:ReturnType:     Manual
+:End:
+:Evaluate: QuEST`Private`ApplyCreatedCircuitInternal::usage = "ApplyCreatedCircuitInternal[circId, qureg, storeBackup, showProgress] applies the circuit created by CreateCircuitInternal to the given qureg."
+
+:Begin:
+:Function:       internal_setCircuitParams
+:Pattern:        QuEST`Private`SetCircuitParamsInternal[circId_Integer, paramInds_List, paramVals_List]
+:Arguments:      { circId, paramInds, paramVals }
+:ArgumentTypes:  { Integer, IntegerList, RealList }
+:ReturnType:     Manual
+:End:
+:Evaluate: QuEST`Private`SetCircuitParamsInternal::usage = "SetCircuitParamsInternal[circId, paramInds, paramVals] overwrites the elements (at the given indices) of the flat params list of the created circuit, recompiling the affected gates."
+
+:Begin:
+:Function:       internal_destroyCircuit
+:Pattern:        QuEST`Private`DestroyCircuitInternal[circId_Integer]
+:Arguments:      { circId }
+:ArgumentTypes:  { Integer }
+:ReturnType:     Manual
+:End:
+:Evaluate: QuEST`Private`DestroyCircuitInternal::usage = "DestroyCircuitInternal[circId] frees the circuit created by CreateCircuitInternal."
+
 
 :Begin:
 :Function:       internal_calcExpecPauliProd
@@ -385,6 +494,33 @@
 :End:
 :Evaluate: QuEST`Private`ApplyPauliSumInternal::usage = "ApplyPauliSumInternal[inQureg, outQureg, termCoeffs, allPauliCodes, allPauliTargets, numPaulisPerTerm] modifies outQureg under the given sum of Pauli products, specified as flat lists. inQureg and outQureg must have the same type and equal dimensions."
 
+:Begin:
+:Function:       internal_applyTrotterCircuit
+:Pattern:        QuEST`Private`ApplyTrotterCircuitInternal[qureg_Integer, time_Real, order_Integer, reps_Integer, termCoeffs_List, allPauliCodes_List, allPauliTargets_List, numPaulisPerTerm_List]
+:Arguments:      { qureg, time, order, reps, termCoeffs, allPauliCodes, allPauliTargets, numPaulisPerTerm }
+:ArgumentTypes:  { Integer, Real, Integer, Integer, Manual }
+:ReturnType:     Manual
+:End:
+:Evaluate: QuEST`Private`ApplyTrotterCircuitInternal::usage = "ApplyTrotterCircuitInternal[qureg, time, order, reps, termCoeffs, allPauliCodes, allPauliTargets, numPaulisPerTerm] applies a Trotterisation of the evolution under the given sum of Pauli products (specified as flat lists) for the given time."
+
+:Begin:
+:Function:       internal_applyKrylovEvolution
+:Pattern:        QuEST`Private`ApplyKrylovEvolutionInternal[qureg_Integer, time_Real, termCoeffs_List, allPauliCodes_List, allPauliTargets_List, numPaulisPerTerm_List]
+:Arguments:      { qureg, time, termCoeffs, allPauliCodes, allPauliTargets, numPaulisPerTerm }
+:ArgumentTypes:  { Integer, Real, Manual }
+:ReturnType:     Manual
+:End:
+:Evaluate: QuEST`Private`ApplyKrylovEvolutionInternal::usage = "ApplyKrylovEvolutionInternal[qureg, time, termCoeffs, allPauliCodes, allPauliTargets, numPaulisPerTerm] applies the exact evolution under the given sum of Pauli products (specified as flat lists) for the given time, by Krylov subspace projection."
+
+:Begin:
+:Function:       internal_calcGroundState
+:Pattern:        QuEST`Private`CalcGroundStateInternal[qureg_Integer, tolerance_Real, termCoeffs_List, allPauliCodes_List, allPauliTargets_List, numPaulisPerTerm_List]
+:Arguments:      { qureg, tolerance, termCoeffs, allPauliCodes, allPauliTargets, numPaulisPerTerm }
+:ArgumentTypes:  { Integer, Real, Manual }
+:ReturnType:     Manual
+:End:
+:Evaluate: QuEST`Private`CalcGroundStateInternal::usage = "CalcGroundStateInternal[qureg, tolerance, termCoeffs, allPauliCodes, allPauliTargets, numPaulisPerTerm] sets qureg to the ground state of the given sum of Pauli products (specified as flat lists), by the Lanczos method, and returns its energy."
+
 :Begin:
 :Function:       internal_calcPauliSumMatrix
 :Pattern:        QuEST`Private`CalcPauliSumMatrixInternal[numQubits_Integer, termCoeffs_List, allPauliCodes_List, allPauliTargets_List, numPaulisPerTerm_List]
@@ -392,7 +528,79 @@
 :ArgumentTypes:  { Integer, Manual }
 :ReturnType:     Manual
 :End:
-:Evaluate: QuEST`Private`CalcPauliSumMatrixInternal::usage = "CalcPauliSumMatrixInternal[numQubits, termCoeffs, allPauliCodes, allPauliTargets, numPaulisPerTerm] returns the action of applying the given sum of Pauli products (specified as flat lists) to every basis state."
+:Evaluate: QuEST`Private`CalcPauliSumMatrixInternal::usage = "CalcPauliSumMatrixInternal[numQubits, termCoeffs, allPauliCodes, allPauliTargets, numPaulisPerTerm] returns the 1-indexed {rows, cols, reals, imags} of the nonzero elements of the matrix of the given sum of Pauli products (specified as flat lists)."
+
+:Begin:
+:Function:       internal_createDiagonalOp
+:Pattern:        QuEST`Private`CreateDiagonalOpInternal[numQubits_Integer, reals_List, imags_List]
+:Arguments:      { numQubits, reals, imags }
+:ArgumentTypes:  { Integer, RealList, RealList }
+:ReturnType:     Manual
+:End:
+:Evaluate: QuEST`Private`CreateDiagonalOpInternal::usage = "CreateDiagonalOpInternal[numQubits, reals, imags] creates a diagonal operator with the given 2^numQubits elements (specified as lists of real and imaginary components), and returns its id."
+
+:Begin:
+:Function:       internal_createDiagonalOpFromFile
+:Pattern:        QuEST`Private`CreateDiagonalOpFromFileInternal[filename_String]
+:Arguments:      { filename }
+:ArgumentTypes:  { String }
+:ReturnType:     Manual
+:End:
+:Evaluate: QuEST`Private`CreateDiagonalOpFromFileInternal::usage = "CreateDiagonalOpFromFileInternal[filename] creates a diagonal operator with elements read (by the backend) from the given file, and returns its id."
+
+:Begin:
+:Function:       wrapper_destroyDiagonalOp
+:Pattern:        QuEST`DestroyDiagonalOp[op_Integer]
+:Arguments:      { op }
+:ArgumentTypes:  { Integer }
+:ReturnType:     Manual
+:End:
+:Evaluate: 
+    QuEST`DestroyDiagonalOp::usage = "DestroyDiagonalOp[op] frees the diagonal operator created by CreateDiagonalOp (and returns its id).";
+    QuEST`DestroyDiagonalOp::error = "`1`";
+    QuEST`DestroyDiagonalOp[___] := QuEST`Private`invalidArgError[DestroyDiagonalOp];
+
+:Begin:
+:Function:       wrapper_applyDiagonalOp
+:Pattern:        QuEST`ApplyDiagonalOp[qureg_Integer, op_Integer]
+:Arguments:      { qureg, op }
+:ArgumentTypes:  { Integer, Integer }
+:ReturnType:     Manual
+:End:
+:Evaluate: 
+    QuEST`ApplyDiagonalOp::usage = "ApplyDiagonalOp[qureg, op] multiplies the qureg by the diagonal operator created by CreateDiagonalOp (left-multiplying density matrices), which need not be unitary nor Hermitian, and returns the qureg id.";
+    QuEST`ApplyDiagonalOp::error = "`1`";
+    QuEST`ApplyDiagonalOp[___] := QuEST`Private`invalidArgError[ApplyDiagonalOp];
+
+:Begin:
+:Function:       wrapper_calcExpecDiagonalOp
+:Pattern:        QuEST`CalcExpecDiagonalOp[qureg_Integer, op_Integer]
+:Arguments:      { qureg, op }
+:ArgumentTypes:  { Integer, Integer }
+:ReturnType:     Manual
+:End:
+:Evaluate: 
+    QuEST`CalcExpecDiagonalOp::usage = "CalcExpecDiagonalOp[qureg, op] returns the (possibly complex) expected value of the diagonal operator created by CreateDiagonalOp, computed in a single pass without a workspace qureg. qureg is unchanged.";
+    QuEST`CalcExpecDiagonalOp::error = "`1`";
+    QuEST`CalcExpecDiagonalOp[___] := QuEST`Private`invalidArgError[CalcExpecDiagonalOp];
+
+:Begin:
+:Function:       internal_applyPhaseFunc
+:Pattern:        QuEST`Private`ApplyPhaseFuncInternal[qureg_Integer, qubits_List, encoding_Integer, coeffs_List, exponents_List, overrideInds_List, overridePhases_List]
+:Arguments:      { qureg, qubits, encoding, coeffs, exponents, overrideInds, overridePhases }
+:ArgumentTypes:  { Integer, IntegerList, Integer, RealList, RealList, IntegerList, RealList }
+:ReturnType:     Manual
+:End:
+:Evaluate: QuEST`Private`ApplyPhaseFuncInternal::usage = "ApplyPhaseFuncInternal[qureg, qubits, encoding, coeffs, exponents, overrideInds, overridePhases] multiplies each basis state by exp(i f(x)) where x is the integer (0 for unsigned, 1 for two's complement) encoded by qubits, and f is the polynomial sum_j coeffs[j] x^exponents[j], unless overridden."
+
+:Begin:
+:Function:       internal_applyPhaseFuncTable
+:Pattern:        QuEST`Private`ApplyPhaseFuncTableInternal[qureg_Integer, qubits_List, phases_List]
+:Arguments:      { qureg, qubits, phases }
+:ArgumentTypes:  { Integer, IntegerList, RealList }
+:ReturnType:     Manual
+:End:
+:Evaluate: QuEST`Private`ApplyPhaseFuncTableInternal::usage = "ApplyPhaseFuncTableInternal[qureg, qubits, phases] multiplies each basis state by exp(i phases[x]) where x is the unsigned integer encoded by qubits."
 
 :Begin:
 :Function:       internal_getQuregMatrix
@@ -439,6 +647,18 @@
     QuEST`DestroyAllQuregs::error = "`1`";
     QuEST`DestroyAllQuregs[___] := QuEST`Private`invalidArgError[DestroyAllQuregs];
 
+:Begin:
+:Function:       callable_releaseFreedMemory
+:Pattern:        QuEST`ReleaseFreedMemory[]
+:Arguments:      { }
+:ArgumentTypes:  { }
+:ReturnType:     Manual
+:End:
+:Evaluate: 
+    QuEST`ReleaseFreedMemory::usage = "ReleaseFreedMemory[] returns to the operating system the memory retained (for reuse by new quregs of the same size) from destroyed quregs. This is done automatically by DestroyAllQuregs[], and when creating a disk-backed qureg.";
+    QuEST`ReleaseFreedMemory::error = "`1`";
+    QuEST`ReleaseFreedMemory[___] := QuEST`Private`invalidArgError[ReleaseFreedMemory];
+
 :Begin:
 :Function:       callable_getAllQuregs
 :Pattern:        QuEST`GetAllQuregs[]
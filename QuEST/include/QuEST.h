@@ -62,10 +62,12 @@ enum phaseGateType {SIGMA_Z=0, S_GATE=1, T_GATE=2};
  */
 typedef struct {
     
-    char* buffer;       // generated QASM string
-    int bufferSize;     // maximum number of chars before overflow
-    int bufferFill;     // number of chars currently in buffer
-    int isLogging;      // whether gates are being added to buffer
+    struct QASMChunk* firstChunk;   // arena of compact binary instruction records
+    struct QASMChunk* lastChunk;    // chunk of the arena currently being appended to
+    long long int arenaFill;        // number of bytes of records currently in the arena
+    long long int streamThreshold;  // arena size beyond which records are formatted into streamFile
+    void* streamFile;               // temporary FILE* holding QASM formatted from earlier records
+    int isLogging;                  // whether gates are being added to the arena
     
 } QASMLogger;
 
@@ -96,6 +98,17 @@ typedef struct ComplexArray
   */
  enum pauliOpType {PAULI_I=0, PAULI_X=1, PAULI_Y=2, PAULI_Z=3};
 
+ /** Flags for specifying how the bits of a sub-register are interpreted as an integer,
+  * as used by applyPhaseFunc().
+  *
+  * - UNSIGNED: the bits encode a non-negative integer \f$ x = \sum_{j} b_j 2^j \f$
+  * - TWOS_COMPLEMENT: the bits encode a signed integer in two's complement, where the 
+  *   final bit \f$ b_{m-1} \f$ is the sign bit, i.e. \f$ x = -b_{m-1} 2^{m-1} + \sum_{j<m-1} b_j 2^j \f$
+  *
+  * @ingroup type
+  */
+ enum bitEncoding {UNSIGNED=0, TWOS_COMPLEMENT=1};
+
 /** Represents one complex number.
  *
  * @ingroup type
@@ -189,6 +202,12 @@ typedef struct Qureg
     //! Storage for generated QASM output
     QASMLogger* qasmLog;
     
+    //! Complex factor (lazily) multiplying every amplitude, applied to stateVec only when required
+    Complex* lazyFactor;
+    
+    //! Whether stateVec (and pairStateVec) are memory-mapped from a file, rather than held in RAM
+    int isDiskBacked;
+    
 } Qureg;
 
 /** Information about the environment the program is running in.
@@ -203,6 +222,32 @@ typedef struct QuESTEnv
     int numRanks;
 } QuESTEnv;
 
+/** Represents a diagonal complex operator on the full Hilbert space of a Qureg.
+ * The operator need not be unitary nor Hermitian (which would constrain it to
+ * real values). It is distributed between processes in the same way as a
+ * state-vector Qureg of the same number of qubits, so that each process
+ * holds the \p numElemsPerChunk diagonal elements corresponding to its own amplitudes.
+ *
+ * @ingroup type
+ */
+typedef struct DiagonalOp
+{
+    //! The number of qubits this operator can act on (informing its size)
+    int numQubits;
+    //! The number of the 2^numQubits total elements stored in this process's real and imag arrays
+    long long int numElemsPerChunk;
+    //! The number of nodes between which the elements of this operator are split
+    int numChunks;
+    //! The position of the chunk of the operator held by this process in the full operator
+    int chunkId;
+    //! The real values of the 2^numQubits complex elements (a subset thereof in the MPI version)
+    qreal *real;
+    //! The imaginary values of the 2^numQubits complex elements (a subset thereof in the MPI version)
+    qreal *imag;
+    //! A copy of the elements stored persistently on the GPU
+    ComplexArray deviceOperator;
+} DiagonalOp;
+
 
 /*
  * Added for Mathematica front-end 
@@ -248,6 +293,50 @@ Qureg createQureg(int numQubits, QuESTEnv env);
  */
 Qureg createDensityQureg(int numQubits, QuESTEnv env);
 
+/** Create a Qureg for a state-vector whose amplitudes live in a memory-mapped file, 
+ * so that it may exceed the available RAM.
+ * The file (one per node, suffixed with \p _rank_k when distributed) is created at 
+ * \p filename, ideally on a fast local disk, and is sized to hold both the amplitudes 
+ * and the buffer used for communication in the distributed version. Its space is 
+ * reserved up-front, so that a full disk is reported here rather than during simulation.
+ * The file is removed from the filesystem as soon as it is mapped, so it never outlives 
+ * the process; use saveQureg() to keep the state.
+ *
+ * The operating system pages the amplitudes between the disk and RAM as they are 
+ * accessed. Since every operator sweeps the amplitudes in order (two strided but 
+ * sequential streams for gates on high qubits), the pages are read ahead and written 
+ * back sequentially. Circuits are best simulated with as few passes as possible, 
+ * e.g. by using applyQFT() and multiQubitUnitary() instead of many one-qubit gates.
+ *
+ * The returned Qureg is used and destroyed (with destroyQureg()) like any other.
+ * Disk-backed registers are not supported on Windows, nor in the GPU version.
+ *
+ * @ingroup type
+ * @returns an object representing the set of qubits
+ * @param[in] numQubits number of qubits in the system
+ * @param[in] filename path of the (temporary) file to create
+ * @param[in] env object representing the execution environment (local, multinode etc)
+ * @throws exitWithError 
+ *      if \p numQubits <= 0, 
+ *      or if the file could not be created, sized or mapped (e.g. the disk is full)
+ */
+Qureg createDiskQureg(int numQubits, char* filename, QuESTEnv env);
+
+/** Create a density matrix Qureg whose amplitudes live in a memory-mapped file.
+ * This is the density matrix analogue of createDiskQureg(), and begins in the 
+ * zero state |0><0|.
+ *
+ * @ingroup type
+ * @returns an object representing the set of qubits
+ * @param[in] numQubits number of qubits represented by the density matrix
+ * @param[in] filename path of the (temporary) file to create
+ * @param[in] env object representing the execution environment (local, multinode etc)
+ * @throws exitWithError 
+ *      if \p numQubits <= 0, 
+ *      or if the file could not be created, sized or mapped (e.g. the disk is full)
+ */
+Qureg createDensityDiskQureg(int numQubits, char* filename, QuESTEnv env);
+
 /** Create a new Qureg which is an exact clone of the passed qureg, which can be
  * either a statevector or a density matrix. That is, it will have the same 
  * dimensions as the passed qureg and begin in an identical quantum state.
@@ -329,6 +418,82 @@ void initComplexMatrixN(ComplexMatrixN m, qreal real[][1<<m.numQubits], qreal im
 #endif 
 #endif
 
+/** Creates a DiagonalOp representing a diagonal operator on the
+ * full Hilbert space of a Qureg. This can only be applied to state-vectors or
+ * density matrices with an equal number of qubits, using applyDiagonalOp().
+ * There is no requirement that the operator is unitary or Hermitian - any complex
+ * operator is allowed.
+ *
+ * The operator is initialised to all zero elements, and is distributed between
+ * processes exactly as a state-vector of \p numQubits qubits, so that each process
+ * stores (and can modify) only the \p numElemsPerChunk elements beginning at
+ * global index \p chunkId * \p numElemsPerChunk. After directly modifying the
+ * .real and .imag arrays, the user must call syncDiagonalOp() to make the changes
+ * visible to the GPU. Alternatively, initDiagonalOp() and setDiagonalOpElems()
+ * modify the operator by global index and perform this synchronisation automatically.
+ *
+ * The DiagonalOp must eventually be freed using destroyDiagonalOp().
+ *
+ * @ingroup type
+ * @returns a DiagonalOp instance, with all elements initialised to zero
+ * @param[in] numQubits number of qubits which the diagonal operator acts on
+ * @param[in] env object representing the execution environment (local, multinode etc)
+ * @throws exitWithError if \p numQubits <= 0, or if the 2^\p numQubits elements
+ *      cannot be evenly distributed between the number of nodes
+ */
+DiagonalOp createDiagonalOp(int numQubits, QuESTEnv env);
+
+/** Destroys a DiagonalOp created with createDiagonalOp(), freeing all of its
+ * memory (including that on the GPU).
+ *
+ * @ingroup type
+ * @param[in] op the diagonal operator to destroy
+ * @param[in] env object representing the execution environment (local, multinode etc)
+ * @throws exitWithError if \p op was not created
+ */
+void destroyDiagonalOp(DiagonalOp op, QuESTEnv env);
+
+/** Copies the elements of \p op (in the .real and .imag arrays) to the GPU,
+ * after they have been directly modified by the user.
+ * This function is not needed after initDiagonalOp() or setDiagonalOpElems(),
+ * and has no effect in the CPU versions of QuEST.
+ *
+ * @ingroup type
+ * @param[in,out] op the diagonal operator to synchronise to the GPU
+ * @throws exitWithError if \p op was not created
+ */
+void syncDiagonalOp(DiagonalOp op);
+
+/** Overwrites all the elements of the diagonal operator \p op with those in the
+ * \p real and \p imag arrays, each of which must contain (at least)
+ * 2^\p op.numQubits elements. In distributed mode, every process must pass
+ * the full arrays, and keeps only the elements of its own chunk.
+ *
+ * @ingroup type
+ * @param[in,out] op the diagonal operator to modify
+ * @param[in] real the real components of the new elements
+ * @param[in] imag the imaginary components of the new elements
+ * @throws exitWithError if \p op was not created
+ */
+void initDiagonalOp(DiagonalOp op, qreal* real, qreal* imag);
+
+/** Overwrites a contiguous subset of the elements of the diagonal operator \p op,
+ * beginning at the global index \p startInd, with the \p numElems values in \p real
+ * and \p imag. In distributed mode, each process keeps only those elements
+ * which fall within its own chunk.
+ *
+ * @ingroup type
+ * @param[in,out] op the diagonal operator to modify
+ * @param[in] startInd the global index of the first element to modify
+ * @param[in] real the real components of the new elements
+ * @param[in] imag the imaginary components of the new elements
+ * @param[in] numElems the number of elements to modify
+ * @throws exitWithError if \p op was not created,
+ *      or if \p startInd is outside [0, 2^\p op.numQubits),
+ *      or if \p numElems is negative or too large to fit after \p startInd
+ */
+void setDiagonalOpElems(DiagonalOp op, long long int startInd, qreal* real, qreal* imag, long long int numElems);
+
 /** Print the current state vector of probability amplitudes for a set of qubits to file.
  * File format:
  * @verbatim
@@ -486,6 +651,55 @@ void initDebugState(Qureg qureg);
  */
 void initStateFromAmps(Qureg qureg, qreal* reals, qreal* imags);
 
+/** Saves the full state of \p qureg (a state-vector or density matrix) to a binary checkpoint, 
+ * which can later be restored with loadQureg(). The checkpoint begins with a versioned header
+ * (recording the number of qubits, the qureg type, the precision and the amplitude layout), 
+ * followed by the raw real components of the amplitudes, then their imaginary components, in
+ * the precision of \p qureg. 
+ *
+ * If \p qureg is distributed, each node writes its own file (in parallel), named \p filename
+ * suffixed with \p _rank_k for node k, else the checkpoint is the single file \p filename. 
+ * Existing files are overwritten. Any lazily applied global factor is first applied to the
+ * amplitudes, and in GPU mode, the state is first copied from the GPU.
+ *
+ * The files are written in the byte order of the machine, and can be loaded only on machines
+ * with the same byte order. They can however be loaded by a build of QuEST of any precision,
+ * so that e.g. a state prepared cheaply with \p QuEST_PREC=1 can be checked or continued
+ * with \p QuEST_PREC=2.
+ *
+ * @ingroup init
+ * @param[in] qureg the state-vector or density matrix to save, which is unchanged
+ * @param[in] filename the name of the checkpoint file (or prefix, if \p qureg is distributed)
+ * @throws exitWithError
+ *      if any file could not be created, or not completely written
+ */
+void saveQureg(Qureg qureg, char* filename);
+
+/** Overwrites \p qureg with the state in a checkpoint written by saveQureg().
+ * The checkpoint must have been saved from a qureg of the same type (state-vector or density
+ * matrix) and number of qubits as \p qureg, though may have been distributed between
+ * a different number of nodes. Each node reads only the amplitudes of its own chunk, which on 
+ * POSIX systems are copied directly from a memory map of the checkpoint files.
+ *
+ * The checkpoint may have been saved in a different precision (\p QuEST_PREC) to that of 
+ * this build, in which case its amplitudes are converted to \ref qreal as they are read.
+ * Loading a single-precision state into double precision is exact, though it of course 
+ * retains the error accrued in single precision. The reverse rounds each amplitude.
+ *
+ * Every file is checked before any amplitude is overwritten, so that \p qureg is unchanged
+ * when the checkpoint is incomplete or invalid.
+ *
+ * @ingroup init
+ * @param[in,out] qureg the state-vector or density matrix to be overwritten
+ * @param[in] filename the name passed to saveQureg() when the checkpoint was saved
+ * @throws exitWithError
+ *      if a checkpoint file could not be opened,
+ *      or if a file is not a complete checkpoint of a compatible version and byte order,
+ *      or if the checkpoint was saved from a qureg of a different type or size,
+ *      or if both a single-file and a distributed checkpoint exist with name \p filename
+ */
+void loadQureg(Qureg qureg, char* filename);
+
 /** Overwrites a subset of the amplitudes in \p qureg, with those passed in \p reals and \p imags.
  * Only amplitudes with indices in [\p startInd, \p startInd + \p numAmps] will be changed, which means
  * the new state may not be L2 normalised. This allows the user to initialise a custom state by 
@@ -815,6 +1029,17 @@ void destroyQuESTEnv(QuESTEnv env);
  */
 void syncQuESTEnv(QuESTEnv env);
 
+/** Returns to the OS the memory retained from destroyed quregs.
+ * On the CPU, destroyQureg() keeps the amplitude arrays of small quregs (less than 1 GiB in total)
+ * so that a subsequent qureg of the same size can reuse them, avoiding the cost of first 
+ * touching fresh memory. This memory is otherwise released only when a qureg of a 
+ * different size, or a disk-backed qureg, is created, or by destroyQuESTEnv().
+ *
+ * @ingroup type
+ * @param[in] env object representing the execution environment. A single instance is used for each program
+ */
+void releaseFreedQuregMemory(QuESTEnv env);
+
 /** Performs a logical AND on all successCodes held by all processes. If any one process has a zero successCode
  * all processes will return a zero success code.
  *
@@ -826,6 +1051,13 @@ void syncQuESTEnv(QuESTEnv env);
 int syncQuESTSuccess(int successCode);
 
 /** Report information about the QuEST environment
+ *
+ * When multithreaded, this includes how OpenMP threads are bound to places (as set by
+ * the \p OMP_PROC_BIND and \p OMP_PLACES environment variables). Amplitudes are 
+ * allocated in the NUMA memory of the thread which processes them, so threads should 
+ * be bound (e.g. \p OMP_PROC_BIND=spread, \p OMP_PLACES=cores) to keep them there.
+ * Memory can instead be interleaved across sockets by launching with 
+ * \p numactl \p --interleave=all.
  *
  * @ingroup debug
  * @param[in] env object representing the execution environment. A single instance is used for each program
@@ -1838,6 +2070,51 @@ Complex calcInnerProduct(Qureg bra, Qureg ket);
  */
 qreal calcDensityInnerProduct(Qureg rho1, Qureg rho2);
 
+/** Computes the matrix of inner products between every pair of the given equal-size
+ * state-vectors, such that 
+ * \f[
+    \text{matr}_{rc} = \langle \text{quregs}[r] | \text{quregs}[c] \rangle,
+ * \f]
+ * stored row-major in \p matrRe and \p matrIm, which must each have room for 
+ * \p numQuregs squared elements. The matrix is Hermitian.
+ *
+ * This is equivalent to calling calcInnerProduct() upon every pair, but is much faster
+ * for many quregs. Rather than streaming two full state-vectors per pair, the 
+ * amplitudes are processed in cache-sized tiles, within which every pairwise product is
+ * accumulated, so that each qureg is read from memory only once.
+ *
+ * @ingroup calc
+ * @param[in] quregs the state-vectors
+ * @param[in] numQuregs the number of state-vectors in \p quregs
+ * @param[out] matrRe the real components of the inner products (row-major)
+ * @param[out] matrIm the imaginary components of the inner products (row-major)
+ * @throws exitWithError
+ *      if \p numQuregs <= 0,
+ *      or if any of \p quregs are not state-vectors,
+ *      or if \p quregs do not all have equal dimensions.
+ */
+void calcInnerProductsMatrix(Qureg* quregs, int numQuregs, qreal* matrRe, qreal* matrIm);
+
+/** Computes the real, symmetric matrix of Hilbert-Schmidt scalar products between every pair
+ * of the given equal-size density matrices, such that \p matr (row-major, with room for 
+ * \p numQuregs squared elements) has elements
+ * \f[
+    \text{matr}_{rc} = \text{Re}\{ \text{Tr}[ \text{quregs}[r]^\dagger \; \text{quregs}[c] ] \}.
+ * \f]
+ * This is equivalent to calling calcDensityInnerProduct() upon every pair, but reads 
+ * each density matrix from memory only once, as described in calcInnerProductsMatrix().
+ *
+ * @ingroup calc
+ * @param[in] quregs the density matrices
+ * @param[in] numQuregs the number of density matrices in \p quregs
+ * @param[out] matr the scalar products (row-major)
+ * @throws exitWithError
+ *      if \p numQuregs <= 0,
+ *      or if any of \p quregs are not density matrices,
+ *      or if \p quregs do not all have equal dimensions.
+ */
+void calcDensityInnerProductsMatrix(Qureg* quregs, int numQuregs, qreal* matr);
+
 /** Seed the Mersenne Twister used for random number generation in the QuEST environment with an example
  * defualt seed.
  * This default seeding function uses the mt19937 init_by_array function with two keys -- 
@@ -1874,6 +2151,11 @@ void seedQuEST(unsigned long int *seedArray, int numSeeds);
  * growing log of QASM instructions, progressively consuming more memory until 
  * disabled with stopRecordingQASM(). The QASM log is bound to this qureg instance.
  *
+ * Operations are recorded as compact binary records and are only formatted as QASM
+ * when printRecordedQASM() or writeRecordedQASMToFile() is called. Once a log grows
+ * beyond several megabytes, its oldest records are formatted and streamed to a 
+ * temporary file, so that recording very long circuits does not exhaust memory.
+ *
  * @ingroup qasm
  * @param[in,out] qureg The qureg to begin recording subsequent operations upon
  * @author Tyson Jones
@@ -2244,6 +2526,21 @@ qreal calcFidelity(Qureg qureg, Qureg pureState);
  */
 void swapGate(Qureg qureg, int qubit1, int qubit2);
 
+/** Permutes the qubits of \p qureg, moving (the state of) qubit \p q to position \p perm[q].
+ * This is equivalent to a network of swapGate, but is effected in a single pass
+ * over the state-vector (or density matrix), and for distributed quregs requires
+ * at most one all-to-all exchange, regardless of how many qubits change node.
+ * For density matrices, the row and column qubits are permuted together.
+ * In the QASM log, the permutation is recorded as its decomposition into swap gates.
+ *
+ * @ingroup unitary
+ * @param[in,out] qureg object representing the set of all qubits
+ * @param[in] perm list of length \p qureg.numQubitsRepresented, where \p perm[q] is the new position of qubit \p q
+ * @throws exitWithError
+ *      if \p perm is not a permutation of [0, \p qureg.numQubitsRepresented)
+ */
+void permuteQubits(Qureg qureg, int* perm);
+
 
 /** Performs a sqrt SWAP gate between \p qubit1 and \p qubit2.
  * This effects
@@ -2420,6 +2717,144 @@ void multiRotateZ(Qureg qureg, int* qubits, int numQubits, qreal angle);
  */
 void multiRotatePauli(Qureg qureg, int* targetQubits, enum pauliOpType* targetPaulis, int numTargets, qreal angle);
 
+/** Induces a phase change upon each amplitude of \p qureg, determined by the value 
+ * of a sub-register (of \p numQubits qubits, listed in \p qubits) interpreted as an 
+ * integer \f$ x \f$, and a polynomial phase function \f$ f(x) \f$. That is, this effects
+ * \f[
+ *    |x\rangle \rightarrow \exp(i f(x)) \, |x\rangle, \;\;\;\;
+ *    f(x) = \sum_{j}^{\text{numTerms}} \text{coeffs}_j \, x^{\, \text{exponents}_j},
+ * \f]
+ * where \p qubits[0] is the least significant bit of \f$ x \f$, and the bits are
+ * interpreted according to \p encoding (UNSIGNED or TWOS_COMPLEMENT; see ::bitEncoding).
+ * For example,
+ *
+ *     int qubits[3] = {0, 1, 2};
+ *     qreal coeffs[2] = {.5, -2};
+ *     qreal exponents[2] = {2, 1};
+ *     applyPhaseFunc(qureg, qubits, 3, UNSIGNED, coeffs, exponents, 2);
+ *
+ * effects \f$ |x\rangle \rightarrow \exp(i (.5 x^2 - 2 x)) |x\rangle \f$ for \f$ x \in [0, 7] \f$.
+ * Exponents may be negative or fractional, subject to the restrictions below, which
+ * can be lifted by overriding the phases of the problematic values with applyPhaseFuncOverrides().
+ * For density matrices, this effects \f$ \rho \rightarrow U \rho U^\dagger \f$.
+ *
+ * The entire phase oracle is effected in a single pass over the amplitudes, without 
+ * communication. When the sub-register is small, \f$ f \f$ is evaluated only once for 
+ * each of its \f$ 2^{\text{numQubits}} \f$ values. This is much faster than an 
+ * equivalent decomposition into (multi-controlled) phase shifts.
+ *
+ * @ingroup unitary
+ * @param[in,out] qureg the state-vector or density matrix to be modified
+ * @param[in] qubits a list of the indices of the qubits encoding \f$ x \f$, from least to most significant
+ * @param[in] numQubits the length of \p qubits
+ * @param[in] encoding how the bits of \p qubits are interpreted as an integer
+ * @param[in] coeffs the coefficients of each term of the polynomial \f$ f \f$
+ * @param[in] exponents the exponents of each term of the polynomial \f$ f \f$
+ * @param[in] numTerms the number of terms in \f$ f \f$, i.e. the length of \p coeffs and \p exponents
+ * @throws exitWithError
+ *      if \p numQubits is outside [1, \p qureg.numQubitsRepresented],
+ *      or if any qubit in \p qubits is invalid or repeated,
+ *      or if \p encoding is not a ::bitEncoding,
+ *      or if \p numTerms <= 0,
+ *      or if any exponent is negative (so \f$ f(0) \f$ diverges) and \f$ x=0 \f$ is not overridden,
+ *      or if any exponent is fractional and \p encoding is TWOS_COMPLEMENT (so \f$ f(x<0) \f$ is complex)
+ */
+void applyPhaseFunc(Qureg qureg, int* qubits, int numQubits, enum bitEncoding encoding, qreal* coeffs, qreal* exponents, int numTerms);
+
+/** As applyPhaseFunc(), but where the phase of any of the given values \f$ x \f$ of 
+ * the sub-register can be overridden. That is, this effects 
+ * \f[
+ *    |x\rangle \rightarrow \exp(i \, \text{overridePhases}_k) \, |x\rangle \;\; 
+ *    \text{if} \;\; x = \text{overrideInds}_k, \;\; \text{else} \;\; 
+ *    |x\rangle \rightarrow \exp(i f(x)) \, |x\rangle.
+ * \f]
+ * The values in \p overrideInds are interpreted according to \p encoding, so may be 
+ * negative for TWOS_COMPLEMENT. If a value is overridden more than once, the first of its 
+ * overrides is used. Overriding allows exponents which would otherwise be invalid; 
+ * a negative exponent is permitted when \f$ x=0 \f$ is overridden.
+ *
+ * @ingroup unitary
+ * @param[in,out] qureg the state-vector or density matrix to be modified
+ * @param[in] qubits a list of the indices of the qubits encoding \f$ x \f$, from least to most significant
+ * @param[in] numQubits the length of \p qubits
+ * @param[in] encoding how the bits of \p qubits are interpreted as an integer
+ * @param[in] coeffs the coefficients of each term of the polynomial \f$ f \f$
+ * @param[in] exponents the exponents of each term of the polynomial \f$ f \f$
+ * @param[in] numTerms the number of terms in \f$ f \f$, i.e. the length of \p coeffs and \p exponents
+ * @param[in] overrideInds the values of \f$ x \f$ whose phases are overridden
+ * @param[in] overridePhases the phases which replace \f$ f(x) \f$ for the corresponding values in \p overrideInds
+ * @param[in] numOverrides the length of \p overrideInds and \p overridePhases
+ * @throws exitWithError
+ *      as per applyPhaseFunc(), 
+ *      or if \p numOverrides < 0,
+ *      or if any value in \p overrideInds cannot be encoded by \p numQubits bits under \p encoding
+ */
+void applyPhaseFuncOverrides(Qureg qureg, int* qubits, int numQubits, enum bitEncoding encoding, qreal* coeffs, qreal* exponents, int numTerms, long long int* overrideInds, qreal* overridePhases, int numOverrides);
+
+/** Induces a phase change upon each amplitude of \p qureg, looked up from a table 
+ * of phases for every value of a sub-register. That is, this effects
+ * \f[
+ *    |x\rangle \rightarrow \exp(i \, \text{phases}_x) \, |x\rangle,
+ * \f]
+ * where \f$ x \f$ is the unsigned value of the sub-register of \p numQubits qubits 
+ * (with \p qubits[0] the least significant bit). Hence \p phases must contain 
+ * \f$ 2^{\text{numQubits}} \f$ elements. This allows arbitrary (e.g. non-polynomial) 
+ * phase functions, effected in a single pass over the amplitudes.
+ * For density matrices, this effects \f$ \rho \rightarrow U \rho U^\dagger \f$.
+ *
+ * @ingroup unitary
+ * @param[in,out] qureg the state-vector or density matrix to be modified
+ * @param[in] qubits a list of the indices of the qubits encoding \f$ x \f$, from least to most significant
+ * @param[in] numQubits the length of \p qubits
+ * @param[in] phases the phase to induce upon each of the \f$ 2^{\text{numQubits}} \f$ values of \f$ x \f$
+ * @throws exitWithError
+ *      if \p numQubits is outside [1, \p qureg.numQubitsRepresented],
+ *      or if any qubit in \p qubits is invalid or repeated
+ */
+void applyPhaseFuncTable(Qureg qureg, int* qubits, int numQubits, qreal* phases);
+
+/** Applies the quantum Fourier transform (QFT) to a sub-register of \p qureg. That is, this effects
+ * \f[
+ *    |x\rangle \rightarrow \frac{1}{\sqrt{2^n}} \sum_{y=0}^{2^n-1} \exp(2 \pi i \, x y / 2^n) \, |y\rangle,
+ * \f]
+ * where \f$ x \f$ and \f$ y \f$ are the unsigned values of the sub-register of \f$ n = \f$ \p numQubits 
+ * qubits (with \p qubits[0] the least significant bit), and all other qubits are unchanged.
+ * For density matrices, this effects \f$ \rho \rightarrow U \rho U^\dagger \f$.
+ *
+ * This is equivalent to the textbook circuit of \f$ n \f$ Hadamard gates, \f$ n(n-1)/2 \f$ 
+ * controlled phase shifts and \f$ \lfloor n/2 \rfloor \f$ swaps, but is performed as an in-place 
+ * fast Fourier transform, in which up to 6 qubits are processed in each pass over the state-vector, 
+ * followed by a single pass to reverse the order of the qubits. Each qubit distributed between 
+ * nodes costs an additional exchange of chunks, as per hadamard().
+ *
+ * The QASM log (if recording) receives the equivalent circuit.
+ *
+ * @ingroup unitary
+ * @param[in,out] qureg the state-vector or density matrix to be modified
+ * @param[in] qubits a list of the indices of the qubits of the sub-register, from least to most significant
+ * @param[in] numQubits the length of \p qubits
+ * @throws exitWithError
+ *      if \p numQubits is outside [1, \p qureg.numQubitsRepresented],
+ *      or if any qubit in \p qubits is invalid or repeated
+ */
+void applyQFT(Qureg qureg, int* qubits, int numQubits);
+
+/** Applies the inverse of the quantum Fourier transform to a sub-register of \p qureg, effecting
+ * \f[
+ *    |y\rangle \rightarrow \frac{1}{\sqrt{2^n}} \sum_{x=0}^{2^n-1} \exp(- 2 \pi i \, x y / 2^n) \, |x\rangle.
+ * \f]
+ * This undoes applyQFT() upon the same \p qubits, at the same cost.
+ *
+ * @ingroup unitary
+ * @param[in,out] qureg the state-vector or density matrix to be modified
+ * @param[in] qubits a list of the indices of the qubits of the sub-register, from least to most significant
+ * @param[in] numQubits the length of \p qubits
+ * @throws exitWithError
+ *      if \p numQubits is outside [1, \p qureg.numQubitsRepresented],
+ *      or if any qubit in \p qubits is invalid or repeated
+ */
+void applyInverseQFT(Qureg qureg, int* qubits, int numQubits);
+
 /** Computes the expected value of a product of Pauli operators.
  * Letting \f$ \sigma = \otimes_j \hat{\sigma}_j \f$ be the operators indicated by \p pauliCodes 
  * and acting on qubits \p targetQubits, this function computes \f$ \langle \psi | \sigma | \psi \rangle \f$ 
@@ -2516,6 +2951,23 @@ qreal calcExpecPauliProd(Qureg qureg, int* targetQubits, enum pauliOpType* pauli
  */
 qreal calcExpecPauliSum(Qureg qureg, enum pauliOpType* allPauliCodes, qreal* termCoeffs, int numSumTerms, Qureg workspace);
 
+/** Computes the expected value of the diagonal operator \p op for state \p qureg.
+ * Since \p op is not necessarily Hermitian, the expected value may be a complex number.
+ *
+ * For a state-vector, this is \f$ \langle \psi | \hat{D} | \psi \rangle = \sum_i D_i |\psi_i|^2 \f$,
+ * and for a density matrix \f$ \rho \f$, this is \f$ \text{Trace}(\hat{D} \rho) = \sum_i D_i \rho_{ii} \f$.
+ * In both cases, this is computed in a single pass (a single fused reduction) over the
+ * amplitudes, without modifying \p qureg nor requiring a workspace register.
+ *
+ * @ingroup calc
+ * @param[in] qureg a state-vector or density matrix
+ * @param[in] op the diagonal operator to compute the expected value of
+ * @returns the (possibly complex) expected value of \p op
+ * @throws exitWithError if \p op was not created,
+ *      or if \p op acts on a different number of qubits than \p qureg represents
+ */
+Complex calcExpecDiagonalOp(Qureg qureg, DiagonalOp op);
+
 /** Apply a general two-qubit unitary (including a global phase factor).
  *
     \f[
@@ -3108,6 +3560,20 @@ qreal calcHilbertSchmidtDistance(Qureg a, Qureg b);
  */
 void setWeightedQureg(Complex fac1, Qureg qureg1, Complex fac2, Qureg qureg2, Complex facOut, Qureg out);
 
+/** Multiplies every amplitude of \p qureg (or element, for density matrices) by \p fac,
+ * such as a global phase \f$ e^{i \phi} \f$ or a derivative normalisation.
+ * This costs no pass over the state; the factor is stored on \p qureg, is accounted
+ * for by the getters (e.g. getAmp()) and calcInnerProduct(), commutes with all gates
+ * and decoherence channels, and is only applied to the amplitudes when required
+ * (e.g. by a measurement, or by copyStateFromGPU() before direct access of \p qureg.stateVec).
+ * Like setWeightedQureg(), a non-unit \p fac leaves \p qureg unnormalised.
+ *
+ * @ingroup init
+ * @param[in,out] qureg object representing the set of all qubits
+ * @param[in] fac the complex number by which to scale every amplitude of \p qureg
+ */
+void applyGlobalFactor(Qureg qureg, Complex fac);
+
 /** Modifies \p outQureg to be the result of applying the weighted sum of Pauli products (a Hermitian but not 
  * necessarily unitary operator) to \p inQureg. Note that afterward, \p outQureg may no longer be normalised and ergo not a
  * statevector or density matrix. Users must therefore be careful passing \p outQureg to
@@ -3132,22 +3598,23 @@ void setWeightedQureg(Complex fac1, Qureg qureg1, Complex fac2, Qureg qureg2, Co
  * will apply Hermitian operation \f$ (1.5 X I I - 3.6 X Y Z) \f$ 
  * (where in this notation, the left-most operator applies to the least-significant qubit, i.e. that with index 0).
  *
- * In theory, \p inQureg is unchanged though its state is temporarily 
- * modified and is reverted by re-applying Paulis (XX=YY=ZZ=I), so may see a change by small numerical errors.
+ * \p inQureg is only read, and is unchanged.
  * The initial state in \p outQureg is not used.
  *
  * \p inQureg and \p outQureg must both be state-vectors, or both density matrices,
  * of equal dimensions. \p inQureg cannot be \p outQureg.
  *
- * This function works by applying each Pauli product to \p inQureg in turn, 
- * and adding the resulting state (weighted by a coefficient in \p termCoeffs)
- * to the initially-blanked \p outQureg. Ergo it should scale with the total number 
- * of Pauli operators specified (excluding identities), and the qureg dimension. 
+ * Each Pauli product maps every basis state to a single (signed) basis state, 
+ * so this function groups the terms by which qubits they flip (their X and Y 
+ * targets), and for each group, adds to every amplitude of the initially-blanked 
+ * \p outQureg the weighted sum of the group's actions on its one partner amplitude in 
+ * \p inQureg. Ergo it makes one pass over the registers per distinct group, 
+ * each scaling with the qureg dimension and the number of terms in the group.
  *
  * @ingroup operator
  * @param[in] inQureg the register containing the state which \p outQureg will be set to, under
- *      the action of the Hermitiain operator specified by the Pauli codes. \p inQureg should be 
- *      unchanged, though may vary slightly due to numerical error.
+ *      the action of the Hermitiain operator specified by the Pauli codes. \p inQureg is 
+ *      unchanged.
  * @param[in] allPauliCodes a list of the Pauli codes (0=PAULI_I, 1=PAULI_X, 2=PAULI_Y, 3=PAULI_Z) 
  *      of all Paulis involved in the products of terms. A Pauli must be specified for each qubit 
  *      in the register, in every term of the sum.
@@ -3163,6 +3630,125 @@ void setWeightedQureg(Complex fac1, Qureg qureg1, Complex fac2, Qureg qureg2, Co
  */
 void applyPauliSum(Qureg inQureg, enum pauliOpType* allPauliCodes, qreal* termCoeffs, int numSumTerms, Qureg outQureg);
 
+/** Applies a Trotter-Suzuki approximation of the unitary \f$ e^{-i H t} \f$ to \p qureg, 
+ * where \f$ H = \sum_j c_j P_j \f$ is a weighted sum of Pauli products, specified by 
+ * \p allPauliCodes, \p termCoeffs and \p numSumTerms exactly as in applyPauliSum().
+ * For density matrices, this effects \f$ e^{-i H t} \rho e^{i H t} \f$.
+ *
+ * The time is divided into \p reps equal steps, each of which is approximated by a 
+ * product of the terms' exponentials \f$ e^{-i c_j P_j \, \Delta t} \f$:
+ * - \p order = 1 applies each term once, in order,
+ * - \p order = 2 applies each term for \f$ \Delta t/2 \f$ in order, then in reverse,
+ * - even \p order > 2 applies the recursive Suzuki construction of the (\p order - 2) step,
+ *   so that \p order = 4 applies 5 second-order steps (10 products of the terms' exponentials).
+ *
+ * Before exponentiation, terms with identical Pauli products are merged, and terms are 
+ * reordered so that (greedily found) groups of mutually commuting terms are contiguous. 
+ * The all-identity term contributes only a global phase, which is applied to state-vectors
+ * lazily (see applyGlobalFactor()).
+ * Each term's exponential is effected as by multiRotatePauli(), and the terms are 
+ * grouped only once for all repetitions, so this is much faster than applying the 
+ * equivalent circuit of multiRotatePauli() gates.
+ *
+ * @ingroup operator
+ * @param[in,out] qureg the register to evolve
+ * @param[in] allPauliCodes a list of the Pauli codes (0=PAULI_I, 1=PAULI_X, 2=PAULI_Y, 3=PAULI_Z) 
+ *      of all Paulis involved in the products of terms. A Pauli must be specified for each qubit 
+ *      in the register, in every term of the sum.
+ * @param[in] termCoeffs the (real) coefficients of each term in the sum of Pauli products
+ * @param[in] numSumTerms the total number of Pauli products specified
+ * @param[in] time the duration of the evolution
+ * @param[in] order the order of the Trotter-Suzuki decomposition; 1, or a positive even number
+ * @param[in] reps the number of Trotter steps into which \p time is divided
+ * @throws exitWithError
+ *      if any code in \p allPauliCodes is not in {0,1,2,3},
+ *      or if numSumTerms <= 0,
+ *      or if \p order is not 1 nor a positive even number,
+ *      or if \p reps < 1
+ */
+void applyTrotterCircuit(Qureg qureg, enum pauliOpType* allPauliCodes, qreal* termCoeffs, int numSumTerms, qreal time, int order, int reps);
+
+/** Applies the unitary \f$ e^{-i H t} \f$ to state-vector \p qureg, where 
+ * \f$ H = \sum_j c_j P_j \f$ is a weighted sum of Pauli products, specified by 
+ * \p allPauliCodes, \p termCoeffs and \p numSumTerms exactly as in applyPauliSum().
+ *
+ * Unlike applyTrotterCircuit(), this is exact to within numerical precision. \p time is
+ * divided into steps, and each step is effected by projecting \f$ H \f$ onto the
+ * (at most 30-dimensional) Krylov subspace of the current state, found by the Lanczos
+ * method, where it is exponentiated exactly. Each step is as long as keeps the state's 
+ * leakage out of the subspace negligible.
+ * The matrix of \f$ H \f$ is never formed; it is only applied to quregs by applyPauliSum().
+ * The Lanczos basis is regenerated rather than stored, so this function needs only three
+ * workspace registers (created and destroyed internally, with their memory recycled), 
+ * and makes about twice as many applications of \f$ H \f$ as the subspace dimension per step.
+ *
+ * @ingroup operator
+ * @param[in,out] qureg the state-vector to evolve
+ * @param[in] allPauliCodes a list of the Pauli codes (0=PAULI_I, 1=PAULI_X, 2=PAULI_Y, 3=PAULI_Z) 
+ *      of all Paulis involved in the products of terms. A Pauli must be specified for each qubit 
+ *      in the register, in every term of the sum.
+ * @param[in] termCoeffs the (real) coefficients of each term in the sum of Pauli products
+ * @param[in] numSumTerms the total number of Pauli products specified
+ * @param[in] time the duration of the evolution
+ * @param[in] env the QuEST environment, in which to create the workspace registers
+ * @throws exitWithError
+ *      if \p qureg is a density matrix,
+ *      or if any code in \p allPauliCodes is not in {0,1,2,3},
+ *      or if numSumTerms <= 0
+ */
+void applyKrylovEvolution(Qureg qureg, enum pauliOpType* allPauliCodes, qreal* termCoeffs, int numSumTerms, qreal time, QuESTEnv env);
+
+/** Overwrites state-vector \p qureg with the (normalised) ground state of the weighted sum 
+ * of Pauli products \f$ H \f$ (specified as in applyPauliSum()), and returns its energy.
+ *
+ * This performs the Lanczos method from the initial state of \p qureg, restarting 
+ * from the lowest Ritz vector of each (at most 30-dimensional) Krylov subspace, until 
+ * that vector \f$ |\psi\rangle \f$ (of Ritz value \f$ E \f$) satisfies
+ * \f$ \| H |\psi\rangle - E |\psi\rangle \| \le \f$ \p tolerance, or 1000 restarts have been made.
+ * As in applyKrylovEvolution(), the matrix of \f$ H \f$ is never formed, and only three 
+ * workspace registers are used.
+ *
+ * The initial state of \p qureg must be non-zero and should overlap the ground state;
+ * a state orthogonal to it (e.g. of a different symmetry sector) converges instead to the lowest 
+ * eigenstate it overlaps. A random state (or the previous ground state of a similar \f$ H \f$)
+ * is a good choice. For a degenerate ground space, the returned state is one of its members.
+ *
+ * @ingroup calc
+ * @param[in,out] qureg the state-vector from which to begin, overwritten with the ground state
+ * @param[in] allPauliCodes a list of the Pauli codes of all Paulis involved in the products of terms,
+ *      as in applyPauliSum()
+ * @param[in] termCoeffs the (real) coefficients of each term in the sum of Pauli products
+ * @param[in] numSumTerms the total number of Pauli products specified
+ * @param[in] tolerance the largest permitted norm of the residual \f$ H |\psi\rangle - E |\psi\rangle \f$
+ * @param[in] env the QuEST environment, in which to create the workspace registers
+ * @returns the ground-state energy \f$ E \f$
+ * @throws exitWithError
+ *      if \p qureg is a density matrix,
+ *      or if any code in \p allPauliCodes is not in {0,1,2,3},
+ *      or if numSumTerms <= 0,
+ *      or if \p tolerance <= 0,
+ *      or if every amplitude of \p qureg is zero,
+ *      or if the residual still exceeds \p tolerance after 1000 restarts (in which case 
+ *      \p qureg is left in the final approximation of the ground state)
+ */
+qreal calcGroundState(Qureg qureg, enum pauliOpType* allPauliCodes, qreal* termCoeffs, int numSumTerms, qreal tolerance, QuESTEnv env);
+
+/** Apply a diagonal complex operator, which is possibly non-unitary and non-Hermitian,
+ * on the entire \p qureg, in a single pass over its amplitudes.
+ *
+ * For a state-vector, this multiplies each amplitude \f$ \psi_i \f$ by the element \f$ D_i \f$.
+ * For a density matrix \f$ \rho \f$, this left-multiplies the operator, effecting
+ * \f$ \rho \rightarrow \hat{D} \rho \f$, consistent with applyPauliSum(). Note this
+ * is not \f$ \hat{D} \rho \hat{D}^\dagger \f$, and the result is generally not a valid density matrix.
+ *
+ * @ingroup operator
+ * @param[in,out] qureg the state to operate the diagonal operator upon
+ * @param[in] op the diagonal operator to apply
+ * @throws exitWithError if \p op was not created,
+ *      or if \p op acts on a different number of qubits than \p qureg represents
+ */
+void applyDiagonalOp(Qureg qureg, DiagonalOp op);
+
 /** An internal function called when invalid arguments are passed to a QuEST API
  * call, which the user can optionally override by redefining. This function is 
  * a weak symbol, so that users can choose how input errors are handled, by 
@@ -3198,7 +3784,7 @@ extern "C" void invalidQuESTInputError(const char* errMsg, const char* errFunc)
  * @ingroup debug
  * @param[in] errMsg a string describing the nature of the argument error
  * @param[in] errFunc the name of the invalidly-called API function
- * @throws exitWithError unless overriden by the user
+ * @throws exitWithError unless overridden by the user
  * @author Tyson Jones
  */
 void invalidQuESTInputError(const char* errMsg, const char* errFunc);
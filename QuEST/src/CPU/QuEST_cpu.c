@@ -10,6 +10,11 @@
  * @author Balint Koczor
  */
 
+/* posix_memalign and madvise (for transparent huge pages) are hidden by -std=c99 */
+#ifdef __linux__
+    #define _DEFAULT_SOURCE
+#endif
+
 /* to support MSVC, we must remove the use of VLA in multiQubtUnitary.
  * We'll instead create stack arrays use _malloca
  */
@@ -17,6 +22,14 @@
     #include <malloc.h>
 #endif
 
+/* disk-backed quregs memory-map a file, which is only supported on POSIX systems */
+#ifndef _WIN32
+    #include <sys/types.h>
+    #include <sys/mman.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
 # include "QuEST.h"
 # include "QuEST_internal.h"
 # include "QuEST_precision.h"
@@ -27,6 +40,7 @@
 # include <math.h>  
 # include <stdio.h>
 # include <stdlib.h>
+# include <string.h>
 # include <stdint.h>
 # include <assert.h>
 
@@ -35,6 +49,59 @@
 # endif
 
 
+/*
+ * reductions
+ */
+
+/** The number of consecutive terms which a reduction sums sequentially into each block 
+ * sum, before the block sums are combined pairwise. Since this (and not the number of 
+ * threads) fixes the order of every addition, reductions are bitwise reproducible for 
+ * any number of threads, and their rounding error grows only with the block size and 
+ * the log of the number of blocks
+ */
+#define REDUCTION_BLOCK_SIZE 1024
+
+long long int getNumReductionBlocks(long long int numTerms) {
+    
+    return (numTerms + REDUCTION_BLOCK_SIZE - 1) / REDUCTION_BLOCK_SIZE;
+}
+
+/** Returns the index of the first term of the next block, or numTerms */
+long long int getReductionBlockEnd(long long int block, long long int numTerms) {
+    
+    long long int end = (block + 1) * REDUCTION_BLOCK_SIZE;
+    return (end < numTerms)? end : numTerms;
+}
+
+/** Returns zeroed storage for the sums of numBlocks blocks, to be freed by the caller.
+ * Exits if it cannot be allocated
+ */
+qaccum* createReductionBlocks(long long int numBlocks) {
+    
+    qaccum* blockSums = calloc(numBlocks, sizeof *blockSums);
+    if (blockSums == NULL && numBlocks > 0) {
+        printf("Could not allocate memory!\n");
+        exit (EXIT_FAILURE);
+    }
+    return blockSums;
+}
+
+/** Returns the sum of the block sums, combined pairwise in an order fixed by numBlocks alone.
+ * The blockSums are overwritten
+ */
+qaccum sumReductionBlocks(qaccum* blockSums, long long int numBlocks) {
+    
+    if (numBlocks == 0)
+        return 0;
+    
+    for (long long int stride=1; stride < numBlocks; stride *= 2)
+        for (long long int block=0; block + stride < numBlocks; block += 2*stride)
+            blockSums[block] += blockSums[block + stride];
+    
+    return blockSums[0];
+}
+
+
 /*
  * overloads for consistent API with GPU 
  */
@@ -43,6 +110,9 @@ void copyStateToGPU(Qureg qureg) {
 }
 
 void copyStateFromGPU(Qureg qureg) {
+    
+    // stateVec may now be accessed directly, so must include the lazy factor
+    statevec_commitLazyFactor(qureg);
 }
 
 
@@ -873,29 +943,36 @@ void densmatr_collapseToKnownProbOutcome(Qureg qureg, const int measureQubit, in
 qreal densmatr_calcPurityLocal(Qureg qureg) {
     
     /* sum of qureg^2, which is sum_i |qureg[i]|^2 */
-    long long int index;
+    long long int index, block, blockEnd;
     long long int numAmps = qureg.numAmpsPerChunk;
+    long long int numBlocks = getNumReductionBlocks(numAmps);
+    qaccum* blockSums = createReductionBlocks(numBlocks);
         
-    qreal trace = 0;
+    qaccum trace;
     qreal *vecRe = qureg.stateVec.real;
     qreal *vecIm = qureg.stateVec.imag;
     
 # ifdef _OPENMP
 # pragma omp parallel \
-    shared    (vecRe, vecIm, numAmps) \
-    private   (index) \
-    reduction ( +:trace )
+    shared    (vecRe, vecIm, numAmps, numBlocks, blockSums) \
+    private   (index, block, blockEnd, trace)
 # endif 
     {
 # ifdef _OPENMP
 # pragma omp for schedule  (static)
 # endif
-        for (index=0LL; index<numAmps; index++) {
-                        
-            trace += vecRe[index]*vecRe[index] + vecIm[index]*vecIm[index];
+        for (block=0LL; block<numBlocks; block++) {
+            blockEnd = getReductionBlockEnd(block, numAmps);
+            
+            trace = 0;
+            for (index=block*REDUCTION_BLOCK_SIZE; index<blockEnd; index++)
+                trace += vecRe[index]*vecRe[index] + vecIm[index]*vecIm[index];
+            blockSums[block] = trace;
         }
     }
     
+    trace = sumReductionBlocks(blockSums, numBlocks);
+    free(blockSums);
     return trace;
 }
 
@@ -934,66 +1011,82 @@ void densmatr_mixDensityMatrix(Qureg combineQureg, qreal otherProb, Qureg otherQ
 /** computes Tr((a-b) conjTrans(a-b)) = sum of abs values of (a-b) */
 qreal densmatr_calcHilbertSchmidtDistanceSquaredLocal(Qureg a, Qureg b) {
     
-    long long int index;
+    long long int index, block, blockEnd;
     long long int numAmps = a.numAmpsPerChunk;
+    long long int numBlocks = getNumReductionBlocks(numAmps);
+    qaccum* blockSums = createReductionBlocks(numBlocks);
         
     qreal *aRe = a.stateVec.real;
     qreal *aIm = a.stateVec.imag;
     qreal *bRe = b.stateVec.real;
     qreal *bIm = b.stateVec.imag;
     
-    qreal trace = 0;
+    qaccum trace;
     qreal difRe, difIm;
     
 # ifdef _OPENMP
 # pragma omp parallel \
-    shared    (aRe,aIm, bRe,bIm, numAmps) \
-    private   (index,difRe,difIm) \
-    reduction ( +:trace )
+    shared    (aRe,aIm, bRe,bIm, numAmps, numBlocks, blockSums) \
+    private   (index, block, blockEnd, trace, difRe,difIm)
 # endif 
     {
 # ifdef _OPENMP
 # pragma omp for schedule  (static)
 # endif
-        for (index=0LL; index<numAmps; index++) {
-                        
-            difRe = aRe[index] - bRe[index];
-            difIm = aIm[index] - bIm[index];
-            trace += difRe*difRe + difIm*difIm;
+        for (block=0LL; block<numBlocks; block++) {
+            blockEnd = getReductionBlockEnd(block, numAmps);
+            
+            trace = 0;
+            for (index=block*REDUCTION_BLOCK_SIZE; index<blockEnd; index++) {
+                difRe = aRe[index] - bRe[index];
+                difIm = aIm[index] - bIm[index];
+                trace += difRe*difRe + difIm*difIm;
+            }
+            blockSums[block] = trace;
         }
     }
     
+    trace = sumReductionBlocks(blockSums, numBlocks);
+    free(blockSums);
     return trace;
 }
 
 /** computes Tr(conjTrans(a) b) = sum of (a_ij^* b_ij) */
 qreal densmatr_calcInnerProductLocal(Qureg a, Qureg b) {
     
-    long long int index;
+    long long int index, block, blockEnd;
     long long int numAmps = a.numAmpsPerChunk;
+    long long int numBlocks = getNumReductionBlocks(numAmps);
+    qaccum* blockSums = createReductionBlocks(numBlocks);
         
     qreal *aRe = a.stateVec.real;
     qreal *aIm = a.stateVec.imag;
     qreal *bRe = b.stateVec.real;
     qreal *bIm = b.stateVec.imag;
     
-    qreal trace = 0;
+    qaccum trace;
     
 # ifdef _OPENMP
 # pragma omp parallel \
-    shared    (aRe,aIm, bRe,bIm, numAmps) \
-    private   (index) \
-    reduction ( +:trace )
+    shared    (aRe,aIm, bRe,bIm, numAmps, numBlocks, blockSums) \
+    private   (index, block, blockEnd, trace)
 # endif 
     {
 # ifdef _OPENMP
 # pragma omp for schedule  (static)
 # endif
-        for (index=0LL; index<numAmps; index++) {
-            trace += aRe[index]*bRe[index] + aIm[index]*bIm[index];
+        for (block=0LL; block<numBlocks; block++) {
+            blockEnd = getReductionBlockEnd(block, numAmps);
+            
+            trace = 0;
+            for (index=block*REDUCTION_BLOCK_SIZE; index<blockEnd; index++)
+                trace += aRe[index]*bRe[index] + aIm[index]*bIm[index];
+            blockSums[block] = trace;
         }
     }
     
+    trace = sumReductionBlocks(blockSums, numBlocks);
+    free(blockSums);
     return trace;
 }
 
@@ -1021,107 +1114,261 @@ qreal densmatr_calcFidelityLocal(Qureg qureg, Qureg pureState) {
     qreal* densRe = qureg.stateVec.real;
     qreal* densIm = qureg.stateVec.imag;
     
-    int row, col;
-    int dim = (int) pureState.numAmpsTotal; 
-    int colsPerNode = (int) pureState.numAmpsPerChunk;
-    // using only int, because density matrix has squared as many amps so its 
-    // iteration would be impossible if the pureStates numAmpsTotal didn't fit into int
+    // the density matrix is column-major, so a column's elements are contiguous
+    long long int numLocalAmps = qureg.numAmpsPerChunk;
+    long long int dim = pureState.numAmpsTotal;
+    int numQubits = pureState.numQubitsRepresented;
     
     // starting GLOBAL column index of the qureg columns on this node
-    int startCol = (int) (qureg.chunkId * pureState.numAmpsPerChunk);
+    long long int startCol = qureg.chunkId * pureState.numAmpsPerChunk;
+    
+    long long int index, row, col, block, blockEnd;
+    long long int numBlocks = getNumReductionBlocks(numLocalAmps);
+    qaccum* blockSums = createReductionBlocks(numBlocks);
     
     qreal densElemRe, densElemIm;
-    qreal prefacRe, prefacIm;
-    qreal rowSumRe, rowSumIm;
-    qreal vecElemRe, vecElemIm;
+    qreal colElemRe, colElemIm;
     
     // quantity computed by this node
-    qreal globalSumRe = 0;   // imag-component is assumed zero
+    qaccum sumRe;   // imag-component is assumed zero
     
+    /* the local elements are walked contiguously (rather than along rows, with stride dim),
+     * in the same static partition as the kernels which wrote them. Each block of elements
+     * sums conj(vec_row) dens_{row,col} vec_col into its own partial sum
+     */
 # ifdef _OPENMP
 # pragma omp parallel \
-    shared    (vecRe,vecIm,densRe,densIm, dim,colsPerNode,startCol) \
-    private   (row,col, prefacRe,prefacIm, rowSumRe,rowSumIm, densElemRe,densElemIm, vecElemRe,vecElemIm) \
-    reduction ( +:globalSumRe )
+    shared    (vecRe,vecIm,densRe,densIm, numLocalAmps,dim,numQubits,startCol, numBlocks,blockSums) \
+    private   (index,row,col, block,blockEnd, sumRe, densElemRe,densElemIm, colElemRe,colElemIm)
 # endif 
     {
 # ifdef _OPENMP
 # pragma omp for schedule  (static)
 # endif
-        // indices of my GLOBAL row
-        for (row=0; row < dim; row++) {
-            
-            // single element of conj(pureState)
-            prefacRe =   vecRe[row];
-            prefacIm = - vecIm[row];
-                    
-            rowSumRe = 0;
-            rowSumIm = 0;
-            
-            // indices of my LOCAL column
-            for (col=0; col < colsPerNode; col++) {
-            
-                // my local density element
-                densElemRe = densRe[row + dim*col];
-                densElemIm = densIm[row + dim*col];
+        for (block=0; block < numBlocks; block++) {
+            blockEnd = getReductionBlockEnd(block, numLocalAmps);
             
-                // state-vector element
-                vecElemRe = vecRe[startCol + col];
-                vecElemIm = vecIm[startCol + col];
-            
-                rowSumRe += densElemRe*vecElemRe - densElemIm*vecElemIm;
-                rowSumIm += densElemRe*vecElemIm + densElemIm*vecElemRe;
+            sumRe = 0;
+            for (index=block*REDUCTION_BLOCK_SIZE; index < blockEnd; index++) {
+                
+                // GLOBAL row and column of my local density element
+                row = index & (dim - 1);
+                col = startCol + (index >> numQubits);
+                
+                // dens_{row,col} vec_col
+                densElemRe = densRe[index];
+                densElemIm = densIm[index];
+                colElemRe = densElemRe*vecRe[col] - densElemIm*vecIm[col];
+                colElemIm = densElemRe*vecIm[col] + densElemIm*vecRe[col];
+                
+                // real component of conj(vec_row) dens_{row,col} vec_col
+                sumRe += vecRe[row]*colElemRe + vecIm[row]*colElemIm;
             }
-        
-            globalSumRe += rowSumRe*prefacRe - rowSumIm*prefacIm;   
+            blockSums[block] = sumRe;
         }
     }
     
-    return globalSumRe;
+    sumRe = sumReductionBlocks(blockSums, numBlocks);
+    free(blockSums);
+    return sumRe;
 }
 
 Complex statevec_calcInnerProductLocal(Qureg bra, Qureg ket) {
     
-    qreal innerProdReal = 0;
-    qreal innerProdImag = 0;
-    
-    long long int index;
+    long long int index, block, blockEnd;
     long long int numAmps = bra.numAmpsPerChunk;
+    long long int numBlocks = getNumReductionBlocks(numAmps);
+    qaccum* blockSumsRe = createReductionBlocks(numBlocks);
+    qaccum* blockSumsIm = createReductionBlocks(numBlocks);
+    
     qreal *braVecReal = bra.stateVec.real;
     qreal *braVecImag = bra.stateVec.imag;
     qreal *ketVecReal = ket.stateVec.real;
     qreal *ketVecImag = ket.stateVec.imag;
     
+    qaccum innerProdReal, innerProdImag;
     qreal braRe, braIm, ketRe, ketIm;
     
 # ifdef _OPENMP
 # pragma omp parallel \
-    shared    (braVecReal, braVecImag, ketVecReal, ketVecImag, numAmps) \
-    private   (index, braRe, braIm, ketRe, ketIm) \
-    reduction ( +:innerProdReal, innerProdImag )
+    shared    (braVecReal, braVecImag, ketVecReal, ketVecImag, numAmps, numBlocks, blockSumsRe, blockSumsIm) \
+    private   (index, block, blockEnd, innerProdReal, innerProdImag, braRe, braIm, ketRe, ketIm)
 # endif 
     {
 # ifdef _OPENMP
 # pragma omp for schedule  (static)
 # endif
-        for (index=0; index < numAmps; index++) {
-            braRe = braVecReal[index];
-            braIm = braVecImag[index];
-            ketRe = ketVecReal[index];
-            ketIm = ketVecImag[index];
+        for (block=0; block < numBlocks; block++) {
+            blockEnd = getReductionBlockEnd(block, numAmps);
             
-            // conj(bra_i) * ket_i
-            innerProdReal += braRe*ketRe + braIm*ketIm;
-            innerProdImag += braRe*ketIm - braIm*ketRe;
+            innerProdReal = 0;
+            innerProdImag = 0;
+            for (index=block*REDUCTION_BLOCK_SIZE; index < blockEnd; index++) {
+                braRe = braVecReal[index];
+                braIm = braVecImag[index];
+                ketRe = ketVecReal[index];
+                ketIm = ketVecImag[index];
+                
+                // conj(bra_i) * ket_i
+                innerProdReal += braRe*ketRe + braIm*ketIm;
+                innerProdImag += braRe*ketIm - braIm*ketRe;
+            }
+            blockSumsRe[block] = innerProdReal;
+            blockSumsIm[block] = innerProdImag;
         }
     }
     
     Complex innerProd;
-    innerProd.real = innerProdReal;
-    innerProd.imag = innerProdImag;
+    innerProd.real = sumReductionBlocks(blockSumsRe, numBlocks);
+    innerProd.imag = sumReductionBlocks(blockSumsIm, numBlocks);
+    free(blockSumsRe);
+    free(blockSumsIm);
     return innerProd;
 }
 
+/** The number of bytes of amplitudes (summed over all quregs) processed per tile by 
+ * calcInnerProductsMatrixLocal, chosen so that a tile stays in a core's L2 cache
+ */
+#define INNER_PRODS_TILE_BYTES (1 << 17)
+
+/** The number of contiguous groups of tiles into which calcInnerProductsMatrixLocal divides 
+ * the amplitudes, each accumulating its own partial matrix. This (rather than the number 
+ * of threads) fixes the summation order, so the result does not depend on the thread count
+ */
+#define INNER_PRODS_NUM_GROUPS 64
+
+/** Computes the (upper triangle of the) Gram matrix of the local amplitudes, into matrRe 
+ * and (unless NULL) matrIm. Each group of tiles of amplitudes accumulates every pairwise 
+ * product from cache into its own partial matrix, so that each qureg is read from memory 
+ * once rather than numQuregs times
+ */
+void calcInnerProductsMatrixLocal(Qureg* quregs, int numQuregs, qreal* matrRe, qreal* matrIm) {
+    
+    long long int numAmps = quregs[0].numAmpsPerChunk;
+    long long int numElems = numQuregs * (long long int) numQuregs;
+    int realOnly = (matrIm == NULL);
+    
+    long long int tileLen = INNER_PRODS_TILE_BYTES / (2 * sizeof(qreal) * numQuregs);
+    if (tileLen < 64)
+        tileLen = 64;
+    long long int numTiles = (numAmps + tileLen - 1) / tileLen;
+    long long int numGroups = (numTiles < INNER_PRODS_NUM_GROUPS)? numTiles : INNER_PRODS_NUM_GROUPS;
+    
+    // Can't use qureg.stateVec as a private OMP var
+    qreal** vecRe = malloc(numQuregs * sizeof *vecRe);
+    qreal** vecIm = malloc(numQuregs * sizeof *vecIm);
+    for (int q=0; q<numQuregs; q++) {
+        vecRe[q] = quregs[q].stateVec.real;
+        vecIm[q] = quregs[q].stateVec.imag;
+    }
+    
+    qaccum* partRe = calloc(numGroups * numElems, sizeof *partRe);
+    qaccum* partIm = calloc(numGroups * numElems, sizeof *partIm);
+    if (vecRe == NULL || vecIm == NULL || partRe == NULL || partIm == NULL) {
+        printf("Could not allocate memory!\n");
+        exit (EXIT_FAILURE);
+    }
+    
+    long long int group, tile, tileStart, tileSize, index;
+    int r, c;
+    qaccum sumRe, sumIm;
+    qreal *rRe, *rIm, *cRe, *cIm;
+    qaccum *groupRe, *groupIm;
+    
+# ifdef _OPENMP
+# pragma omp parallel \
+    default  (none) \
+    shared   (numQuregs,numAmps,numElems,realOnly, tileLen,numTiles,numGroups, vecRe,vecIm, partRe,partIm) \
+    private  (group,tile,tileStart,tileSize,index, r,c, sumRe,sumIm, rRe,rIm,cRe,cIm, groupRe,groupIm) 
+# endif
+    {
+# ifdef _OPENMP
+# pragma omp for schedule (static)
+# endif
+        for (group=0; group<numGroups; group++) {
+            groupRe = &partRe[group * numElems];
+            groupIm = &partIm[group * numElems];
+            
+            for (tile=(group*numTiles)/numGroups; tile<((group+1)*numTiles)/numGroups; tile++) {
+                tileStart = tile * tileLen;
+                tileSize = (tileStart + tileLen < numAmps)? tileLen : numAmps - tileStart;
+                
+                for (r=0; r<numQuregs; r++) {
+                    rRe = &vecRe[r][tileStart];
+                    rIm = &vecIm[r][tileStart];
+                    
+                    for (c=r; c<numQuregs; c++) {
+                        cRe = &vecRe[c][tileStart];
+                        cIm = &vecIm[c][tileStart];
+                        
+                        // conj(r_i) * c_i
+                        sumRe = 0;
+                        sumIm = 0;
+                        if (realOnly) {
+                            for (index=0; index<tileSize; index++)
+                                sumRe += rRe[index]*cRe[index] + rIm[index]*cIm[index];
+                        } else {
+                            for (index=0; index<tileSize; index++) {
+                                sumRe += rRe[index]*cRe[index] + rIm[index]*cIm[index];
+                                sumIm += rRe[index]*cIm[index] - rIm[index]*cRe[index];
+                            }
+                        }
+                        groupRe[r*numQuregs + c] += sumRe;
+                        groupIm[r*numQuregs + c] += sumIm;
+                    }
+                }
+            }
+        }
+    }
+    
+    // combine the groups' upper triangles, always in the same order
+    for (r=0; r<numQuregs; r++) {
+        for (c=r; c<numQuregs; c++) {
+            sumRe = 0;
+            sumIm = 0;
+            for (group=0; group<numGroups; group++) {
+                sumRe += partRe[group*numElems + r*numQuregs + c];
+                sumIm += partIm[group*numElems + r*numQuregs + c];
+            }
+            matrRe[r*numQuregs + c] = sumRe;
+            if (!realOnly)
+                matrIm[r*numQuregs + c] = sumIm;
+        }
+    }
+    
+    free(vecRe);
+    free(vecIm);
+    free(partRe);
+    free(partIm);
+}
+
+/** Populates the lower triangle of the (row-major) matrix from its upper triangle, 
+ * such that it is Hermitian (or symmetric if matrIm is NULL)
+ */
+void fillLowerTriangle(qreal* matrRe, qreal* matrIm, int dim) {
+    
+    for (int r=0; r<dim; r++) {
+        for (int c=0; c<r; c++) {
+            matrRe[r*dim + c] = matrRe[c*dim + r];
+            if (matrIm != NULL)
+                matrIm[r*dim + c] = - matrIm[c*dim + r];
+        }
+    }
+}
+
+void statevec_calcInnerProductsMatrixLocal(Qureg* quregs, int numQuregs, qreal* matrRe, qreal* matrIm) {
+    
+    calcInnerProductsMatrixLocal(quregs, numQuregs, matrRe, matrIm);
+    fillLowerTriangle(matrRe, matrIm, numQuregs);
+}
+
+/** computes Tr(conjTrans(a) b) for every pair of the density matrices */
+void densmatr_calcInnerProductsMatrixLocal(Qureg* quregs, int numQuregs, qreal* matr) {
+    
+    calcInnerProductsMatrixLocal(quregs, numQuregs, matr, NULL);
+    fillLowerTriangle(matr, NULL, numQuregs);
+}
+
 
 
 void densmatr_initClassicalState (Qureg qureg, long long int stateInd)
@@ -1201,8 +1448,9 @@ void densmatr_initPureStateLocal(Qureg targetQureg, Qureg copyQureg) {
      */
     
     long long int colOffset = targetQureg.chunkId * copyQureg.numAmpsPerChunk;
-    long long int colsPerNode = copyQureg.numAmpsPerChunk;
+    long long int numLocalAmps = targetQureg.numAmpsPerChunk;
     long long int rowsPerNode = copyQureg.numAmpsTotal;
+    int numQubits = copyQureg.numQubitsRepresented;
     
     // unpack vars for OpenMP
     qreal* vecRe = targetQureg.pairStateVec.real;
@@ -1215,33 +1463,33 @@ void densmatr_initPureStateLocal(Qureg targetQureg, Qureg copyQureg) {
     // a_i conj(a_j) |i><j|
     qreal ketRe, ketIm, braRe, braIm;
     
+    // local elements are written contiguously, and split between threads as by the other 
+    // kernels, even when this node holds fewer columns than there are threads
 # ifdef _OPENMP
 # pragma omp parallel \
     default  (none) \
-    shared   (colOffset, colsPerNode,rowsPerNode, vecRe,vecIm,densRe,densIm) \
+    shared   (colOffset, numLocalAmps,rowsPerNode,numQubits, vecRe,vecIm,densRe,densIm) \
     private  (col,row, ketRe,ketIm,braRe,braIm, index) 
 # endif
     {
 # ifdef _OPENMP
 # pragma omp for schedule (static)
 # endif
-        // local column
-        for (col=0; col < colsPerNode; col++) {
-        
-            // global row
-            for (row=0; row < rowsPerNode; row++) {
-            
-                // get pure state amps
-                ketRe = vecRe[row];
-                ketIm = vecIm[row];
-                braRe =   vecRe[col + colOffset];
-                braIm = - vecIm[col + colOffset]; // minus for conjugation
-            
-                // update density matrix
-                index = row + col*rowsPerNode; // local ind
-                densRe[index] = ketRe*braRe - ketIm*braIm;
-                densIm[index] = ketRe*braIm + ketIm*braRe;
-            }
+        for (index=0; index < numLocalAmps; index++) {
+            
+            // global row, and global column
+            row = index & (rowsPerNode - 1);
+            col = (index >> numQubits) + colOffset;
+            
+            // get pure state amps
+            ketRe = vecRe[row];
+            ketIm = vecIm[row];
+            braRe =   vecRe[col];
+            braIm = - vecIm[col]; // minus for conjugation
+            
+            // update density matrix
+            densRe[index] = ketRe*braRe - ketIm*braIm;
+            densIm[index] = ketRe*braIm + ketIm*braRe;
         }
     }
 }
@@ -1288,6 +1536,184 @@ void statevec_setAmps(Qureg qureg, long long int startInd, qreal* reals, qreal*
     }
 }
 
+void reportThreadPlacement(void) {
+    
+# if defined(_OPENMP) && _OPENMP >= 201511
+    const char* policy;
+    switch (omp_get_proc_bind()) {
+        case omp_proc_bind_false:  policy = "false"; break;
+        case omp_proc_bind_true:   policy = "true"; break;
+        case omp_proc_bind_master: policy = "master"; break;
+        case omp_proc_bind_close:  policy = "close"; break;
+        case omp_proc_bind_spread: policy = "spread"; break;
+        default:                   policy = "unknown";
+    }
+    if (omp_get_proc_bind() == omp_proc_bind_false) {
+        printf("Thread binding (OMP_PROC_BIND) is false, so threads may migrate away from the NUMA memory of their amplitudes\n");
+        return;
+    }
+    printf("Thread binding (OMP_PROC_BIND) is %s, over %d places (OMP_PLACES)\n", 
+        policy, omp_get_num_places());
+    
+    int numThreads = omp_get_max_threads();
+    int* places = malloc(numThreads * sizeof *places);
+# pragma omp parallel \
+    default  (none) \
+    shared   (places)
+    {
+        places[omp_get_thread_num()] = omp_get_place_num();
+    }
+    printf("Place of each thread:");
+    for (int t=0; t<numThreads; t++)
+        printf(" %d", places[t]);
+    printf("\n");
+    free(places);
+# endif
+}
+
+/** The maximum number of freed amplitude arrays retained for reuse. Each qureg 
+ * holds two arrays, or four when distributed (including pairStateVec)
+ */
+#define MAX_NUM_POOLED_AMP_ARRAYS 64
+
+/** The total memory of the freed amplitude arrays retained for reuse is kept below this. 
+ * Arrays which would reach it (such as those of a single large qureg) are freed immediately, 
+ * so that destroying a large qureg always returns its memory to the OS
+ */
+#define MAX_POOLED_AMP_BYTES (1LL << 30)
+
+/* Amplitude arrays of destroyed quregs, recycled when a qureg of the same size 
+ * is next created. This spares repeatedly creating and destroying same-sized 
+ * quregs (e.g. workspaces and clones) the malloc, and the page faults of first 
+ * touching the fresh memory (and of the OS zeroing it), which dominate at many qubits
+ */
+static qreal* pooledAmpArrays[MAX_NUM_POOLED_AMP_ARRAYS];
+static size_t pooledAmpArraySizes[MAX_NUM_POOLED_AMP_ARRAYS];
+static int numPooledAmpArrays = 0;
+static long long int numPooledAmpBytes = 0;
+
+void releaseAmpArrayPool(void) {
+    
+    for (int i=0; i<numPooledAmpArrays; i++)
+        free(pooledAmpArrays[i]);
+    numPooledAmpArrays = 0;
+    numPooledAmpBytes = 0;
+}
+
+/** The size of a (transparent) huge page on x86-64 and most aarch64 Linux systems */
+#define HUGE_PAGE_SIZE (1 << 21)
+
+/** Allocates an amplitude array, requesting transparent huge pages on Linux when it 
+ * spans at least one. The kernels access amplitudes with strides of 2^target, which 
+ * at many qubits touch a new 4 KiB page (and TLB entry) on nearly every access. The 
+ * array is aligned to a huge page so that it can be wholly backed by them, and the 
+ * advice is given before the first touch so that the pages are faulted in as huge. 
+ * If huge pages are disabled, the advice is ignored and ordinary pages are used. 
+ * Memory is freed with free() as usual
+ */
+qreal* mallocAmpArray(size_t numBytes) {
+
+#ifdef __linux__
+    if (numBytes >= HUGE_PAGE_SIZE) {
+        void* arr;
+        if (posix_memalign(&arr, HUGE_PAGE_SIZE, numBytes) != 0)
+            return NULL;
+        madvise(arr, numBytes, MADV_HUGEPAGE);
+        return arr;
+    }
+#endif
+    return malloc(numBytes);
+}
+
+void reportHugePages(void) {
+
+#ifdef __linux__
+    char mode[64] = "unavailable";
+    FILE* file = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+    if (file != NULL) {
+        if (fgets(mode, sizeof mode, file) == NULL)
+            sprintf(mode, "unknown");
+        mode[strcspn(mode, "\n")] = '\0';
+        fclose(file);
+    }
+    printf("Transparent huge pages requested for amplitude arrays of >= %d MiB (system mode: %s)\n", 
+        HUGE_PAGE_SIZE >> 20, mode);
+#else
+    printf("Huge pages not requested (only supported on Linux)\n");
+#endif
+}
+
+/** Writes zero to every element of a freshly allocated array, with the same static 
+ * OpenMP partitioning as the initialisation and gate kernels. Under the first-touch 
+ * policy, each page is thereby placed in the NUMA memory of the thread which will 
+ * later process it (provided threads are bound, see reportQuESTEnv). This is needed 
+ * for pairStateVec in particular, which is otherwise first touched by a single-threaded
+ * MPI receive, and so would land wholly on one socket
+ */
+void firstTouchAmpArray(qreal* arr, size_t numBytes) {
+    
+    long long int numElems = numBytes / sizeof(qreal);
+    long long int index;
+    
+# ifdef _OPENMP
+# pragma omp parallel \
+    default  (none) \
+    shared   (numElems, arr) \
+    private  (index) 
+# endif
+    {
+# ifdef _OPENMP
+# pragma omp for schedule (static)
+# endif
+        for (index=0; index<numElems; index++)
+            arr[index] = 0;
+    }
+}
+
+/** Returns an uninitialised array of numBytes, preferring a pooled array of the 
+ * same size. The pool is emptied when it cannot serve the request, so that memory 
+ * retained for quregs of one size never accumulates when another size is needed.
+ * Pooled arrays keep the page placement of their first touch
+ */
+qreal* allocAmpArray(size_t numBytes) {
+    
+    for (int i=numPooledAmpArrays-1; i>=0; i--) {
+        if (pooledAmpArraySizes[i] == numBytes) {
+            qreal* arr = pooledAmpArrays[i];
+            numPooledAmpBytes -= numBytes;
+            numPooledAmpArrays--;
+            pooledAmpArrays[i] = pooledAmpArrays[numPooledAmpArrays];
+            pooledAmpArraySizes[i] = pooledAmpArraySizes[numPooledAmpArrays];
+            return arr;
+        }
+    }
+    
+    releaseAmpArrayPool();
+    qreal* arr = mallocAmpArray(numBytes);
+    if (arr != NULL)
+        firstTouchAmpArray(arr, numBytes);
+    return arr;
+}
+
+/** Returns the array (as allocated by allocAmpArray) to the pool, or frees it if 
+ * the pool is full, or would then reach MAX_POOLED_AMP_BYTES
+ */
+void freeAmpArray(qreal* arr, size_t numBytes) {
+    
+    if (arr == NULL)
+        return;
+    
+    if (numPooledAmpArrays == MAX_NUM_POOLED_AMP_ARRAYS ||
+        numPooledAmpBytes + (long long int) numBytes >= MAX_POOLED_AMP_BYTES) {
+        free(arr);
+        return;
+    }
+    pooledAmpArrays[numPooledAmpArrays] = arr;
+    pooledAmpArraySizes[numPooledAmpArrays] = numBytes;
+    numPooledAmpArrays++;
+    numPooledAmpBytes += numBytes;
+}
+
 void statevec_createQureg(Qureg *qureg, int numQubits, QuESTEnv env)
 {
     long long int numAmps = 1LL << numQubits;
@@ -1299,11 +1725,11 @@ void statevec_createQureg(Qureg *qureg, int numQubits, QuESTEnv env)
     }
 
     size_t arrSize = (size_t) (numAmpsPerRank * sizeof(*(qureg->stateVec.real)));
-    qureg->stateVec.real = malloc(arrSize);
-    qureg->stateVec.imag = malloc(arrSize);
+    qureg->stateVec.real = allocAmpArray(arrSize);
+    qureg->stateVec.imag = allocAmpArray(arrSize);
     if (env.numRanks>1){
-        qureg->pairStateVec.real = malloc(arrSize);
-        qureg->pairStateVec.imag = malloc(arrSize);
+        qureg->pairStateVec.real = allocAmpArray(arrSize);
+        qureg->pairStateVec.imag = allocAmpArray(arrSize);
     }
 
     if ( (!(qureg->stateVec.real) || !(qureg->stateVec.imag))
@@ -1324,19 +1750,120 @@ void statevec_createQureg(Qureg *qureg, int numQubits, QuESTEnv env)
     qureg->chunkId = env.rank;
     qureg->numChunks = env.numRanks;
     qureg->isDensityMatrix = 0;
+    qureg->isDiskBacked = 0;
+}
+
+/** Returns the number of bytes of the file backing a disk qureg, which holds the 
+ * real and imaginary arrays of stateVec, followed by those of pairStateVec when distributed
+ */
+size_t getDiskQuregFileSize(long long int numAmpsPerRank, int numRanks) {
+    
+    int numArrs = (numRanks>1)? 4 : 2;
+    return numArrs * numAmpsPerRank * sizeof(qreal);
+}
+
+#ifndef _WIN32
+/** Extends the empty file to numBytes by writing zeros, so that the disk space is 
+ * allocated now. Mapping a sparse file instead would defer a full disk to a SIGBUS 
+ * mid-simulation. Returns 0 if the space could not be written.
+ */
+int reserveDiskQuregFile(int fd, size_t numBytes) {
+    
+    static const char zeros[1<<16];
+    size_t numWritten = 0;
+    while (numWritten < numBytes) {
+        size_t len = numBytes - numWritten;
+        if (len > sizeof zeros)
+            len = sizeof zeros;
+        
+        ssize_t wrote = write(fd, zeros, len);
+        if (wrote <= 0)
+            return 0;
+        numWritten += wrote;
+    }
+    return 1;
+}
+#endif
+
+int statevec_createDiskQureg(Qureg *qureg, int numQubits, char* filename, QuESTEnv env)
+{
+    long long int numAmps = 1LL << numQubits;
+    long long int numAmpsPerRank = numAmps/env.numRanks;
+    
+    qureg->numQubitsInStateVec = numQubits;
+    qureg->numAmpsTotal = numAmps;
+    qureg->numAmpsPerChunk = numAmpsPerRank;
+    qureg->chunkId = env.rank;
+    qureg->numChunks = env.numRanks;
+    qureg->isDensityMatrix = 0;
+    qureg->isDiskBacked = 1;
+    
+    // a disk-backed qureg is likely created because RAM is short, so return any retained to the OS
+    releaseAmpArrayPool();
+    
+#ifndef _WIN32
+    void* map = MAP_FAILED;
+    size_t fileSize = 0;
+    
+    // the file must be addressable in its entirety
+    if (numAmpsPerRank <= (long long int) (SIZE_MAX / (4*sizeof(qreal)))) {
+        fileSize = getDiskQuregFileSize(numAmpsPerRank, env.numRanks);
+        
+        char* name = getQuregFileName(filename, env.numRanks, env.rank);
+        int fd = open(name, O_RDWR | O_CREAT | O_TRUNC, 0600);
+        if (fd != -1) {
+            
+            // MAP_SHARED so that evicted pages are written back to the file, rather than to swap
+            if (reserveDiskQuregFile(fd, fileSize))
+                map = mmap(NULL, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            
+            // the mapping keeps the (now anonymous) file alive until munmap
+            close(fd);
+            unlink(name);
+        }
+        free(name);
+    }
+    int success = (map != MAP_FAILED);
+    
+    // every node must succeed, else every node releases its file
+    if (!syncQuESTSuccess(success)) {
+        if (success)
+            munmap(map, fileSize);
+        return 0;
+    }
+    
+    qureg->stateVec.real = (qreal*) map;
+    qureg->stateVec.imag = qureg->stateVec.real + numAmpsPerRank;
+    if (env.numRanks>1) {
+        qureg->pairStateVec.real = qureg->stateVec.imag + numAmpsPerRank;
+        qureg->pairStateVec.imag = qureg->pairStateVec.real + numAmpsPerRank;
+    }
+    return 1;
+#else
+    return 0;
+#endif
 }
 
 void statevec_destroyQureg(Qureg qureg, QuESTEnv env){
 
+    size_t arrSize = (size_t) (qureg.numAmpsPerChunk * sizeof(*(qureg.stateVec.real)));
+
+#ifndef _WIN32
+    if (qureg.isDiskBacked)
+        munmap(qureg.stateVec.real, getDiskQuregFileSize(qureg.numAmpsPerChunk, env.numRanks));
+#endif
+
     qureg.numQubitsInStateVec = 0;
     qureg.numAmpsTotal = 0;
     qureg.numAmpsPerChunk = 0;
 
-    free(qureg.stateVec.real);
-    free(qureg.stateVec.imag);
-    if (env.numRanks>1){
-        free(qureg.pairStateVec.real);
-        free(qureg.pairStateVec.imag);
+    if (!qureg.isDiskBacked) {
+        freeAmpArray(qureg.stateVec.real, arrSize);
+        freeAmpArray(qureg.stateVec.imag, arrSize);
+        if (env.numRanks>1){
+            freeAmpArray(qureg.pairStateVec.real, arrSize);
+            freeAmpArray(qureg.pairStateVec.imag, arrSize);
+        }
     }
     qureg.stateVec.real = NULL;
     qureg.stateVec.imag = NULL;
@@ -1344,39 +1871,115 @@ void statevec_destroyQureg(Qureg qureg, QuESTEnv env){
     qureg.pairStateVec.imag = NULL;
 }
 
-void statevec_reportStateToScreen(Qureg qureg, QuESTEnv env, int reportRank){
-    long long int index;
-    int rank;
-    if (qureg.numQubitsInStateVec<=5){
-        for (rank=0; rank<qureg.numChunks; rank++){
-            if (qureg.chunkId==rank){
-                if (reportRank) {
-                    printf("Reporting state from rank %d [\n", qureg.chunkId);
-                    printf("real, imag\n");
-                } else if (rank==0) {
-                    printf("Reporting state [\n");
-                    printf("real, imag\n");
-                }
+DiagonalOp agnostic_createDiagonalOp(int numQubits, QuESTEnv env) {
 
-                for(index=0; index<qureg.numAmpsPerChunk; index++){
-                    //printf(REAL_STRING_FORMAT ", " REAL_STRING_FORMAT "\n", qureg.pairStateVec.real[index], qureg.pairStateVec.imag[index]);
-                    printf(REAL_STRING_FORMAT ", " REAL_STRING_FORMAT "\n", qureg.stateVec.real[index], qureg.stateVec.imag[index]);
-                }
-                if (reportRank || rank==qureg.numChunks-1) printf("]\n");
-            }
-            syncQuESTEnv(env);
-        }
-    } else printf("Error: reportStateToScreen will not print output for systems of more than 5 qubits.\n");
+    // the 2^numQubits elements are distributed exactly as a state-vector's amplitudes
+    DiagonalOp op;
+    op.numQubits = numQubits;
+    op.numElemsPerChunk = (1LL << numQubits) / env.numRanks;
+    op.chunkId = env.rank;
+    op.numChunks = env.numRanks;
+    
+    // allocate CPU memory (initialised to zero)
+    op.real = (qreal*) calloc(op.numElemsPerChunk, sizeof(qreal));
+    op.imag = (qreal*) calloc(op.numElemsPerChunk, sizeof(qreal));
+    
+    // there is no GPU memory
+    op.deviceOperator.real = NULL;
+    op.deviceOperator.imag = NULL;
+    
+    // check CPU memory allocation was successful
+    if ( !op.real || !op.imag ) {
+        printf("Could not allocate memory!\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    return op;
 }
-void statevec_getEnvironmentString(QuESTEnv env, Qureg qureg, char str[200]){
-    int numThreads=1;
-# ifdef _OPENMP
-    numThreads=omp_get_max_threads(); 
-# endif
-    sprintf(str, "%dqubits_CPU_%dranksx%dthreads", qureg.numQubitsInStateVec, env.numRanks, numThreads);
+
+void agnostic_destroyDiagonalOp(DiagonalOp op) {
+    free(op.real);
+    free(op.imag);
 }
 
-void statevec_initBlankState (Qureg qureg)
+void agnostic_syncDiagonalOp(DiagonalOp op) {
+    // nothing to do on CPU
+}
+
+void agnostic_setDiagonalOpElems(DiagonalOp op, long long int startInd, qreal* real, qreal* imag, long long int numElems) {
+    
+    /* this is actually distributed, since the user's code runs on every node */
+    
+    // local start/end indices of the given elements, as in statevec_setAmps
+    long long int localStartInd = startInd - op.chunkId*op.numElemsPerChunk;
+    long long int localEndInd = localStartInd + numElems; // exclusive
+    
+    // add this to a local index to get corresponding elem in real & imag
+    long long int offset = op.chunkId*op.numElemsPerChunk - startInd;
+    
+    // restrict these indices to fit into this chunk
+    if (localStartInd < 0)
+        localStartInd = 0;
+    if (localEndInd > op.numElemsPerChunk)
+        localEndInd = op.numElemsPerChunk;
+    // they may now be out of order = no iterations
+    
+    // unpacking OpenMP vars
+    long long int index;
+    qreal* opRe = op.real;
+    qreal* opIm = op.imag;
+    
+# ifdef _OPENMP
+# pragma omp parallel \
+    default  (none) \
+    shared   (localStartInd,localEndInd, opRe,opIm, real,imag, offset) \
+    private  (index) 
+# endif
+    {
+# ifdef _OPENMP
+# pragma omp for schedule (static)
+# endif
+        // iterate these local inds - this might involve no iterations
+        for (index=localStartInd; index < localEndInd; index++) {
+            opRe[index] = real[index + offset];
+            opIm[index] = imag[index + offset];
+        }
+    }
+}
+
+void statevec_reportStateToScreen(Qureg qureg, QuESTEnv env, int reportRank){
+    long long int index;
+    int rank;
+    if (qureg.numQubitsInStateVec<=5){
+        for (rank=0; rank<qureg.numChunks; rank++){
+            if (qureg.chunkId==rank){
+                if (reportRank) {
+                    printf("Reporting state from rank %d [\n", qureg.chunkId);
+                    printf("real, imag\n");
+                } else if (rank==0) {
+                    printf("Reporting state [\n");
+                    printf("real, imag\n");
+                }
+
+                for(index=0; index<qureg.numAmpsPerChunk; index++){
+                    //printf(REAL_STRING_FORMAT ", " REAL_STRING_FORMAT "\n", qureg.pairStateVec.real[index], qureg.pairStateVec.imag[index]);
+                    printf(REAL_STRING_FORMAT ", " REAL_STRING_FORMAT "\n", qureg.stateVec.real[index], qureg.stateVec.imag[index]);
+                }
+                if (reportRank || rank==qureg.numChunks-1) printf("]\n");
+            }
+            syncQuESTEnv(env);
+        }
+    } else printf("Error: reportStateToScreen will not print output for systems of more than 5 qubits.\n");
+}
+void statevec_getEnvironmentString(QuESTEnv env, Qureg qureg, char str[200]){
+    int numThreads=1;
+# ifdef _OPENMP
+    numThreads=omp_get_max_threads(); 
+# endif
+    sprintf(str, "%dqubits_CPU_%dranksx%dthreads", qureg.numQubitsInStateVec, env.numRanks, numThreads);
+}
+
+void statevec_initBlankState (Qureg qureg)
 {
     long long int stateVecSize;
     long long int index;
@@ -3140,6 +3743,699 @@ void statevec_multiRotateZ(Qureg qureg, long long int mask, qreal angle)
     }
 }
 
+void statevec_applyPhaseFuncOverrides(
+    Qureg qureg, int* qubits, int numQubits, enum bitEncoding encoding,
+    qreal* coeffs, qreal* exponents, int numTerms, 
+    long long int* overrideInds, qreal* overridePhases, int numOverrides,
+    int conj)
+{
+    // each amplitude is modified independently, using its global index
+    long long int index, globalInd, phaseInd;
+    long long int numAmps = qureg.numAmpsPerChunk;
+    long long int chunkOffset = qureg.chunkId*qureg.numAmpsPerChunk;
+    
+    // two's complement values beyond this are negative
+    long long int signBitVal = 1LL << (numQubits-1);
+    long long int numVals = 1LL << numQubits;
+    int isSigned = (encoding == TWOS_COMPLEMENT);
+    
+    qreal *stateVecReal = qureg.stateVec.real;
+    qreal *stateVecImag = qureg.stateVec.imag;
+    
+    int q, t, i;
+    qreal phase, c, s, re, im;
+
+# ifdef _OPENMP
+# pragma omp parallel \
+    default  (none) \
+    shared   (stateVecReal,stateVecImag, numAmps,chunkOffset, qubits,numQubits, \
+              isSigned,signBitVal,numVals, coeffs,exponents,numTerms, \
+              overrideInds,overridePhases,numOverrides, conj) \
+    private  (index, globalInd,phaseInd, q,t,i, phase,c,s,re,im)
+# endif
+    {
+# ifdef _OPENMP
+# pragma omp for schedule (static)
+# endif
+        for (index=0; index<numAmps; index++) {
+            
+            // determine the sub-register value encoded by this basis state
+            globalInd = index + chunkOffset;
+            phaseInd = 0;
+            for (q=0; q<numQubits; q++)
+                phaseInd += ((globalInd >> qubits[q]) & 1LL) << q;
+            if (isSigned && phaseInd >= signBitVal)
+                phaseInd -= numVals;
+            
+            // the first matching override (if any) replaces the phase function
+            for (i=0; i<numOverrides; i++)
+                if (phaseInd == overrideInds[i])
+                    break;
+            
+            if (i < numOverrides)
+                phase = overridePhases[i];
+            else {
+                phase = 0;
+                for (t=0; t<numTerms; t++)
+                    phase += coeffs[t] * pow(phaseInd, exponents[t]);
+            }
+            if (conj)
+                phase = - phase;
+            
+            c = cos(phase);
+            s = sin(phase);
+            re = stateVecReal[index];
+            im = stateVecImag[index];
+            
+            // (re + im i)(c + s i)
+            stateVecReal[index] = re*c - im*s;
+            stateVecImag[index] = re*s + im*c;
+        }
+    }
+}
+
+void statevec_applyPhaseFuncTable(Qureg qureg, int* qubits, int numQubits, qreal* phases, int conj)
+{
+    long long int index, globalInd, phaseInd;
+    long long int numAmps = qureg.numAmpsPerChunk;
+    long long int chunkOffset = qureg.chunkId*qureg.numAmpsPerChunk;
+    
+    qreal *stateVecReal = qureg.stateVec.real;
+    qreal *stateVecImag = qureg.stateVec.imag;
+    
+    int q;
+    qreal phase, c, s, re, im;
+
+# ifdef _OPENMP
+# pragma omp parallel \
+    default  (none) \
+    shared   (stateVecReal,stateVecImag, numAmps,chunkOffset, qubits,numQubits, phases, conj) \
+    private  (index, globalInd,phaseInd, q, phase,c,s,re,im)
+# endif
+    {
+# ifdef _OPENMP
+# pragma omp for schedule (static)
+# endif
+        for (index=0; index<numAmps; index++) {
+            
+            // the table is indexed by the unsigned value of the sub-register
+            globalInd = index + chunkOffset;
+            phaseInd = 0;
+            for (q=0; q<numQubits; q++)
+                phaseInd += ((globalInd >> qubits[q]) & 1LL) << q;
+            
+            phase = (conj)? - phases[phaseInd] : phases[phaseInd];
+            
+            c = cos(phase);
+            s = sin(phase);
+            re = stateVecReal[index];
+            im = stateVecImag[index];
+            
+            stateVecReal[index] = re*c - im*s;
+            stateVecImag[index] = re*s + im*c;
+        }
+    }
+}
+
+/** Performs the numStages consecutive stages topStage, topStage-1, ... of the (decimation-in-frequency)
+ * FFT over the sub-register qubits, the qubits of which must all lie within a chunk. Each task gathers
+ * the 2^numStages amplitudes differing only in these qubits, and privately performs every butterfly
+ * upon them, so that the state-vector is swept once rather than numStages times. Stage s maps
+ * (a0, a1) -> (a0 + a1, (a0 - a1) exp(i pi x / 2^s))/sqrt(2), where x is the value of the sub-register 
+ * qubits below qubits[s], and the phase is negated if conj.
+ */
+void statevec_applyFourierStages(Qureg qureg, int* qubits, int topStage, int numStages, int conj)
+{
+    // can't use qureg.stateVec as a private OMP var
+    qreal *reVec = qureg.stateVec.real;
+    qreal *imVec = qureg.stateVec.imag;
+    
+    const int lowStage = topStage - numStages + 1;
+    const long long int numTasks = qureg.numAmpsPerChunk >> numStages;
+    const long long int numBlockAmps = 1LL << numStages;
+    const long long int chunkOffset = qureg.chunkId*qureg.numAmpsPerChunk;
+    const qreal recRoot2 = 1.0/sqrt(2);
+    const qreal sign = (conj)? -1 : 1;
+    
+    long long int thisTask, ind0, lowVal, i, k, u, v;
+    int j, q, t;
+    qreal angle, reU, imU, reDif, imDif, reTwid, imTwid, reFac, imFac;
+    
+    // each task privately records its block of amplitudes and its twiddle factors
+    #ifndef _WIN32
+        long long int offsets[numBlockAmps];
+        qreal reTab[numBlockAmps];
+        qreal imTab[numBlockAmps];
+        int sortedQubits[numStages];
+        qreal reAmps[numBlockAmps];
+        qreal imAmps[numBlockAmps];
+        qreal reBase[numStages];
+        qreal imBase[numStages];
+    #else
+        long long int* offsets = _malloca(numBlockAmps * sizeof *offsets);
+        qreal* reTab = _malloca(numBlockAmps * sizeof *reTab);
+        qreal* imTab = _malloca(numBlockAmps * sizeof *imTab);
+        int* sortedQubits = _malloca(numStages * sizeof *sortedQubits);
+        qreal* reAmps = _malloca(numBlockAmps * sizeof *reAmps);
+        qreal* imAmps = _malloca(numBlockAmps * sizeof *imAmps);
+        qreal* reBase = _malloca(numStages * sizeof *reBase);
+        qreal* imBase = _malloca(numStages * sizeof *imBase);
+    #endif
+    
+    // the offset of each block amplitude from the block's first (where the stages' qubits are 0)
+    for (i=0; i < numBlockAmps; i++) {
+        offsets[i] = 0;
+        for (j=0; j < numStages; j++)
+            if (extractBit(j, i))
+                offsets[i] += 1LL << qubits[lowStage + j];
+    }
+    for (j=0; j < numStages; j++)
+        sortedQubits[j] = qubits[lowStage + j];
+    qsort(sortedQubits, numStages, sizeof(int), qsortComp);
+    
+    // the twiddle of block stage j upon the value k < 2^j of the lower block qubits is exp(i pi k/2^j), 
+    // stored at index 2^j + k, and must be multiplied by a per-task factor from the qubits below the block
+    for (j=0; j < numStages; j++) {
+        for (k=0; k < (1LL << j); k++) {
+            angle = sign * QUEST_PI * k / (1LL << j);
+            reTab[(1LL << j) + k] = cos(angle);
+            imTab[(1LL << j) + k] = sin(angle);
+        }
+    }
+    
+# ifdef _OPENMP
+# pragma omp parallel \
+    default  (none) \
+    shared   (reVec,imVec, offsets,sortedQubits,reTab,imTab, qubits,numStages) \
+    private  (thisTask,ind0,lowVal,i,k,u,v,j,q,t, angle,reU,imU,reDif,imDif,reTwid,imTwid,reFac,imFac, reAmps,imAmps,reBase,imBase)
+# endif
+    {
+# ifdef _OPENMP
+# pragma omp for schedule (static)
+# endif
+        for (thisTask=0; thisTask<numTasks; thisTask++) {
+            
+            // find this task's first amplitude
+            ind0 = thisTask;
+            for (t=0; t < numStages; t++)
+                ind0 = insertZeroBit(ind0, sortedQubits[t]);
+                
+            // each stage's twiddle factor from the value of the sub-register qubits below the block
+            lowVal = 0;
+            for (q=0; q < lowStage; q++)
+                lowVal += ((long long int) extractBit(qubits[q], ind0 + chunkOffset)) << q;
+            for (j=0; j < numStages; j++) {
+                angle = sign * QUEST_PI * lowVal / (1LL << (lowStage + j));
+                reBase[j] = cos(angle);
+                imBase[j] = sin(angle);
+            }
+            
+            for (i=0; i < numBlockAmps; i++) {
+                reAmps[i] = reVec[ind0 + offsets[i]];
+                imAmps[i] = imVec[ind0 + offsets[i]];
+            }
+            
+            // perform the stages from the most significant, each upon every pair of block amplitudes
+            for (j=numStages-1; j >= 0; j--) {
+                
+                for (k=0; k < numBlockAmps/2; k++) {
+                    u = insertZeroBit(k, j);
+                    v = flipBit(u, j);
+                    
+                    reTwid = reTab[(1LL << j) + (u & ((1LL << j) - 1))];
+                    imTwid = imTab[(1LL << j) + (u & ((1LL << j) - 1))];
+                    reFac = reTwid*reBase[j] - imTwid*imBase[j];
+                    imFac = reTwid*imBase[j] + imTwid*reBase[j];
+                    
+                    reU = reAmps[u];
+                    imU = imAmps[u];
+                    reDif = recRoot2*(reU - reAmps[v]);
+                    imDif = recRoot2*(imU - imAmps[v]);
+                    
+                    reAmps[u] = recRoot2*(reU + reAmps[v]);
+                    imAmps[u] = recRoot2*(imU + imAmps[v]);
+                    reAmps[v] = reDif*reFac - imDif*imFac;
+                    imAmps[v] = reDif*imFac + imDif*reFac;
+                }
+            }
+            
+            for (i=0; i < numBlockAmps; i++) {
+                reVec[ind0 + offsets[i]] = reAmps[i];
+                imVec[ind0 + offsets[i]] = imAmps[i];
+            }
+        }
+    }
+    
+    // on Windows, we must explicitly free the stack structures
+    #ifdef _WIN32
+        _freea(offsets);
+        _freea(reTab);
+        _freea(imTab);
+        _freea(sortedQubits);
+        _freea(reAmps);
+        _freea(imAmps);
+        _freea(reBase);
+        _freea(imBase);
+    #endif
+}
+
+/** Multiplies every amplitude in which qubits[stage] is 1 by the twiddle factor exp(i pi x / 2^stage)
+ * (negated if conj), where x is the value of the sub-register qubits below qubits[stage]. This completes
+ * an FFT stage upon a qubit spread between nodes, after its hadamard, and needs no communication.
+ */
+void statevec_applyFourierTwiddles(Qureg qureg, int* qubits, int stage, int conj)
+{
+    long long int index, globalInd, lowVal;
+    long long int numAmps = qureg.numAmpsPerChunk;
+    long long int chunkOffset = qureg.chunkId*qureg.numAmpsPerChunk;
+    
+    qreal *stateVecReal = qureg.stateVec.real;
+    qreal *stateVecImag = qureg.stateVec.imag;
+    
+    const qreal fac = ((conj)? -1 : 1) * QUEST_PI / (1LL << stage);
+    
+    int q;
+    qreal phase, c, s, re, im;
+
+# ifdef _OPENMP
+# pragma omp parallel \
+    default  (none) \
+    shared   (stateVecReal,stateVecImag, numAmps,chunkOffset, qubits,stage) \
+    private  (index, globalInd,lowVal, q, phase,c,s,re,im)
+# endif
+    {
+# ifdef _OPENMP
+# pragma omp for schedule (static)
+# endif
+        for (index=0; index<numAmps; index++) {
+            
+            globalInd = index + chunkOffset;
+            if (!extractBit(qubits[stage], globalInd))
+                continue;
+            
+            lowVal = 0;
+            for (q=0; q<stage; q++)
+                lowVal += ((globalInd >> qubits[q]) & 1LL) << q;
+            
+            phase = fac * lowVal;
+            c = cos(phase);
+            s = sin(phase);
+            re = stateVecReal[index];
+            im = stateVecImag[index];
+            
+            stateVecReal[index] = re*c - im*s;
+            stateVecImag[index] = re*s + im*c;
+        }
+    }
+}
+
+/** Simultaneously swaps each qubits1[p] with qubits2[p] (which must be disjoint, and all lie 
+ * within a chunk) in a single pass. The combined permutation of amplitudes is an involution, 
+ * so each swapped pair of amplitudes is visited once, by the smaller index.
+ */
+void statevec_swapQubitAmpsPairs(Qureg qureg, int* qubits1, int* qubits2, int numPairs)
+{
+    long long int index, pairInd;
+    long long int numAmps = qureg.numAmpsPerChunk;
+    
+    qreal *stateVecReal = qureg.stateVec.real;
+    qreal *stateVecImag = qureg.stateVec.imag;
+    
+    int p;
+    qreal re, im;
+
+# ifdef _OPENMP
+# pragma omp parallel \
+    default  (none) \
+    shared   (stateVecReal,stateVecImag, numAmps, qubits1,qubits2,numPairs) \
+    private  (index,pairInd, p, re,im)
+# endif
+    {
+# ifdef _OPENMP
+# pragma omp for schedule (static)
+# endif
+        for (index=0; index<numAmps; index++) {
+            
+            pairInd = index;
+            for (p=0; p<numPairs; p++)
+                if (extractBit(qubits1[p], index) != extractBit(qubits2[p], index))
+                    pairInd = flipBit(flipBit(pairInd, qubits1[p]), qubits2[p]);
+            
+            if (pairInd <= index)
+                continue;
+            
+            re = stateVecReal[index];
+            im = stateVecImag[index];
+            stateVecReal[index] = stateVecReal[pairInd];
+            stateVecImag[index] = stateVecImag[pairInd];
+            stateVecReal[pairInd] = re;
+            stateVecImag[pairInd] = im;
+        }
+    }
+}
+
+/** Effects exp(-i angle/2 P) in a single pass, for the Pauli product P which flips
+ * the bits of flipMask (its X and Y targets) and negates amplitudes with odd parity
+ * under phaseMask (its Y and Z targets). Every amplitude |j> is mixed only with 
+ * |j ^ flipMask>, which must also lie in this chunk; each pair is visited once via 
+ * the amplitude with a zero in flipMask's highest bit.
+ */
+void statevec_multiRotatePauliLocal(Qureg qureg, long long int flipMask, long long int phaseMask, qreal cosAngle, Complex sinFac)
+{
+    long long int thisTask;
+    long long int indLo, indHi;
+    const long long int numTasks = qureg.numAmpsPerChunk >> 1;
+    const long long int chunkOffset = qureg.chunkId*qureg.numAmpsPerChunk;
+    
+    int pivotBit = 0;
+    while ((flipMask >> (pivotBit+1)) != 0)
+        pivotBit++;
+    
+    qreal *stateVecReal = qureg.stateVec.real;
+    qreal *stateVecImag = qureg.stateVec.imag;
+    const qreal facRe = sinFac.real;
+    const qreal facIm = sinFac.imag;
+    
+    qreal reLo, imLo, reHi, imHi;
+    int sgnLo, sgnHi;
+
+# ifdef _OPENMP
+# pragma omp parallel \
+    default  (none) \
+    shared   (stateVecReal,stateVecImag, flipMask,phaseMask,pivotBit, cosAngle) \
+    private  (thisTask, indLo,indHi, reLo,imLo,reHi,imHi, sgnLo,sgnHi)
+# endif
+    {
+# ifdef _OPENMP
+# pragma omp for schedule (static)
+# endif
+        for (thisTask=0; thisTask<numTasks; thisTask++) {
+            indLo = insertZeroBit(thisTask, pivotBit);
+            indHi = indLo ^ flipMask;
+            
+            sgnLo = getBitMaskParity(phaseMask & (indLo+chunkOffset))? -1 : 1;
+            sgnHi = getBitMaskParity(phaseMask & (indHi+chunkOffset))? -1 : 1;
+            
+            reLo = stateVecReal[indLo];
+            imLo = stateVecImag[indLo];
+            reHi = stateVecReal[indHi];
+            imHi = stateVecImag[indHi];
+            
+            // |lo> receives sinFac sgn(hi) amp(hi), and vice versa
+            stateVecReal[indLo] = cosAngle*reLo + sgnHi*(facRe*reHi - facIm*imHi);
+            stateVecImag[indLo] = cosAngle*imLo + sgnHi*(facRe*imHi + facIm*reHi);
+            stateVecReal[indHi] = cosAngle*reHi + sgnLo*(facRe*reLo - facIm*imLo);
+            stateVecImag[indHi] = cosAngle*imHi + sgnLo*(facRe*imLo + facIm*reLo);
+        }
+    }
+}
+
+/** As statevec_multiRotatePauliLocal, but where flipMask contains chunk-index bits,
+ * so that the partner of every amplitude in this chunk lies in stateVecIn (the chunk
+ * of the pair rank). Every amplitude of this chunk is updated, into stateVecOut.
+ */
+void statevec_multiRotatePauliDistributed(Qureg qureg, long long int flipMask, long long int phaseMask, qreal cosAngle, Complex sinFac,
+        ComplexArray stateVecIn,
+        ComplexArray stateVecOut)
+{
+    long long int index, pairIndex;
+    const long long int numAmps = qureg.numAmpsPerChunk;
+    const long long int chunkOffset = qureg.chunkId*qureg.numAmpsPerChunk;
+    const long long int localFlipMask = flipMask & (numAmps - 1);
+    
+    qreal *stateVecReal = qureg.stateVec.real;
+    qreal *stateVecImag = qureg.stateVec.imag;
+    qreal *stateVecRealPair = stateVecIn.real;
+    qreal *stateVecImagPair = stateVecIn.imag;
+    qreal *stateVecRealOut = stateVecOut.real;
+    qreal *stateVecImagOut = stateVecOut.imag;
+    const qreal facRe = sinFac.real;
+    const qreal facIm = sinFac.imag;
+    
+    qreal re, im, rePair, imPair;
+    int sgnPair;
+
+# ifdef _OPENMP
+# pragma omp parallel \
+    default  (none) \
+    shared   (stateVecReal,stateVecImag, stateVecRealPair,stateVecImagPair, \
+              stateVecRealOut,stateVecImagOut, flipMask,phaseMask, cosAngle) \
+    private  (index, pairIndex, re,im,rePair,imPair, sgnPair)
+# endif
+    {
+# ifdef _OPENMP
+# pragma omp for schedule (static)
+# endif
+        for (index=0; index<numAmps; index++) {
+            pairIndex = index ^ localFlipMask;
+            sgnPair = getBitMaskParity(phaseMask & ((index+chunkOffset) ^ flipMask))? -1 : 1;
+            
+            re = stateVecReal[index];
+            im = stateVecImag[index];
+            rePair = stateVecRealPair[pairIndex];
+            imPair = stateVecImagPair[pairIndex];
+            
+            stateVecRealOut[index] = cosAngle*re + sgnPair*(facRe*rePair - facIm*imPair);
+            stateVecImagOut[index] = cosAngle*im + sgnPair*(facRe*imPair + facIm*rePair);
+        }
+    }
+}
+
+/** Adds sum_t coeffs[t] P_t |in> to outQureg, for Pauli products P_t which all flip 
+ * the bits of flipMask, and negate amplitudes with odd parity under phaseMasks[t].
+ * Each amplitude of this chunk gathers from its partner |j ^ flipMask>, which lies in 
+ * stateVecIn (either the input qureg's own chunk, or that of its pair rank), so that 
+ * the input is only read, and the output written once for all numProds products.
+ */
+void statevec_addPauliProdsLocal(Qureg outQureg, long long int flipMask, long long int* phaseMasks, Complex* coeffs, int numProds,
+        ComplexArray stateVecIn)
+{
+    long long int index, pairIndex, globalPairIndex;
+    const long long int numAmps = outQureg.numAmpsPerChunk;
+    const long long int chunkOffset = outQureg.chunkId*outQureg.numAmpsPerChunk;
+    const long long int localFlipMask = flipMask & (numAmps - 1);
+    
+    qreal *stateVecRealIn = stateVecIn.real;
+    qreal *stateVecImagIn = stateVecIn.imag;
+    qreal *stateVecRealOut = outQureg.stateVec.real;
+    qreal *stateVecImagOut = outQureg.stateVec.imag;
+    
+    qreal facRe, facIm, rePair, imPair;
+    int p, sgn;
+
+# ifdef _OPENMP
+# pragma omp parallel \
+    default  (none) \
+    shared   (stateVecRealIn,stateVecImagIn, stateVecRealOut,stateVecImagOut, flipMask,phaseMasks,coeffs,numProds) \
+    private  (index, pairIndex,globalPairIndex, facRe,facIm, rePair,imPair, p,sgn)
+# endif
+    {
+# ifdef _OPENMP
+# pragma omp for schedule (static)
+# endif
+        for (index=0; index<numAmps; index++) {
+            pairIndex = index ^ localFlipMask;
+            globalPairIndex = (index+chunkOffset) ^ flipMask;
+            
+            // sum_t coeffs[t] (-1)^parity(pair & phaseMasks[t])
+            facRe = 0;
+            facIm = 0;
+            for (p=0; p<numProds; p++) {
+                sgn = getBitMaskParity(phaseMasks[p] & globalPairIndex)? -1 : 1;
+                facRe += sgn*coeffs[p].real;
+                facIm += sgn*coeffs[p].imag;
+            }
+            
+            rePair = stateVecRealIn[pairIndex];
+            imPair = stateVecImagIn[pairIndex];
+            stateVecRealOut[index] += facRe*rePair - facIm*imPair;
+            stateVecImagOut[index] += facRe*imPair + facIm*rePair;
+        }
+    }
+}
+
+void statevec_applyDiagonalOpLocal(Qureg qureg, DiagonalOp op) {
+    
+    // each chunk of op corresponds to the same-index chunk of qureg
+    long long int index;
+    long long int numAmps = qureg.numAmpsPerChunk;
+    
+    qreal *stateVecReal = qureg.stateVec.real;
+    qreal *stateVecImag = qureg.stateVec.imag;
+    qreal *opReal = op.real;
+    qreal *opImag = op.imag;
+    
+    qreal a, b, c, d;
+
+# ifdef _OPENMP
+# pragma omp parallel \
+    shared   (stateVecReal,stateVecImag, opReal,opImag, numAmps) \
+    private  (index, a,b,c,d)
+# endif
+    {
+# ifdef _OPENMP
+# pragma omp for schedule (static)
+# endif
+        for (index=0; index<numAmps; index++) {
+            a = stateVecReal[index];
+            b = stateVecImag[index];
+            c = opReal[index];
+            d = opImag[index];
+            
+            // (a + b i)(c + d i) = (a c - b d) + i (a d + b c)
+            stateVecReal[index] = a*c - b*d;
+            stateVecImag[index] = a*d + b*c;
+        }
+    }
+}
+
+/** Left-multiplies the density matrix by the diagonal operator, whose real and imag 
+ * arrays must contain every (not merely this chunk's) diagonal element. 
+ * Since every chunk contains whole columns, the row of each local amplitude 
+ * is found from its local index alone.
+ */
+void densmatr_applyDiagonalOpLocal(Qureg qureg, DiagonalOp op) {
+    
+    long long int index;
+    long long int numAmps = qureg.numAmpsPerChunk;
+    long long int rowMask = (1LL << qureg.numQubitsRepresented) - 1;
+    
+    qreal *stateVecReal = qureg.stateVec.real;
+    qreal *stateVecImag = qureg.stateVec.imag;
+    qreal *opReal = op.real;
+    qreal *opImag = op.imag;
+    
+    qreal a, b, c, d;
+
+# ifdef _OPENMP
+# pragma omp parallel \
+    shared   (stateVecReal,stateVecImag, opReal,opImag, numAmps, rowMask) \
+    private  (index, a,b,c,d)
+# endif
+    {
+# ifdef _OPENMP
+# pragma omp for schedule (static)
+# endif
+        for (index=0; index<numAmps; index++) {
+            a = stateVecReal[index];
+            b = stateVecImag[index];
+            c = opReal[index & rowMask];
+            d = opImag[index & rowMask];
+            
+            stateVecReal[index] = a*c - b*d;
+            stateVecImag[index] = a*d + b*c;
+        }
+    }
+}
+
+Complex statevec_calcExpecDiagonalOpLocal(Qureg qureg, DiagonalOp op) {
+    
+    // sum_i D_i |psi_i|^2, accumulating both components in a single pass
+    long long int index, block, blockEnd;
+    long long int numAmps = qureg.numAmpsPerChunk;
+    long long int numBlocks = getNumReductionBlocks(numAmps);
+    qaccum* blockSumsRe = createReductionBlocks(numBlocks);
+    qaccum* blockSumsIm = createReductionBlocks(numBlocks);
+    
+    qreal *stateVecReal = qureg.stateVec.real;
+    qreal *stateVecImag = qureg.stateVec.imag;
+    qreal *opReal = op.real;
+    qreal *opImag = op.imag;
+    
+    qaccum expecRe, expecIm;
+    qreal prob;
+
+# ifdef _OPENMP
+# pragma omp parallel \
+    shared    (stateVecReal,stateVecImag, opReal,opImag, numAmps, numBlocks, blockSumsRe,blockSumsIm) \
+    private   (index, block, blockEnd, expecRe, expecIm, prob)
+# endif
+    {
+# ifdef _OPENMP
+# pragma omp for schedule (static)
+# endif
+        for (block=0; block<numBlocks; block++) {
+            blockEnd = getReductionBlockEnd(block, numAmps);
+            
+            expecRe = 0;
+            expecIm = 0;
+            for (index=block*REDUCTION_BLOCK_SIZE; index<blockEnd; index++) {
+                prob = stateVecReal[index]*stateVecReal[index] + stateVecImag[index]*stateVecImag[index];
+                expecRe += opReal[index] * prob;
+                expecIm += opImag[index] * prob;
+            }
+            blockSumsRe[block] = expecRe;
+            blockSumsIm[block] = expecIm;
+        }
+    }
+    
+    Complex expec;
+    expec.real = sumReductionBlocks(blockSumsRe, numBlocks);
+    expec.imag = sumReductionBlocks(blockSumsIm, numBlocks);
+    free(blockSumsRe);
+    free(blockSumsIm);
+    return expec;
+}
+
+/** Computes this chunk's contribution to Trace(D rho). Every chunk contains whole 
+ * columns, and the columns of chunk k are exactly those rows (diagonal elements) 
+ * stored in chunk k of op, so no communication is needed. 
+ */
+Complex densmatr_calcExpecDiagonalOpLocal(Qureg qureg, DiagonalOp op) {
+    
+    long long int localCol, diagIndex, block, blockEnd;
+    long long int numCols = op.numElemsPerChunk;
+    long long int densityDim = 1LL << qureg.numQubitsRepresented;
+    long long int colOffset = qureg.chunkId * numCols;
+    long long int numBlocks = getNumReductionBlocks(numCols);
+    qaccum* blockSumsRe = createReductionBlocks(numBlocks);
+    qaccum* blockSumsIm = createReductionBlocks(numBlocks);
+    
+    qreal *stateVecReal = qureg.stateVec.real;
+    qreal *stateVecImag = qureg.stateVec.imag;
+    qreal *opReal = op.real;
+    qreal *opImag = op.imag;
+    
+    qaccum expecRe, expecIm;
+    qreal a, b, c, d;
+
+# ifdef _OPENMP
+# pragma omp parallel \
+    shared    (stateVecReal,stateVecImag, opReal,opImag, numCols, densityDim, colOffset, numBlocks, blockSumsRe,blockSumsIm) \
+    private   (localCol, diagIndex, block, blockEnd, expecRe, expecIm, a,b,c,d)
+# endif
+    {
+# ifdef _OPENMP
+# pragma omp for schedule (static)
+# endif
+        for (block=0; block<numBlocks; block++) {
+            blockEnd = getReductionBlockEnd(block, numCols);
+            
+            expecRe = 0;
+            expecIm = 0;
+            for (localCol=block*REDUCTION_BLOCK_SIZE; localCol<blockEnd; localCol++) {
+                diagIndex = localCol*densityDim + localCol + colOffset;
+                a = stateVecReal[diagIndex];
+                b = stateVecImag[diagIndex];
+                c = opReal[localCol];
+                d = opImag[localCol];
+                
+                expecRe += a*c - b*d;
+                expecIm += a*d + b*c;
+            }
+            blockSumsRe[block] = expecRe;
+            blockSumsIm[block] = expecIm;
+        }
+    }
+    
+    Complex expec;
+    expec.real = sumReductionBlocks(blockSumsRe, numBlocks);
+    expec.imag = sumReductionBlocks(blockSumsIm, numBlocks);
+    free(blockSumsRe);
+    free(blockSumsIm);
+    return expec;
+}
+
 qreal densmatr_findProbabilityOfZeroLocal(Qureg qureg, const int measureQubit) {
     
     // computes first local index containing a diagonal element
@@ -3159,32 +4455,41 @@ qreal densmatr_findProbabilityOfZeroLocal(Qureg qureg, const int measureQubit) {
     long long int visitedDiags;     // number of visited diagonals in this chunk so far
     long long int basisStateInd;    // current diagonal index being considered
     long long int index;            // index in the local chunk
+    long long int block, blockEnd;
+    long long int numBlocks = getNumReductionBlocks(numDiagsInThisChunk);
+    qaccum* blockSums = createReductionBlocks(numBlocks);
     
-    qreal zeroProb = 0;
+    qaccum zeroProb;
     qreal *stateVecReal = qureg.stateVec.real;
     
 # ifdef _OPENMP
 # pragma omp parallel \
-    shared    (localIndNextDiag, numPrevDiags, diagSpacing, stateVecReal, numDiagsInThisChunk) \
-    private   (visitedDiags, basisStateInd, index) \
-    reduction ( +:zeroProb )
+    shared    (localIndNextDiag, numPrevDiags, diagSpacing, stateVecReal, numDiagsInThisChunk, numBlocks, blockSums) \
+    private   (visitedDiags, basisStateInd, index, block, blockEnd, zeroProb)
 # endif 
     {
 # ifdef _OPENMP
 # pragma omp for schedule  (static)
 # endif
-        // sums the diagonal elems of the density matrix where measureQubit=0
-        for (visitedDiags = 0; visitedDiags < numDiagsInThisChunk; visitedDiags++) {
+        for (block = 0; block < numBlocks; block++) {
+            blockEnd = getReductionBlockEnd(block, numDiagsInThisChunk);
             
-            basisStateInd = numPrevDiags + visitedDiags;
-            index = localIndNextDiag + diagSpacing * visitedDiags;
-    
-            if (extractBit(measureQubit, basisStateInd) == 0)
-                zeroProb += stateVecReal[index]; // assume imag[diagonls] ~ 0
-
+            // sums the diagonal elems of the density matrix where measureQubit=0
+            zeroProb = 0;
+            for (visitedDiags = block*REDUCTION_BLOCK_SIZE; visitedDiags < blockEnd; visitedDiags++) {
+                
+                basisStateInd = numPrevDiags + visitedDiags;
+                index = localIndNextDiag + diagSpacing * visitedDiags;
+        
+                if (extractBit(measureQubit, basisStateInd) == 0)
+                    zeroProb += stateVecReal[index]; // assume imag[diagonls] ~ 0
+            }
+            blockSums[block] = zeroProb;
         }
     }
     
+    zeroProb = sumReductionBlocks(blockSums, numBlocks);
+    free(blockSums);
     return zeroProb;
 }
 
@@ -3205,10 +4510,13 @@ qreal statevec_findProbabilityOfZeroLocal (Qureg qureg,
     long long int thisBlock,                                  // current block
          index;                                               // current index for first half block
     // ----- measured probability
-    qreal   totalProbability;                                  // probability (returned) value
+    qaccum  totalProbability;                                  // probability (returned) value
     // ----- temp variables
     long long int thisTask;                                   
     long long int numTasks=qureg.numAmpsPerChunk>>1;
+    long long int block, blockEnd;
+    long long int numBlocks = getNumReductionBlocks(numTasks);
+    qaccum* blockSums = createReductionBlocks(numBlocks);
 
     // ---------------------------------------------------------------- //
     //            dimensions                                            //
@@ -3217,30 +4525,35 @@ qreal statevec_findProbabilityOfZeroLocal (Qureg qureg,
     // and then the number to skip
     sizeBlock     = 2LL * sizeHalfBlock;                         // size of blocks (pairs of measure and skip entries)
 
-    // initialise returned value
-    totalProbability = 0.0;
-
     qreal *stateVecReal = qureg.stateVec.real;
     qreal *stateVecImag = qureg.stateVec.imag;
 
 # ifdef _OPENMP
 # pragma omp parallel \
-    shared    (numTasks,sizeBlock,sizeHalfBlock, stateVecReal,stateVecImag) \
-    private   (thisTask,thisBlock,index) \
-    reduction ( +:totalProbability )
+    shared    (numTasks,sizeBlock,sizeHalfBlock, stateVecReal,stateVecImag, numBlocks,blockSums) \
+    private   (thisTask,thisBlock,index, block,blockEnd, totalProbability)
 # endif 
     {
 # ifdef _OPENMP
 # pragma omp for schedule  (static)
 # endif
-        for (thisTask=0; thisTask<numTasks; thisTask++) {
-            thisBlock = thisTask / sizeHalfBlock;
-            index     = thisBlock*sizeBlock + thisTask%sizeHalfBlock;
+        for (block=0; block<numBlocks; block++) {
+            blockEnd = getReductionBlockEnd(block, numTasks);
+            
+            totalProbability = 0.0;
+            for (thisTask=block*REDUCTION_BLOCK_SIZE; thisTask<blockEnd; thisTask++) {
+                thisBlock = thisTask / sizeHalfBlock;
+                index     = thisBlock*sizeBlock + thisTask%sizeHalfBlock;
 
-            totalProbability += stateVecReal[index]*stateVecReal[index]
-                + stateVecImag[index]*stateVecImag[index];
+                totalProbability += stateVecReal[index]*stateVecReal[index]
+                    + stateVecImag[index]*stateVecImag[index];
+            }
+            blockSums[block] = totalProbability;
         }
     }
+    
+    totalProbability = sumReductionBlocks(blockSums, numBlocks);
+    free(blockSums);
     return totalProbability;
 }
 
@@ -3252,41 +4565,91 @@ qreal statevec_findProbabilityOfZeroLocal (Qureg qureg,
  *  @return probability of qubit measureQubit being zero
  */
 qreal statevec_findProbabilityOfZeroDistributed (Qureg qureg) {
-    // ----- measured probability
-    qreal   totalProbability;                                  // probability (returned) value
-    // ----- temp variables
-    long long int thisTask;                                   // task based approach for expose loop with small granularity
-    long long int numTasks=qureg.numAmpsPerChunk;
-
-    // ---------------------------------------------------------------- //
-    //            find probability                                      //
-    // ---------------------------------------------------------------- //
-
-    // initialise returned value
-    totalProbability = 0.0;
+    
+    // every local amplitude has the measured qubit in the zero state
+    return statevec_calcTotalProbLocal(qureg);
+}
 
+/** Returns the sum of |amp|^2 over the amplitudes in this chunk */
+qreal statevec_calcTotalProbLocal(Qureg qureg) {
+    
+    long long int index, block, blockEnd;
+    long long int numAmps = qureg.numAmpsPerChunk;
+    long long int numBlocks = getNumReductionBlocks(numAmps);
+    qaccum* blockSums = createReductionBlocks(numBlocks);
+    
+    qaccum totalProbability;
     qreal *stateVecReal = qureg.stateVec.real;
     qreal *stateVecImag = qureg.stateVec.imag;
 
 # ifdef _OPENMP
 # pragma omp parallel \
-    shared    (numTasks,stateVecReal,stateVecImag) \
-    private   (thisTask) \
-    reduction ( +:totalProbability )
+    shared    (numAmps,stateVecReal,stateVecImag, numBlocks,blockSums) \
+    private   (index, block,blockEnd, totalProbability)
 # endif
     {
 # ifdef _OPENMP
 # pragma omp for schedule  (static)
 # endif
-        for (thisTask=0; thisTask<numTasks; thisTask++) {
-            totalProbability += stateVecReal[thisTask]*stateVecReal[thisTask]
-                + stateVecImag[thisTask]*stateVecImag[thisTask];
+        for (block=0; block<numBlocks; block++) {
+            blockEnd = getReductionBlockEnd(block, numAmps);
+            
+            totalProbability = 0;
+            for (index=block*REDUCTION_BLOCK_SIZE; index<blockEnd; index++)
+                totalProbability += stateVecReal[index]*stateVecReal[index]
+                    + stateVecImag[index]*stateVecImag[index];
+            blockSums[block] = totalProbability;
         }
     }
-
+    
+    totalProbability = sumReductionBlocks(blockSums, numBlocks);
+    free(blockSums);
     return totalProbability;
 }
 
+/** Returns the sum of the real components of the diagonal elements in this chunk */
+qreal densmatr_calcTotalProbLocal(Qureg qureg) {
+    
+    // the diagonal elements ("diags") have global index (2^n + 1)i for i in [0, 2^n-1]
+    long long int numAmps = qureg.numAmpsPerChunk;
+    long long int diagSpacing = 1LL + (1LL << qureg.numQubitsRepresented);
+    long long int numPrevDiags = (qureg.chunkId>0)? 1+(qureg.chunkId*numAmps)/diagSpacing : 0;
+    long long int localIndNextDiag = (diagSpacing * numPrevDiags) % numAmps;
+    long long int numLocalDiags = (localIndNextDiag < numAmps)? 
+        1 + (numAmps - 1 - localIndNextDiag) / diagSpacing : 0;
+    
+    long long int diag, block, blockEnd;
+    long long int numBlocks = getNumReductionBlocks(numLocalDiags);
+    qaccum* blockSums = createReductionBlocks(numBlocks);
+    
+    qaccum trace;
+    qreal *stateVecReal = qureg.stateVec.real;
+    
+# ifdef _OPENMP
+# pragma omp parallel \
+    shared    (localIndNextDiag,diagSpacing,numLocalDiags, stateVecReal, numBlocks,blockSums) \
+    private   (diag, block,blockEnd, trace)
+# endif
+    {
+# ifdef _OPENMP
+# pragma omp for schedule  (static)
+# endif
+        for (block=0; block<numBlocks; block++) {
+            blockEnd = getReductionBlockEnd(block, numLocalDiags);
+            
+            // does not check imaginary component, by design
+            trace = 0;
+            for (diag=block*REDUCTION_BLOCK_SIZE; diag<blockEnd; diag++)
+                trace += stateVecReal[localIndNextDiag + diag*diagSpacing];
+            blockSums[block] = trace;
+        }
+    }
+    
+    trace = sumReductionBlocks(blockSums, numBlocks);
+    free(blockSums);
+    return trace;
+}
+
 
 
 void statevec_controlledPhaseFlip (Qureg qureg, const int idQubit1, const int idQubit2)
@@ -3608,6 +4971,79 @@ void statevec_swapQubitAmpsDistributed(Qureg qureg, int pairRank, int qb1, int q
     }
 }
 
+/** Sets outVec to be inVec with the bits of every (chunk-local) amplitude index
+ * rearranged, such that bit b of an index into outVec is bit srcBits[b] of the
+ * corresponding index into inVec. This is a single gather pass; outVec is written
+ * contiguously (in the same static schedule as all other kernels) while inVec is read
+ * with a stride set by the permutation. The source index of each amplitude is
+ * assembled from two lookup tables (for the low and high halves of the destination
+ * index) of only O(sqrt(numAmpsPerChunk)) entries, which remain cache resident.
+ * inVec and outVec must not alias.
+ */
+void statevec_permuteAmpsLocal(Qureg qureg, ComplexArray inVec, ComplexArray outVec, int* srcBits) {
+
+    long long int numTasks = qureg.numAmpsPerChunk;
+
+    int numBits = 0;
+    while ((1LL << numBits) < numTasks)
+        numBits++;
+
+    // split destination indices into low and high halves, each with its own table
+    int numLoBits = numBits/2;
+    int numHiBits = numBits - numLoBits;
+    long long int numLoInds = 1LL << numLoBits;
+    long long int numHiInds = 1LL << numHiBits;
+    long long int loMask = numLoInds - 1;
+
+    long long int *loTable = malloc(numLoInds * sizeof *loTable);
+    long long int *hiTable = malloc(numHiInds * sizeof *hiTable);
+    if (!loTable || !hiTable) {
+        printf("Could not allocate memory!");
+        exit (EXIT_FAILURE);
+    }
+
+    long long int ind;
+    int b;
+    for (ind=0; ind<numLoInds; ind++) {
+        loTable[ind] = 0;
+        for (b=0; b<numLoBits; b++)
+            loTable[ind] |= ((long long int) extractBit(b, ind)) << srcBits[b];
+    }
+    for (ind=0; ind<numHiInds; ind++) {
+        hiTable[ind] = 0;
+        for (b=0; b<numHiBits; b++)
+            hiTable[ind] |= ((long long int) extractBit(b, ind)) << srcBits[b + numLoBits];
+    }
+
+    // can't use qureg.stateVec as a private OMP var
+    qreal *inRe = inVec.real;
+    qreal *inIm = inVec.imag;
+    qreal *outRe = outVec.real;
+    qreal *outIm = outVec.imag;
+
+    long long int thisTask, srcInd;
+
+# ifdef _OPENMP
+# pragma omp parallel \
+    default  (none) \
+    shared   (inRe,inIm,outRe,outIm,loTable,hiTable,numTasks,numLoBits,loMask) \
+    private  (thisTask,srcInd)
+# endif
+    {
+# ifdef _OPENMP
+# pragma omp for schedule (static)
+# endif
+        for (thisTask=0; thisTask<numTasks; thisTask++) {
+            srcInd = hiTable[thisTask >> numLoBits] | loTable[thisTask & loMask];
+            outRe[thisTask] = inRe[srcInd];
+            outIm[thisTask] = inIm[srcInd];
+        }
+    }
+
+    free(loTable);
+    free(hiTable);
+}
+
 void statevec_setWeightedQureg(Complex fac1, Qureg qureg1, Complex fac2, Qureg qureg2, Complex facOut, Qureg out) {
 
     long long int numAmps = qureg1.numAmpsPerChunk;
@@ -49,30 +49,21 @@ Complex statevec_calcInnerProduct(Qureg bra, Qureg ket) {
     return globalInnerProd;
 }
 
+void statevec_calcInnerProductsMatrix(Qureg* quregs, int numQuregs, qreal* matrRe, qreal* matrIm) {
+    
+    statevec_calcInnerProductsMatrixLocal(quregs, numQuregs, matrRe, matrIm);
+    if (quregs[0].numChunks == 1)
+        return;
+    
+    int numElems = numQuregs * numQuregs;
+    MPI_Allreduce(MPI_IN_PLACE, matrRe, numElems, MPI_QuEST_REAL, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(MPI_IN_PLACE, matrIm, numElems, MPI_QuEST_REAL, MPI_SUM, MPI_COMM_WORLD);
+}
+
 qreal densmatr_calcTotalProb(Qureg qureg) {
 	
-	// computes the trace by summing every element ("diag") with global index (2^n + 1)i for i in [0, 2^n-1]
-	
-	// computes first local index containing a diagonal element
-	long long int diagSpacing = 1LL + (1LL << qureg.numQubitsRepresented);
-    long long int numPrevDiags = (qureg.chunkId>0)? 1+(qureg.chunkId*qureg.numAmpsPerChunk)/diagSpacing : 0;
-	long long int globalIndNextDiag = diagSpacing * numPrevDiags;
-	long long int localIndNextDiag = globalIndNextDiag % qureg.numAmpsPerChunk;
-	long long int index;
-	
-	qreal rankTotal = 0;
-	qreal y, t, c;
-	c = 0;
-	
-	// iterates every local diagonal
-	for (index=localIndNextDiag; index < qureg.numAmpsPerChunk; index += diagSpacing) {
-		
-		// Kahan summation - brackets are important
-		y = qureg.stateVec.real[index] - c;
-		t = rankTotal + y;
-		c = ( t - rankTotal ) - y;
-		rankTotal = t;
-	}
+	// sums this node's diagonals ("diags"), which have global index (2^n + 1)i for i in [0, 2^n-1]
+	qreal rankTotal = densmatr_calcTotalProbLocal(qureg);
 	
 	// combine each node's sum of diagonals
 	qreal globalTotal;
@@ -85,28 +76,10 @@ qreal densmatr_calcTotalProb(Qureg qureg) {
 }
 
 qreal statevec_calcTotalProb(Qureg qureg){
-    // Implemented using Kahan summation for greater accuracy at a slight floating
-    //   point operation overhead. For more details see https://en.wikipedia.org/wiki/Kahan_summation_algorithm
-    qreal pTotal=0; 
-    qreal y, t, c;
+    
+    // sums in fixed blocks combined pairwise (see sumReductionBlocks), in lieu of Kahan summation
+    qreal pTotal = statevec_calcTotalProbLocal(qureg);
     qreal allRankTotals=0;
-    long long int index;
-    long long int numAmpsPerRank = qureg.numAmpsPerChunk;
-    c = 0.0;
-    for (index=0; index<numAmpsPerRank; index++){ 
-        // Perform pTotal+=qureg.stateVec.real[index]*qureg.stateVec.real[index]; by Kahan
-        y = qureg.stateVec.real[index]*qureg.stateVec.real[index] - c;
-        t = pTotal + y;
-        // Don't change the bracketing on the following line
-        c = ( t - pTotal ) - y;
-        pTotal = t;
-        // Perform pTotal+=qureg.stateVec.imag[index]*qureg.stateVec.imag[index]; by Kahan
-        y = qureg.stateVec.imag[index]*qureg.stateVec.imag[index] - c;
-        t = pTotal + y;
-        // Don't change the bracketing on the following line
-        c = ( t - pTotal ) - y;
-        pTotal = t;
-    } 
     if (qureg.numChunks>1)
 		MPI_Allreduce(&pTotal, &allRankTotals, 1, MPI_QuEST_REAL, MPI_SUM, MPI_COMM_WORLD);
     else 
@@ -166,7 +139,13 @@ int syncQuESTSuccess(int successCode){
     return totalSuccess;
 }
 
+void releaseFreedQuregMemory(QuESTEnv env){
+    releaseAmpArrayPool();
+}
+
 void destroyQuESTEnv(QuESTEnv env){
+    releaseAmpArrayPool();
+    
     int finalized;
     MPI_Finalized(&finalized);
     if (!finalized) MPI_Finalize();
@@ -181,9 +160,11 @@ void reportQuESTEnv(QuESTEnv env){
 # ifdef _OPENMP
         printf("OpenMP enabled\n");
         printf("Number of threads available is %d\n", omp_get_max_threads());
+        reportThreadPlacement();
 # else
         printf("OpenMP disabled\n");
 # endif 
+        reportHugePages();
         printf("Precision: size of qreal is %ld bytes\n", sizeof(qreal) );
     }
 }
@@ -383,7 +364,18 @@ void copyVecIntoMatrixPairState(Qureg matr, Qureg vec) {
     // we now want to share this node's vec segment with other node, so that 
     // vec is cloned in every node's matr.pairStateVec 
 
-    // work out how many messages needed to send vec chunks (2GB limit)
+    // when each node's segment fits in one message, a single gather shares them all
+    if (numLocalAmps <= MPI_MAX_AMPS_IN_MSG) {
+        MPI_Allgather(
+            MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, 
+            matr.pairStateVec.real, numLocalAmps, MPI_QuEST_REAL, MPI_COMM_WORLD);
+        MPI_Allgather(
+            MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, 
+            matr.pairStateVec.imag, numLocalAmps, MPI_QuEST_REAL, MPI_COMM_WORLD);
+        return;
+    }
+
+    // otherwise work out how many messages needed to send vec chunks (2GB limit)
     long long int maxMsgSize = MPI_MAX_AMPS_IN_MSG;
     if (numLocalAmps < maxMsgSize) 
         maxMsgSize = numLocalAmps;
@@ -446,6 +438,14 @@ qreal densmatr_calcInnerProduct(Qureg a, Qureg b) {
     return dist;
 }
 
+void densmatr_calcInnerProductsMatrix(Qureg* quregs, int numQuregs, qreal* matr) {
+    
+    densmatr_calcInnerProductsMatrixLocal(quregs, numQuregs, matr);
+    
+    int numElems = numQuregs * numQuregs;
+    MPI_Allreduce(MPI_IN_PLACE, matr, numElems, MPI_QuEST_REAL, MPI_SUM, MPI_COMM_WORLD);
+}
+
 void densmatr_initPureState(Qureg targetQureg, Qureg copyQureg) {
 
     if (targetQureg.numChunks==1){
@@ -1370,6 +1370,242 @@ void statevec_swapQubitAmps(Qureg qureg, int qb1, int qb2) {
     statevec_swapQubitAmpsDistributed(qureg, pairRank, qb1, qb2);
 }
 
+void statevec_multiRotatePauliByMasks(Qureg qureg, long long int flipMask, long long int phaseMask, qreal cosAngle, Complex sinFac) {
+    
+    // perform locally if every amplitude's partner (under flipMask) is in this chunk
+    if (flipMask < qureg.numAmpsPerChunk)
+        return statevec_multiRotatePauliLocal(qureg, flipMask, phaseMask, cosAngle, sinFac);
+    
+    // else every partner lies in the chunk of a single pair node
+    int pairRank = qureg.chunkId ^ (int) (flipMask / qureg.numAmpsPerChunk);
+    exchangeStateVectors(qureg, pairRank);
+    statevec_multiRotatePauliDistributed(qureg, flipMask, phaseMask, cosAngle, sinFac,
+            qureg.pairStateVec, // in
+            qureg.stateVec); // out
+}
+
+void statevec_addPauliProdsByMask(Qureg inQureg, long long int flipMask, long long int* phaseMasks, Complex* coeffs, int numProds, Qureg outQureg) {
+    
+    // gather locally if every amplitude's partner (under flipMask) is in this chunk
+    if (flipMask < inQureg.numAmpsPerChunk)
+        return statevec_addPauliProdsLocal(outQureg, flipMask, phaseMasks, coeffs, numProds, inQureg.stateVec);
+    
+    // else every partner lies in the chunk of a single pair node, received into inQureg's buffer
+    int pairRank = inQureg.chunkId ^ (int) (flipMask / inQureg.numAmpsPerChunk);
+    exchangeStateVectors(inQureg, pairRank);
+    statevec_addPauliProdsLocal(outQureg, flipMask, phaseMasks, coeffs, numProds, inQureg.pairStateVec);
+}
+
+void statevec_applyDiagonalOp(Qureg qureg, DiagonalOp op) {
+    
+    // op is distributed identically to qureg, so each chunk is independent
+    statevec_applyDiagonalOpLocal(qureg, op);
+}
+
+void densmatr_applyDiagonalOp(Qureg qureg, DiagonalOp op) {
+    
+    // every chunk contains whole columns, so needs every row's diagonal element
+    if (qureg.numChunks == 1)
+        return densmatr_applyDiagonalOpLocal(qureg, op);
+    
+    // gather the full diagonal into pairStateVec, which (holding a whole column) is large enough
+    MPI_Allgather(op.real, op.numElemsPerChunk, MPI_QuEST_REAL, 
+        qureg.pairStateVec.real, op.numElemsPerChunk, MPI_QuEST_REAL, MPI_COMM_WORLD);
+    MPI_Allgather(op.imag, op.numElemsPerChunk, MPI_QuEST_REAL, 
+        qureg.pairStateVec.imag, op.numElemsPerChunk, MPI_QuEST_REAL, MPI_COMM_WORLD);
+    
+    DiagonalOp fullOp = op;
+    fullOp.real = qureg.pairStateVec.real;
+    fullOp.imag = qureg.pairStateVec.imag;
+    densmatr_applyDiagonalOpLocal(qureg, fullOp);
+}
+
+/** Combines the chunks' contributions to an expectation value in a single reduction */
+static Complex reduceComplexSum(Complex localSum) {
+    
+    qreal localVals[2] = {localSum.real, localSum.imag};
+    qreal globalVals[2];
+    MPI_Allreduce(localVals, globalVals, 2, MPI_QuEST_REAL, MPI_SUM, MPI_COMM_WORLD);
+    
+    Complex globalSum;
+    globalSum.real = globalVals[0];
+    globalSum.imag = globalVals[1];
+    return globalSum;
+}
+
+Complex statevec_calcExpecDiagonalOp(Qureg qureg, DiagonalOp op) {
+    
+    Complex localExpec = statevec_calcExpecDiagonalOpLocal(qureg, op);
+    if (qureg.numChunks == 1)
+        return localExpec;
+    
+    return reduceComplexSum(localExpec);
+}
+
+Complex densmatr_calcExpecDiagonalOp(Qureg qureg, DiagonalOp op) {
+    
+    Complex localExpec = densmatr_calcExpecDiagonalOpLocal(qureg, op);
+    if (qureg.numChunks == 1)
+        return localExpec;
+    
+    return reduceComplexSum(localExpec);
+}
+
+/** Rearranges the chunk-local amplitudes of qureg.stateVec (via qureg.pairStateVec)
+ * such that bit b of each new local index is bit srcBits[b] of its old local index
+ */
+static void permuteLocalAmpsInPlace(Qureg qureg, int* srcBits) {
+    size_t arrSize = qureg.numAmpsPerChunk * sizeof *(qureg.stateVec.real);
+    memcpy(qureg.pairStateVec.real, qureg.stateVec.real, arrSize);
+    memcpy(qureg.pairStateVec.imag, qureg.stateVec.imag, arrSize);
+    statevec_permuteAmpsLocal(qureg, qureg.pairStateVec, qureg.stateVec, srcBits);
+}
+
+/** Moves qubit q to position perm[q], with at most one all-to-all exchange.
+ * The m local qubits which must become global (rank) qubits are first gathered
+ * into the top m local bit positions, so that each chunk divides into 2^m contiguous
+ * blocks, each destined for a single rank. A single MPI_Alltoallv then swaps these
+ * with the m global qubits which must become local (and simultaneously relabels any
+ * global qubits which stay global), after which a final local gather places every
+ * local qubit in its requested position. This replaces the O(numQubits) sequential
+ * pairwise exchanges of a chain of swap gates.
+ */
+void statevec_permuteQubits(Qureg qureg, int* perm) {
+
+    int numQb = qureg.numQubitsInStateVec;
+    int numLocalQb = 0;
+    while ((1LL << numLocalQb) < qureg.numAmpsPerChunk)
+        numLocalQb++;
+
+    // inverse perm: invPerm[p] is the qubit moved to position p
+    int invPerm[8*sizeof(long long int)];
+    for (int q=0; q < numQb; q++)
+        invPerm[perm[q]] = q;
+
+    // qubits crossing the local/global boundary (ordered by their original position)
+    int toGlobal[8*sizeof(long long int)];
+    int toLocal[8*sizeof(long long int)];
+    int numToGlobal = 0;
+    int numToLocal = 0;
+    int ranksRelabelled = 0;
+    for (int q=0; q < numQb; q++) {
+        if (q < numLocalQb && perm[q] >= numLocalQb)
+            toGlobal[numToGlobal++] = q;
+        if (q >= numLocalQb && perm[q] < numLocalQb)
+            toLocal[numToLocal++] = q;
+        if (q >= numLocalQb && perm[q] >= numLocalQb && perm[q] != q)
+            ranksRelabelled = 1;
+    }
+
+    int srcBits[8*sizeof(long long int)];
+
+    // if only local qubits are permuted amongst themselves, no communication is needed
+    if (numToGlobal == 0 && !ranksRelabelled) {
+        for (int p=0; p < numLocalQb; p++)
+            srcBits[p] = invPerm[p];
+        permuteLocalAmpsInPlace(qureg, srcBits);
+        return;
+    }
+
+    // gather the to-be-global qubits into the top local positions (retaining the order
+    // of the remaining local qubits below them), directly into pairStateVec
+    int numStayLocal = numLocalQb - numToGlobal;
+    int layout[8*sizeof(long long int)]; // layout[p] is the qubit at local position p
+    int ind = 0;
+    for (int q=0; q < numLocalQb; q++)
+        if (perm[q] < numLocalQb)
+            layout[ind++] = q;
+    for (int j=0; j < numToGlobal; j++)
+        layout[numStayLocal + j] = toGlobal[j];
+    statevec_permuteAmpsLocal(qureg, qureg.stateVec, qureg.pairStateVec, layout);
+
+    // every chunk now comprises 2^numToGlobal contiguous blocks, each sent to one rank
+    long long int numAmpsPerBlock = qureg.numAmpsPerChunk >> numToGlobal;
+    int numBlocks = 1 << numToGlobal;
+
+    // MPI counts are ints, so blocks are sent as a number of (at most 2GB) messages
+    long long int maxMessageCount = MPI_MAX_AMPS_IN_MSG;
+    if (numAmpsPerBlock < maxMessageCount)
+        maxMessageCount = numAmpsPerBlock;
+    int numMessagesPerBlock = numAmpsPerBlock / maxMessageCount;
+    MPI_Datatype messageType;
+    MPI_Type_contiguous(maxMessageCount, MPI_QuEST_REAL, &messageType);
+    MPI_Type_commit(&messageType);
+
+    int *sendCounts = calloc(qureg.numChunks, sizeof *sendCounts);
+    int *sendDispls = calloc(qureg.numChunks, sizeof *sendDispls);
+    int *recvCounts = calloc(qureg.numChunks, sizeof *recvCounts);
+    int *recvDispls = calloc(qureg.numChunks, sizeof *recvDispls);
+    if (!sendCounts || !sendDispls || !recvCounts || !recvDispls) {
+        printf("Could not allocate memory!");
+        exit (EXIT_FAILURE);
+    }
+
+    for (int block=0; block < numBlocks; block++) {
+
+        // block (with top local bits = block) is sent to the rank whose bit at each global
+        // position matches that of the qubit moved there
+        int destRank = 0;
+        int srcRank = 0;
+        for (int p=numLocalQb; p < numQb; p++) {
+            int q = invPerm[p];
+            int bit;
+            if (q >= numLocalQb)
+                bit = extractBit(q - numLocalQb, qureg.chunkId);
+            else {
+                int j = 0;
+                while (toGlobal[j] != q)
+                    j++;
+                bit = extractBit(j, block);
+            }
+            destRank |= bit << (p - numLocalQb);
+        }
+        sendCounts[destRank] = numMessagesPerBlock;
+        sendDispls[destRank] = block * numMessagesPerBlock;
+
+        // and block (with the to-be-local qubits now above the remaining local qubits)
+        // is received from the rank whose global bits produce this rank's
+        for (int q=numLocalQb; q < numQb; q++) {
+            int bit;
+            if (perm[q] >= numLocalQb)
+                bit = extractBit(perm[q] - numLocalQb, qureg.chunkId);
+            else {
+                int j = 0;
+                while (toLocal[j] != q)
+                    j++;
+                bit = extractBit(j, block);
+            }
+            srcRank |= bit << (q - numLocalQb);
+        }
+        recvCounts[srcRank] = numMessagesPerBlock;
+        recvDispls[srcRank] = block * numMessagesPerBlock;
+    }
+
+    MPI_Alltoallv(
+        qureg.pairStateVec.real, sendCounts, sendDispls, messageType,
+        qureg.stateVec.real,     recvCounts, recvDispls, messageType, MPI_COMM_WORLD);
+    MPI_Alltoallv(
+        qureg.pairStateVec.imag, sendCounts, sendDispls, messageType,
+        qureg.stateVec.imag,     recvCounts, recvDispls, messageType, MPI_COMM_WORLD);
+
+    MPI_Type_free(&messageType);
+    free(sendCounts);
+    free(sendDispls);
+    free(recvCounts);
+    free(recvDispls);
+
+    // the top local positions now hold the to-be-local qubits; place all local qubits
+    for (int j=0; j < numToLocal; j++)
+        layout[numStayLocal + j] = toLocal[j];
+    for (int p=0; p < numLocalQb; p++) {
+        int pos = 0;
+        while (layout[pos] != invPerm[p])
+            pos++;
+        srcBits[p] = pos;
+    }
+    permuteLocalAmpsInPlace(qureg, srcBits);
+}
+
 /** This calls swapQubitAmps only when it would involve a distributed communication;
  * if the qubit chunks already fit in the node, it operates the unitary direct.
  * Note the order of q1 and q2 in the call to twoQubitUnitaryLocal is important.
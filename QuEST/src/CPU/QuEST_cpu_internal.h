@@ -15,6 +15,18 @@
 
 # include "QuEST_precision.h"
 
+# include <stddef.h>
+
+/*
+ * The type in which reductions (sums over amplitudes) accumulate their partial sums.
+ * Single precision quregs accumulate in double, while double precision quregs keep a 
+ * (vectorisable) double accumulator and rely on the blocked, pairwise summation
+ */
+# if QuEST_PREC==4
+    # define qaccum long double
+# else
+    # define qaccum double
+# endif
 
 /*
 * Bit twiddling functions are defined seperately here in the CPU backend, 
@@ -67,8 +79,16 @@ qreal densmatr_calcHilbertSchmidtDistanceSquaredLocal(Qureg a, Qureg b);
 
 qreal densmatr_calcInnerProductLocal(Qureg a, Qureg b);
 
+void densmatr_calcInnerProductsMatrixLocal(Qureg* quregs, int numQuregs, qreal* matr);
+
+void densmatr_applyDiagonalOpLocal(Qureg qureg, DiagonalOp op);
+
+Complex densmatr_calcExpecDiagonalOpLocal(Qureg qureg, DiagonalOp op);
+
 qreal densmatr_findProbabilityOfZeroLocal(Qureg qureg, const int measureQubit);
 
+qreal densmatr_calcTotalProbLocal(Qureg qureg);
+
 void densmatr_mixDepolarisingLocal(Qureg qureg, const int targetQubit, qreal depolLevel);
 
 void densmatr_mixDepolarisingDistributed(Qureg qureg, const int targetQubit, qreal depolLevel);
@@ -94,6 +114,8 @@ void densmatr_mixTwoQubitDepolarisingQ1LocalQ2DistributedPart3(Qureg qureg, cons
 
 Complex statevec_calcInnerProductLocal(Qureg bra, Qureg ket);
 
+void statevec_calcInnerProductsMatrixLocal(Qureg* quregs, int numQuregs, qreal* matrRe, qreal* matrIm);
+
 void statevec_compactUnitaryLocal (Qureg qureg, const int targetQubit, Complex alpha, Complex beta);
 
 void statevec_compactUnitaryDistributed (Qureg qureg,
@@ -102,6 +124,10 @@ void statevec_compactUnitaryDistributed (Qureg qureg,
         ComplexArray stateVecLo,
         ComplexArray stateVecOut);
 
+void statevec_applyDiagonalOpLocal(Qureg qureg, DiagonalOp op);
+
+Complex statevec_calcExpecDiagonalOpLocal(Qureg qureg, DiagonalOp op);
+
 void statevec_unitaryLocal(Qureg qureg, const int targetQubit, ComplexMatrix2 u);
 
 void statevec_unitaryDistributed (Qureg qureg,
@@ -174,6 +200,8 @@ qreal statevec_findProbabilityOfZeroLocal (Qureg qureg, const int measureQubit);
 
 qreal statevec_findProbabilityOfZeroDistributed (Qureg qureg);
 
+qreal statevec_calcTotalProbLocal(Qureg qureg);
+
 void statevec_collapseToKnownProbOutcomeLocal(Qureg qureg, int measureQubit, int outcome, qreal totalProbability);
 
 void statevec_collapseToKnownProbOutcomeDistributedRenorm (Qureg qureg, const int measureQubit, const qreal totalProbability);
@@ -184,9 +212,46 @@ void statevec_swapQubitAmpsLocal(Qureg qureg, int qb1, int qb2);
 
 void statevec_swapQubitAmpsDistributed(Qureg qureg, int pairRank, int qb1, int qb2);
 
+void statevec_permuteAmpsLocal(Qureg qureg, ComplexArray inVec, ComplexArray outVec, int* srcBits);
+
+void statevec_multiRotatePauliLocal(Qureg qureg, long long int flipMask, long long int phaseMask, qreal cosAngle, Complex sinFac);
+
+void statevec_multiRotatePauliDistributed(Qureg qureg, long long int flipMask, long long int phaseMask, qreal cosAngle, Complex sinFac,
+        ComplexArray stateVecIn,
+        ComplexArray stateVecOut);
+
+void statevec_addPauliProdsLocal(Qureg outQureg, long long int flipMask, long long int* phaseMasks, Complex* coeffs, int numProds,
+        ComplexArray stateVecIn);
+
 void statevec_multiControlledTwoQubitUnitaryLocal(Qureg qureg, long long int ctrlMask, const int q1, const int q2, ComplexMatrix4 u);
 
 void statevec_multiControlledMultiQubitUnitaryLocal(Qureg qureg, long long int ctrlMask, int* targs, const int numTargs, ComplexMatrixN u);
 
 
+/*
+ * reductions
+ */
+
+long long int getNumReductionBlocks(long long int numTerms);
+
+long long int getReductionBlockEnd(long long int block, long long int numTerms);
+
+qaccum sumReductionBlocks(qaccum* blockSums, long long int numBlocks);
+
+
+/*
+ * amplitude array allocation
+ */
+
+qreal* allocAmpArray(size_t numBytes);
+
+void freeAmpArray(qreal* arr, size_t numBytes);
+
+void releaseAmpArrayPool(void);
+
+void reportThreadPlacement(void);
+
+void reportHugePages(void);
+
+
 # endif // QUEST_CPU_INTERNAL_H
@@ -18,6 +18,7 @@
 
 # include <stdlib.h>
 # include <stdio.h>
+# include <string.h>    // for memcpy
 # include <math.h>
 # include <time.h>
 # include <sys/types.h>
@@ -65,6 +66,10 @@ qreal densmatr_calcHilbertSchmidtDistance(Qureg a, Qureg b) {
     return dist;
 }
 
+void densmatr_calcInnerProductsMatrix(Qureg* quregs, int numQuregs, qreal* matr) {
+    densmatr_calcInnerProductsMatrixLocal(quregs, numQuregs, matr);
+}
+
 qreal densmatr_calcInnerProduct(Qureg a, Qureg b) {
     
     qreal scalar = densmatr_calcInnerProductLocal(a, b);
@@ -113,57 +118,20 @@ Complex statevec_calcInnerProduct(Qureg bra, Qureg ket) {
     return statevec_calcInnerProductLocal(bra, ket);
 }
 
+void statevec_calcInnerProductsMatrix(Qureg* quregs, int numQuregs, qreal* matrRe, qreal* matrIm) {
+    statevec_calcInnerProductsMatrixLocal(quregs, numQuregs, matrRe, matrIm);
+}
+
 qreal densmatr_calcTotalProb(Qureg qureg) {
     
-    // computes the trace using Kahan summation
-    qreal pTotal=0;
-    qreal y, t, c;
-    c = 0;
-    
-    long long int numCols = 1LL << qureg.numQubitsRepresented;
-    long long diagIndex;
-    
-    for (int col=0; col< numCols; col++) {
-        diagIndex = col*(numCols + 1);
-        y = qureg.stateVec.real[diagIndex] - c;
-        t = pTotal + y;
-        c = ( t - pTotal ) - y; // brackets are important
-        pTotal = t;
-    }
-    
     // does not check imaginary component, by design
-        
-    return pTotal;
+    return densmatr_calcTotalProbLocal(qureg);
 }
 
 qreal statevec_calcTotalProb(Qureg qureg){
-    // implemented using Kahan summation for greater accuracy at a slight floating
-    // point operation overhead. For more details see https://en.wikipedia.org/wiki/Kahan_summation_algorithm
-    qreal pTotal=0; 
-    qreal y, t, c;
-    long long int index;
-    long long int numAmpsPerRank = qureg.numAmpsPerChunk;
-    c = 0.0;
-    for (index=0; index<numAmpsPerRank; index++){ 
-        // Perform pTotal+=qureg.stateVec.real[index]*qureg.stateVec.real[index]; by Kahan
-
-        y = qureg.stateVec.real[index]*qureg.stateVec.real[index] - c;
-        t = pTotal + y;
-        // Don't change the bracketing on the following line
-        c = ( t - pTotal ) - y;
-        pTotal = t;
-
-        // Perform pTotal+=qureg.stateVec.imag[index]*qureg.stateVec.imag[index]; by Kahan
-
-        y = qureg.stateVec.imag[index]*qureg.stateVec.imag[index] - c;
-        t = pTotal + y;
-        // Don't change the bracketing on the following line
-        c = ( t - pTotal ) - y;
-        pTotal = t;
-
-
-    } 
-    return pTotal;
+    
+    // sums in fixed blocks combined pairwise (see sumReductionBlocks), in lieu of Kahan summation
+    return statevec_calcTotalProbLocal(qureg);
 }
 
 
@@ -187,7 +155,13 @@ int syncQuESTSuccess(int successCode){
     return successCode;
 }
 
+void releaseFreedQuregMemory(QuESTEnv env){
+    releaseAmpArrayPool();
+}
+
 void destroyQuESTEnv(QuESTEnv env){
+    releaseAmpArrayPool();
+    
     // MPI finalize goes here in MPI version. Call this function anyway for consistency
 }
 
@@ -198,9 +172,11 @@ void reportQuESTEnv(QuESTEnv env){
 # ifdef _OPENMP
     printf("OpenMP enabled\n");
     printf("Number of threads available is %d\n", omp_get_max_threads());
+    reportThreadPlacement();
 # else
     printf("OpenMP disabled\n");
 # endif
+    reportHugePages();
     printf("Precision: size of qreal is %ld bytes\n", sizeof(qreal));
 }
 
@@ -321,3 +297,58 @@ void statevec_swapQubitAmps(Qureg qureg, int qb1, int qb2)
 {
     statevec_swapQubitAmpsLocal(qureg, qb1, qb2);
 }
+
+void statevec_multiRotatePauliByMasks(Qureg qureg, long long int flipMask, long long int phaseMask, qreal cosAngle, Complex sinFac)
+{
+    statevec_multiRotatePauliLocal(qureg, flipMask, phaseMask, cosAngle, sinFac);
+}
+
+void statevec_addPauliProdsByMask(Qureg inQureg, long long int flipMask, long long int* phaseMasks, Complex* coeffs, int numProds, Qureg outQureg)
+{
+    statevec_addPauliProdsLocal(outQureg, flipMask, phaseMasks, coeffs, numProds, inQureg.stateVec);
+}
+
+void statevec_applyDiagonalOp(Qureg qureg, DiagonalOp op)
+{
+    statevec_applyDiagonalOpLocal(qureg, op);
+}
+
+void densmatr_applyDiagonalOp(Qureg qureg, DiagonalOp op)
+{
+    densmatr_applyDiagonalOpLocal(qureg, op);
+}
+
+Complex statevec_calcExpecDiagonalOp(Qureg qureg, DiagonalOp op)
+{
+    return statevec_calcExpecDiagonalOpLocal(qureg, op);
+}
+
+Complex densmatr_calcExpecDiagonalOp(Qureg qureg, DiagonalOp op)
+{
+    return densmatr_calcExpecDiagonalOpLocal(qureg, op);
+}
+
+void statevec_permuteQubits(Qureg qureg, int* perm)
+{
+    // qubit q moves to position perm[q], so is found there by the gather
+    int srcBits[8*sizeof(long long int)];
+    for (int q=0; q < qureg.numQubitsInStateVec; q++)
+        srcBits[perm[q]] = q;
+    
+    // there is no pairStateVec in the single-node build, so copy the state aside
+    size_t arrSize = qureg.numAmpsPerChunk * sizeof *(qureg.stateVec.real);
+    ComplexArray copyVec;
+    copyVec.real = malloc(arrSize);
+    copyVec.imag = malloc(arrSize);
+    if (!(copyVec.real) || !(copyVec.imag)) {
+        printf("Could not allocate memory!");
+        exit (EXIT_FAILURE);
+    }
+    memcpy(copyVec.real, qureg.stateVec.real, arrSize);
+    memcpy(copyVec.imag, qureg.stateVec.imag, arrSize);
+    
+    statevec_permuteAmpsLocal(qureg, copyVec, qureg.stateVec, srcBits);
+    
+    free(copyVec.real);
+    free(copyVec.imag);
+}
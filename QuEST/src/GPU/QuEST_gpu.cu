@@ -305,6 +305,7 @@ void statevec_createQureg(Qureg *qureg, int numQubits, QuESTEnv env)
     qureg->chunkId = env.rank;
     qureg->numChunks = env.numRanks;
     qureg->isDensityMatrix = 0;
+    qureg->isDiskBacked = 0;
 
     // allocate GPU memory
     cudaMalloc(&(qureg->deviceStateVec.real), qureg->numAmpsPerChunk*sizeof(*(qureg->deviceStateVec.real)));
@@ -321,6 +322,12 @@ void statevec_createQureg(Qureg *qureg, int numQubits, QuESTEnv env)
 
 }
 
+int statevec_createDiskQureg(Qureg *qureg, int numQubits, char* filename, QuESTEnv env)
+{
+    // amplitudes must reside in GPU memory, so cannot be backed by a file
+    return 0;
+}
+
 void statevec_destroyQureg(Qureg qureg, QuESTEnv env)
 {
     // Free CPU memory
@@ -335,6 +342,77 @@ void statevec_destroyQureg(Qureg qureg, QuESTEnv env)
     cudaFree(qureg.deviceStateVec.real);
     cudaFree(qureg.deviceStateVec.imag);
 }
+DiagonalOp agnostic_createDiagonalOp(int numQubits, QuESTEnv env) {
+
+    DiagonalOp op;
+    op.numQubits = numQubits;
+    op.numElemsPerChunk = (1LL << numQubits) / env.numRanks;
+    op.chunkId = env.rank;
+    op.numChunks = env.numRanks;
+    
+    // allocate CPU memory (initialised to zero)
+    op.real = (qreal*) calloc(op.numElemsPerChunk, sizeof(qreal));
+    op.imag = (qreal*) calloc(op.numElemsPerChunk, sizeof(qreal));
+    
+    // check CPU memory allocation was successful
+    if ( !op.real || !op.imag ) {
+        printf("Could not allocate memory!\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    // allocate GPU memory
+    size_t arrSize = op.numElemsPerChunk * sizeof(qreal);
+    cudaMalloc(&(op.deviceOperator.real), arrSize);
+    cudaMalloc(&(op.deviceOperator.imag), arrSize);
+    
+    // check gpu memory allocation was successful
+    if (!op.deviceOperator.real || !op.deviceOperator.imag) {
+        printf("Could not allocate memory on GPU!\n");
+        exit(EXIT_FAILURE);
+    }
+    
+    // initialise GPU memory to zero
+    cudaMemset(op.deviceOperator.real, 0, arrSize);
+    cudaMemset(op.deviceOperator.imag, 0, arrSize);
+    
+    return op;
+}
+
+void agnostic_destroyDiagonalOp(DiagonalOp op) {
+    free(op.real);
+    free(op.imag);
+    cudaFree(op.deviceOperator.real);
+    cudaFree(op.deviceOperator.imag);
+}
+
+void agnostic_syncDiagonalOp(DiagonalOp op) {
+    cudaDeviceSynchronize();
+    size_t mem_elems = op.numElemsPerChunk * sizeof *op.real;
+    cudaMemcpy(op.deviceOperator.real, op.real, mem_elems, cudaMemcpyHostToDevice);
+    cudaMemcpy(op.deviceOperator.imag, op.imag, mem_elems, cudaMemcpyHostToDevice);
+}
+
+void agnostic_setDiagonalOpElems(DiagonalOp op, long long int startInd, qreal* real, qreal* imag, long long int numElems) {
+    
+    // update both the CPU copy (so it remains consistent) and the GPU copy
+    for (long long int i=0; i<numElems; i++) {
+        op.real[startInd + i] = real[i];
+        op.imag[startInd + i] = imag[i];
+    }
+    
+    cudaDeviceSynchronize();
+    cudaMemcpy(
+        op.deviceOperator.real + startInd, 
+        real,
+        numElems * sizeof(*(op.deviceOperator.real)), 
+        cudaMemcpyHostToDevice);
+    cudaMemcpy(
+        op.deviceOperator.imag + startInd,
+        imag,
+        numElems * sizeof(*(op.deviceOperator.imag)), 
+        cudaMemcpyHostToDevice);
+}
+
 
 int GPUExists(void){
     int deviceCount, device;
@@ -377,6 +455,10 @@ int syncQuESTSuccess(int successCode){
     return successCode;
 }
 
+void releaseFreedQuregMemory(QuESTEnv env){
+    // GPU memory is freed immediately by destroyQureg
+}
+
 void destroyQuESTEnv(QuESTEnv env){
     // MPI finalize goes here in MPI version. Call this function anyway for consistency
 }
@@ -409,6 +491,7 @@ void copyStateToGPU(Qureg qureg)
 
 void copyStateFromGPU(Qureg qureg)
 {
+    statevec_commitLazyFactor(qureg);
     cudaDeviceSynchronize();
     if (DEBUG) printf("Copying data from GPU\n");
     cudaMemcpy(qureg.stateVec.real, qureg.deviceStateVec.real, 
@@ -1476,6 +1559,408 @@ void statevec_multiRotateZ(Qureg qureg, long long int mask, qreal angle)
     CUDABlocks = ceil((qreal)(qureg.numAmpsPerChunk)/threadsPerCUDABlock);
     statevec_multiRotateZKernel<<<CUDABlocks, threadsPerCUDABlock>>>(qureg, mask, cosAngle, sinAngle);
 }
+
+__global__ void statevec_applyPhaseFuncOverridesKernel(
+    Qureg qureg, int* qubits, int numQubits, int isSigned,
+    qreal* coeffs, qreal* exponents, int numTerms, 
+    long long int* overrideInds, qreal* overridePhases, int numOverrides,
+    int conj
+) {
+    long long int index = blockIdx.x*blockDim.x + threadIdx.x;
+    if (index>=qureg.numAmpsPerChunk) return;
+    
+    // determine the sub-register value encoded by this basis state
+    long long int phaseInd = 0LL;
+    for (int q=0; q<numQubits; q++)
+        phaseInd += ((index >> qubits[q]) & 1LL) << q;
+    if (isSigned && phaseInd >= (1LL << (numQubits-1)))
+        phaseInd -= (1LL << numQubits);
+    
+    // the first matching override (if any) replaces the phase function
+    int i;
+    for (i=0; i<numOverrides; i++)
+        if (phaseInd == overrideInds[i])
+            break;
+    
+    qreal phase = 0;
+    if (i < numOverrides)
+        phase = overridePhases[i];
+    else
+        for (int t=0; t<numTerms; t++)
+            phase += coeffs[t] * pow((qreal) phaseInd, exponents[t]);
+    if (conj)
+        phase = - phase;
+    
+    qreal c = cos(phase);
+    qreal s = sin(phase);
+    qreal re = qureg.deviceStateVec.real[index];
+    qreal im = qureg.deviceStateVec.imag[index];
+    
+    // (re + im i)(c + s i)
+    qureg.deviceStateVec.real[index] = re*c - im*s;
+    qureg.deviceStateVec.imag[index] = re*s + im*c;
+}
+
+void statevec_applyPhaseFuncOverrides(
+    Qureg qureg, int* qubits, int numQubits, enum bitEncoding encoding,
+    qreal* coeffs, qreal* exponents, int numTerms, 
+    long long int* overrideInds, qreal* overridePhases, int numOverrides,
+    int conj
+) {
+    // copy the function specification to device memory
+    int* d_qubits;
+    qreal *d_coeffs, *d_exponents, *d_overridePhases;
+    long long int* d_overrideInds;
+    size_t qubitsMemSize = numQubits * sizeof *d_qubits;
+    size_t termsMemSize = numTerms * sizeof *d_coeffs;
+    size_t overrideIndsMemSize = numOverrides * sizeof *d_overrideInds;
+    size_t overridePhasesMemSize = numOverrides * sizeof *d_overridePhases;
+    cudaMalloc(&d_qubits, qubitsMemSize);
+    cudaMalloc(&d_coeffs, termsMemSize);
+    cudaMalloc(&d_exponents, termsMemSize);
+    cudaMalloc(&d_overrideInds, overrideIndsMemSize);
+    cudaMalloc(&d_overridePhases, overridePhasesMemSize);
+    cudaMemcpy(d_qubits, qubits, qubitsMemSize, cudaMemcpyHostToDevice);
+    cudaMemcpy(d_coeffs, coeffs, termsMemSize, cudaMemcpyHostToDevice);
+    cudaMemcpy(d_exponents, exponents, termsMemSize, cudaMemcpyHostToDevice);
+    cudaMemcpy(d_overrideInds, overrideInds, overrideIndsMemSize, cudaMemcpyHostToDevice);
+    cudaMemcpy(d_overridePhases, overridePhases, overridePhasesMemSize, cudaMemcpyHostToDevice);
+    
+    int isSigned = (encoding == TWOS_COMPLEMENT);
+    
+    int threadsPerCUDABlock, CUDABlocks;
+    threadsPerCUDABlock = 128;
+    CUDABlocks = ceil((qreal)(qureg.numAmpsPerChunk)/threadsPerCUDABlock);
+    statevec_applyPhaseFuncOverridesKernel<<<CUDABlocks, threadsPerCUDABlock>>>(
+        qureg, d_qubits, numQubits, isSigned, d_coeffs, d_exponents, numTerms, 
+        d_overrideInds, d_overridePhases, numOverrides, conj);
+    
+    cudaFree(d_qubits);
+    cudaFree(d_coeffs);
+    cudaFree(d_exponents);
+    cudaFree(d_overrideInds);
+    cudaFree(d_overridePhases);
+}
+
+__global__ void statevec_applyPhaseFuncTableKernel(Qureg qureg, int* qubits, int numQubits, qreal* phases, int conj) {
+    
+    long long int index = blockIdx.x*blockDim.x + threadIdx.x;
+    if (index>=qureg.numAmpsPerChunk) return;
+    
+    // the table is indexed by the unsigned value of the sub-register
+    long long int phaseInd = 0LL;
+    for (int q=0; q<numQubits; q++)
+        phaseInd += ((index >> qubits[q]) & 1LL) << q;
+    
+    qreal phase = (conj)? - phases[phaseInd] : phases[phaseInd];
+    qreal c = cos(phase);
+    qreal s = sin(phase);
+    qreal re = qureg.deviceStateVec.real[index];
+    qreal im = qureg.deviceStateVec.imag[index];
+    
+    qureg.deviceStateVec.real[index] = re*c - im*s;
+    qureg.deviceStateVec.imag[index] = re*s + im*c;
+}
+
+void statevec_applyPhaseFuncTable(Qureg qureg, int* qubits, int numQubits, qreal* phases, int conj) 
+{
+    // copy the qubits and table to device memory
+    int* d_qubits;
+    qreal* d_phases;
+    size_t qubitsMemSize = numQubits * sizeof *d_qubits;
+    size_t phasesMemSize = (1LL << numQubits) * sizeof *d_phases;
+    cudaMalloc(&d_qubits, qubitsMemSize);
+    cudaMalloc(&d_phases, phasesMemSize);
+    cudaMemcpy(d_qubits, qubits, qubitsMemSize, cudaMemcpyHostToDevice);
+    cudaMemcpy(d_phases, phases, phasesMemSize, cudaMemcpyHostToDevice);
+    
+    int threadsPerCUDABlock, CUDABlocks;
+    threadsPerCUDABlock = 128;
+    CUDABlocks = ceil((qreal)(qureg.numAmpsPerChunk)/threadsPerCUDABlock);
+    statevec_applyPhaseFuncTableKernel<<<CUDABlocks, threadsPerCUDABlock>>>(
+        qureg, d_qubits, numQubits, d_phases, conj);
+    
+    cudaFree(d_qubits);
+    cudaFree(d_phases);
+}
+
+__global__ void statevec_applyFourierStageKernel(Qureg qureg, int* qubits, int stage, int conj) {
+    
+    long long int numTasks = qureg.numAmpsPerChunk >> 1;
+    long long int thisTask = blockIdx.x*blockDim.x + threadIdx.x;
+    if (thisTask>=numTasks) return;
+    
+    qreal *stateVecReal = qureg.deviceStateVec.real;
+    qreal *stateVecImag = qureg.deviceStateVec.imag;
+    
+    long long int indU = insertZeroBit(thisTask, qubits[stage]);
+    long long int indV = flipBit(indU, qubits[stage]);
+    
+    // twiddle from the value of the sub-register qubits below this stage's
+    long long int lowVal = 0LL;
+    for (int q=0; q<stage; q++)
+        lowVal += ((indU >> qubits[q]) & 1LL) << q;
+    qreal phase = ((conj)? -1 : 1) * QUEST_PI * lowVal / (1LL << stage);
+    qreal c = cos(phase);
+    qreal s = sin(phase);
+    
+    qreal recRoot2 = 1.0/sqrt(2.0);
+    qreal reU = stateVecReal[indU];
+    qreal imU = stateVecImag[indU];
+    qreal reV = stateVecReal[indV];
+    qreal imV = stateVecImag[indV];
+    qreal reDif = recRoot2*(reU - reV);
+    qreal imDif = recRoot2*(imU - imV);
+    
+    stateVecReal[indU] = recRoot2*(reU + reV);
+    stateVecImag[indU] = recRoot2*(imU + imV);
+    stateVecReal[indV] = reDif*c - imDif*s;
+    stateVecImag[indV] = reDif*s + imDif*c;
+}
+
+void statevec_applyFourierStages(Qureg qureg, int* qubits, int topStage, int numStages, int conj)
+{
+    // the device has ample bandwidth for a pass per stage
+    int* d_qubits;
+    size_t qubitsMemSize = (topStage + 1) * sizeof *d_qubits;
+    cudaMalloc(&d_qubits, qubitsMemSize);
+    cudaMemcpy(d_qubits, qubits, qubitsMemSize, cudaMemcpyHostToDevice);
+    
+    int threadsPerCUDABlock, CUDABlocks;
+    threadsPerCUDABlock = 128;
+    CUDABlocks = ceil((qreal)(qureg.numAmpsPerChunk>>1)/threadsPerCUDABlock);
+    for (int stage=topStage; stage > topStage - numStages; stage--)
+        statevec_applyFourierStageKernel<<<CUDABlocks, threadsPerCUDABlock>>>(qureg, d_qubits, stage, conj);
+    
+    cudaFree(d_qubits);
+}
+
+__global__ void statevec_applyFourierTwiddlesKernel(Qureg qureg, int* qubits, int stage, int conj) {
+    
+    long long int index = blockIdx.x*blockDim.x + threadIdx.x;
+    if (index>=qureg.numAmpsPerChunk) return;
+    if (!extractBit(qubits[stage], index)) return;
+    
+    long long int lowVal = 0LL;
+    for (int q=0; q<stage; q++)
+        lowVal += ((index >> qubits[q]) & 1LL) << q;
+    
+    qreal phase = ((conj)? -1 : 1) * QUEST_PI * lowVal / (1LL << stage);
+    qreal c = cos(phase);
+    qreal s = sin(phase);
+    qreal re = qureg.deviceStateVec.real[index];
+    qreal im = qureg.deviceStateVec.imag[index];
+    
+    qureg.deviceStateVec.real[index] = re*c - im*s;
+    qureg.deviceStateVec.imag[index] = re*s + im*c;
+}
+
+void statevec_applyFourierTwiddles(Qureg qureg, int* qubits, int stage, int conj)
+{
+    int* d_qubits;
+    size_t qubitsMemSize = (stage + 1) * sizeof *d_qubits;
+    cudaMalloc(&d_qubits, qubitsMemSize);
+    cudaMemcpy(d_qubits, qubits, qubitsMemSize, cudaMemcpyHostToDevice);
+    
+    int threadsPerCUDABlock, CUDABlocks;
+    threadsPerCUDABlock = 128;
+    CUDABlocks = ceil((qreal)(qureg.numAmpsPerChunk)/threadsPerCUDABlock);
+    statevec_applyFourierTwiddlesKernel<<<CUDABlocks, threadsPerCUDABlock>>>(qureg, d_qubits, stage, conj);
+    
+    cudaFree(d_qubits);
+}
+
+__global__ void statevec_swapQubitAmpsPairsKernel(Qureg qureg, int* qubits1, int* qubits2, int numPairs) {
+    
+    long long int index = blockIdx.x*blockDim.x + threadIdx.x;
+    if (index>=qureg.numAmpsPerChunk) return;
+    
+    long long int pairInd = index;
+    for (int p=0; p<numPairs; p++)
+        if (extractBit(qubits1[p], index) != extractBit(qubits2[p], index))
+            pairInd = flipBit(flipBit(pairInd, qubits1[p]), qubits2[p]);
+    
+    // each pair of amplitudes is swapped by the thread of the smaller index
+    if (pairInd <= index) return;
+    
+    qreal re = qureg.deviceStateVec.real[index];
+    qreal im = qureg.deviceStateVec.imag[index];
+    qureg.deviceStateVec.real[index] = qureg.deviceStateVec.real[pairInd];
+    qureg.deviceStateVec.imag[index] = qureg.deviceStateVec.imag[pairInd];
+    qureg.deviceStateVec.real[pairInd] = re;
+    qureg.deviceStateVec.imag[pairInd] = im;
+}
+
+void statevec_swapQubitAmpsPairs(Qureg qureg, int* qubits1, int* qubits2, int numPairs)
+{
+    int* d_qubits;
+    size_t qubitsMemSize = numPairs * sizeof *d_qubits;
+    cudaMalloc(&d_qubits, 2*qubitsMemSize);
+    cudaMemcpy(d_qubits, qubits1, qubitsMemSize, cudaMemcpyHostToDevice);
+    cudaMemcpy(d_qubits + numPairs, qubits2, qubitsMemSize, cudaMemcpyHostToDevice);
+    
+    int threadsPerCUDABlock, CUDABlocks;
+    threadsPerCUDABlock = 128;
+    CUDABlocks = ceil((qreal)(qureg.numAmpsPerChunk)/threadsPerCUDABlock);
+    statevec_swapQubitAmpsPairsKernel<<<CUDABlocks, threadsPerCUDABlock>>>(
+        qureg, d_qubits, d_qubits + numPairs, numPairs);
+    
+    cudaFree(d_qubits);
+}
+
+__global__ void statevec_multiRotatePauliKernel(
+    Qureg qureg, long long int flipMask, long long int phaseMask, int pivotBit, 
+    qreal cosAngle, qreal facRe, qreal facIm
+) {
+    long long int numTasks = qureg.numAmpsPerChunk >> 1;
+    long long int thisTask = blockIdx.x*blockDim.x + threadIdx.x;
+    if (thisTask>=numTasks) return;
+    
+    qreal *stateVecReal = qureg.deviceStateVec.real;
+    qreal *stateVecImag = qureg.deviceStateVec.imag;
+    
+    // each pair |lo>, |lo ^ flipMask> is visited once
+    long long int indLo = insertZeroBit(thisTask, pivotBit);
+    long long int indHi = indLo ^ flipMask;
+    int sgnLo = getBitMaskParity(phaseMask & indLo)? -1 : 1;
+    int sgnHi = getBitMaskParity(phaseMask & indHi)? -1 : 1;
+    
+    qreal reLo = stateVecReal[indLo];
+    qreal imLo = stateVecImag[indLo];
+    qreal reHi = stateVecReal[indHi];
+    qreal imHi = stateVecImag[indHi];
+    
+    stateVecReal[indLo] = cosAngle*reLo + sgnHi*(facRe*reHi - facIm*imHi);
+    stateVecImag[indLo] = cosAngle*imLo + sgnHi*(facRe*imHi + facIm*reHi);
+    stateVecReal[indHi] = cosAngle*reHi + sgnLo*(facRe*reLo - facIm*imLo);
+    stateVecImag[indHi] = cosAngle*imHi + sgnLo*(facRe*imLo + facIm*reLo);
+}
+
+void statevec_multiRotatePauliByMasks(Qureg qureg, long long int flipMask, long long int phaseMask, qreal cosAngle, Complex sinFac)
+{
+    int pivotBit = 0;
+    while ((flipMask >> (pivotBit+1)) != 0)
+        pivotBit++;
+    
+    int threadsPerCUDABlock, CUDABlocks;
+    threadsPerCUDABlock = 128;
+    CUDABlocks = ceil((qreal)(qureg.numAmpsPerChunk>>1)/threadsPerCUDABlock);
+    statevec_multiRotatePauliKernel<<<CUDABlocks, threadsPerCUDABlock>>>(
+        qureg, flipMask, phaseMask, pivotBit, cosAngle, sinFac.real, sinFac.imag);
+}
+
+__global__ void statevec_addPauliProdsKernel(
+    Qureg inQureg, Qureg outQureg, long long int flipMask, long long int* phaseMasks, qreal* coeffsRe, qreal* coeffsIm, int numProds
+) {
+    long long int numTasks = outQureg.numAmpsPerChunk;
+    long long int index = blockIdx.x*blockDim.x + threadIdx.x;
+    if (index>=numTasks) return;
+    
+    // each amplitude gathers from its partner, which every product reads with its own sign
+    long long int pairIndex = index ^ flipMask;
+    qreal facRe = 0;
+    qreal facIm = 0;
+    for (int p=0; p<numProds; p++) {
+        int sgn = getBitMaskParity(phaseMasks[p] & pairIndex)? -1 : 1;
+        facRe += sgn*coeffsRe[p];
+        facIm += sgn*coeffsIm[p];
+    }
+    
+    qreal rePair = inQureg.deviceStateVec.real[pairIndex];
+    qreal imPair = inQureg.deviceStateVec.imag[pairIndex];
+    outQureg.deviceStateVec.real[index] += facRe*rePair - facIm*imPair;
+    outQureg.deviceStateVec.imag[index] += facRe*imPair + facIm*rePair;
+}
+
+void statevec_addPauliProdsByMask(Qureg inQureg, long long int flipMask, long long int* phaseMasks, Complex* coeffs, int numProds, Qureg outQureg)
+{
+    // copy the products' masks and coefficients to the device
+    long long int* d_phaseMasks;
+    qreal* d_coeffs;
+    cudaMalloc(&d_phaseMasks, numProds * sizeof *d_phaseMasks);
+    cudaMalloc(&d_coeffs, 2 * numProds * sizeof *d_coeffs);
+    
+    qreal* hostCoeffs = (qreal*) malloc(2 * numProds * sizeof *hostCoeffs);
+    for (int p=0; p<numProds; p++) {
+        hostCoeffs[p] = coeffs[p].real;
+        hostCoeffs[p + numProds] = coeffs[p].imag;
+    }
+    cudaMemcpy(d_phaseMasks, phaseMasks, numProds * sizeof *d_phaseMasks, cudaMemcpyHostToDevice);
+    cudaMemcpy(d_coeffs, hostCoeffs, 2 * numProds * sizeof *d_coeffs, cudaMemcpyHostToDevice);
+    free(hostCoeffs);
+    
+    int threadsPerCUDABlock, CUDABlocks;
+    threadsPerCUDABlock = 128;
+    CUDABlocks = ceil((qreal)(outQureg.numAmpsPerChunk)/threadsPerCUDABlock);
+    statevec_addPauliProdsKernel<<<CUDABlocks, threadsPerCUDABlock>>>(
+        inQureg, outQureg, flipMask, d_phaseMasks, d_coeffs, d_coeffs + numProds, numProds);
+    
+    cudaFree(d_phaseMasks);
+    cudaFree(d_coeffs);
+}
+
+__global__ void statevec_applyDiagonalOpKernel(Qureg qureg, DiagonalOp op) {
+    
+    // each thread modifies one value; a wasteful and inefficient strategy
+    long long int numTasks = qureg.numAmpsPerChunk;
+    long long int thisTask = blockIdx.x*blockDim.x + threadIdx.x;
+    if (thisTask >= numTasks) return;
+    
+    qreal* stateRe = qureg.deviceStateVec.real;
+    qreal* stateIm = qureg.deviceStateVec.imag;
+    qreal* opRe = op.deviceOperator.real;
+    qreal* opIm = op.deviceOperator.imag;
+    
+    qreal a = stateRe[thisTask];
+    qreal b = stateIm[thisTask];
+    qreal c = opRe[thisTask];
+    qreal d = opIm[thisTask];
+    
+    // (a + b i)(c + d i) = (a c - b d) + i (a d + b c)
+    stateRe[thisTask] = a*c - b*d;
+    stateIm[thisTask] = a*d + b*c;
+}
+
+void statevec_applyDiagonalOp(Qureg qureg, DiagonalOp op) 
+{
+    int threadsPerCUDABlock, CUDABlocks;
+    threadsPerCUDABlock = 128;
+    CUDABlocks = ceil((qreal)(qureg.numAmpsPerChunk)/threadsPerCUDABlock);
+    statevec_applyDiagonalOpKernel<<<CUDABlocks, threadsPerCUDABlock>>>(qureg, op);
+}
+
+__global__ void densmatr_applyDiagonalOpKernel(Qureg qureg, DiagonalOp op) {
+    
+    // each thread modifies one value; a wasteful and inefficient strategy
+    long long int numTasks = qureg.numAmpsPerChunk;
+    long long int thisTask = blockIdx.x*blockDim.x + threadIdx.x;
+    if (thisTask >= numTasks) return;
+    
+    qreal* stateRe = qureg.deviceStateVec.real;
+    qreal* stateIm = qureg.deviceStateVec.imag;
+    qreal* opRe = op.deviceOperator.real;
+    qreal* opIm = op.deviceOperator.imag;
+    
+    // left-multiplying scales each amplitude by the element of its row
+    long long int opInd = thisTask & ((1LL << op.numQubits) - 1);
+    
+    qreal a = stateRe[thisTask];
+    qreal b = stateIm[thisTask];
+    qreal c = opRe[opInd];
+    qreal d = opIm[opInd];
+    
+    stateRe[thisTask] = a*c - b*d;
+    stateIm[thisTask] = a*d + b*c;
+}
+
+void densmatr_applyDiagonalOp(Qureg qureg, DiagonalOp op) {
+    
+    int threadsPerCUDABlock, CUDABlocks;
+    threadsPerCUDABlock = 128;
+    CUDABlocks = ceil((qreal)(qureg.numAmpsPerChunk)/threadsPerCUDABlock);
+    densmatr_applyDiagonalOpKernel<<<CUDABlocks, threadsPerCUDABlock>>>(qureg, op);
+}
+
 qreal densmatr_calcTotalProb(Qureg qureg) {
     
     // computes the trace using Kahan summation
@@ -1621,6 +2106,48 @@ void statevec_swapQubitAmps(Qureg qureg, int qb1, int qb2)
     statevec_swapQubitAmpsKernel<<<CUDABlocks, threadsPerCUDABlock>>>(qureg, qb1, qb2);
 }
 
+__global__ void statevec_permuteQubitsKernel(Qureg qureg, int* perm, qreal* outRe, qreal* outIm) {
+
+    long long int thisTask = blockIdx.x*blockDim.x + threadIdx.x;
+    if (thisTask>=qureg.numAmpsPerChunk) return;
+
+    // bit q of the source index is bit perm[q] of the destination index
+    long long int srcInd = 0;
+    for (int q=0; q < qureg.numQubitsInStateVec; q++)
+        srcInd |= ((long long int) extractBit(perm[q], thisTask)) << q;
+
+    outRe[thisTask] = qureg.deviceStateVec.real[srcInd];
+    outIm[thisTask] = qureg.deviceStateVec.imag[srcInd];
+}
+
+void statevec_permuteQubits(Qureg qureg, int* perm)
+{
+    int threadsPerCUDABlock, CUDABlocks;
+    threadsPerCUDABlock = 128;
+    CUDABlocks = ceil((qreal)(qureg.numAmpsPerChunk)/threadsPerCUDABlock);
+
+    // allocate device space for {perm} (length: numQubitsInStateVec) and populate
+    int *d_perm;
+    size_t permMemSize = qureg.numQubitsInStateVec * sizeof *d_perm;
+    cudaMalloc(&d_perm, permMemSize);
+    cudaMemcpy(d_perm, perm, permMemSize, cudaMemcpyHostToDevice);
+
+    // gather into temporary device memory, then copy back into the state-vector
+    qreal *d_outRe, *d_outIm;
+    size_t vecMemSize = qureg.numAmpsPerChunk * sizeof *d_outRe;
+    cudaMalloc(&d_outRe, vecMemSize);
+    cudaMalloc(&d_outIm, vecMemSize);
+
+    statevec_permuteQubitsKernel<<<CUDABlocks, threadsPerCUDABlock>>>(qureg, d_perm, d_outRe, d_outIm);
+
+    cudaMemcpy(qureg.deviceStateVec.real, d_outRe, vecMemSize, cudaMemcpyDeviceToDevice);
+    cudaMemcpy(qureg.deviceStateVec.imag, d_outIm, vecMemSize, cudaMemcpyDeviceToDevice);
+
+    cudaFree(d_perm);
+    cudaFree(d_outRe);
+    cudaFree(d_outIm);
+}
+
 __global__ void statevec_hadamardKernel (Qureg qureg, const int targetQubit){
     // ----- sizes
     long long int sizeBlock,                                           // size of blocks
@@ -2037,6 +2564,17 @@ qreal densmatr_calcInnerProduct(Qureg a, Qureg b) {
     return innerprod;
 }
 
+void densmatr_calcInnerProductsMatrix(Qureg* quregs, int numQuregs, qreal* matr) {
+    
+    for (int r=0; r<numQuregs; r++) {
+        for (int c=r; c<numQuregs; c++) {
+            qreal prod = densmatr_calcInnerProduct(quregs[r], quregs[c]);
+            matr[r*numQuregs + c] = prod;
+            matr[c*numQuregs + r] = prod;
+        }
+    }
+}
+
 /** computes either a real or imag term in the inner product */
 __global__ void statevec_calcInnerProductKernel(
     int getRealComp,
@@ -2155,6 +2693,150 @@ Complex statevec_calcInnerProduct(Qureg bra, Qureg ket) {
     return innerProd;
 }
 
+void statevec_calcInnerProductsMatrix(Qureg* quregs, int numQuregs, qreal* matrRe, qreal* matrIm) {
+    
+    // each pair is reduced in turn by the existing kernel
+    for (int r=0; r<numQuregs; r++) {
+        for (int c=r; c<numQuregs; c++) {
+            Complex prod = statevec_calcInnerProduct(quregs[r], quregs[c]);
+            matrRe[r*numQuregs + c] =   prod.real;
+            matrIm[r*numQuregs + c] =   prod.imag;
+            matrRe[c*numQuregs + r] =   prod.real;
+            matrIm[c*numQuregs + r] = - prod.imag;
+        }
+    }
+}
+/** computes either a real or imag term of |vec_i|^2 op_i */
+__global__ void statevec_calcExpecDiagonalOpKernel(
+    int getRealComp,
+    qreal* vecReal, qreal* vecImag, qreal* opReal, qreal* opImag, 
+    long long int numTermsToSum, qreal* reducedArray) 
+{
+    long long int index = blockIdx.x*blockDim.x + threadIdx.x;
+    if (index >= numTermsToSum) return;
+    
+    qreal vecAbs = vecReal[index]*vecReal[index] + vecImag[index]*vecImag[index];
+    
+    // choose whether to calculate the real or imaginary term of the expec term
+    qreal expecVal;
+    if (getRealComp)
+        expecVal = vecAbs * opReal[index];
+    else
+        expecVal = vecAbs * opImag[index];
+    
+    // array of each thread's collected sum term, to be summed
+    extern __shared__ qreal tempReductionArray[];
+    tempReductionArray[threadIdx.x] = expecVal;
+    __syncthreads();
+    
+    // every second thread reduces
+    if (threadIdx.x<blockDim.x/2)
+        reduceBlock(tempReductionArray, reducedArray, blockDim.x);
+}
+
+/** computes either a real or imag term of rho_ii op_i */
+__global__ void densmatr_calcExpecDiagonalOpKernel(
+    int getRealComp,
+    qreal* matReal, qreal* matImag, qreal* opReal, qreal* opImag, 
+    int numQubits, long long int numTermsToSum, qreal* reducedArray) 
+{
+    // each thread sums one diagonal element of the density matrix
+    long long int index = blockIdx.x*blockDim.x + threadIdx.x;
+    if (index >= numTermsToSum) return;
+    
+    // ... which lies at matrix index (index, index)
+    long long int matInd = (index << numQubits) + index;
+    
+    qreal a = matReal[matInd];
+    qreal b = matImag[matInd];
+    qreal c = opReal[index];
+    qreal d = opImag[index];
+    
+    qreal expecVal;
+    if (getRealComp)
+        expecVal = a*c - b*d;
+    else
+        expecVal = a*d + b*c;
+    
+    extern __shared__ qreal tempReductionArray[];
+    tempReductionArray[threadIdx.x] = expecVal;
+    __syncthreads();
+    
+    if (threadIdx.x<blockDim.x/2)
+        reduceBlock(tempReductionArray, reducedArray, blockDim.x);
+}
+
+/** Reduces the real and then imaginary components of the expected value of op, 
+ * each in a single multiply-and-reduce pass over the (diagonal) amplitudes 
+ */
+Complex calcExpecDiagonalOpByComponents(Qureg qureg, DiagonalOp op) {
+    
+    qreal expecComps[2];
+    
+    int getRealComp;
+    long long int numValuesToReduce;
+    int valuesPerCUDABlock, numCUDABlocks, sharedMemSize;
+    int maxReducedPerLevel = REDUCE_SHARED_SIZE;
+    int firstTime;
+    
+    for (int comp=0; comp<2; comp++) {
+        getRealComp = (comp == 0);
+        numValuesToReduce = op.numElemsPerChunk;
+        firstTime = 1;
+        while (numValuesToReduce > 1) {
+            if (numValuesToReduce < maxReducedPerLevel) {
+                valuesPerCUDABlock = numValuesToReduce;
+                numCUDABlocks = 1;
+            }
+            else {
+                valuesPerCUDABlock = maxReducedPerLevel;
+                numCUDABlocks = ceil((qreal)numValuesToReduce/valuesPerCUDABlock);
+            }
+            sharedMemSize = valuesPerCUDABlock*sizeof(qreal);
+            if (firstTime && qureg.isDensityMatrix) {
+                densmatr_calcExpecDiagonalOpKernel<<<numCUDABlocks, valuesPerCUDABlock, sharedMemSize>>>(
+                    getRealComp,
+                    qureg.deviceStateVec.real, qureg.deviceStateVec.imag, 
+                    op.deviceOperator.real, op.deviceOperator.imag, 
+                    op.numQubits, numValuesToReduce, 
+                    qureg.firstLevelReduction);
+                firstTime = 0;
+            } else if (firstTime) {
+                statevec_calcExpecDiagonalOpKernel<<<numCUDABlocks, valuesPerCUDABlock, sharedMemSize>>>(
+                    getRealComp,
+                    qureg.deviceStateVec.real, qureg.deviceStateVec.imag, 
+                    op.deviceOperator.real, op.deviceOperator.imag, 
+                    numValuesToReduce, 
+                    qureg.firstLevelReduction);
+                firstTime = 0;
+            } else {
+                cudaDeviceSynchronize();    
+                copySharedReduceBlock<<<numCUDABlocks, valuesPerCUDABlock/2, sharedMemSize>>>(
+                        qureg.firstLevelReduction, 
+                        qureg.secondLevelReduction, valuesPerCUDABlock); 
+                cudaDeviceSynchronize();    
+                swapDouble(&(qureg.firstLevelReduction), &(qureg.secondLevelReduction));
+            }
+            numValuesToReduce = numValuesToReduce/maxReducedPerLevel;
+        }
+        cudaMemcpy(&expecComps[comp], qureg.firstLevelReduction, sizeof(qreal), cudaMemcpyDeviceToHost);
+    }
+    
+    Complex expecVal;
+    expecVal.real = expecComps[0];
+    expecVal.imag = expecComps[1];
+    return expecVal;
+}
+
+Complex statevec_calcExpecDiagonalOp(Qureg qureg, DiagonalOp op) {
+    return calcExpecDiagonalOpByComponents(qureg, op);
+}
+
+Complex densmatr_calcExpecDiagonalOp(Qureg qureg, DiagonalOp op) {
+    return calcExpecDiagonalOpByComponents(qureg, op);
+}
+
+
 /** computes one term of (vec^*T) dens * vec */
 __global__ void densmatr_calcFidelityKernel(Qureg dens, Qureg vec, long long int dim, qreal* reducedArray) {
 
@@ -75,6 +75,7 @@ Qureg createQureg(int numQubits, QuESTEnv env) {
     qureg.numQubitsInStateVec = numQubits;
     
     qasm_setup(&qureg);
+    statevec_createLazyFactor(&qureg);
     initZeroState(qureg); // safe call to public function
     return qureg;
 }
@@ -89,6 +90,39 @@ Qureg createDensityQureg(int numQubits, QuESTEnv env) {
     qureg.numQubitsInStateVec = 2*numQubits;
     
     qasm_setup(&qureg);
+    statevec_createLazyFactor(&qureg);
+    initZeroState(qureg); // safe call to public function
+    return qureg;
+}
+
+Qureg createDiskQureg(int numQubits, char* filename, QuESTEnv env) {
+    validateCreateNumQubits(numQubits, __func__);
+    
+    Qureg qureg;
+    int success = statevec_createDiskQureg(&qureg, numQubits, filename, env);
+    validateDiskQureg(success, __func__);
+    qureg.isDensityMatrix = 0;
+    qureg.numQubitsRepresented = numQubits;
+    qureg.numQubitsInStateVec = numQubits;
+    
+    qasm_setup(&qureg);
+    statevec_createLazyFactor(&qureg);
+    initZeroState(qureg); // safe call to public function
+    return qureg;
+}
+
+Qureg createDensityDiskQureg(int numQubits, char* filename, QuESTEnv env) {
+    validateCreateNumQubits(numQubits, __func__);
+    
+    Qureg qureg;
+    int success = statevec_createDiskQureg(&qureg, 2*numQubits, filename, env);
+    validateDiskQureg(success, __func__);
+    qureg.isDensityMatrix = 1;
+    qureg.numQubitsRepresented = numQubits;
+    qureg.numQubitsInStateVec = 2*numQubits;
+    
+    qasm_setup(&qureg);
+    statevec_createLazyFactor(&qureg);
     initZeroState(qureg); // safe call to public function
     return qureg;
 }
@@ -102,12 +136,15 @@ Qureg createCloneQureg(Qureg qureg, QuESTEnv env) {
     newQureg.numQubitsInStateVec = qureg.numQubitsInStateVec;
     
     qasm_setup(&newQureg);
+    statevec_createLazyFactor(&newQureg);
     statevec_cloneQureg(newQureg, qureg);
+    *(newQureg.lazyFactor) = *(qureg.lazyFactor);
     return newQureg;
 }
 
 void destroyQureg(Qureg qureg, QuESTEnv env) {
     statevec_destroyQureg(qureg, env);
+    statevec_destroyLazyFactor(qureg);
     qasm_free(qureg);
 }
 
@@ -144,12 +181,14 @@ void writeRecordedQASMToFile(Qureg qureg, char* filename) {
 
 void initZeroState(Qureg qureg) {
     statevec_initZeroState(qureg); // valid for both statevec and density matrices
+    statevec_clearLazyFactor(qureg);
     
     qasm_recordInitZero(qureg);
 }
 
 void initBlankState(Qureg qureg) {
     statevec_initBlankState(qureg);
+    statevec_clearLazyFactor(qureg);
     
     qasm_recordComment(qureg, "Here, the register was initialised to an unphysical all-zero-amplitudes 'state'.");
 }
@@ -159,6 +198,7 @@ void initPlusState(Qureg qureg) {
         densmatr_initPlusState(qureg);
     else
         statevec_initPlusState(qureg);
+    statevec_clearLazyFactor(qureg);
     
     qasm_recordInitPlus(qureg);
 }
@@ -170,6 +210,7 @@ void initClassicalState(Qureg qureg, long long int stateInd) {
         densmatr_initClassicalState(qureg, stateInd);
     else
         statevec_initClassicalState(qureg, stateInd);
+    statevec_clearLazyFactor(qureg);
     
     qasm_recordInitClassical(qureg, stateInd);
 }
@@ -178,10 +219,12 @@ void initPureState(Qureg qureg, Qureg pure) {
     validateSecondQuregStateVec(pure, __func__);
     validateMatchingQuregDims(qureg, pure, __func__);
 
+    statevec_commitLazyFactor(pure);
     if (qureg.isDensityMatrix)
         densmatr_initPureState(qureg, pure);
     else
         statevec_cloneQureg(qureg, pure);
+    statevec_clearLazyFactor(qureg);
     
     qasm_recordComment(qureg, "Here, the register was initialised to an undisclosed given pure state.");
 }
@@ -192,15 +235,38 @@ void initStateFromAmps(Qureg qureg, qreal* reals, qreal* imags) {
     //validateStateVecQureg(qureg, __func__);
     
     statevec_setAmps(qureg, 0, reals, imags, qureg.numAmpsTotal);
+    statevec_clearLazyFactor(qureg);
     
     qasm_recordComment(qureg, "Here, the register was initialised to an undisclosed given pure state.");
 }
 
+void saveQureg(Qureg qureg, char* filename) {
+    statevec_commitLazyFactor(qureg);
+    copyStateFromGPU(qureg);
+    
+    int success = agnostic_saveQureg(qureg, filename);
+    validateFileOpened(success, __func__);
+}
+
+void loadQureg(Qureg qureg, char* filename) {
+    int status = agnostic_loadQureg(qureg, filename);
+    validateFileOpened(status != QUREG_FILE_NOT_OPENED, __func__);
+    validateQuregFile(status != QUREG_FILE_INVALID, __func__);
+    validateMatchingQuregFile(status != QUREG_FILE_MISMATCH, __func__);
+    validateUnambiguousQuregFile(status != QUREG_FILE_AMBIGUOUS, __func__);
+    
+    copyStateToGPU(qureg);
+    statevec_clearLazyFactor(qureg);
+    
+    qasm_recordComment(qureg, "Here, the register was loaded from a checkpoint file.");
+}
+
 void cloneQureg(Qureg targetQureg, Qureg copyQureg) {
     validateMatchingQuregTypes(targetQureg, copyQureg, __func__);
     validateMatchingQuregDims(targetQureg, copyQureg, __func__);
     
     statevec_cloneQureg(targetQureg, copyQureg);
+    *(targetQureg.lazyFactor) = *(copyQureg.lazyFactor);
 }
 
 
@@ -644,6 +710,17 @@ void swapGate(Qureg qureg, int qb1, int qb2) {
     qasm_recordControlledGate(qureg, GATE_SWAP, qb1, qb2);
 }
 
+void permuteQubits(Qureg qureg, int* perm) {
+    validateQubitPermutation(qureg, perm, __func__);
+    
+    if (qureg.isDensityMatrix)
+        densmatr_permuteQubits(qureg, perm);
+    else
+        statevec_permuteQubits(qureg, perm);
+    
+    qasm_recordQubitPermutation(qureg, perm);
+}
+
 void sqrtSwapGate(Qureg qureg, int qb1, int qb2) {
     validateUniqueTargets(qureg, qb1, qb2, __func__);
     validateMultiQubitMatrixFitsInNode(qureg, 2, __func__); // uses 2qb unitary in QuEST_common
@@ -693,6 +770,100 @@ void multiRotatePauli(Qureg qureg, int* targetQubits, enum pauliOpType* targetPa
         numTargets, angle);
 }
 
+void applyPhaseFunc(Qureg qureg, int* qubits, int numQubits, enum bitEncoding encoding, qreal* coeffs, qreal* exponents, int numTerms) {
+    validateMultiQubits(qureg, qubits, numQubits, __func__);
+    validateBitEncoding(encoding, __func__);
+    validatePhaseFuncTerms(encoding, exponents, numTerms, NULL, 0, __func__);
+    
+    int conj = 0;
+    statevec_applyPhaseFunc(qureg, qubits, numQubits, encoding, coeffs, exponents, numTerms, NULL, NULL, 0, conj);
+    if (qureg.isDensityMatrix) {
+        conj = 1;
+        int shift = qureg.numQubitsRepresented;
+        shiftIndices(qubits, numQubits, shift);
+        statevec_applyPhaseFunc(qureg, qubits, numQubits, encoding, coeffs, exponents, numTerms, NULL, NULL, 0, conj);
+        shiftIndices(qubits, numQubits, -shift);
+    }
+    
+    // @TODO: create actual QASM
+    qasm_recordComment(qureg, 
+        "Here a %d-term phase function was applied to a %d-qubit sub-register (QASM not yet implemented)",
+        numTerms, numQubits);
+}
+
+void applyPhaseFuncOverrides(Qureg qureg, int* qubits, int numQubits, enum bitEncoding encoding, qreal* coeffs, qreal* exponents, int numTerms, long long int* overrideInds, qreal* overridePhases, int numOverrides) {
+    validateMultiQubits(qureg, qubits, numQubits, __func__);
+    validateBitEncoding(encoding, __func__);
+    validatePhaseFuncOverrides(numQubits, encoding, overrideInds, numOverrides, __func__);
+    validatePhaseFuncTerms(encoding, exponents, numTerms, overrideInds, numOverrides, __func__);
+    
+    int conj = 0;
+    statevec_applyPhaseFunc(qureg, qubits, numQubits, encoding, coeffs, exponents, numTerms, overrideInds, overridePhases, numOverrides, conj);
+    if (qureg.isDensityMatrix) {
+        conj = 1;
+        int shift = qureg.numQubitsRepresented;
+        shiftIndices(qubits, numQubits, shift);
+        statevec_applyPhaseFunc(qureg, qubits, numQubits, encoding, coeffs, exponents, numTerms, overrideInds, overridePhases, numOverrides, conj);
+        shiftIndices(qubits, numQubits, -shift);
+    }
+    
+    // @TODO: create actual QASM
+    qasm_recordComment(qureg, 
+        "Here a %d-term phase function (with %d overrides) was applied to a %d-qubit sub-register (QASM not yet implemented)",
+        numTerms, numOverrides, numQubits);
+}
+
+void applyPhaseFuncTable(Qureg qureg, int* qubits, int numQubits, qreal* phases) {
+    validateMultiQubits(qureg, qubits, numQubits, __func__);
+    
+    int conj = 0;
+    statevec_applyPhaseFuncTable(qureg, qubits, numQubits, phases, conj);
+    if (qureg.isDensityMatrix) {
+        conj = 1;
+        int shift = qureg.numQubitsRepresented;
+        shiftIndices(qubits, numQubits, shift);
+        statevec_applyPhaseFuncTable(qureg, qubits, numQubits, phases, conj);
+        shiftIndices(qubits, numQubits, -shift);
+    }
+    
+    // @TODO: create actual QASM
+    qasm_recordComment(qureg, 
+        "Here a tabulated phase function was applied to a %d-qubit sub-register (QASM not yet implemented)",
+        numQubits);
+}
+
+void applyQFT(Qureg qureg, int* qubits, int numQubits) {
+    validateMultiTargets(qureg, qubits, numQubits, __func__);
+    
+    int conj = 0;
+    statevec_applyQFT(qureg, qubits, numQubits, conj);
+    if (qureg.isDensityMatrix) {
+        conj = 1;
+        int shift = qureg.numQubitsRepresented;
+        shiftIndices(qubits, numQubits, shift);
+        statevec_applyQFT(qureg, qubits, numQubits, conj);
+        shiftIndices(qubits, numQubits, -shift);
+    }
+    
+    qasm_recordQFT(qureg, qubits, numQubits, 0);
+}
+
+void applyInverseQFT(Qureg qureg, int* qubits, int numQubits) {
+    validateMultiTargets(qureg, qubits, numQubits, __func__);
+    
+    int conj = 1;
+    statevec_applyQFT(qureg, qubits, numQubits, conj);
+    if (qureg.isDensityMatrix) {
+        conj = 0;
+        int shift = qureg.numQubitsRepresented;
+        shiftIndices(qubits, numQubits, shift);
+        statevec_applyQFT(qureg, qubits, numQubits, conj);
+        shiftIndices(qubits, numQubits, -shift);
+    }
+    
+    qasm_recordQFT(qureg, qubits, numQubits, 1);
+}
+
 
 
 /*
@@ -713,14 +884,14 @@ qreal getRealAmp(Qureg qureg, long long int index) {
     validateStateVecQureg(qureg, __func__);
     validateAmpIndex(qureg, index, __func__);
     
-    return statevec_getRealAmp(qureg, index);
+    return statevec_getAmp(qureg, index).real;
 }
 
 qreal getImagAmp(Qureg qureg, long long int index) {
     validateStateVecQureg(qureg, __func__);
     validateAmpIndex(qureg, index, __func__);
     
-    return statevec_getImagAmp(qureg, index);
+    return statevec_getAmp(qureg, index).imag;
 }
 
 qreal getProbAmp(Qureg qureg, long long int index) {
@@ -734,10 +905,7 @@ Complex getAmp(Qureg qureg, long long int index) {
     validateStateVecQureg(qureg, __func__);
     validateAmpIndex(qureg, index, __func__);
     
-    Complex amp;
-    amp.real = statevec_getRealAmp(qureg, index);
-    amp.imag = statevec_getImagAmp(qureg, index);
-    return amp;
+    return statevec_getAmp(qureg, index);
 }
 
 Complex getDensityAmp(Qureg qureg, long long int row, long long int col) {
@@ -746,10 +914,7 @@ Complex getDensityAmp(Qureg qureg, long long int row, long long int col) {
     validateAmpIndex(qureg, col, __func__);
     
     long long ind = row + col*(1LL << qureg.numQubitsRepresented);
-    Complex amp;
-    amp.real = statevec_getRealAmp(qureg, ind);
-    amp.imag = statevec_getImagAmp(qureg, ind);
-    return amp;
+    return statevec_getAmp(qureg, ind);
 }
 
 
@@ -761,6 +926,7 @@ qreal collapseToOutcome(Qureg qureg, const int measureQubit, int outcome) {
     validateTarget(qureg, measureQubit, __func__);
     validateOutcome(outcome, __func__);
     
+    statevec_commitLazyFactorUnlessPhase(qureg);
     qreal outcomeProb;
     if (qureg.isDensityMatrix) {
         outcomeProb = densmatr_calcProbOfOutcome(qureg, measureQubit, outcome);
@@ -779,6 +945,7 @@ qreal collapseToOutcome(Qureg qureg, const int measureQubit, int outcome) {
 int measureWithStats(Qureg qureg, int measureQubit, qreal *outcomeProb) {
     validateTarget(qureg, measureQubit, __func__);
 
+    statevec_commitLazyFactorUnlessPhase(qureg);
     int outcome;
     if (qureg.isDensityMatrix)
         outcome = densmatr_measureWithStats(qureg, measureQubit, outcomeProb);
@@ -792,6 +959,7 @@ int measureWithStats(Qureg qureg, int measureQubit, qreal *outcomeProb) {
 int measure(Qureg qureg, int measureQubit) {
     validateTarget(qureg, measureQubit, __func__);
     
+    statevec_commitLazyFactorUnlessPhase(qureg);
     int outcome;
     qreal discardedProb;
     if (qureg.isDensityMatrix)
@@ -809,6 +977,8 @@ void mixDensityMatrix(Qureg combineQureg, qreal otherProb, Qureg otherQureg) {
     validateMatchingQuregDims(combineQureg, otherQureg, __func__);
     validateProb(otherProb, __func__);
     
+    statevec_commitLazyFactor(combineQureg);
+    statevec_commitLazyFactor(otherQureg);
     densmatr_mixDensityMatrix(combineQureg, otherProb, otherQureg);
 }
 
@@ -816,6 +986,7 @@ void setAmps(Qureg qureg, long long int startInd, qreal* reals, qreal* imags, lo
     validateStateVecQureg(qureg, __func__);
     validateNumAmps(qureg, startInd, numAmps, __func__);
     
+    statevec_commitLazyFactor(qureg);
     statevec_setAmps(qureg, startInd, reals, imags, numAmps);
     
     qasm_recordComment(qureg, "Here, some amplitudes in the statevector were manually edited.");
@@ -824,6 +995,7 @@ void setAmps(Qureg qureg, long long int startInd, qreal* reals, qreal* imags, lo
 void setDensityAmps(Qureg qureg, qreal* reals, qreal* imags) {
     long long int numAmps = qureg.numAmpsTotal; 
     statevec_setAmps(qureg, 0, reals, imags, numAmps);
+    statevec_clearLazyFactor(qureg);
     
     qasm_recordComment(qureg, "Here, some amplitudes in the density matrix were manually edited.");
 }
@@ -834,11 +1006,22 @@ void setWeightedQureg(Complex fac1, Qureg qureg1, Complex fac2, Qureg qureg2, Co
     validateMatchingQuregDims(qureg1, qureg2,  __func__);
     validateMatchingQuregDims(qureg1, out, __func__);
 
+    // fold the lazy factors into the weights (before out's is cleared, since it may be qureg1 or qureg2)
+    fac1 = getProductOfScalars(fac1, *(qureg1.lazyFactor));
+    fac2 = getProductOfScalars(fac2, *(qureg2.lazyFactor));
+    facOut = getProductOfScalars(facOut, *(out.lazyFactor));
+    statevec_clearLazyFactor(out);
     statevec_setWeightedQureg(fac1, qureg1, fac2, qureg2, facOut, out);
 
     qasm_recordComment(out, "Here, the register was modified to an undisclosed and possibly unphysical state (setWeightedQureg).");
 } 
 
+void applyGlobalFactor(Qureg qureg, Complex fac) {
+    statevec_scaleLazyFactor(qureg, fac);
+    
+    qasm_recordComment(qureg, "Here, the register was multiplied by the global factor (%g) + i(%g).", fac.real, fac.imag);
+}
+
 void applyPauliSum(Qureg inQureg, enum pauliOpType* allPauliCodes, qreal* termCoeffs, int numSumTerms, Qureg outQureg) {
     validateMatchingQuregTypes(inQureg, outQureg, __func__);
     validateMatchingQuregDims(inQureg, outQureg, __func__);
@@ -846,16 +1029,88 @@ void applyPauliSum(Qureg inQureg, enum pauliOpType* allPauliCodes, qreal* termCo
     validatePauliCodes(allPauliCodes, numSumTerms*inQureg.numQubitsRepresented, __func__);
     
     statevec_applyPauliSum(inQureg, allPauliCodes, termCoeffs, numSumTerms, outQureg);
+    *(outQureg.lazyFactor) = *(inQureg.lazyFactor); // the sum is linear in inQureg
     
     qasm_recordComment(outQureg, "Here, the register was modified to an undisclosed and possibly unphysical state (applyPauliSum).");
 }
 
+void applyTrotterCircuit(Qureg qureg, enum pauliOpType* allPauliCodes, qreal* termCoeffs, int numSumTerms, qreal time, int order, int reps) {
+    validateNumPauliSumTerms(numSumTerms, __func__);
+    validatePauliCodes(allPauliCodes, numSumTerms*qureg.numQubitsRepresented, __func__);
+    validateTrotterParams(order, reps, __func__);
+    
+    statevec_applyTrotterCircuit(qureg, allPauliCodes, termCoeffs, numSumTerms, time, order, reps);
+    
+    // @TODO: create actual QASM
+    qasm_recordComment(qureg, 
+        "Here, a %d-term Pauli sum was exponentiated over time %g by a Trotterisation "
+        "of order %d with %d repetitions (QASM not yet implemented)", numSumTerms, time, order, reps);
+}
+
+void applyKrylovEvolution(Qureg qureg, enum pauliOpType* allPauliCodes, qreal* termCoeffs, int numSumTerms, qreal time, QuESTEnv env) {
+    validateStateVecQureg(qureg, __func__);
+    validateNumPauliSumTerms(numSumTerms, __func__);
+    validatePauliCodes(allPauliCodes, numSumTerms*qureg.numQubitsRepresented, __func__);
+    
+    // the Lanczos recurrence needs three registers (whose memory is recycled by the backend)
+    Qureg workspaces[3];
+    for (int i=0; i < 3; i++)
+        workspaces[i] = createQureg(qureg.numQubitsRepresented, env);
+    
+    // the evolution is linear, so acts on the amplitudes without committing the lazy factor
+    statevec_applyKrylovEvolution(qureg, allPauliCodes, termCoeffs, numSumTerms, time, workspaces);
+    
+    for (int i=0; i < 3; i++)
+        destroyQureg(workspaces[i], env);
+    
+    qasm_recordComment(qureg, 
+        "Here, a %d-term Pauli sum was exponentiated over time %g by Krylov subspace projection", numSumTerms, time);
+}
+
+qreal calcGroundState(Qureg qureg, enum pauliOpType* allPauliCodes, qreal* termCoeffs, int numSumTerms, qreal tolerance, QuESTEnv env) {
+    validateStateVecQureg(qureg, __func__);
+    validateNumPauliSumTerms(numSumTerms, __func__);
+    validatePauliCodes(allPauliCodes, numSumTerms*qureg.numQubitsRepresented, __func__);
+    validateGroundStateTolerance(tolerance, __func__);
+    validateNonZeroNorm(statevec_calcTotalProb(qureg), __func__);
+    
+    Qureg workspaces[3];
+    for (int i=0; i < 3; i++)
+        workspaces[i] = createQureg(qureg.numQubitsRepresented, env);
+    
+    // the (normalised) ground state replaces the amplitudes, discarding any global factor
+    qreal residual;
+    qreal energy = statevec_calcGroundState(qureg, allPauliCodes, termCoeffs, numSumTerms, tolerance, workspaces, &residual);
+    statevec_clearLazyFactor(qureg);
+    
+    for (int i=0; i < 3; i++)
+        destroyQureg(workspaces[i], env);
+    
+    qasm_recordComment(qureg, "Here, the register was set to the ground state of a %d-term Pauli sum (calcGroundState).", numSumTerms);
+    
+    // checked only after the workspaces are freed, since validation may not return
+    validateGroundStateConverged(residual, tolerance, __func__);
+    return energy;
+}
+
+void applyDiagonalOp(Qureg qureg, DiagonalOp op) {
+    validateDiagonalOp(qureg, op, __func__);
+    
+    if (qureg.isDensityMatrix)
+        densmatr_applyDiagonalOp(qureg, op);
+    else
+        statevec_applyDiagonalOp(qureg, op);
+    
+    qasm_recordComment(qureg, "Here, the register was modified to an undisclosed and possibly unphysical state (applyDiagonalOp).");
+}
+
 
 /*
  * calculations
  */
 
 qreal calcTotalProb(Qureg qureg) {
+    statevec_commitLazyFactorUnlessPhase(qureg);
     if (qureg.isDensityMatrix)  
             return densmatr_calcTotalProb(qureg);
         else
@@ -867,7 +1122,9 @@ Complex calcInnerProduct(Qureg bra, Qureg ket) {
     validateStateVecQureg(ket, __func__);
     validateMatchingQuregDims(bra, ket,  __func__);
     
-    return statevec_calcInnerProduct(bra, ket);
+    Complex prod = statevec_calcInnerProduct(bra, ket);
+    Complex fac = getProductOfScalars(getConjugateScalar(*(bra.lazyFactor)), *(ket.lazyFactor));
+    return getProductOfScalars(prod, fac);
 }
 
 qreal calcDensityInnerProduct(Qureg rho1, Qureg rho2) {
@@ -875,13 +1132,50 @@ qreal calcDensityInnerProduct(Qureg rho1, Qureg rho2) {
     validateDensityMatrQureg(rho2, __func__);
     validateMatchingQuregDims(rho1, rho2, __func__);
     
+    statevec_commitLazyFactor(rho1);
+    statevec_commitLazyFactor(rho2);
     return densmatr_calcInnerProduct(rho1, rho2);
 }
 
+void calcInnerProductsMatrix(Qureg* quregs, int numQuregs, qreal* matrRe, qreal* matrIm) {
+    validateNumQuregs(numQuregs, __func__);
+    for (int i=0; i<numQuregs; i++) {
+        validateStateVecQureg(quregs[i], __func__);
+        validateMatchingQuregDims(quregs[0], quregs[i], __func__);
+    }
+    
+    statevec_calcInnerProductsMatrix(quregs, numQuregs, matrRe, matrIm);
+    
+    // <r|c> carries the lazy factors conj(f_r) f_c
+    for (int r=0; r<numQuregs; r++) {
+        for (int c=0; c<numQuregs; c++) {
+            long long int ind = r*(long long int) numQuregs + c;
+            Complex prod = {.real=matrRe[ind], .imag=matrIm[ind]};
+            Complex fac = getProductOfScalars(getConjugateScalar(*(quregs[r].lazyFactor)), *(quregs[c].lazyFactor));
+            prod = getProductOfScalars(prod, fac);
+            matrRe[ind] = prod.real;
+            matrIm[ind] = prod.imag;
+        }
+    }
+}
+
+void calcDensityInnerProductsMatrix(Qureg* quregs, int numQuregs, qreal* matr) {
+    validateNumQuregs(numQuregs, __func__);
+    for (int i=0; i<numQuregs; i++) {
+        validateDensityMatrQureg(quregs[i], __func__);
+        validateMatchingQuregDims(quregs[0], quregs[i], __func__);
+    }
+    
+    for (int i=0; i<numQuregs; i++)
+        statevec_commitLazyFactor(quregs[i]);
+    densmatr_calcInnerProductsMatrix(quregs, numQuregs, matr);
+}
+
 qreal calcProbOfOutcome(Qureg qureg, const int measureQubit, int outcome) {
     validateTarget(qureg, measureQubit, __func__);
     validateOutcome(outcome, __func__);
     
+    statevec_commitLazyFactorUnlessPhase(qureg);
     if (qureg.isDensityMatrix)
         return densmatr_calcProbOfOutcome(qureg, measureQubit, outcome);
     else
@@ -891,6 +1185,7 @@ qreal calcProbOfOutcome(Qureg qureg, const int measureQubit, int outcome) {
 qreal calcPurity(Qureg qureg) {
     validateDensityMatrQureg(qureg, __func__);
     
+    statevec_commitLazyFactor(qureg);
     return densmatr_calcPurity(qureg);
 }
 
@@ -898,6 +1193,8 @@ qreal calcFidelity(Qureg qureg, Qureg pureState) {
     validateSecondQuregStateVec(pureState, __func__);
     validateMatchingQuregDims(qureg, pureState, __func__);
     
+    statevec_commitLazyFactorUnlessPhase(qureg);
+    statevec_commitLazyFactorUnlessPhase(pureState);
     if (qureg.isDensityMatrix)
         return densmatr_calcFidelity(qureg, pureState);
     else
@@ -910,6 +1207,8 @@ qreal calcExpecPauliProd(Qureg qureg, int* targetQubits, enum pauliOpType* pauli
     validateMatchingQuregTypes(qureg, workspace, __func__);
     validateMatchingQuregDims(qureg, workspace, __func__);
     
+    statevec_commitLazyFactorUnlessPhase(qureg);
+    statevec_clearLazyFactor(workspace);
     return statevec_calcExpecPauliProd(qureg, targetQubits, pauliCodes, numTargets, workspace);
 }
 
@@ -919,14 +1218,34 @@ qreal calcExpecPauliSum(Qureg qureg, enum pauliOpType* allPauliCodes, qreal* ter
     validateMatchingQuregTypes(qureg, workspace, __func__);
     validateMatchingQuregDims(qureg, workspace, __func__);
     
+    statevec_commitLazyFactorUnlessPhase(qureg);
+    statevec_clearLazyFactor(workspace);
     return statevec_calcExpecPauliSum(qureg, allPauliCodes, termCoeffs, numSumTerms, workspace);
 }
 
+Complex calcExpecDiagonalOp(Qureg qureg, DiagonalOp op) {
+    validateDiagonalOp(qureg, op, __func__);
+    
+    // rather than committing the lazy factor, the (linear) expectation value is rescaled
+    Complex fac = *(qureg.lazyFactor);
+    Complex expec;
+    if (qureg.isDensityMatrix)
+        expec = densmatr_calcExpecDiagonalOp(qureg, op);
+    else {
+        expec = statevec_calcExpecDiagonalOp(qureg, op);
+        fac.real = fac.real*fac.real + fac.imag*fac.imag;
+        fac.imag = 0;
+    }
+    return getProductOfScalars(expec, fac);
+}
+
 qreal calcHilbertSchmidtDistance(Qureg a, Qureg b) {
     validateDensityMatrQureg(a, __func__);
     validateDensityMatrQureg(b, __func__);
     validateMatchingQuregDims(a, b, __func__);
     
+    statevec_commitLazyFactor(a);
+    statevec_commitLazyFactor(b);
     return densmatr_calcHilbertSchmidtDistance(a, b);
 }
 
@@ -1083,22 +1402,62 @@ void initComplexMatrixN(ComplexMatrixN m, qreal re[][1<<m.numQubits], qreal im[]
 }
 #endif
 
+DiagonalOp createDiagonalOp(int numQubits, QuESTEnv env) {
+    validateCreateNumDiagOpQubits(numQubits, env.numRanks, __func__);
+    
+    DiagonalOp op = agnostic_createDiagonalOp(numQubits, env);
+    
+    // error if the DiagonalOp was not successfully malloc'd
+    validateDiagOpInit(op, __func__);
+    
+    return op;
+}
+
+void destroyDiagonalOp(DiagonalOp op, QuESTEnv env) {
+    validateDiagOpInit(op, __func__);
+    
+    agnostic_destroyDiagonalOp(op);
+}
+
+void syncDiagonalOp(DiagonalOp op) {
+    validateDiagOpInit(op, __func__);
+    
+    agnostic_syncDiagonalOp(op);
+}
+
+void initDiagonalOp(DiagonalOp op, qreal* real, qreal* imag) {
+    validateDiagOpInit(op, __func__);
+    
+    agnostic_setDiagonalOpElems(op, 0, real, imag, 1LL << op.numQubits);
+}
+
+void setDiagonalOpElems(DiagonalOp op, long long int startInd, qreal* real, qreal* imag, long long int numElems) {
+    validateDiagOpInit(op, __func__);
+    validateNumDiagOpElems(op, startInd, numElems, __func__);
+    
+    agnostic_setDiagonalOpElems(op, startInd, real, imag, numElems);
+}
+
 /*
  * debug
  */
 
 int compareStates(Qureg qureg1, Qureg qureg2, qreal precision) {
     validateMatchingQuregDims(qureg1, qureg2, __func__);
+    statevec_commitLazyFactor(qureg1);
+    statevec_commitLazyFactor(qureg2);
     return statevec_compareStates(qureg1, qureg2, precision);
 }
 
 void initDebugState(Qureg qureg) {
     statevec_initDebugState(qureg);
+    statevec_clearLazyFactor(qureg);
 }
 
 void initStateFromSingleFile(Qureg *qureg, char filename[200], QuESTEnv env) {
     int success = statevec_initStateFromSingleFile(qureg, filename, env);
     validateFileOpened(success, __func__);
+    statevec_clearLazyFactor(*qureg);
 }
 
 void initStateOfSingleQubit(Qureg *qureg, int qubitId, int outcome) {
@@ -1106,9 +1465,11 @@ void initStateOfSingleQubit(Qureg *qureg, int qubitId, int outcome) {
     validateTarget(*qureg, qubitId, __func__);
     validateOutcome(outcome, __func__);
     statevec_initStateOfSingleQubit(qureg, qubitId, outcome);
+    statevec_clearLazyFactor(*qureg);
 }
 
 void reportStateToScreen(Qureg qureg, QuESTEnv env, int reportRank)  {
+    statevec_commitLazyFactor(qureg);
     statevec_reportStateToScreen(qureg, env, reportRank);
 }
 
@@ -36,14 +36,20 @@
   #include <Windows.h>
   #include <io.h>
   #include <process.h>
+  #include <sys/stat.h>
 #else
   #include <unistd.h>
   #include <sys/time.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
 #endif
 
 # include <sys/types.h> 
 # include <stdio.h>
 # include <stdlib.h>
+# include <string.h>
+# include <stdint.h>
 
 
 #ifdef __cplusplus
@@ -100,6 +106,14 @@ Complex getConjugateScalar(Complex scalar) {
     return conjScalar;
 }
 
+Complex getProductOfScalars(Complex a, Complex b) {
+    
+    Complex prod;
+    prod.real = a.real*b.real - a.imag*b.imag;
+    prod.imag = a.real*b.imag + a.imag*b.real;
+    return prod;
+}
+
 #define macro_setConjugateMatrix(dest, src, dim) \
     for (int i=0; i<dim; i++) \
         for (int j=0; j<dim; j++) { \
@@ -224,6 +238,7 @@ void seedQuEST(unsigned long int *seedArray, int numSeeds){
 }
 
 void reportState(Qureg qureg){
+    statevec_commitLazyFactor(qureg);
     FILE *state;
     char filename[100];
     long long int index;
@@ -252,10 +267,401 @@ void reportQuregParams(Qureg qureg){
     }
 }
 
+/* Checkpoints written by saveQureg consist of one file per node (just filename when 
+ * the qureg is not distributed, else filename_rank_<k>), each beginning with this 
+ * header (in the writer's byte order), followed by the real components of the file's 
+ * contiguous range of amplitudes, then their imaginary components.
+ */
+typedef struct {
+    char magic[8];
+    int32_t version;
+    int32_t bytesPerReal;
+    int32_t numQubitsRepresented;
+    int32_t isDensityMatrix;
+    int32_t numFiles;
+    int32_t fileIndex;
+    int64_t numAmpsTotal;
+    int64_t firstAmpIndex;
+    int64_t numAmpsInFile;
+    uint32_t byteOrderMark;
+    int32_t layout;
+} QuregFileHeader;
+
+#define QUREG_FILE_MAGIC "QuESTqrg"
+#define QUREG_FILE_VERSION 1
+#define QUREG_FILE_BYTE_ORDER_MARK 0x01020304
+#define QUREG_FILE_LAYOUT_SPLIT_COMPLEX 0
+
+/* allocates and returns the name of the file which stores the given fraction of a checkpoint */
+char* getQuregFileName(char* filename, int numFiles, int fileIndex) {
+    
+    char* name = malloc(strlen(filename) + 32);
+    if (numFiles == 1)
+        sprintf(name, "%s", filename);
+    else
+        sprintf(name, "%s_rank_%d", filename, fileIndex);
+    return name;
+}
+
+int saveQuregChunk(Qureg qureg, char* filename) {
+    
+    QuregFileHeader header;
+    memset(&header, 0, sizeof header);
+    memcpy(header.magic, QUREG_FILE_MAGIC, sizeof header.magic);
+    header.version = QUREG_FILE_VERSION;
+    header.bytesPerReal = sizeof(qreal);
+    header.numQubitsRepresented = qureg.numQubitsRepresented;
+    header.isDensityMatrix = qureg.isDensityMatrix;
+    header.numFiles = qureg.numChunks;
+    header.fileIndex = qureg.chunkId;
+    header.numAmpsTotal = qureg.numAmpsTotal;
+    header.firstAmpIndex = qureg.chunkId * qureg.numAmpsPerChunk;
+    header.numAmpsInFile = qureg.numAmpsPerChunk;
+    header.byteOrderMark = QUREG_FILE_BYTE_ORDER_MARK;
+    header.layout = QUREG_FILE_LAYOUT_SPLIT_COMPLEX;
+    
+    char* name = getQuregFileName(filename, qureg.numChunks, qureg.chunkId);
+    FILE* file = fopen(name, "wb");
+    free(name);
+    if (file == NULL)
+        return 0;
+    
+    size_t numAmps = qureg.numAmpsPerChunk;
+    int success = (
+        fwrite(&header, sizeof header, 1, file) == 1 &&
+        fwrite(qureg.stateVec.real, sizeof(qreal), numAmps, file) == numAmps &&
+        fwrite(qureg.stateVec.imag, sizeof(qreal), numAmps, file) == numAmps);
+    
+    // closing flushes, which may itself fail (e.g. on a full disk)
+    return (fclose(file) == 0) && success;
+}
+
+/* Writes this node's chunk to its own checkpoint file, returning whether every node succeeded */
+int agnostic_saveQureg(Qureg qureg, char* filename) {
+    
+    int success = saveQuregChunk(qureg, filename);
+    return syncQuESTSuccess(success);
+}
+
+/* reads and checks the header of the given fraction of a checkpoint, returning a QUREG_FILE_ code */
+int readQuregFileHeader(FILE* file, Qureg qureg, QuregFileHeader* header) {
+    
+    if (fread(header, sizeof *header, 1, file) != 1)
+        return QUREG_FILE_INVALID;
+    if (memcmp(header->magic, QUREG_FILE_MAGIC, sizeof header->magic) != 0 ||
+        header->version != QUREG_FILE_VERSION ||
+        header->byteOrderMark != QUREG_FILE_BYTE_ORDER_MARK ||
+        header->layout != QUREG_FILE_LAYOUT_SPLIT_COMPLEX ||
+        header->numFiles < 1 || header->numAmpsTotal % header->numFiles != 0 ||
+        header->numAmpsInFile != header->numAmpsTotal / header->numFiles ||
+        header->firstAmpIndex != header->fileIndex * header->numAmpsInFile)
+        return QUREG_FILE_INVALID;
+    if (header->bytesPerReal != sizeof(float) && 
+        header->bytesPerReal != sizeof(double) && 
+        header->bytesPerReal != sizeof(long double))
+        return QUREG_FILE_INVALID;
+    if (header->numQubitsRepresented != qureg.numQubitsRepresented ||
+        header->isDensityMatrix != qureg.isDensityMatrix ||
+        header->numAmpsTotal != qureg.numAmpsTotal)
+        return QUREG_FILE_MISMATCH;
+    return QUREG_FILE_LOADED;
+}
+
+/* converts numReals reals, each of bytesPerReal (that of a float, double or long double), into qreals */
+void convertQuregFileReals(qreal* dest, char* src, int bytesPerReal, long long int numReals) {
+    
+    if (bytesPerReal == sizeof(float))
+        for (long long int i=0; i<numReals; i++)
+            dest[i] = (qreal) ((float*) src)[i];
+    else if (bytesPerReal == sizeof(double))
+        for (long long int i=0; i<numReals; i++)
+            dest[i] = (qreal) ((double*) src)[i];
+    else
+        for (long long int i=0; i<numReals; i++)
+            dest[i] = (qreal) ((long double*) src)[i];
+}
+
+/* copies numAmps amplitudes, from the ampOffset-th in the named file, into the chunk at chunkOffset,
+ * converting them from the precision of the file if it differs from qreal. 
+ * On POSIX systems the file is memory-mapped, so that its pages are copied directly into the 
+ * chunk without an intermediate buffer
+ */
+int readQuregFileAmps(char* name, QuregFileHeader header, Qureg qureg, 
+    long long int ampOffset, long long int chunkOffset, long long int numAmps
+) {
+    int bytesPerReal = header.bytesPerReal;
+    int isSamePrec = (bytesPerReal == sizeof(qreal));
+    long long int blockSize = header.numAmpsInFile * bytesPerReal;
+    long long int offset = sizeof header + ampOffset * bytesPerReal;
+    size_t numBytes = numAmps * bytesPerReal;
+    qreal* destRe = &qureg.stateVec.real[chunkOffset];
+    qreal* destIm = &qureg.stateVec.imag[chunkOffset];
+    
+#if defined(_WIN32) && ! defined(__MINGW32__)
+    FILE* file = fopen(name, "rb");
+    if (file == NULL)
+        return 0;
+    
+    // amplitudes of a different precision are read into a buffer, then converted
+    char* buffRe = isSamePrec? (char*) destRe : malloc(numBytes);
+    char* buffIm = isSamePrec? (char*) destIm : malloc(numBytes);
+    int success = (
+        buffRe != NULL && buffIm != NULL &&
+        _fseeki64(file, offset, SEEK_SET) == 0 &&
+        fread(buffRe, 1, numBytes, file) == numBytes &&
+        _fseeki64(file, offset + blockSize, SEEK_SET) == 0 &&
+        fread(buffIm, 1, numBytes, file) == numBytes);
+    fclose(file);
+    if (!isSamePrec) {
+        if (success) {
+            convertQuregFileReals(destRe, buffRe, bytesPerReal, numAmps);
+            convertQuregFileReals(destIm, buffIm, bytesPerReal, numAmps);
+        }
+        free(buffRe);
+        free(buffIm);
+    }
+    return success;
+#else
+    int fd = open(name, O_RDONLY);
+    if (fd == -1)
+        return 0;
+    
+    // a truncated file cannot be mapped safely
+    struct stat info;
+    size_t fileSize = sizeof header + 2*blockSize;
+    if (fstat(fd, &info) != 0 || (size_t) info.st_size < fileSize) {
+        close(fd);
+        return 0;
+    }
+    
+    char* map = mmap(NULL, fileSize, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return 0;
+    if (isSamePrec) {
+        memcpy(destRe, map + offset, numBytes);
+        memcpy(destIm, map + offset + blockSize, numBytes);
+    } else {
+        convertQuregFileReals(destRe, map + offset, bytesPerReal, numAmps);
+        convertQuregFileReals(destIm, map + offset + blockSize, bytesPerReal, numAmps);
+    }
+    munmap(map, fileSize);
+    return 1;
+#endif
+}
+
+/* returns the size in bytes of an opened file, or -1 if it cannot be determined.
+ * The file's position is restored
+ */
+long long int getQuregFileSize(FILE* file) {
+    
+#if defined(_WIN32) && ! defined(__MINGW32__)
+    struct _stat64 info;
+    if (_fstat64(_fileno(file), &info) != 0)
+        return -1;
+    return info.st_size;
+#else
+    // fileno is not C99, but long is 64-bit on the POSIX platforms QuEST supports
+    long int pos = ftell(file);
+    if (pos < 0 || fseek(file, 0, SEEK_END) != 0)
+        return -1;
+    long int size = ftell(file);
+    if (fseek(file, pos, SEEK_SET) != 0)
+        return -1;
+    return size;
+#endif
+}
+
+int doesQuregFileExist(char* name) {
+    
+    FILE* file = fopen(name, "rb");
+    if (file == NULL)
+        return 0;
+    fclose(file);
+    return 1;
+}
+
+/* Checks the header and size of every checkpoint file overlapping this node's chunk, without
+ * modifying the qureg, returning a QUREG_FILE_ code. The checkpoint may have been saved by 
+ * any number of nodes (which is returned in numFiles); a single-file checkpoint and a 
+ * distributed one of the same name are refused, rather than one silently shadowing the other
+ */
+int checkQuregChunkFiles(Qureg qureg, char* filename, int* numFiles) {
+    
+    char* firstName = getQuregFileName(filename, 2, 0);
+    int isSingle = doesQuregFileExist(filename);
+    int isSplit = doesQuregFileExist(firstName);
+    free(firstName);
+    if (isSingle && isSplit)
+        return QUREG_FILE_AMBIGUOUS;
+    if (!isSingle && !isSplit)
+        return QUREG_FILE_NOT_OPENED;
+    
+    // the number of files is recorded in each, and must agree with the layout found
+    QuregFileHeader header;
+    char* name = getQuregFileName(filename, isSingle? 1 : 2, 0);
+    FILE* file = fopen(name, "rb");
+    free(name);
+    if (file == NULL)
+        return QUREG_FILE_NOT_OPENED;
+    int status = readQuregFileHeader(file, qureg, &header);
+    fclose(file);
+    if (status != QUREG_FILE_LOADED)
+        return status;
+    if ((header.numFiles == 1) != isSingle)
+        return QUREG_FILE_INVALID;
+    *numFiles = header.numFiles;
+    
+    long long int ampsPerFile = header.numAmpsInFile;
+    long long int chunkStart = qureg.chunkId * qureg.numAmpsPerChunk;
+    long long int chunkEnd = chunkStart + qureg.numAmpsPerChunk;
+    
+    for (int f = chunkStart/ampsPerFile; f <= (chunkEnd-1)/ampsPerFile; f++) {
+        
+        name = getQuregFileName(filename, *numFiles, f);
+        file = fopen(name, "rb");
+        free(name);
+        if (file == NULL)
+            return QUREG_FILE_NOT_OPENED;
+        
+        status = readQuregFileHeader(file, qureg, &header);
+        long long int size = getQuregFileSize(file);
+        fclose(file);
+        if (status == QUREG_FILE_LOADED && (
+                header.numFiles != *numFiles || header.fileIndex != f ||
+                size < (long long int) sizeof header + 2 * header.numAmpsInFile * header.bytesPerReal))
+            status = QUREG_FILE_INVALID;
+        if (status != QUREG_FILE_LOADED)
+            return status;
+    }
+    
+    return QUREG_FILE_LOADED;
+}
+
+/* Overwrites this node's chunk with its range of amplitudes from every file (of a checkpoint 
+ * already checked by checkQuregChunkFiles) which overlaps it, returning a QUREG_FILE_ code
+ */
+int loadQuregChunk(Qureg qureg, char* filename, int numFiles) {
+    
+    long long int ampsPerFile = qureg.numAmpsTotal / numFiles;
+    long long int chunkStart = qureg.chunkId * qureg.numAmpsPerChunk;
+    long long int chunkEnd = chunkStart + qureg.numAmpsPerChunk;
+    
+    for (int f = chunkStart/ampsPerFile; f <= (chunkEnd-1)/ampsPerFile; f++) {
+        
+        char* name = getQuregFileName(filename, numFiles, f);
+        FILE* file = fopen(name, "rb");
+        QuregFileHeader header;
+        int status = (file == NULL)? QUREG_FILE_NOT_OPENED : readQuregFileHeader(file, qureg, &header);
+        if (file != NULL)
+            fclose(file);
+        
+        long long int fileStart = f * ampsPerFile;
+        long long int start = (chunkStart > fileStart)? chunkStart : fileStart;
+        long long int end = (chunkEnd < fileStart + ampsPerFile)? chunkEnd : fileStart + ampsPerFile;
+        if (status == QUREG_FILE_LOADED && 
+            !readQuregFileAmps(name, header, qureg, start - fileStart, start - chunkStart, end - start))
+            status = QUREG_FILE_INVALID;
+        
+        free(name);
+        if (status != QUREG_FILE_LOADED)
+            return status;
+    }
+    
+    return QUREG_FILE_LOADED;
+}
+
+/* returns the first error (in order of QUREG_FILE_ code) encountered by any node, else QUREG_FILE_LOADED */
+int syncQuregFileStatus(int status) {
+    
+    for (int error=QUREG_FILE_NOT_OPENED; error <= QUREG_FILE_AMBIGUOUS; error++)
+        if (!syncQuESTSuccess(status != error))
+            return error;
+    return QUREG_FILE_LOADED;
+}
+
+/* Overwrites this node's chunk with its amplitudes in a checkpoint, returning a QUREG_FILE_ code 
+ * which is agreed between all nodes, so that all succeed or fail (with the same error) together.
+ * Every node checks all of its files before any amplitudes are overwritten, so that an invalid 
+ * or incomplete checkpoint leaves the qureg unchanged; only a subsequent read error (of a file 
+ * found complete) can leave it partially overwritten
+ */
+int agnostic_loadQureg(Qureg qureg, char* filename) {
+    
+    int numFiles = 0;
+    int status = syncQuregFileStatus(checkQuregChunkFiles(qureg, filename, &numFiles));
+    if (status != QUREG_FILE_LOADED)
+        return status;
+    
+    return syncQuregFileStatus(loadQuregChunk(qureg, filename, numFiles));
+}
+
+/* The lazy factor is a complex scalar (stored once per qureg, alongside the QASM
+ * logger) which implicitly multiplies every amplitude. Operations which are linear
+ * in the amplitudes (gates, channels, projectors) commute with it and ignore it,
+ * reads apply it on the fly, and it is only committed to the amplitudes (by a single
+ * sweep) before an operation which is neither.
+ */
+
+void statevec_createLazyFactor(Qureg* qureg) {
+    
+    qureg->lazyFactor = malloc(sizeof *(qureg->lazyFactor));
+    if (qureg->lazyFactor == NULL) {
+        printf("Could not allocate memory!\n");
+        exit (EXIT_FAILURE);
+    }
+    statevec_clearLazyFactor(*qureg);
+}
+
+void statevec_destroyLazyFactor(Qureg qureg) {
+    
+    free(qureg.lazyFactor);
+}
+
+void statevec_clearLazyFactor(Qureg qureg) {
+    
+    qureg.lazyFactor->real = 1;
+    qureg.lazyFactor->imag = 0;
+}
+
+void statevec_scaleLazyFactor(Qureg qureg, Complex fac) {
+    
+    *(qureg.lazyFactor) = getProductOfScalars(*(qureg.lazyFactor), fac);
+}
+
+void statevec_commitLazyFactor(Qureg qureg) {
+    
+    Complex fac = *(qureg.lazyFactor);
+    if (fac.real == 1 && fac.imag == 0)
+        return;
+    
+    Complex zero; zero.real=0; zero.imag=0;
+    statevec_setWeightedQureg(zero, qureg, zero, qureg, fac, qureg);
+    statevec_clearLazyFactor(qureg);
+}
+
+void statevec_commitLazyFactorUnlessPhase(Qureg qureg) {
+    
+    // a global phase cannot affect the probabilities of a state-vector, so may stay lazy
+    Complex fac = *(qureg.lazyFactor);
+    qreal norm = fac.real*fac.real + fac.imag*fac.imag;
+    if (!qureg.isDensityMatrix && absReal(1 - norm) < REAL_EPS)
+        return;
+    
+    statevec_commitLazyFactor(qureg);
+}
+
+Complex statevec_getAmp(Qureg qureg, long long int index) {
+    
+    Complex amp;
+    amp.real = statevec_getRealAmp(qureg, index);
+    amp.imag = statevec_getImagAmp(qureg, index);
+    return getProductOfScalars(amp, *(qureg.lazyFactor));
+}
+
 qreal statevec_getProbAmp(Qureg qureg, long long int index){
-    qreal real = statevec_getRealAmp(qureg, index);
-    qreal imag = statevec_getImagAmp(qureg, index);
-    return real*real + imag*imag;
+    Complex amp = statevec_getAmp(qureg, index);
+    return amp.real*amp.real + amp.imag*amp.imag;
 }
 
 void statevec_phaseShift(Qureg qureg, const int targetQubit, qreal angle) {
@@ -422,39 +828,46 @@ void statevec_multiRotatePauli(
     Qureg qureg, int* targetQubits, enum pauliOpType* targetPaulis, int numTargets, qreal angle,
     int applyConj
 ) {
-    qreal fac = 1/sqrt(2);
-    Complex uRxAlpha = {.real = fac, .imag = 0}; // Rx(pi/2)* rotates Z -> Y
-    Complex uRxBeta = {.real = 0, .imag = (applyConj)? fac : -fac};
-    Complex uRyAlpha = {.real = fac, .imag = 0}; // Ry(-pi/2) rotates Z -> X
-    Complex uRyBeta = {.real = -fac, .imag = 0};
-    
-    // mask may be modified to remove superfluous Identity ops
-    long long int mask = getQubitBitMask(targetQubits, numTargets);
-    
-    // rotate basis so that exp(Z) will effect exp(Y) and exp(X)
+    // P|x> = i^numY (-1)^parity(x & phaseMask) |x ^ flipMask>, 
+    // so exp(-i angle/2 P) mixes only the amplitude pairs |x>, |x ^ flipMask>
+    long long int flipMask = 0;
+    long long int phaseMask = 0;
+    int numY = 0;
     for (int t=0; t < numTargets; t++) {
-        if (targetPaulis[t] == PAULI_I)
-            mask -= 1LL << targetQubits[t]; // remove target from mask
+        long long int bit = 1LL << targetQubits[t];
+        // (targetPaulis[t] == PAULI_I) is removed
         if (targetPaulis[t] == PAULI_X)
-            statevec_compactUnitary(qureg, targetQubits[t], uRyAlpha, uRyBeta);
-        if (targetPaulis[t] == PAULI_Y)
-            statevec_compactUnitary(qureg, targetQubits[t], uRxAlpha, uRxBeta);
-        // (targetPaulis[t] == 3) is Z basis
+            flipMask |= bit;
+        if (targetPaulis[t] == PAULI_Y) {
+            flipMask |= bit;
+            phaseMask |= bit;
+            numY++;
+        }
+        if (targetPaulis[t] == PAULI_Z)
+            phaseMask |= bit;
     }
     
-    // does nothing if there are no qubits to 'rotate'
-    if (mask != 0)
-        statevec_multiRotateZ(qureg, mask, (applyConj)? -angle : angle);
+    // a diagonal P is effected by multiRotateZ, which does nothing if there are no qubits to 'rotate'
+    if (flipMask == 0) {
+        if (phaseMask != 0)
+            statevec_multiRotateZ(qureg, phaseMask, (applyConj)? -angle : angle);
+        return;
+    }
     
-    // undo X and Y basis rotations
-    uRxBeta.imag *= -1;
-    uRyBeta.real *= -1;
-    for (int t=0; t < numTargets; t++) {
-        if (targetPaulis[t] == PAULI_X)
-            statevec_compactUnitary(qureg, targetQubits[t], uRyAlpha, uRyBeta);
-        if (targetPaulis[t] == PAULI_Y)
-            statevec_compactUnitary(qureg, targetQubits[t], uRxAlpha, uRxBeta);
+    // exp(-i angle/2 P) = cos(angle/2) + sinFac (-1)^parity |x ^ flipMask><x|, where sinFac = -i sin(angle/2) i^numY
+    qreal cosAngle = cos(angle/2);
+    qreal sinAngle = sin(angle/2);
+    Complex sinFac;
+    switch (numY % 4) {
+        case 0: sinFac.real = 0;         sinFac.imag = - sinAngle; break;
+        case 1: sinFac.real = sinAngle;  sinFac.imag = 0;          break;
+        case 2: sinFac.real = 0;         sinFac.imag = sinAngle;   break;
+        case 3: sinFac.real = - sinAngle; sinFac.imag = 0;         break;
     }
+    if (applyConj)
+        sinFac.imag *= -1;
+    
+    statevec_multiRotatePauliByMasks(qureg, flipMask, phaseMask, cosAngle, sinFac);
 }
 
 /* produces both pauli|qureg> or pauli * qureg (as a density matrix) */
@@ -501,29 +914,636 @@ qreal statevec_calcExpecPauliSum(Qureg qureg, enum pauliOpType* allCodes, qreal*
     return value;
 }
 
+/* a term of a Pauli sum in the mask form of statevec_multiRotatePauli, such that the term 
+ * maps |x> to coeff (-1)^parity(x & phaseMask) |x ^ flipMask>, with coeff including i^numY
+ */
+typedef struct {
+    long long int flipMask;
+    long long int phaseMask;
+    Complex coeff;
+} PauliSumTerm;
+
+int comparePauliSumTermFlipMasks(const void* a, const void* b) {
+    
+    long long int maskA = ((const PauliSumTerm*) a)->flipMask;
+    long long int maskB = ((const PauliSumTerm*) b)->flipMask;
+    return (maskA > maskB) - (maskA < maskB);
+}
+
 void statevec_applyPauliSum(Qureg inQureg, enum pauliOpType* allCodes, qreal* termCoeffs, int numSumTerms, Qureg outQureg) {
     
     int numQb = inQureg.numQubitsRepresented;
+    PauliSumTerm* terms = malloc(numSumTerms * sizeof *terms);
+    if (terms == NULL) {
+        printf("Could not allocate memory!\n");
+        exit (EXIT_FAILURE);
+    }
+    
+    for (int t=0; t < numSumTerms; t++) {
+        long long int flipMask = 0;
+        long long int phaseMask = 0;
+        int numY = 0;
+        for (int q=0; q < numQb; q++) {
+            enum pauliOpType code = allCodes[t*numQb + q];
+            if (code == PAULI_X || code == PAULI_Y)
+                flipMask |= 1LL << q;
+            if (code == PAULI_Y || code == PAULI_Z)
+                phaseMask |= 1LL << q;
+            if (code == PAULI_Y)
+                numY++;
+        }
+        
+        // Y|b> = i (-1)^b |!b>, so the term's coefficient gains i^numY
+        qreal c = termCoeffs[t];
+        Complex coeff;
+        switch (numY % 4) {
+            case 0: coeff.real = c;   coeff.imag = 0;   break;
+            case 1: coeff.real = 0;   coeff.imag = c;   break;
+            case 2: coeff.real = -c;  coeff.imag = 0;   break;
+            case 3: coeff.real = 0;   coeff.imag = -c;  break;
+        }
+        terms[t] = (PauliSumTerm) {.flipMask=flipMask, .phaseMask=phaseMask, .coeff=coeff};
+    }
+    
+    // terms sharing a flipMask gather from the same amplitudes, so are applied in one pass
+    qsort(terms, numSumTerms, sizeof *terms, comparePauliSumTermFlipMasks);
+    
+    long long int* phaseMasks = malloc(numSumTerms * sizeof *phaseMasks);
+    Complex* coeffs = malloc(numSumTerms * sizeof *coeffs);
+    if (phaseMasks == NULL || coeffs == NULL) {
+        printf("Could not allocate memory!\n");
+        exit (EXIT_FAILURE);
+    }
+    for (int t=0; t < numSumTerms; t++) {
+        phaseMasks[t] = terms[t].phaseMask;
+        coeffs[t] = terms[t].coeff;
+    }
+    
+    // outQureg = sum_t coeff_t paulis_t(inQureg), leaving inQureg unmodified
+    statevec_initBlankState(outQureg);
+    
+    int first, last;
+    for (first=0; first < numSumTerms; first=last) {
+        for (last=first; last < numSumTerms && terms[last].flipMask == terms[first].flipMask; last++)
+            ;
+        statevec_addPauliProdsByMask(inQureg, terms[first].flipMask, 
+            &phaseMasks[first], &coeffs[first], last - first, outQureg);
+    }
+    
+    free(terms);
+    free(phaseMasks);
+    free(coeffs);
+}
+
+int arePauliProdsCommuting(enum pauliOpType* codes1, enum pauliOpType* codes2, int numQb) {
+    
+    // Pauli products commute iff they contain an even number of anticommuting pairs
+    int numAnticommuting = 0;
+    for (int q=0; q < numQb; q++)
+        if (codes1[q] != PAULI_I && codes2[q] != PAULI_I && codes1[q] != codes2[q])
+            numAnticommuting++;
+    return (numAnticommuting % 2) == 0;
+}
+
+int arePauliProdsEqual(enum pauliOpType* codes1, enum pauliOpType* codes2, int numQb) {
+    
+    for (int q=0; q < numQb; q++)
+        if (codes1[q] != codes2[q])
+            return 0;
+    return 1;
+}
+
+/* Copies the Pauli sum into outCodes and outCoeffs (each at least as long as 
+ * the input), merging terms with identical Pauli products, and ordering terms 
+ * such that each (greedily formed) group of mutually commuting terms is contiguous, 
+ * within which their Trotterisation is exact. The all-identity term is removed, 
+ * with its coefficient returned in idenCoeff. Returns the new number of terms.
+ */
+int getGroupedPauliSum(
+    int numQb, enum pauliOpType* allCodes, qreal* termCoeffs, int numSumTerms, 
+    enum pauliOpType* outCodes, qreal* outCoeffs, qreal* idenCoeff
+) {
+    int* termInds = malloc(numSumTerms * sizeof *termInds);
+    int* groupInds = malloc(numSumTerms * sizeof *groupInds);
+    qreal* coeffs = malloc(numSumTerms * sizeof *coeffs);
+    if (termInds == NULL || groupInds == NULL || coeffs == NULL) {
+        printf("Could not allocate memory!\n");
+        exit (EXIT_FAILURE);
+    }
+    int numTerms = 0;
+    int numGroups = 0;
+    *idenCoeff = 0;
+    
+    for (int t=0; t < numSumTerms; t++) {
+        enum pauliOpType* codes = &allCodes[t*numQb];
+        
+        int isIden = 1;
+        for (int q=0; q < numQb; q++)
+            if (codes[q] != PAULI_I)
+                isIden = 0;
+        if (isIden) {
+            *idenCoeff += termCoeffs[t];
+            continue;
+        }
+        
+        // merge with an existing identical term
+        int m;
+        for (m=0; m < numTerms; m++)
+            if (arePauliProdsEqual(codes, &allCodes[termInds[m]*numQb], numQb))
+                break;
+        if (m < numTerms) {
+            coeffs[m] += termCoeffs[t];
+            continue;
+        }
+        
+        // else join the first group whose every term commutes with this one
+        int g;
+        for (g=0; g < numGroups; g++) {
+            int commutes = 1;
+            for (int n=0; n < numTerms && commutes; n++)
+                if (groupInds[n] == g)
+                    commutes = arePauliProdsCommuting(codes, &allCodes[termInds[n]*numQb], numQb);
+            if (commutes)
+                break;
+        }
+        if (g == numGroups)
+            numGroups++;
+            
+        termInds[numTerms] = t;
+        groupInds[numTerms] = g;
+        coeffs[numTerms] = termCoeffs[t];
+        numTerms++;
+    }
+    
+    // output terms group by group
+    int outInd = 0;
+    for (int g=0; g < numGroups; g++)
+        for (int n=0; n < numTerms; n++)
+            if (groupInds[n] == g) {
+                for (int q=0; q < numQb; q++)
+                    outCodes[outInd*numQb + q] = allCodes[termInds[n]*numQb + q];
+                outCoeffs[outInd] = coeffs[n];
+                outInd++;
+            }
+    
+    free(termInds);
+    free(groupInds);
+    free(coeffs);
+    return numTerms;
+}
+
+/* effects exp(-i fac H) for Pauli sum H, as a product of the exponential of each 
+ * term, in the given order or its reverse 
+ */
+void applyExponentiatedPauliSum(
+    Qureg qureg, enum pauliOpType* allCodes, qreal* termCoeffs, int numSumTerms, 
+    qreal fac, int reverse
+) {
+    int numQb = qureg.numQubitsRepresented;
     int targs[AT_LEAST(numQb)];
     for (int q=0; q < numQb; q++)
         targs[q] = q;
+    
+    for (int i=0; i < numSumTerms; i++) {
+        int t = (reverse)? numSumTerms-1-i : i;
         
-    statevec_initBlankState(outQureg);
+        // exp(-i fac c P) = multiRotatePauli(2 fac c)
+        qreal angle = 2 * fac * termCoeffs[t];
+        statevec_multiRotatePauli(qureg, targs, &allCodes[t*numQb], numQb, angle, 0);
+        if (qureg.isDensityMatrix) {
+            shiftIndices(targs, numQb, numQb);
+            statevec_multiRotatePauli(qureg, targs, &allCodes[t*numQb], numQb, angle, 1);
+            shiftIndices(targs, numQb, -numQb);
+        }
+    }
+}
+
+/* effects a single Trotter-Suzuki step of the given order (1, or even), 
+ * recursively via the Suzuki construction for order > 2
+ */
+void applySymmetrizedTrotterCircuit(
+    Qureg qureg, enum pauliOpType* allCodes, qreal* termCoeffs, int numSumTerms, 
+    qreal time, int order
+) {
+    if (order == 1) {
+        applyExponentiatedPauliSum(qureg, allCodes, termCoeffs, numSumTerms, time, 0);
+    }
+    else if (order == 2) {
+        applyExponentiatedPauliSum(qureg, allCodes, termCoeffs, numSumTerms, time/2., 0);
+        applyExponentiatedPauliSum(qureg, allCodes, termCoeffs, numSumTerms, time/2., 1);
+    }
+    else {
+        qreal p = 1. / (4 - pow(4, 1./(order-1)));
+        int lower = order - 2;
+        applySymmetrizedTrotterCircuit(qureg, allCodes, termCoeffs, numSumTerms, p*time, lower);
+        applySymmetrizedTrotterCircuit(qureg, allCodes, termCoeffs, numSumTerms, p*time, lower);
+        applySymmetrizedTrotterCircuit(qureg, allCodes, termCoeffs, numSumTerms, (1-4*p)*time, lower);
+        applySymmetrizedTrotterCircuit(qureg, allCodes, termCoeffs, numSumTerms, p*time, lower);
+        applySymmetrizedTrotterCircuit(qureg, allCodes, termCoeffs, numSumTerms, p*time, lower);
+    }
+}
+
+void statevec_applyTrotterCircuit(
+    Qureg qureg, enum pauliOpType* allCodes, qreal* termCoeffs, int numSumTerms, 
+    qreal time, int order, int reps
+) {
+    if (time == 0)
+        return;
     
-    for (int t=0; t < numSumTerms; t++) {
-        Complex coef = (Complex) {.real=termCoeffs[t], .imag=0};
-        Complex iden = (Complex) {.real=1, .imag=0};
-        Complex zero = (Complex) {.real=0, .imag=0};
+    // group the terms once, for all repetitions
+    int numQb = qureg.numQubitsRepresented;
+    enum pauliOpType* codes = malloc(numSumTerms * numQb * sizeof *codes);
+    qreal* coeffs = malloc(numSumTerms * sizeof *coeffs);
+    if (codes == NULL || coeffs == NULL) {
+        printf("Could not allocate memory!\n");
+        exit (EXIT_FAILURE);
+    }
+    qreal idenCoeff;
+    int numTerms = getGroupedPauliSum(
+        numQb, allCodes, termCoeffs, numSumTerms, codes, coeffs, &idenCoeff);
+    
+    for (int r=0; r < reps; r++)
+        applySymmetrizedTrotterCircuit(qureg, codes, coeffs, numTerms, time/reps, order);
+        
+    // the identity term commutes with all others, so effects exactly the global 
+    // phase exp(-i c time), which is applied lazily and cannot change density matrices
+    if (idenCoeff != 0 && !qureg.isDensityMatrix) {
+        Complex phase;
+        phase.real = cos(- idenCoeff * time);
+        phase.imag = sin(- idenCoeff * time);
+        statevec_scaleLazyFactor(qureg, phase);
+    }
+    
+    free(codes);
+    free(coeffs);
+}
+
+/* The largest Krylov subspace built by applyKrylovEvolution and calcGroundState, and
+ * the maximum number of times calcGroundState restarts from its latest Ritz vector
+ */
+#define MAX_KRYLOV_DIM 30
+#define MAX_GROUND_STATE_RESTARTS 1000
+
+/* The error (in the normalised state) permitted per step of applyKrylovEvolution */
+#define KRYLOV_EVOLUTION_TOLERANCE (10*REAL_EPS)
+
+/* Overwrites eigVals and the columns of eigVecs (row-major, dim x dim) with the eigenvalues
+ * and eigenvectors of the real symmetric matrix matr (which is destroyed), by cyclic Jacobi
+ * rotations. This is only ever applied to the small matrices of Krylov subspaces.
+ */
+void getSymmetricEigenDecomposition(int dim, qreal* matr, qreal* eigVals, qreal* eigVecs) {
+    
+    for (int r=0; r < dim; r++)
+        for (int c=0; c < dim; c++)
+            eigVecs[r*dim + c] = (r == c);
+    
+    for (int sweep=0; sweep < 100; sweep++) {
+        qreal offDiag = 0;
+        for (int r=0; r < dim; r++)
+            for (int c=r+1; c < dim; c++)
+                offDiag += matr[r*dim + c] * matr[r*dim + c];
+        if (offDiag == 0)
+            break;
+        
+        for (int p=0; p < dim; p++) {
+            for (int q=p+1; q < dim; q++) {
+                qreal apq = matr[p*dim + q];
+                if (apq == 0)
+                    continue;
+                
+                // the rotation (cos, sin) which zeroes matr[p][q]
+                qreal theta = (matr[q*dim + q] - matr[p*dim + p]) / (2*apq);
+                qreal t = ((theta >= 0)? 1 : -1) / (fabs(theta) + sqrt(theta*theta + 1));
+                qreal cs = 1 / sqrt(t*t + 1);
+                qreal sn = t * cs;
+                
+                for (int k=0; k < dim; k++) {
+                    qreal akp = matr[k*dim + p];
+                    qreal akq = matr[k*dim + q];
+                    matr[k*dim + p] = cs*akp - sn*akq;
+                    matr[k*dim + q] = sn*akp + cs*akq;
+                }
+                for (int k=0; k < dim; k++) {
+                    qreal apk = matr[p*dim + k];
+                    qreal aqk = matr[q*dim + k];
+                    matr[p*dim + k] = cs*apk - sn*aqk;
+                    matr[q*dim + k] = sn*apk + cs*aqk;
+                }
+                for (int k=0; k < dim; k++) {
+                    qreal vkp = eigVecs[k*dim + p];
+                    qreal vkq = eigVecs[k*dim + q];
+                    eigVecs[k*dim + p] = cs*vkp - sn*vkq;
+                    eigVecs[k*dim + q] = sn*vkp + cs*vkq;
+                }
+            }
+        }
+    }
+    
+    for (int k=0; k < dim; k++)
+        eigVals[k] = matr[k*dim + k];
+}
+
+/* Performs (at most maxDim steps of) the Lanczos recurrence of the Pauli sum from the 
+ * normalised state qureg/norm, without modifying qureg. Populates alphas (the diagonal of 
+ * the tridiagonal projection of the Pauli sum) and betas, where betas[k] couples the k-1 and
+ * k-th basis vectors, and betas[dim] couples the subspace to the rest of the Hilbert space,
+ * or is zero if the subspace is invariant. Returns the subspace dimension, dim.
+ * The basis vectors are not retained; populateKrylovCombination regenerates them.
+ */
+int populateLanczosCoeffs(
+    Qureg qureg, qreal norm, enum pauliOpType* allCodes, qreal* termCoeffs, int numSumTerms, 
+    Qureg* workspaces, int maxDim, qreal* alphas, qreal* betas
+) {
+    Qureg prevVec = workspaces[0];
+    Qureg currVec = workspaces[1];
+    Qureg nextVec = workspaces[2];
+    Complex zero = {.real=0, .imag=0};
+    Complex one = {.real=1, .imag=0};
+    
+    statevec_initBlankState(prevVec);
+    statevec_setWeightedQureg((Complex) {.real=1/norm, .imag=0}, qureg, zero, qureg, zero, currVec);
+    betas[0] = 0;
+    
+    int dim;
+    for (dim=1; dim <= maxDim; dim++) {
+        
+        // nextVec = H currVec - alpha currVec - beta prevVec
+        statevec_applyPauliSum(currVec, allCodes, termCoeffs, numSumTerms, nextVec);
+        alphas[dim-1] = statevec_calcInnerProduct(currVec, nextVec).real;
+        statevec_setWeightedQureg(
+            (Complex) {.real=-alphas[dim-1], .imag=0}, currVec,
+            (Complex) {.real=-betas[dim-1], .imag=0}, prevVec, one, nextVec);
+        betas[dim] = sqrt(statevec_calcTotalProb(nextVec));
+        
+        // the subspace is (numerically) invariant under H
+        if (betas[dim] <= REAL_EPS * (fabs(alphas[dim-1]) + betas[dim-1])) {
+            betas[dim] = 0;
+            break;
+        }
+        if (dim == maxDim)
+            break;
         
-        // outQureg += coef paulis(inQureg)
-        statevec_applyPauliProd(inQureg, targs, &allCodes[t*numQb], numQb);
-        statevec_setWeightedQureg(coef, inQureg, iden, outQureg, zero, outQureg); 
+        // normalise the next basis vector, and rotate the workspaces
+        statevec_setWeightedQureg(zero, nextVec, zero, nextVec, (Complex) {.real=1/betas[dim], .imag=0}, nextVec);
+        Qureg tmp = prevVec;
+        prevVec = currVec;
+        currVec = nextVec;
+        nextVec = tmp;
+    }
+    
+    return (dim < maxDim)? dim : maxDim;
+}
+
+/* Overwrites qureg with sum_k coeffs[k] v_k, where v_k are the Krylov basis vectors 
+ * (of dimension dim) generated from qureg/norm, by repeating the Lanczos recurrence 
+ * with the alphas and betas of populateLanczosCoeffs
+ */
+void populateKrylovCombination(
+    Qureg qureg, qreal norm, enum pauliOpType* allCodes, qreal* termCoeffs, int numSumTerms, 
+    Qureg* workspaces, int dim, qreal* alphas, qreal* betas, Complex* coeffs
+) {
+    Qureg prevVec = workspaces[0];
+    Qureg currVec = workspaces[1];
+    Qureg nextVec = workspaces[2];
+    Complex zero = {.real=0, .imag=0};
+    Complex one = {.real=1, .imag=0};
+    
+    statevec_initBlankState(prevVec);
+    statevec_setWeightedQureg((Complex) {.real=1/norm, .imag=0}, qureg, zero, qureg, zero, currVec);
+    statevec_setWeightedQureg(coeffs[0], currVec, zero, currVec, zero, qureg);
+    
+    for (int k=1; k < dim; k++) {
+        
+        // nextVec = (H currVec - alpha currVec - beta prevVec) / nextBeta
+        statevec_applyPauliSum(currVec, allCodes, termCoeffs, numSumTerms, nextVec);
+        statevec_setWeightedQureg(
+            (Complex) {.real=-alphas[k-1]/betas[k], .imag=0}, currVec,
+            (Complex) {.real=-betas[k-1]/betas[k], .imag=0}, prevVec, 
+            (Complex) {.real=1/betas[k], .imag=0}, nextVec);
         
-        // undero paulis(inQureg), exploiting XX=YY=ZZ=I
-        statevec_applyPauliProd(inQureg, targs, &allCodes[t*numQb], numQb);
+        Qureg tmp = prevVec;
+        prevVec = currVec;
+        currVec = nextVec;
+        nextVec = tmp;
+        
+        statevec_setWeightedQureg(coeffs[k], currVec, zero, currVec, one, qureg);
     }
 }
 
+/* Populates the alphas (diagonal) and betas (off-diagonal) tridiagonal matrix into dense matr */
+void populateTridiagonalMatrix(int dim, qreal* alphas, qreal* betas, qreal* matr) {
+    
+    for (int r=0; r < dim; r++)
+        for (int c=0; c < dim; c++)
+            matr[r*dim + c] = (r == c)? alphas[r] : ((c == r+1)? betas[c] : ((r == c+1)? betas[r] : 0));
+}
+
+void statevec_applyKrylovEvolution(
+    Qureg qureg, enum pauliOpType* allCodes, qreal* termCoeffs, int numSumTerms, 
+    qreal time, Qureg* workspaces
+) {
+    int maxDim = (qureg.numAmpsTotal < MAX_KRYLOV_DIM)? (int) qureg.numAmpsTotal : MAX_KRYLOV_DIM;
+    qreal alphas[MAX_KRYLOV_DIM], betas[MAX_KRYLOV_DIM+1];
+    qreal matr[MAX_KRYLOV_DIM*MAX_KRYLOV_DIM], eigVals[MAX_KRYLOV_DIM], eigVecs[MAX_KRYLOV_DIM*MAX_KRYLOV_DIM];
+    Complex coeffs[MAX_KRYLOV_DIM];
+    
+    qreal remaining = time;
+    while (remaining != 0) {
+        
+        qreal norm = sqrt(statevec_calcTotalProb(qureg));
+        if (norm == 0)
+            return;
+        
+        // H is approximated by its projection T = Q diag(eigVals) Q^T onto the Krylov subspace
+        int dim = populateLanczosCoeffs(
+            qureg, norm, allCodes, termCoeffs, numSumTerms, workspaces, maxDim, alphas, betas);
+        populateTridiagonalMatrix(dim, alphas, betas, matr);
+        getSymmetricEigenDecomposition(dim, matr, eigVals, eigVecs);
+        
+        // find the longest step (by halving) for which exp(-i T dt) e_0 leaks negligibly out of the subspace
+        qreal dt = remaining;
+        for (;;) {
+            for (int k=0; k < dim; k++) {
+                coeffs[k] = (Complex) {.real=0, .imag=0};
+                for (int j=0; j < dim; j++) {
+                    qreal fac = eigVecs[k*dim + j] * eigVecs[0*dim + j];
+                    coeffs[k].real += fac * cos(- eigVals[j] * dt);
+                    coeffs[k].imag += fac * sin(- eigVals[j] * dt);
+                }
+            }
+            qreal leak = betas[dim] * sqrt(
+                coeffs[dim-1].real*coeffs[dim-1].real + coeffs[dim-1].imag*coeffs[dim-1].imag);
+            if (leak <= KRYLOV_EVOLUTION_TOLERANCE || fabs(dt) <= fabs(time) * REAL_EPS)
+                break;
+            dt /= 2;
+        }
+        
+        // qureg = norm V exp(-i T dt) e_0
+        for (int k=0; k < dim; k++) {
+            coeffs[k].real *= norm;
+            coeffs[k].imag *= norm;
+        }
+        populateKrylovCombination(
+            qureg, norm, allCodes, termCoeffs, numSumTerms, workspaces, dim, alphas, betas, coeffs);
+        
+        remaining = (dt == remaining)? 0 : remaining - dt;
+    }
+}
+
+/* Replaces qureg with (an approximation of) the ground state of H, normalised, and returns its 
+ * energy <psi|H|psi>. Sets residual to |H psi - energy psi|, which exceeds tolerance only if 
+ * MAX_GROUND_STATE_RESTARTS were insufficient.
+ * The Lanczos basis is not reorthogonalised (it is never stored), so loses orthogonality and 
+ * the Ritz vector is neither exactly normalised nor exactly of the Ritz value. Hence each 
+ * restart renormalises it, and judges convergence by its true residual (at the cost of
+ * one further application of H), rather than by the Lanczos estimate
+ */
+qreal statevec_calcGroundState(
+    Qureg qureg, enum pauliOpType* allCodes, qreal* termCoeffs, int numSumTerms, 
+    qreal tolerance, Qureg* workspaces, qreal* residual
+) {
+    int maxDim = (qureg.numAmpsTotal < MAX_KRYLOV_DIM)? (int) qureg.numAmpsTotal : MAX_KRYLOV_DIM;
+    qreal alphas[MAX_KRYLOV_DIM], betas[MAX_KRYLOV_DIM+1];
+    qreal matr[MAX_KRYLOV_DIM*MAX_KRYLOV_DIM], eigVals[MAX_KRYLOV_DIM], eigVecs[MAX_KRYLOV_DIM*MAX_KRYLOV_DIM];
+    Complex coeffs[MAX_KRYLOV_DIM];
+    Complex zero = {.real=0, .imag=0};
+    Complex one = {.real=1, .imag=0};
+    
+    qreal energy = 0;
+    for (int restart=0; restart < MAX_GROUND_STATE_RESTARTS; restart++) {
+        
+        qreal norm = sqrt(statevec_calcTotalProb(qureg));
+        int dim = populateLanczosCoeffs(
+            qureg, norm, allCodes, termCoeffs, numSumTerms, workspaces, maxDim, alphas, betas);
+        populateTridiagonalMatrix(dim, alphas, betas, matr);
+        getSymmetricEigenDecomposition(dim, matr, eigVals, eigVecs);
+        
+        // restart from the lowest Ritz vector
+        int low = 0;
+        for (int j=1; j < dim; j++)
+            if (eigVals[j] < eigVals[low])
+                low = j;
+        for (int k=0; k < dim; k++)
+            coeffs[k] = (Complex) {.real=eigVecs[k*dim + low], .imag=0};
+        populateKrylovCombination(
+            qureg, norm, allCodes, termCoeffs, numSumTerms, workspaces, dim, alphas, betas, coeffs);
+        
+        norm = sqrt(statevec_calcTotalProb(qureg));
+        statevec_setWeightedQureg(zero, qureg, zero, qureg, (Complex) {.real=1/norm, .imag=0}, qureg);
+        
+        // the residual |H psi - energy psi| of the normalised Ritz vector
+        Qureg hPsi = workspaces[0];
+        statevec_applyPauliSum(qureg, allCodes, termCoeffs, numSumTerms, hPsi);
+        energy = statevec_calcInnerProduct(qureg, hPsi).real;
+        statevec_setWeightedQureg((Complex) {.real=-energy, .imag=0}, qureg, zero, qureg, one, hPsi);
+        *residual = sqrt(statevec_calcTotalProb(hPsi));
+        if (*residual <= tolerance)
+            break;
+    }
+    
+    return energy;
+}
+
+/* Sub-registers of at most this many qubits (and smaller than a chunk) have their phase function 
+ * evaluated once per value, into a table, rather than once per amplitude
+ */
+#define MAX_NUM_TABULATED_PHASE_FUNC_QUBITS 16
+
+void statevec_applyPhaseFunc(
+    Qureg qureg, int* qubits, int numQubits, enum bitEncoding encoding,
+    qreal* coeffs, qreal* exponents, int numTerms, 
+    long long int* overrideInds, qreal* overridePhases, int numOverrides,
+    int conj
+) {
+    long long int numVals = 1LL << numQubits;
+    if (numQubits > MAX_NUM_TABULATED_PHASE_FUNC_QUBITS || numVals >= qureg.numAmpsPerChunk) {
+        statevec_applyPhaseFuncOverrides(qureg, qubits, numQubits, encoding, 
+            coeffs, exponents, numTerms, overrideInds, overridePhases, numOverrides, conj);
+        return;
+    }
+    
+    // evaluate the phase of every (unsigned) sub-register value
+    qreal* phases = malloc(numVals * sizeof *phases);
+    if (phases == NULL) {
+        printf("Could not allocate memory!\n");
+        exit (EXIT_FAILURE);
+    }
+    for (long long int k=0; k < numVals; k++) {
+        long long int x = (encoding == TWOS_COMPLEMENT && k >= numVals/2)? k - numVals : k;
+        phases[k] = 0;
+        for (int t=0; t < numTerms; t++)
+            phases[k] += coeffs[t] * pow(x, exponents[t]);
+    }
+    
+    // overwrite overridden values, in reverse so that the first override of a value takes precedence
+    for (int i=numOverrides-1; i >= 0; i--) {
+        long long int k = (overrideInds[i] < 0)? overrideInds[i] + numVals : overrideInds[i];
+        phases[k] = overridePhases[i];
+    }
+    
+    statevec_applyPhaseFuncTable(qureg, qubits, numQubits, phases, conj);
+    free(phases);
+}
+
+/* The maximum number of consecutive FFT stages (one per sub-register qubit) which are 
+ * performed in a single pass over the state-vector, by gathering 2^this amplitudes per task
+ */
+#define MAX_NUM_FOURIER_BLOCK_QUBITS 6
+
+/* Applies the QFT (or its conjugate, if conj) to the sub-register of qubits (qubits[0] being least 
+ * significant), as an in-place decimation-in-frequency radix-2 FFT followed by a bit-reversal. 
+ * Consecutive stages on qubits within a chunk are blocked into a single pass, while stages upon 
+ * qubits spread between nodes exchange chunks via the distributed hadamard, as in a 
+ * binary-exchange distributed FFT. The twiddle of such stages needs no communication.
+ */
+void statevec_applyQFT(Qureg qureg, int* qubits, int numQubits, int conj) {
+    
+    // stages proceed from the most significant qubit of the sub-register
+    int stage = numQubits - 1;
+    while (stage >= 0) {
+        
+        if ((1LL << qubits[stage]) >= qureg.numAmpsPerChunk) {
+            statevec_hadamard(qureg, qubits[stage]);
+            if (stage > 0)
+                statevec_applyFourierTwiddles(qureg, qubits, stage, conj);
+            stage--;
+            continue;
+        }
+        
+        int numStages = 1;
+        while (numStages < MAX_NUM_FOURIER_BLOCK_QUBITS && stage - numStages >= 0 &&
+                (1LL << qubits[stage - numStages]) < qureg.numAmpsPerChunk)
+            numStages++;
+        
+        statevec_applyFourierStages(qureg, qubits, stage, numStages, conj);
+        stage -= numStages;
+    }
+    
+    // reverse the order of the sub-register qubits, swapping all pairs within a chunk in one pass
+    int numPairs = 0;
+    int* qubits1 = malloc((numQubits/2) * sizeof *qubits1);
+    int* qubits2 = malloc((numQubits/2) * sizeof *qubits2);
+    if ((qubits1 == NULL || qubits2 == NULL) && numQubits/2 > 0) {
+        printf("Could not allocate memory!\n");
+        exit (EXIT_FAILURE);
+    }
+    for (int i=0; i < numQubits/2; i++) {
+        int qb1 = qubits[i];
+        int qb2 = qubits[numQubits - 1 - i];
+        if ((1LL << qb1) < qureg.numAmpsPerChunk && (1LL << qb2) < qureg.numAmpsPerChunk) {
+            qubits1[numPairs] = qb1;
+            qubits2[numPairs] = qb2;
+            numPairs++;
+        } else
+            statevec_swapQubitAmps(qureg, qb1, qb2);
+    }
+    if (numPairs > 0)
+        statevec_swapQubitAmpsPairs(qureg, qubits1, qubits2, numPairs);
+    
+    free(qubits1);
+    free(qubits2);
+}
+
 void statevec_twoQubitUnitary(Qureg qureg, const int targetQubit1, const int targetQubit2, ComplexMatrix4 u) {
     
     long long int ctrlMask = 0;
@@ -729,6 +1749,19 @@ void densmatr_mixPauli(Qureg qureg, int qubit, qreal probX, qreal probY, qreal p
     densmatr_mixKrausMap(qureg, qubit, ops, numOps);
 }
 
+void densmatr_permuteQubits(Qureg qureg, int* perm) {
+    
+    // permute the row and (shifted) column qubits together, in a single pass
+    int numQb = qureg.numQubitsRepresented;
+    int fullPerm[AT_LEAST(2*numQb)];
+    for (int q=0; q < numQb; q++) {
+        fullPerm[q] = perm[q];
+        fullPerm[q + numQb] = perm[q] + numQb;
+    }
+    
+    statevec_permuteQubits(qureg, fullPerm);
+}
+
 #ifdef __cplusplus
 }
 #endif
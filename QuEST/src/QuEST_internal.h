@@ -14,6 +14,9 @@
 # include "QuEST.h"
 # include "QuEST_precision.h"
 
+/** pi, which math.h need not define under strict C99 */
+# define QUEST_PI 3.14159265358979323846
+
 # ifdef __cplusplus
 extern "C" {
 # endif
@@ -32,6 +35,8 @@ qreal getVectorMagnitude(Vector vec);
 
 Complex getConjugateScalar(Complex scalar);
 
+Complex getProductOfScalars(Complex a, Complex b);
+
 ComplexMatrix2 getConjugateMatrix2(ComplexMatrix2 src);
 
 ComplexMatrix4 getConjugateMatrix4(ComplexMatrix4 src);
@@ -53,6 +58,34 @@ void conjugateMatrixN(ComplexMatrixN u);
 void getQuESTDefaultSeedKey(unsigned long int *key);
 
 
+/*
+ * diagonal operators
+ */
+
+DiagonalOp agnostic_createDiagonalOp(int numQubits, QuESTEnv env);
+
+void agnostic_destroyDiagonalOp(DiagonalOp op);
+
+void agnostic_syncDiagonalOp(DiagonalOp op);
+
+void agnostic_setDiagonalOpElems(DiagonalOp op, long long int startInd, qreal* real, qreal* imag, long long int numElems);
+
+
+/*
+ * checkpoint files
+ */
+
+/** outcomes of loading a qureg from a checkpoint saved by saveQureg */
+enum quregFileStatus {QUREG_FILE_LOADED, QUREG_FILE_NOT_OPENED, QUREG_FILE_INVALID, QUREG_FILE_MISMATCH, QUREG_FILE_AMBIGUOUS};
+
+/** returns the (malloc'd) name of the fileIndex-th of numFiles files sharing the prefix filename */
+char* getQuregFileName(char* filename, int numFiles, int fileIndex);
+
+int agnostic_saveQureg(Qureg qureg, char* filename);
+
+int agnostic_loadQureg(Qureg qureg, char* filename);
+
+
 /*
  * operations upon density matrices 
  */
@@ -73,6 +106,8 @@ qreal densmatr_calcHilbertSchmidtDistance(Qureg a, Qureg b);
 
 qreal densmatr_calcInnerProduct(Qureg a, Qureg b);
 
+void densmatr_calcInnerProductsMatrix(Qureg* quregs, int numQuregs, qreal* matr);
+
 qreal densmatr_calcProbOfOutcome(Qureg qureg, const int measureQubit, int outcome);
 
 void densmatr_collapseToKnownProbOutcome(Qureg qureg, const int measureQubit, int outcome, qreal outcomeProb);
@@ -98,6 +133,12 @@ void densmatr_mixKrausMap(Qureg qureg, int target, ComplexMatrix2 *ops, int numO
 void densmatr_mixTwoQubitKrausMap(Qureg qureg, int target1, int target2, ComplexMatrix4 *ops, int numOps);
 
 void densmatr_mixMultiQubitKrausMap(Qureg qureg, int* targets, int numTargets, ComplexMatrixN* ops, int numOps);
+
+void densmatr_permuteQubits(Qureg qureg, int* perm);
+
+void densmatr_applyDiagonalOp(Qureg qureg, DiagonalOp op);
+
+Complex densmatr_calcExpecDiagonalOp(Qureg qureg, DiagonalOp op);
     
 
 /* 
@@ -114,6 +155,8 @@ void statevec_initStateOfSingleQubit(Qureg *qureg, int qubitId, int outcome);
 
 void statevec_createQureg(Qureg *qureg, int numQubits, QuESTEnv env);
 
+int statevec_createDiskQureg(Qureg *qureg, int numQubits, char* filename, QuESTEnv env);
+
 void statevec_destroyQureg(Qureg qureg, QuESTEnv env);
 
 void statevec_initBlankState(Qureg qureg);
@@ -166,6 +209,20 @@ qreal statevec_getRealAmp(Qureg qureg, long long int index);
 
 qreal statevec_getImagAmp(Qureg qureg, long long int index);
 
+void statevec_createLazyFactor(Qureg* qureg);
+
+void statevec_destroyLazyFactor(Qureg qureg);
+
+void statevec_clearLazyFactor(Qureg qureg);
+
+void statevec_scaleLazyFactor(Qureg qureg, Complex fac);
+
+void statevec_commitLazyFactor(Qureg qureg);
+
+void statevec_commitLazyFactorUnlessPhase(Qureg qureg);
+
+Complex statevec_getAmp(Qureg qureg, long long int index);
+
 qreal statevec_getProbAmp(Qureg qureg, long long int index);
 
 qreal statevec_calcTotalProb(Qureg qureg);
@@ -174,6 +231,8 @@ qreal statevec_calcFidelity(Qureg qureg, Qureg pureState);
 
 Complex statevec_calcInnerProduct(Qureg bra, Qureg ket);
 
+void statevec_calcInnerProductsMatrix(Qureg* quregs, int numQuregs, qreal* matrRe, qreal* matrIm);
+
 qreal statevec_calcExpecPauliProd(Qureg qureg, int* targetQubits, enum pauliOpType* pauliCodes, int numTargets, Qureg workspace);
 
 qreal statevec_calcExpecPauliSum(Qureg qureg, enum pauliOpType* allCodes, qreal* termCoeffs, int numSumTerms, Qureg workspace);
@@ -232,6 +291,8 @@ int statevec_measureWithStats(Qureg qureg, int measureQubit, qreal *outcomeProb)
 
 void statevec_swapQubitAmps(Qureg qureg, int qb1, int qb2);
 
+void statevec_permuteQubits(Qureg qureg, int* perm);
+
 void statevec_sqrtSwapGate(Qureg qureg, int qb1, int qb2);
 
 void statevec_sqrtSwapGateConj(Qureg qureg, int qb1, int qb2);
@@ -240,10 +301,38 @@ void statevec_multiRotateZ(Qureg qureg, long long int mask, qreal angle);
 
 void statevec_multiRotatePauli(Qureg qureg, int* targetQubits, enum pauliOpType* targetPaulis, int numTargets, qreal angle, int applyConj);
 
+void statevec_multiRotatePauliByMasks(Qureg qureg, long long int flipMask, long long int phaseMask, qreal cosAngle, Complex sinFac);
+
+void statevec_addPauliProdsByMask(Qureg inQureg, long long int flipMask, long long int* phaseMasks, Complex* coeffs, int numProds, Qureg outQureg);
+
+void statevec_applyPhaseFunc(Qureg qureg, int* qubits, int numQubits, enum bitEncoding encoding, qreal* coeffs, qreal* exponents, int numTerms, long long int* overrideInds, qreal* overridePhases, int numOverrides, int conj);
+
+void statevec_applyPhaseFuncOverrides(Qureg qureg, int* qubits, int numQubits, enum bitEncoding encoding, qreal* coeffs, qreal* exponents, int numTerms, long long int* overrideInds, qreal* overridePhases, int numOverrides, int conj);
+
+void statevec_applyPhaseFuncTable(Qureg qureg, int* qubits, int numQubits, qreal* phases, int conj);
+
+void statevec_applyQFT(Qureg qureg, int* qubits, int numQubits, int conj);
+
+void statevec_applyFourierStages(Qureg qureg, int* qubits, int topStage, int numStages, int conj);
+
+void statevec_applyFourierTwiddles(Qureg qureg, int* qubits, int stage, int conj);
+
+void statevec_swapQubitAmpsPairs(Qureg qureg, int* qubits1, int* qubits2, int numPairs);
+
 void statevec_setWeightedQureg(Complex fac1, Qureg qureg1, Complex fac2, Qureg qureg2, Complex facOut, Qureg out);
 
 void statevec_applyPauliSum(Qureg inQureg, enum pauliOpType* allCodes, qreal* termCoeffs, int numSumTerms, Qureg outQureg);
 
+void statevec_applyTrotterCircuit(Qureg qureg, enum pauliOpType* allCodes, qreal* termCoeffs, int numSumTerms, qreal time, int order, int reps);
+
+void statevec_applyKrylovEvolution(Qureg qureg, enum pauliOpType* allCodes, qreal* termCoeffs, int numSumTerms, qreal time, Qureg* workspaces);
+
+qreal statevec_calcGroundState(Qureg qureg, enum pauliOpType* allCodes, qreal* termCoeffs, int numSumTerms, qreal tolerance, Qureg* workspaces, qreal* residual);
+
+void statevec_applyDiagonalOp(Qureg qureg, DiagonalOp op);
+
+Complex statevec_calcExpecDiagonalOp(Qureg qureg, DiagonalOp op);
+
 # ifdef __cplusplus
 }
 # endif
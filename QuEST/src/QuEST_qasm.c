@@ -31,9 +31,38 @@
 # define INIT_ZERO_CMD "reset"  // QASM cmd for setting state 0
 # define COMMENT_PREF "//"     // QASM syntax for a comment ;)
 
-# define MAX_LINE_LEN 200       // maximum length (#chars) of a single QASM instruction
-# define BUF_INIT_SIZE 1000     // initial size of the QASM buffer (#chars)
-# define BUF_GROW_FAC 2         // growth factor when buffer dynamically resizes
+# define MAX_LINE_LEN 200       // maximum length (#chars) of a recorded comment
+# define CHUNK_SIZE (1 << 16)   // size (#bytes) of each chunk of the binary record arena
+# define STREAM_THRESHOLD (1LL << 24) // arena size (#bytes) beyond which records are streamed to file
+# define COPY_BUF_SIZE 4096     // size (#chars) of the buffer used to copy streamed QASM
+
+/* Kinds of binary record appended to the arena */
+typedef enum {
+    RECORD_HEADER,          // register declarations; target is the number of qubits
+    RECORD_GATE,            // a (controlled, parameterised) gate upon a single target
+    RECORD_REGISTER_GATE,   // a gate applied to the entire quantum register
+    RECORD_MEASURE,         // measurement of target into the classical register
+    RECORD_INIT_ZERO,       // reset of the entire quantum register
+    RECORD_COMMENT          // a comment; target is the number of chars which follow
+} RecordType;
+
+/* A record is this fixed-size header, immediately followed in the arena by
+ * numControls ints and numParams qreals (or by the chars of a comment). 
+ * These are always copied with memcpy, so need not be aligned in the arena
+ */
+typedef struct {
+    int type;
+    int gate;
+    int target;
+    short numControls;
+    short numParams;
+} QASMRecord;
+
+struct QASMChunk {
+    struct QASMChunk* next;
+    size_t fill;
+    unsigned char bytes[CHUNK_SIZE];
+};
 
 static const char* qasmGateLabels[] = {
     [GATE_SIGMA_X] = "x",
@@ -53,10 +82,163 @@ static const char* qasmGateLabels[] = {
 
 // @TODO make a proper internal error thing
 void bufferOverflow(void) {
-    printf("!!!\nINTERNAL ERROR: QASM line buffer filled!\n!!!");
+    printf("!!!\nINTERNAL ERROR: could not allocate memory for the QASM log!\n!!!");
     exit(1);
 }
 
+void writeRecordToQASM(FILE* file, QASMRecord rec, int* controls, qreal* params, char* comment) {
+    
+    switch (rec.type) {
+        
+        case RECORD_HEADER:
+            fprintf(file, "OPENQASM 2.0;\nqreg %s[%d];\ncreg %s[%d];\n", 
+                QUREG_LABEL, rec.target, MESREG_LABEL, rec.target);
+            break;
+            
+        case RECORD_GATE: ;
+            // two-qubit gates are recorded with their first target as a control
+            int numCtrlLabels = rec.numControls;
+            if (rec.gate == GATE_SWAP || rec.gate == GATE_SQRT_SWAP)
+                numCtrlLabels--;
+            for (int i=0; i < numCtrlLabels; i++)
+                fputs(CTRL_LABEL_PREF, file);
+            fputs(qasmGateLabels[rec.gate], file);
+            if (rec.numParams > 0) {
+                fputc('(', file);
+                for (int i=0; i < rec.numParams; i++) {
+                    fprintf(file, REAL_QASM_FORMAT, params[i]);
+                    if (i != rec.numParams - 1)
+                        fputc(',', file);
+                }
+                fputc(')', file);
+            }
+            fputc(' ', file);
+            for (int i=0; i < rec.numControls; i++)
+                fprintf(file, "%s[%d],", QUREG_LABEL, controls[i]);
+            fprintf(file, "%s[%d];\n", QUREG_LABEL, rec.target);
+            break;
+            
+        case RECORD_REGISTER_GATE:
+            fprintf(file, "%s %s;\n", qasmGateLabels[rec.gate], QUREG_LABEL);
+            break;
+            
+        case RECORD_MEASURE:
+            fprintf(file, "%s %s[%d] -> %s[%d];\n",
+                MEASURE_CMD, QUREG_LABEL, rec.target, MESREG_LABEL, rec.target);
+            break;
+            
+        case RECORD_INIT_ZERO:
+            fprintf(file, "%s %s;\n", INIT_ZERO_CMD, QUREG_LABEL);
+            break;
+            
+        case RECORD_COMMENT:
+            fprintf(file, "%s %.*s\n", COMMENT_PREF, rec.target, comment);
+            break;
+    }
+}
+
+/** formats every record currently in the arena, in order, as QASM into file */
+void writeArenaToQASM(QASMLogger* qasmLog, FILE* file) {
+    
+    int controls[8*sizeof(long long int)];
+    qreal params[3];
+    
+    for (struct QASMChunk* chunk = qasmLog->firstChunk; chunk != NULL; chunk = chunk->next) {
+        
+        size_t pos = 0;
+        while (pos < chunk->fill) {
+            QASMRecord rec;
+            memcpy(&rec, chunk->bytes + pos, sizeof rec);
+            pos += sizeof rec;
+            
+            char* comment = NULL;
+            if (rec.type == RECORD_COMMENT) {
+                comment = (char*) (chunk->bytes + pos);
+                pos += rec.target;
+            } else {
+                memcpy(controls, chunk->bytes + pos, rec.numControls * sizeof *controls);
+                pos += rec.numControls * sizeof *controls;
+                memcpy(params, chunk->bytes + pos, rec.numParams * sizeof *params);
+                pos += rec.numParams * sizeof *params;
+            }
+            writeRecordToQASM(file, rec, controls, params, comment);
+        }
+        
+        // chunks beyond the last are spare capacity retained after clearing
+        if (chunk == qasmLog->lastChunk)
+            break;
+    }
+}
+
+/** empties the arena, retaining its chunks for reuse */
+void resetArena(QASMLogger* qasmLog) {
+    
+    for (struct QASMChunk* chunk = qasmLog->firstChunk; chunk != NULL; chunk = chunk->next)
+        chunk->fill = 0;
+    qasmLog->lastChunk = qasmLog->firstChunk;
+    qasmLog->arenaFill = 0;
+}
+
+/** formats the whole arena onto the end of the stream file, and empties the arena.
+ * If a temporary file cannot be created, the arena is instead permitted to grow further
+ */
+void streamArenaToFile(QASMLogger* qasmLog) {
+    
+    if (qasmLog->streamFile == NULL)
+        qasmLog->streamFile = tmpfile();
+    if (qasmLog->streamFile == NULL) {
+        qasmLog->streamThreshold *= 2;
+        return;
+    }
+    
+    writeArenaToQASM(qasmLog, qasmLog->streamFile);
+    resetArena(qasmLog);
+}
+
+/** returns a pointer to numBytes of contiguous space at the end of the arena */
+unsigned char* reserveRecordSpace(QASMLogger* qasmLog, size_t numBytes) {
+    
+    struct QASMChunk* chunk = qasmLog->lastChunk;
+    if (chunk->fill + numBytes > CHUNK_SIZE) {
+        
+        // reuse a chunk retained from before the log was last cleared, else create one
+        if (chunk->next == NULL) {
+            chunk->next = malloc(sizeof *chunk);
+            if (chunk->next == NULL)
+                bufferOverflow();
+            chunk->next->next = NULL;
+            chunk->next->fill = 0;
+        }
+        chunk = chunk->next;
+        qasmLog->lastChunk = chunk;
+    }
+    
+    unsigned char* space = chunk->bytes + chunk->fill;
+    chunk->fill += numBytes;
+    qasmLog->arenaFill += numBytes;
+    return space;
+}
+
+void addRecordToQASM(Qureg qureg, RecordType type, int gate, int* controlQubits, int numControlQubits, int target, qreal* params, int numParams) {
+    
+    QASMLogger* qasmLog = qureg.qasmLog;
+    if (qasmLog->arenaFill >= qasmLog->streamThreshold)
+        streamArenaToFile(qasmLog);
+    
+    QASMRecord rec = {
+        .type = type, .gate = gate, .target = target, 
+        .numControls = (short) numControlQubits, .numParams = (short) numParams};
+    size_t ctrlBytes = numControlQubits * sizeof *controlQubits;
+    size_t paramBytes = numParams * sizeof *params;
+    
+    unsigned char* space = reserveRecordSpace(qasmLog, sizeof rec + ctrlBytes + paramBytes);
+    memcpy(space, &rec, sizeof rec);
+    if (ctrlBytes > 0)
+        memcpy(space + sizeof rec, controlQubits, ctrlBytes);
+    if (paramBytes > 0)
+        memcpy(space + sizeof rec + ctrlBytes, params, paramBytes);
+}
+
 void qasm_setup(Qureg* qureg) {
     
     // populate and attach QASM logger
@@ -66,19 +248,16 @@ void qasm_setup(Qureg* qureg) {
         bufferOverflow();
     
     qasmLog->isLogging = 0;
-    qasmLog->bufferSize = BUF_INIT_SIZE;
-    qasmLog->buffer = malloc(qasmLog->bufferSize * sizeof *(qasmLog->buffer));
-    if (qasmLog->buffer == NULL)
+    qasmLog->streamFile = NULL;
+    qasmLog->streamThreshold = STREAM_THRESHOLD;
+    qasmLog->firstChunk = malloc(sizeof *(qasmLog->firstChunk));
+    if (qasmLog->firstChunk == NULL)
         bufferOverflow();
+    qasmLog->firstChunk->next = NULL;
+    resetArena(qasmLog);
     
     // add headers and quantum / classical register creation
-    qasmLog->bufferFill = snprintf(
-        qasmLog->buffer, qasmLog->bufferSize,
-        "OPENQASM 2.0;\nqreg %s[%d];\ncreg %s[%d];\n", 
-        QUREG_LABEL, qureg->numQubitsRepresented,
-        MESREG_LABEL, qureg->numQubitsRepresented);
-    if (qasmLog->bufferFill >= qasmLog->bufferSize)
-        bufferOverflow();
+    addRecordToQASM(*qureg, RECORD_HEADER, 0, NULL, 0, qureg->numQubitsRepresented, NULL, 0);
 }
 
 void qasm_startRecording(Qureg qureg) {
@@ -89,90 +268,33 @@ void qasm_stopRecording(Qureg qureg) {
     qureg.qasmLog->isLogging = 0;
 }
 
-void addStringToQASM(Qureg qureg, char line[], int lineLen) {
-    
-    char* buf = qureg.qasmLog->buffer;
-    int bufSize = qureg.qasmLog->bufferSize;
-    int bufFill = qureg.qasmLog->bufferFill;
-    
-    // grow QASM buffer if necessary
-    if (lineLen + bufFill > bufSize) {
-                
-        int newBufSize = BUF_GROW_FAC * bufSize;
-        if (lineLen + bufFill > newBufSize)
-            bufferOverflow();
-        
-        char* newBuffer = malloc(newBufSize * sizeof *newBuffer);
-        sprintf(newBuffer, "%s", buf);
-        free(buf);
-        
-        qureg.qasmLog->bufferSize = newBufSize;
-        qureg.qasmLog->buffer = newBuffer;
-        bufSize = newBufSize;
-        buf = newBuffer;
-    }
-        
-    // add new str
-    int addedChars = snprintf(buf+bufFill, bufSize-bufFill, "%s", line);
-    qureg.qasmLog->bufferFill += addedChars;
-}
-
 void qasm_recordComment(Qureg qureg, char* comment, ...) {
     
     if (!qureg.qasmLog->isLogging)
         return;
     
-    // write formatted comment to buff
+    // comments are formatted immediately, since their arguments cannot be deferred
     va_list argp;
     va_start(argp, comment);
     char buff[MAX_LINE_LEN - 4];
     vsnprintf(buff, MAX_LINE_LEN-5, comment, argp);
     va_end(argp);
     
-    // add chars to buff, write to QASM logger
-    char line[MAX_LINE_LEN + 1]; // for trailing \0
-    int len = snprintf(line, MAX_LINE_LEN, "%s %s\n", COMMENT_PREF, buff);
-    addStringToQASM(qureg, line, len);
+    // store the chars (without the trailing \0) after the record
+    int len = strlen(buff);
+    QASMLogger* qasmLog = qureg.qasmLog;
+    if (qasmLog->arenaFill >= qasmLog->streamThreshold)
+        streamArenaToFile(qasmLog);
+    
+    QASMRecord rec = {.type = RECORD_COMMENT, .gate = 0, .target = len, .numControls = 0, .numParams = 0};
+    unsigned char* space = reserveRecordSpace(qasmLog, sizeof rec + len);
+    memcpy(space, &rec, sizeof rec);
+    memcpy(space + sizeof rec, buff, len);
 }
 
 void addGateToQASM(Qureg qureg, TargetGate gate, int* controlQubits, int numControlQubits, int targetQubit, qreal* params, int numParams) {
     
-    int len = 0;
-    char line[MAX_LINE_LEN + 1]; // for trailing \0
-    
-    // add control labels
-    for (int i=0; i < numControlQubits; i++)
-        len += snprintf(line+len, MAX_LINE_LEN-len, "%s", CTRL_LABEL_PREF);
-    
-    // add target gate
-    len += snprintf(line+len, MAX_LINE_LEN-len, "%s", qasmGateLabels[gate]);
-    
-    // add parameters
-    if (numParams > 0) {
-        len += snprintf(line+len, MAX_LINE_LEN-len, "(");
-        for (int i=0; i < numParams; i++) {
-            len += snprintf(line+len, MAX_LINE_LEN-len, REAL_QASM_FORMAT, params[i]);
-            if (i != numParams - 1)
-                len += snprintf(line+len, MAX_LINE_LEN-len, ",");
-        }
-        len += snprintf(line+len, MAX_LINE_LEN-len, ")");
-    }
-    
-    // add space
-    len += snprintf(line+len, MAX_LINE_LEN-len, " ");
-    
-    // add control qubits
-    for (int i=0; i < numControlQubits; i++)
-        len += snprintf(line+len, MAX_LINE_LEN-len, "%s[%d],", QUREG_LABEL, controlQubits[i]);
-    
-    // add target qubit, colon and newline
-    len += snprintf(line+len, MAX_LINE_LEN-len, "%s[%d];\n", QUREG_LABEL, targetQubit);
-    
-    // check whether we overflowed buffer
-    if (len >= MAX_LINE_LEN)
-        bufferOverflow();
-        
-    addStringToQASM(qureg, line, len);
+    addRecordToQASM(qureg, RECORD_GATE, gate, controlQubits, numControlQubits, targetQubit, params, numParams);
 }
 
 void qasm_recordGate(Qureg qureg, TargetGate gate, int targetQubit) {
@@ -200,7 +322,8 @@ void qasm_recordCompactUnitary(Qureg qureg, Complex alpha, Complex beta, int tar
     qreal rz2, ry, rz1;
     getZYZRotAnglesFromComplexPair(alpha, beta, &rz2, &ry, &rz1);
     
-    qreal params[3] = {rz2, ry, rz1};
+    // QASM's U(theta,phi,lambda) is Rz(phi) Ry(theta) Rz(lambda), up to global phase
+    qreal params[3] = {ry, rz2, rz1};
     addGateToQASM(qureg, GATE_UNITARY, NULL, 0, targetQubit, params, 3);
 }
 
@@ -216,7 +339,7 @@ void qasm_recordUnitary(Qureg qureg, ComplexMatrix2 u, int targetQubit) {
     qreal rz2, ry, rz1;
     getZYZRotAnglesFromComplexPair(alpha, beta, &rz2, &ry, &rz1);
     
-    qreal params[3] = {rz2, ry, rz1};
+    qreal params[3] = {ry, rz2, rz1};
     addGateToQASM(qureg, GATE_UNITARY, NULL, 0, targetQubit, params, 3);
 }
 
@@ -231,7 +354,7 @@ void qasm_recordAxisRotation(Qureg qureg, qreal angle, Vector axis, const int ta
     qreal rz2, ry, rz1;
     getZYZRotAnglesFromComplexPair(alpha, beta, &rz2, &ry, &rz1);
     
-    qreal params[3] = {rz2, ry, rz1};
+    qreal params[3] = {ry, rz2, rz1};
     addGateToQASM(qureg, GATE_UNITARY, NULL, 0, targetQubit, params, 3);
 }
 
@@ -270,7 +393,7 @@ void qasm_recordControlledCompactUnitary(Qureg qureg, Complex alpha, Complex bet
     getZYZRotAnglesFromComplexPair(alpha, beta, &rz2, &ry, &rz1);
     
     int controls[1] = {controlQubit};
-    qreal params[3] = {rz2, ry, rz1};
+    qreal params[3] = {ry, rz2, rz1};
     addGateToQASM(qureg, GATE_UNITARY, controls, 1, targetQubit, params, 3);
 }
 
@@ -288,7 +411,7 @@ void qasm_recordControlledUnitary(Qureg qureg, ComplexMatrix2 u, int controlQubi
     getZYZRotAnglesFromComplexPair(alpha, beta, &rz2, &ry, &rz1);
     
     int controls[1] = {controlQubit};
-    qreal params[3] = {rz2, ry, rz1};
+    qreal params[3] = {ry, rz2, rz1};
     addGateToQASM(qureg, GATE_UNITARY, controls, 1, targetQubit, params, 3);
     
     // add Rz
@@ -309,7 +432,7 @@ void qasm_recordControlledAxisRotation(Qureg qureg, qreal angle, Vector axis, in
     getZYZRotAnglesFromComplexPair(alpha, beta, &rz2, &ry, &rz1);
     
     int controls[1] = {controlQubit};
-    qreal params[3] = {rz2, ry, rz1};
+    qreal params[3] = {ry, rz2, rz1};
     addGateToQASM(qureg, GATE_UNITARY, controls, 1, targetQubit, params, 3);
 }
 
@@ -350,7 +473,7 @@ void qasm_recordMultiControlledUnitary(Qureg qureg, ComplexMatrix2 u, int* contr
     qreal rz2, ry, rz1;
     getZYZRotAnglesFromComplexPair(alpha, beta, &rz2, &ry, &rz1);
     
-    qreal params[3] = {rz2, ry, rz1};
+    qreal params[3] = {ry, rz2, rz1};
     addGateToQASM(qureg, GATE_UNITARY, controlQubits, numControlQubits, targetQubit, params, 3);
     
     // add Rz
@@ -390,41 +513,86 @@ void qasm_recordMultiControlledAxisRotation(Qureg qureg, qreal angle, Vector axi
     qreal rz2, ry, rz1;
     getZYZRotAnglesFromComplexPair(alpha, beta, &rz2, &ry, &rz1);
     
-    qreal params[3] = {rz2, ry, rz1};
+    qreal params[3] = {ry, rz2, rz1};
     addGateToQASM(qureg, GATE_UNITARY, controlQubits, numControlQubits, targetQubit, params, 3);
 }
 */
 
-void qasm_recordMeasurement(Qureg qureg, const int measureQubit) {
+void qasm_recordQubitPermutation(Qureg qureg, int* perm) {
 
     if (!qureg.qasmLog->isLogging)
         return;
+
+    qasm_recordComment(qureg, "Here, the qubits were permuted, as effected by the following swaps");
+
+    // record the swaps which bring each qubit (in turn) into its permuted position
+    int numQb = qureg.numQubitsRepresented;
+    int qubitAt[8*sizeof(long long int)];
+    for (int p=0; p < numQb; p++)
+        qubitAt[p] = p;
+
+    for (int q=0; q < numQb; q++) {
+        int p = 0;
+        while (qubitAt[p] != q)
+            p++;
+        if (p != perm[q]) {
+            int other = qubitAt[perm[q]];
+            qubitAt[perm[q]] = q;
+            qubitAt[p] = other;
+            qasm_recordControlledGate(qureg, GATE_SWAP, p, perm[q]);
+        }
+    }
+}
+
+void qasm_recordQFT(Qureg qureg, int* qubits, int numQubits, int isInverse) {
+
+    if (!qureg.qasmLog->isLogging)
+        return;
+
+    qasm_recordComment(qureg, "Here, a %d-qubit %sQFT was performed, as effected by the following gates", 
+        numQubits, (isInverse)? "inverse " : "");
     
-    char line[MAX_LINE_LEN + 1]; // for trailing \0
-    int len = snprintf(
-        line, MAX_LINE_LEN, "%s %s[%d] -> %s[%d];\n",
-        MEASURE_CMD, QUREG_LABEL, measureQubit, MESREG_LABEL, measureQubit);
+    // the inverse circuit is the reverse of the QFT circuit, with negated phases
+    if (isInverse)
+        for (int i=0; i < numQubits/2; i++)
+            qasm_recordControlledGate(qureg, GATE_SWAP, qubits[i], qubits[numQubits-1-i]);
+
+    for (int n=0; n < numQubits; n++) {
+        int t = (isInverse)? n : numQubits-1-n;
         
-    // check whether we overflowed buffer
-    if (len >= MAX_LINE_LEN)
-        bufferOverflow();
+        if (!isInverse)
+            qasm_recordGate(qureg, GATE_HADAMARD, qubits[t]);
+        
+        for (int m=0; m < t; m++) {
+            int c = (isInverse)? m : t-1-m;
+            qreal angle = QUEST_PI / (1LL << (t-c));
+            qasm_recordControlledParamGate(qureg, GATE_PHASE_SHIFT, qubits[c], qubits[t], 
+                (isInverse)? -angle : angle);
+        }
+        
+        if (isInverse)
+            qasm_recordGate(qureg, GATE_HADAMARD, qubits[t]);
+    }
     
-    addStringToQASM(qureg, line, len);
+    if (!isInverse)
+        for (int i=0; i < numQubits/2; i++)
+            qasm_recordControlledGate(qureg, GATE_SWAP, qubits[i], qubits[numQubits-1-i]);
 }
 
-void qasm_recordInitZero(Qureg qureg) {
-    
+void qasm_recordMeasurement(Qureg qureg, const int measureQubit) {
+
     if (!qureg.qasmLog->isLogging)
         return;
     
-    char line[MAX_LINE_LEN + 1]; // for trailing \0
-    int len = snprintf(line, MAX_LINE_LEN, "%s %s;\n", INIT_ZERO_CMD, QUREG_LABEL);
+    addRecordToQASM(qureg, RECORD_MEASURE, 0, NULL, 0, measureQubit, NULL, 0);
+}
+
+void qasm_recordInitZero(Qureg qureg) {
     
-    // check whether we overflowed buffer
-    if (len >= MAX_LINE_LEN)
-        bufferOverflow();
+    if (!qureg.qasmLog->isLogging)
+        return;
     
-    addStringToQASM(qureg, line, len);
+    addRecordToQASM(qureg, RECORD_INIT_ZERO, 0, NULL, 0, 0, NULL, 0);
 }
 
 void qasm_recordInitPlus(Qureg qureg) {
@@ -433,19 +601,12 @@ void qasm_recordInitPlus(Qureg qureg) {
         return;
     
     // add an explanatory comment
-    char buf[MAX_LINE_LEN+1];
-    sprintf(buf, "Initialising state |+>");
-    qasm_recordComment(qureg, buf);
+    qasm_recordComment(qureg, "Initialising state |+>");
     
     // it's valid QASM to h the register (I think)
     // |+> = H |0>
     qasm_recordInitZero(qureg);
-    int charsWritten = snprintf(
-        buf, MAX_LINE_LEN, "%s %s;\n", 
-        qasmGateLabels[GATE_HADAMARD], QUREG_LABEL);
-    if (charsWritten >= MAX_LINE_LEN)
-        bufferOverflow();
-    addStringToQASM(qureg, buf, charsWritten);
+    addRecordToQASM(qureg, RECORD_REGISTER_GATE, GATE_HADAMARD, NULL, 0, 0, NULL, 0);
     
     // old code (before above QASM shortcut)
     /*
@@ -476,13 +637,36 @@ void qasm_recordInitClassical(Qureg qureg, long long int stateInd) {
 
 void qasm_clearRecorded(Qureg qureg) {
     
-    // maintains current buffer size
-    (qureg.qasmLog->buffer)[0] = '\0';
-    qureg.qasmLog->bufferFill = 0;
+    // maintains current arena size; the temporary stream file is deleted when closed
+    QASMLogger* qasmLog = qureg.qasmLog;
+    if (qasmLog->streamFile != NULL)
+        fclose(qasmLog->streamFile);
+    qasmLog->streamFile = NULL;
+    qasmLog->streamThreshold = STREAM_THRESHOLD;
+    resetArena(qasmLog);
+}
+
+/** writes all QASM so far recorded to file, including that already streamed */
+void writeRecordedToQASM(Qureg qureg, FILE* file) {
+    
+    QASMLogger* qasmLog = qureg.qasmLog;
+    FILE* stream = qasmLog->streamFile;
+    if (stream != NULL) {
+        char buf[COPY_BUF_SIZE];
+        size_t numRead;
+        rewind(stream);
+        while ((numRead = fread(buf, 1, COPY_BUF_SIZE, stream)) > 0)
+            fwrite(buf, 1, numRead, file);
+        
+        // subsequently streamed records are appended
+        fseek(stream, 0, SEEK_END);
+    }
+    
+    writeArenaToQASM(qasmLog, file);
 }
 
 void qasm_printRecorded(Qureg qureg) {
-    printf("%s", qureg.qasmLog->buffer);
+    writeRecordedToQASM(qureg, stdout);
 }
 
 /** returns success of file write */
@@ -492,13 +676,22 @@ int qasm_writeRecordedToFile(Qureg qureg, char* filename) {
     if (file == NULL)
         return 0;
     
-    fprintf(file, "%s", qureg.qasmLog->buffer);
+    writeRecordedToQASM(qureg, file);
     fclose(file);
     return 1;
 }
 
 void qasm_free(Qureg qureg) {
     
-    free(qureg.qasmLog->buffer);
-    free(qureg.qasmLog);
+    QASMLogger* qasmLog = qureg.qasmLog;
+    if (qasmLog->streamFile != NULL)
+        fclose(qasmLog->streamFile);
+    
+    struct QASMChunk* chunk = qasmLog->firstChunk;
+    while (chunk != NULL) {
+        struct QASMChunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    free(qasmLog);
 }
@@ -73,6 +73,10 @@ void qasm_recordMultiStateControlledUnitary(Qureg qureg, ComplexMatrix2 u, int*
 void qasm_recordMultiControlledAxisRotation(Qureg qureg, qreal angle, Vector axis, int* controlQubits, const int numControlQubits, const int targetQubit);\
 */
 
+void qasm_recordQubitPermutation(Qureg qureg, int* perm);
+
+void qasm_recordQFT(Qureg qureg, int* qubits, int numQubits, int isInverse);
+
 void qasm_recordMeasurement(Qureg qureg, const int measureQubit);
 
 void qasm_recordInitZero(Qureg qureg);
@@ -73,7 +73,32 @@ typedef enum {
     E_INVALID_NUM_TWO_QUBIT_KRAUS_OPS,
     E_INVALID_NUM_N_QUBIT_KRAUS_OPS,
     E_INVALID_KRAUS_OPS,
-    E_MISMATCHING_NUM_TARGS_KRAUS_SIZE
+    E_MISMATCHING_NUM_TARGS_KRAUS_SIZE,
+    E_INVALID_QUBIT_PERMUTATION,
+    E_INVALID_TROTTER_ORDER,
+    E_INVALID_TROTTER_REPS,
+    E_DIAGONAL_OP_NOT_INITIALISED,
+    E_INVALID_NUM_DIAGONAL_OP_QUBITS,
+    E_DISTRIB_DIAGONAL_OP_TOO_SMALL,
+    E_MISMATCHING_QUREG_DIAGONAL_OP_SIZE,
+    E_INVALID_DIAGONAL_OP_ELEM_INDEX,
+    E_INVALID_NUM_DIAGONAL_OP_ELEMS,
+    E_INVALID_OFFSET_NUM_DIAGONAL_OP_ELEMS,
+    E_INVALID_BIT_ENCODING,
+    E_INVALID_NUM_PHASE_FUNC_TERMS,
+    E_INVALID_NUM_PHASE_FUNC_OVERRIDES,
+    E_INVALID_PHASE_FUNC_OVERRIDE_UNSIGNED_INDEX,
+    E_INVALID_PHASE_FUNC_OVERRIDE_TWOS_COMPLEMENT_INDEX,
+    E_NEGATIVE_EXPONENT_WITHOUT_ZERO_OVERRIDE,
+    E_FRACTIONAL_EXPONENT_WITH_TWOS_COMPLEMENT,
+    E_INVALID_QUREG_FILE,
+    E_MISMATCHING_QUREG_FILE,
+    E_AMBIGUOUS_QUREG_FILE,
+    E_CANNOT_CREATE_DISK_QUREG,
+    E_INVALID_NUM_QUREGS,
+    E_INVALID_GROUND_STATE_TOLERANCE,
+    E_ZERO_NORM_QUREG,
+    E_GROUND_STATE_NOT_CONVERGED
 } ErrorCode;
 
 static const char* errorMessages[] = {
@@ -123,7 +148,32 @@ static const char* errorMessages[] = {
     [E_INVALID_NUM_TWO_QUBIT_KRAUS_OPS] = "At least 1 and at most 16 two-qubit Kraus operators may be specified.",
     [E_INVALID_NUM_N_QUBIT_KRAUS_OPS] = "At least 1 and at most 4*N^2 of N-qubit Kraus operators may be specified.",
     [E_INVALID_KRAUS_OPS] = "The specified Kraus map is not a completely positive, trace preserving map.",
-    [E_MISMATCHING_NUM_TARGS_KRAUS_SIZE] = "Every Kraus operator must be of the same number of qubits as the number of targets."
+    [E_MISMATCHING_NUM_TARGS_KRAUS_SIZE] = "Every Kraus operator must be of the same number of qubits as the number of targets.",
+    [E_INVALID_QUBIT_PERMUTATION] = "Invalid qubit permutation. Must contain every qubit index in [0, numQubits) exactly once.",
+    [E_INVALID_TROTTER_ORDER] = "Invalid Trotterisation order. Must be 1, or a positive even number (e.g. 2 or 4).",
+    [E_INVALID_TROTTER_REPS] = "Invalid number of Trotterisation repetitions. Must be >=1.",
+    [E_DIAGONAL_OP_NOT_INITIALISED] = "The diagonal operator has not been initialised through createDiagonalOp().",
+    [E_INVALID_NUM_DIAGONAL_OP_QUBITS] = "Invalid number of qubits. Diagonal operators must act upon >0 qubits.",
+    [E_DISTRIB_DIAGONAL_OP_TOO_SMALL] = "Too few qubits. The created diagonal operator would contain fewer elements than there are nodes, so cannot be distributed.",
+    [E_MISMATCHING_QUREG_DIAGONAL_OP_SIZE] = "The qureg must represent an equal number of qubits as that in the applied diagonal operator.",
+    [E_INVALID_DIAGONAL_OP_ELEM_INDEX] = "Invalid element index. Must be >=0 and <2^numQubits.",
+    [E_INVALID_NUM_DIAGONAL_OP_ELEMS] = "Invalid number of elements. Must be >=0 and <=2^numQubits.",
+    [E_INVALID_OFFSET_NUM_DIAGONAL_OP_ELEMS] = "More elements given than exist in the diagonal operator from the given starting index.",
+    [E_INVALID_BIT_ENCODING] = "Invalid bit encoding. Must be one of {UNSIGNED, TWOS_COMPLEMENT}.",
+    [E_INVALID_NUM_PHASE_FUNC_TERMS] = "Invalid number of terms in the phase function. Must be >0.",
+    [E_INVALID_NUM_PHASE_FUNC_OVERRIDES] = "Invalid number of phase function overrides. Must be >=0.",
+    [E_INVALID_PHASE_FUNC_OVERRIDE_UNSIGNED_INDEX] = "Invalid phase function override index, in the UNSIGNED encoding. Must be >=0, and <2^numQubits.",
+    [E_INVALID_PHASE_FUNC_OVERRIDE_TWOS_COMPLEMENT_INDEX] = "Invalid phase function override index, in the TWOS_COMPLEMENT encoding. Must be >=-2^(numQubits-1), and <2^(numQubits-1).",
+    [E_NEGATIVE_EXPONENT_WITHOUT_ZERO_OVERRIDE] = "The phase function contained a negative exponent which would diverge at zero, but the zero index was not overridden.",
+    [E_FRACTIONAL_EXPONENT_WITH_TWOS_COMPLEMENT] = "The phase function contained a fractional exponent, which is not permitted in the TWOS_COMPLEMENT encoding, since negative values would give complex phases.",
+    [E_INVALID_QUREG_FILE] = "The file is not a complete checkpoint written by saveQureg (of this version and byte order, and of a precision supported by this machine).",
+    [E_MISMATCHING_QUREG_FILE] = "The checkpoint was saved from a qureg of a different number of qubits, or type (state-vector or density matrix).",
+    [E_AMBIGUOUS_QUREG_FILE] = "Both a single-file and a distributed (_rank_N) checkpoint exist with this name. Remove or rename one.",
+    [E_CANNOT_CREATE_DISK_QUREG] = "Could not create, reserve space for, or memory-map the file backing the Qureg. Check the path is writable and the disk has space for the amplitudes. Disk-backed registers are not supported on Windows, nor in GPU mode.",
+    [E_INVALID_NUM_QUREGS] = "Invalid number of quregs. Must be >0.",
+    [E_INVALID_GROUND_STATE_TOLERANCE] = "Invalid ground-state tolerance. Must be >0.",
+    [E_ZERO_NORM_QUREG] = "The Qureg has zero norm (every amplitude is zero), so cannot be used as a starting state.",
+    [E_GROUND_STATE_NOT_CONVERGED] = "The ground state did not converge to within the tolerance, after the maximum number of Lanczos restarts. The Qureg holds the final approximation. Try a larger tolerance."
 };
 
 /* QuESTlink defines invalidQuESTInputError, so it doesn't need to be weakly 
@@ -306,6 +356,12 @@ void validateMultiControls(Qureg qureg, int* controlQubits, const int numControl
     QuESTAssert(areUniqueQubits(controlQubits, numControlQubits), E_CONTROLS_NOT_UNIQUE, caller);
 }
 
+void validateQubitPermutation(Qureg qureg, int* perm, const char* caller) {
+    for (int q=0; q < qureg.numQubitsRepresented; q++)
+        QuESTAssert(perm[q]>=0 && perm[q]<qureg.numQubitsRepresented, E_INVALID_QUBIT_PERMUTATION, caller);
+    QuESTAssert(areUniqueQubits(perm, qureg.numQubitsRepresented), E_INVALID_QUBIT_PERMUTATION, caller);
+}
+
 void validateMultiQubits(Qureg qureg, int* qubits, const int numQubits, const char* caller) {
     QuESTAssert(numQubits>0 && numQubits<=qureg.numQubitsRepresented, E_INVALID_NUM_QUBITS, caller);
     for (int i=0; i < numQubits; i++)
@@ -393,6 +449,10 @@ void validateMatchingQuregDims(Qureg qureg1, Qureg qureg2, const char *caller) {
     QuESTAssert(qureg1.numQubitsRepresented==qureg2.numQubitsRepresented, E_MISMATCHING_QUREG_DIMENSIONS, caller);
 }
 
+void validateNumQuregs(int numQuregs, const char *caller) {
+    QuESTAssert(numQuregs > 0, E_INVALID_NUM_QUREGS, caller);
+}
+
 void validateMatchingQuregTypes(Qureg qureg1, Qureg qureg2, const char *caller) {
     QuESTAssert(qureg1.isDensityMatrix==qureg2.isDensityMatrix, E_MISMATCHING_QUREG_TYPES, caller);
 }
@@ -405,6 +465,22 @@ void validateFileOpened(int found, const char* caller) {
     QuESTAssert(found, E_CANNOT_OPEN_FILE, caller);
 }
 
+void validateQuregFile(int valid, const char* caller) {
+    QuESTAssert(valid, E_INVALID_QUREG_FILE, caller);
+}
+
+void validateMatchingQuregFile(int matches, const char* caller) {
+    QuESTAssert(matches, E_MISMATCHING_QUREG_FILE, caller);
+}
+
+void validateUnambiguousQuregFile(int unambiguous, const char* caller) {
+    QuESTAssert(unambiguous, E_AMBIGUOUS_QUREG_FILE, caller);
+}
+
+void validateDiskQureg(int created, const char* caller) {
+    QuESTAssert(created, E_CANNOT_CREATE_DISK_QUREG, caller);
+}
+
 void validateProb(qreal prob, const char* caller) {
     QuESTAssert(prob >= 0 && prob <= 1, E_INVALID_PROB, caller);
 }
@@ -466,6 +542,89 @@ void validateNumPauliSumTerms(int numTerms, const char* caller) {
     QuESTAssert(numTerms > 0, E_INVALID_NUM_SUM_TERMS, caller);
 }
 
+void validateGroundStateTolerance(qreal tolerance, const char* caller) {
+    QuESTAssert(tolerance > 0, E_INVALID_GROUND_STATE_TOLERANCE, caller);
+}
+
+void validateNonZeroNorm(qreal totalProb, const char* caller) {
+    QuESTAssert(totalProb > 0, E_ZERO_NORM_QUREG, caller);
+}
+
+void validateGroundStateConverged(qreal residual, qreal tolerance, const char* caller) {
+    QuESTAssert(residual <= tolerance, E_GROUND_STATE_NOT_CONVERGED, caller);
+}
+
+void validateTrotterParams(int order, int reps, const char* caller) {
+    int isEven = (order % 2) == 0;
+    QuESTAssert(order > 0 && (isEven || order==1), E_INVALID_TROTTER_ORDER, caller);
+    QuESTAssert(reps > 0, E_INVALID_TROTTER_REPS, caller);
+}
+
+void validateDiagOpInit(DiagonalOp op, const char* caller) {
+    QuESTAssert(op.real != NULL && op.imag != NULL, E_DIAGONAL_OP_NOT_INITIALISED, caller);
+}
+
+void validateCreateNumDiagOpQubits(int numQubits, int numRanks, const char* caller) {
+    QuESTAssert(numQubits>0, E_INVALID_NUM_DIAGONAL_OP_QUBITS, caller);
+    QuESTAssert((1LL << numQubits) >= numRanks, E_DISTRIB_DIAGONAL_OP_TOO_SMALL, caller);
+}
+
+void validateDiagonalOp(Qureg qureg, DiagonalOp op, const char* caller) {
+    validateDiagOpInit(op, caller);
+    QuESTAssert(qureg.numQubitsRepresented == op.numQubits, E_MISMATCHING_QUREG_DIAGONAL_OP_SIZE, caller);
+}
+
+void validateNumDiagOpElems(DiagonalOp op, long long int startInd, long long int numElems, const char* caller) {
+    long long int numElemsTotal = 1LL << op.numQubits;
+    QuESTAssert(startInd >= 0 && startInd < numElemsTotal, E_INVALID_DIAGONAL_OP_ELEM_INDEX, caller);
+    QuESTAssert(numElems >= 0 && numElems <= numElemsTotal, E_INVALID_NUM_DIAGONAL_OP_ELEMS, caller);
+    QuESTAssert(numElems + startInd <= numElemsTotal, E_INVALID_OFFSET_NUM_DIAGONAL_OP_ELEMS, caller);
+}
+
+void validateBitEncoding(enum bitEncoding encoding, const char* caller) {
+    QuESTAssert(encoding == UNSIGNED || encoding == TWOS_COMPLEMENT, E_INVALID_BIT_ENCODING, caller);
+}
+
+void validatePhaseFuncOverrides(int numQubits, enum bitEncoding encoding, long long int* overrideInds, int numOverrides, const char* caller) {
+    QuESTAssert(numOverrides >= 0, E_INVALID_NUM_PHASE_FUNC_OVERRIDES, caller);
+    
+    if (encoding == UNSIGNED) {
+        long long int maxInd = (1LL << numQubits) - 1;
+        for (int i=0; i<numOverrides; i++)
+            QuESTAssert(overrideInds[i] >= 0 && overrideInds[i] <= maxInd, E_INVALID_PHASE_FUNC_OVERRIDE_UNSIGNED_INDEX, caller);
+    }
+    else {
+        long long int maxInd = (1LL << (numQubits-1)) - 1;
+        long long int minInd = - (1LL << (numQubits-1));
+        for (int i=0; i<numOverrides; i++)
+            QuESTAssert(overrideInds[i] >= minInd && overrideInds[i] <= maxInd, E_INVALID_PHASE_FUNC_OVERRIDE_TWOS_COMPLEMENT_INDEX, caller);
+    }
+}
+
+void validatePhaseFuncTerms(enum bitEncoding encoding, qreal* exponents, int numTerms, long long int* overrideInds, int numOverrides, const char* caller) {
+    QuESTAssert(numTerms > 0, E_INVALID_NUM_PHASE_FUNC_TERMS, caller);
+    
+    int hasNegExp = 0;
+    int hasFracExp = 0;
+    for (int t=0; t<numTerms; t++) {
+        if (exponents[t] < 0)
+            hasNegExp = 1;
+        if (exponents[t] != floor(exponents[t]))
+            hasFracExp = 1;
+    }
+    
+    // a negative exponent diverges at x=0, unless it is overridden
+    if (hasNegExp) {
+        int zeroIsOverridden = 0;
+        for (int i=0; i<numOverrides; i++)
+            if (overrideInds[i] == 0)
+                zeroIsOverridden = 1;
+        QuESTAssert(zeroIsOverridden, E_NEGATIVE_EXPONENT_WITHOUT_ZERO_OVERRIDE, caller);
+    }
+    
+    QuESTAssert(!(hasFracExp && encoding == TWOS_COMPLEMENT), E_FRACTIONAL_EXPONENT_WITH_TWOS_COMPLEMENT, caller);
+}
+
 void validateOneQubitKrausMap(Qureg qureg, ComplexMatrix2* ops, int numOps, const char* caller) {
     int opNumQubits = 1;
     int superOpNumQubits = 2*opNumQubits;
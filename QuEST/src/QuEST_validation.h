@@ -31,6 +31,8 @@ void validateUniqueTargets(Qureg qureg, int qubit1, int qubit2, const char* call
 
 void validateMultiQubits(Qureg qureg, int* qubits, const int numQubits, const char* caller);
 
+void validateQubitPermutation(Qureg qureg, int* perm, const char* caller);
+
 void validateMultiTargets(Qureg qurge, int* targetQubits, const int numTargetQubits, const char* caller);
 
 void validateMultiControls(Qureg qureg, int* controlQubits, const int numControlQubits, const char* caller);
@@ -63,6 +65,8 @@ void validateMeasurementProb(qreal prob, const char* caller);
 
 void validateMatchingQuregDims(Qureg qureg1, Qureg qureg2, const char *caller);
 
+void validateNumQuregs(int numQuregs, const char *caller);
+
 void validateMatchingQuregTypes(Qureg qureg1, Qureg qureg2, const char *caller);
 
 void validateSecondQuregStateVec(Qureg qureg2, const char *caller);
@@ -71,6 +75,14 @@ void validateNumAmps(Qureg qureg, long long int startInd, long long int numAmps,
 
 void validateFileOpened(int opened, const char* caller);
 
+void validateQuregFile(int valid, const char* caller);
+
+void validateMatchingQuregFile(int matches, const char* caller);
+
+void validateUnambiguousQuregFile(int unambiguous, const char* caller);
+
+void validateDiskQureg(int created, const char* caller);
+
 void validateProb(qreal prob, const char* caller);
 
 void validateNormProbs(qreal prob1, qreal prob2, const char* caller);
@@ -89,6 +101,28 @@ void validatePauliCodes(enum pauliOpType* pauliCodes, int numPauliCodes, const c
 
 void validateNumPauliSumTerms(int numTerms, const char* caller);
 
+void validateTrotterParams(int order, int reps, const char* caller);
+
+void validateGroundStateTolerance(qreal tolerance, const char* caller);
+
+void validateNonZeroNorm(qreal totalProb, const char* caller);
+
+void validateGroundStateConverged(qreal residual, qreal tolerance, const char* caller);
+
+void validateDiagOpInit(DiagonalOp op, const char* caller);
+
+void validateCreateNumDiagOpQubits(int numQubits, int numRanks, const char* caller);
+
+void validateDiagonalOp(Qureg qureg, DiagonalOp op, const char* caller);
+
+void validateNumDiagOpElems(DiagonalOp op, long long int startInd, long long int numElems, const char* caller);
+
+void validateBitEncoding(enum bitEncoding encoding, const char* caller);
+
+void validatePhaseFuncOverrides(int numQubits, enum bitEncoding encoding, long long int* overrideInds, int numOverrides, const char* caller);
+
+void validatePhaseFuncTerms(enum bitEncoding encoding, qreal* exponents, int numTerms, long long int* overrideInds, int numOverrides, const char* caller);
+
 void validateMatrixInit(ComplexMatrixN matr, const char* caller);
 
 void validateOneQubitKrausMap(Qureg qureg, ComplexMatrix2* ops, int numOps, const char* caller);